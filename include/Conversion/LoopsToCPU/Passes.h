@@ -0,0 +1,38 @@
+#ifndef CONVERSION_LOOPSTOCPU_PASSES_H
+#define CONVERSION_LOOPSTOCPU_PASSES_H
+
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/Pass/Pass.h"
+#include <memory>
+
+namespace mlir {
+
+class Pass;
+
+/// Create a pass that replaces the gpu allocations introduced by the stencil
+/// to standard lowering by host allocations
+std::unique_ptr<OperationPass<FuncOp>> createHostAllocationsPass();
+
+/// Create a pass that vectorizes the unit-stride dimension of the innermost
+/// parallel loops using the given vector width
+std::unique_ptr<OperationPass<FuncOp>> createVectorizeInnerLoopsPass();
+std::unique_ptr<OperationPass<FuncOp>>
+createVectorizeInnerLoopsPass(unsigned vectorWidth);
+
+/// Create a pass that distributes the iterations of the outermost parallel
+/// loops to the threads of an OpenMP parallel region
+std::unique_ptr<OperationPass<ModuleOp>> createParallelLoopsToOpenMPPass();
+
+void registerStencilToCPUPipeline();
+
+//===----------------------------------------------------------------------===//
+// Registration
+//===----------------------------------------------------------------------===//
+
+/// Generate the code for registering passes.
+#define GEN_PASS_REGISTRATION
+#include "Conversion/LoopsToCPU/Passes.h.inc"
+
+} // namespace mlir
+
+#endif // CONVERSION_LOOPSTOCPU_PASSES_H
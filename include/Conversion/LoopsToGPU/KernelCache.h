@@ -0,0 +1,22 @@
+#ifndef CONVERSION_LOOPSTOGPU_KERNELCACHE_H
+#define CONVERSION_LOOPSTOGPU_KERNELCACHE_H
+
+#include "mlir/Conversion/GPUCommon/GPUCommonPass.h"
+#include "mlir/Support/LLVM.h"
+#include "llvm/ADT/StringRef.h"
+
+namespace mlir {
+
+/// Environment variable setting the directory of the compiled kernel cache
+/// (caching is disabled if the variable is not set)
+constexpr char kernelCacheDirEnv[] = "OEC_KERNEL_CACHE_DIR";
+
+/// Wrap a blob generator with an on-disk cache that stores the blobs by a
+/// hash of the generator input, the target triple, chip, and features
+BlobGenerator createCachedBlobGenerator(BlobGenerator blobGenerator,
+                                        StringRef triple, StringRef targetChip,
+                                        StringRef features);
+
+} // namespace mlir
+
+#endif // CONVERSION_LOOPSTOGPU_KERNELCACHE_H
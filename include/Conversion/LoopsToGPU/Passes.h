@@ -2,9 +2,11 @@
 #define CONVERSION_LOOPSTOGPU_PASSES_H
 
 #include "mlir/Conversion/GPUCommon/GPUCommonPass.h"
+#include "mlir/Dialect/GPU/GPUDialect.h"
 #include "mlir/IR/BuiltinOps.h"
 #include "mlir/Pass/Pass.h"
 #include "llvm/ADT/StringRef.h"
+#include <cstdint>
 #include <memory>
 #include <string>
 
@@ -12,9 +14,42 @@ namespace mlir {
 
 class Pass;
 
+/// Create a pass that promotes workgroup memory allocations of the kernels
+/// to workgroup memory attributions
+std::unique_ptr<OperationPass<gpu::GPUModuleOp>>
+createPromoteWorkgroupAllocationsPass();
+
+/// Create a pass that executes the kernels asynchronously and places
+/// independent kernels on separate streams
+std::unique_ptr<OperationPass<ModuleOp>> createStreamAssignmentPass();
+
+/// Create a pass that adds entry points taking bare device pointers, sizes,
+/// strides, and a caller-owned stream to the lowered host functions
+std::unique_ptr<OperationPass<ModuleOp>> createCallerStreamEntryPointsPass();
+
+/// Attribute storing the maximal number of threads per block of a kernel
+constexpr char kernelMaxThreadsAttrName[] = "stencil.max_threads";
+
+/// Create a pass that annotates the kernels with the maximal number of
+/// threads of their launches, warns about block sizes that are not a multiple
+/// of the wavefront size, and checks the workgroup memory of the kernels fits
+/// the target (a workgroup memory size of zero disables the check)
+std::unique_ptr<OperationPass<ModuleOp>> createKernelLaunchBoundsPass();
+std::unique_ptr<OperationPass<ModuleOp>>
+createKernelLaunchBoundsPass(unsigned wavefrontSize,
+                             int64_t workgroupMemorySize);
+
 void registerGPUToCUBINPipeline();
 void registerGPUToHSACOPipeline();
 
+//===----------------------------------------------------------------------===//
+// Registration
+//===----------------------------------------------------------------------===//
+
+/// Generate the code for registering passes.
+#define GEN_PASS_REGISTRATION
+#include "Conversion/LoopsToGPU/Passes.h.inc"
+
 } // namespace mlir
 
 #endif // CONVERSION_LOOPSTOGPU_PASSES_H
@@ -1,7 +1,9 @@
 #ifndef CONVERSION_STENCILTOSTANDARD_CONVERTSTENCILTOSTANDARD_H
 #define CONVERSION_STENCILTOSTANDARD_CONVERTSTENCILTOSTANDARD_H
 
+#include "Dialect/Stencil/StencilDialect.h"
 #include "Dialect/Stencil/StencilOps.h"
+#include "Dialect/Stencil/StencilTypes.h"
 #include "mlir/IR/MLIRContext.h"
 #include "mlir/Support/LLVM.h"
 #include "mlir/Transforms/DialectConversion.h"
@@ -11,18 +13,59 @@
 namespace mlir {
 namespace stencil {
 
+/// Options controlling the stencil to standard lowering
+struct StencilToStdOptions {
+  /// Tile sizes used to stage the apply op inputs in workgroup memory
+  /// (staging is disabled if no tile sizes are set)
+  Index tileSizes;
+
+  /// Lower the vertical dimension to a sequential loop and keep the vertical
+  /// neighbors in registers
+  bool verticalCaching = false;
+
+  /// Stage the inputs accessed at dynamic offsets in workgroup memory
+  /// (assumes the dynamic offsets are within the bounds of the accesses)
+  bool stageDynAccess = false;
+
+  /// Workgroup memory in bytes available to stage the inputs of an apply op
+  /// (the inputs exceeding the budget are not staged and the budget is not
+  /// limited if the size is zero)
+  int64_t workgroupMemorySize = 0;
+
+  /// Order of the memref dimensions from the unit-stride to the outermost
+  /// dimension (the default order stores the i dimension contiguously)
+  SmallVector<unsigned, 3> dimensionOrder = {kIDimension, kJDimension,
+                                             kKDimension};
+
+  /// Alignment in bytes of the unit-stride dimension of the buffers
+  /// (padding is disabled if the alignment is zero)
+  int64_t leadingDimAlignment = 0;
+
+  /// Number of ensemble members computed by every apply op (the memrefs get
+  /// an outer ensemble dimension if the ensemble size is non-zero)
+  int64_t ensembleSize = 0;
+
+  /// Return the allocated dimensions ordered from outermost to unit-stride
+  SmallVector<unsigned, 3> getMemRefDims(ArrayRef<bool> allocation) const;
+};
+
 /// Convert stencil types to standard types
 struct StencilTypeConverter : public TypeConverter {
   using TypeConverter::TypeConverter;
 
   /// Create a stencil type converter using the default conversions
-  StencilTypeConverter(MLIRContext *context);
+  StencilTypeConverter(MLIRContext *context,
+                       const StencilToStdOptions &options);
 
   /// Return the context
   MLIRContext *getContext() { return context; }
 
+  /// Compute the memref shape of a field or temp using the dimension order
+  SmallVector<int64_t, 3> getMemRefShape(GridType type) const;
+
 private:
   MLIRContext *context;
+  const StencilToStdOptions &options;
 };
 
 /// Base class for the stencil to standard operation conversions
@@ -32,11 +75,14 @@ public:
       StringRef rootOpName, StencilTypeConverter &typeConverter,
       DenseMap<Value, Index> &valueToLB,
       DenseMap<Value, SmallVector<OpOperand *, 10>> &valueToReturnOpOperands,
-      PatternBenefit benefit = 1);
+      const StencilToStdOptions &options, PatternBenefit benefit = 1);
 
   // Return the induction variables of the parent loop nest
   SmallVector<Value, 3> getInductionVars(Operation *operation) const;
 
+  /// Return the ensemble member index of the parent loop nest
+  Value getEnsembleMember(Operation *operation) const;
+
   /// Compute the shape of the operation
   Index computeShape(ShapeOp shapeOp) const;
 
@@ -69,6 +115,9 @@ protected:
 
   /// Map the result values to the return op operand
   DenseMap<Value, SmallVector<OpOperand *, 10>> &valueToReturnOpOperands;
+
+  /// Options of the lowering
+  const StencilToStdOptions &options;
 };
 
 /// Helper class to implement patterns that match one source operation
@@ -78,16 +127,16 @@ public:
   StencilOpToStdPattern(
       StencilTypeConverter &typeConverter, DenseMap<Value, Index> &valueToLB,
       DenseMap<Value, SmallVector<OpOperand *, 10>> &valueToReturnOpOperands,
-      PatternBenefit benefit = 1)
+      const StencilToStdOptions &options, PatternBenefit benefit = 1)
       : StencilToStdPattern(OpTy::getOperationName(), typeConverter, valueToLB,
-                            valueToReturnOpOperands, benefit) {}
+                            valueToReturnOpOperands, options, benefit) {}
 };
 
 /// Helper method to populate the conversion pattern list
 void populateStencilToStdConversionPatterns(
     StencilTypeConverter &typeConveter, DenseMap<Value, Index> &valueToLB,
     DenseMap<Value, SmallVector<OpOperand *, 10>> &valueToReturnOpOperands,
-    OwningRewritePatternList &patterns);
+    const StencilToStdOptions &options, OwningRewritePatternList &patterns);
 
 } // namespace stencil
 } // namespace mlir
@@ -1,6 +1,7 @@
 #ifndef CONVERSION_STENCILTOSTANDARD_PASSES_H
 #define CONVERSION_STENCILTOSTANDARD_PASSES_H
 
+#include "mlir/IR/BuiltinOps.h"
 #include "mlir/Pass/Pass.h"
 
 namespace mlir {
@@ -9,6 +10,12 @@ class Pass;
 
 std::unique_ptr<Pass> createConvertStencilToStandardPass();
 
+std::unique_ptr<OperationPass<ModuleOp>> createMemoryPlanningPass();
+
+std::unique_ptr<OperationPass<ModuleOp>> createInstrumentationPass();
+
+std::unique_ptr<OperationPass<ModuleOp>> createSummaryPass();
+
 //===----------------------------------------------------------------------===//
 // Registration
 //===----------------------------------------------------------------------===//
@@ -1,7 +1,7 @@
 #ifndef DIALECT_STENCIL_PASSES_H
 #define DIALECT_STENCIL_PASSES_H
 
-
+#include "mlir/IR/BuiltinOps.h"
 #include "mlir/Pass/Pass.h"
 
 namespace mlir {
@@ -10,10 +10,16 @@ std::unique_ptr<OperationPass<FuncOp>> createDomainSplitPass();
 
 std::unique_ptr<OperationPass<FuncOp>> createStencilInliningPass();
 
+std::unique_ptr<OperationPass<FuncOp>> createKernelFusionPass();
+
 std::unique_ptr<OperationPass<FuncOp>> createStencilUnrollingPass();
 
 std::unique_ptr<OperationPass<FuncOp>> createCombineToIfElsePass();
 
+std::unique_ptr<OperationPass<FuncOp>> createInteriorSplitPass();
+
+std::unique_ptr<OperationPass<ModuleOp>> createPrecisionPolicyPass();
+
 std::unique_ptr<OperationPass<FuncOp>> createShapeInferencePass();
 
 std::unique_ptr<OperationPass<FuncOp>> createShapeOverlapPass();
@@ -22,6 +28,14 @@ std::unique_ptr<OperationPass<FuncOp>> createStorageMaterializationPass();
 
 std::unique_ptr<OperationPass<FuncOp>> createPeelOddIterationsPass();
 
+std::unique_ptr<OperationPass<FuncOp>> createTemporalBlockingPass();
+
+std::unique_ptr<OperationPass<ModuleOp>> createDomainDecompositionPass();
+
+std::unique_ptr<OperationPass<ModuleOp>> createDomainSpecializationPass();
+
+std::unique_ptr<OperationPass<ModuleOp>> createSlabStreamingPass();
+
 //===----------------------------------------------------------------------===//
 // Registration
 //===----------------------------------------------------------------------===//
@@ -0,0 +1,44 @@
+#ifndef DIALECT_STENCIL_STENCILANALYSIS_H
+#define DIALECT_STENCIL_STENCILANALYSIS_H
+
+#include "Dialect/Stencil/StencilOps.h"
+#include "Dialect/Stencil/StencilTypes.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/Value.h"
+#include "mlir/Support/LLVM.h"
+#include "llvm/ADT/DenseMap.h"
+
+namespace mlir {
+namespace stencil {
+
+/// This class computes for every stencil apply operand
+/// the minimal bounding box containing all access offsets
+/// (transformations that modify individual apply ops can update the cached
+/// analysis and mark it preserved instead of recomputing it)
+class AccessExtents {
+public:
+  // This struct stores the positive and negative extends
+  struct Extent {
+    Index negative;
+    Index positive;
+  };
+
+  AccessExtents(Operation *op);
+
+  /// Return the extent of an apply op operand or nullptr if there is none
+  const Extent *lookupExtent(Operation *op, Value value) const;
+
+  /// Recompute the extents of an apply op after it has been modified
+  void update(stencil::ApplyOp applyOp);
+
+  /// Remove the extents of an apply op before it is erased
+  void erase(Operation *op);
+
+private:
+  llvm::DenseMap<Operation *, llvm::DenseMap<Value, Extent>> extents;
+};
+
+} // namespace stencil
+} // namespace mlir
+
+#endif // DIALECT_STENCIL_STENCILANALYSIS_H
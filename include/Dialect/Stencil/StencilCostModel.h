@@ -0,0 +1,133 @@
+#ifndef DIALECT_STENCIL_STENCILCOSTMODEL_H
+#define DIALECT_STENCIL_STENCILCOSTMODEL_H
+
+#include "Dialect/Stencil/StencilOps.h"
+#include "mlir/Support/LLVM.h"
+#include <cstdint>
+
+namespace mlir {
+namespace stencil {
+
+/// This class estimates if inlining a producer into its consumer pays off
+/// by comparing the recomputation to the memory traffic saved per point
+class InliningCostModel {
+public:
+  InliningCostModel(double maxFlopsPerByte, unsigned maxOffsets)
+      : maxFlopsPerByte(maxFlopsPerByte), maxOffsets(maxOffsets) {}
+
+  /// Return the number of distinct offsets the consumer accesses the producer
+  /// (every dynamic access counts as a distinct offset)
+  static unsigned getNumOffsets(ApplyOp producerOp, ApplyOp consumerOp);
+
+  /// Return the number of operations computed by the apply op body
+  static unsigned getNumComputeOps(ApplyOp applyOp);
+
+  /// Return the number of bytes stored and loaded per point to materialize
+  /// the producer results used by the consumer
+  static unsigned getTrafficBytes(ApplyOp producerOp, ApplyOp consumerOp);
+
+  /// Return true if inlining the producer into the consumer is profitable
+  bool isInliningProfitable(ApplyOp producerOp, ApplyOp consumerOp) const;
+
+private:
+  double maxFlopsPerByte;
+  unsigned maxOffsets;
+};
+
+/// This class estimates the registers per thread of an unrolled apply op and
+/// selects the unroll factor that minimizes the loads per point without
+/// exceeding the register budget that keeps the occupancy target
+class UnrollingCostModel {
+public:
+  UnrollingCostModel(unsigned maxRegisters) : maxRegisters(maxRegisters) {}
+
+  /// Registers reserved for the loop indexes and the addresses
+  static constexpr unsigned kBaseRegisters = 16;
+
+  /// Return the 32-bit registers that hold the distinct accesses of the
+  /// apply op unrolled by the factor in the unroll dimension
+  static unsigned getAccessRegisters(ApplyOp applyOp, unsigned factor,
+                                     unsigned index);
+
+  /// Return the maximal 32-bit registers that hold the computed values of
+  /// one iteration that are live at the same time
+  static unsigned getLiveRegisters(ApplyOp applyOp);
+
+  /// Return the estimated 32-bit registers per thread
+  static unsigned getNumRegisters(ApplyOp applyOp, unsigned factor,
+                                  unsigned index);
+
+  /// Return the power of two unroll factor up to the maximal factor
+  unsigned getUnrollFactor(ApplyOp applyOp, unsigned maxFactor,
+                           unsigned index) const;
+
+private:
+  unsigned maxRegisters;
+};
+
+/// This class estimates the memory traffic saved by fusing independent apply
+/// ops that load the same inputs into one multi-result apply op
+class FusionCostModel {
+public:
+  FusionCostModel(unsigned maxRegisters, unsigned maxInputs)
+      : maxRegisters(maxRegisters), maxInputs(maxInputs) {}
+
+  /// Return the bytes loaded and stored per point by the apply op
+  static unsigned getTrafficBytes(ApplyOp applyOp);
+
+  /// Return the bytes per point both apply ops load from the same inputs
+  static unsigned getSharedBytes(ApplyOp applyOp1, ApplyOp applyOp2);
+
+  /// Return the estimated registers per thread of the fused apply op
+  static unsigned getNumRegisters(ApplyOp applyOp1, ApplyOp applyOp2);
+
+  /// Return the number of distinct inputs of the fused apply op
+  static unsigned getNumInputs(ApplyOp applyOp1, ApplyOp applyOp2);
+
+  /// Return true if the fused apply op saves memory traffic and fits the
+  /// register budget and the input budget that bounds the workgroup memory
+  /// needed to stage the inputs
+  bool isFusionProfitable(ApplyOp applyOp1, ApplyOp applyOp2) const;
+
+private:
+  unsigned maxRegisters;
+  unsigned maxInputs;
+};
+
+/// This class estimates if lowering a combine tree consumed by an apply op
+/// to a predicated if/else pays off compared to materializing its results.
+/// The lowering in place lets the inlining recompute the predicated
+/// producers at every offset of the consumer instead of storing and loading
+/// the results of the combine in a temporary of the full domain
+class CombineCostModel {
+public:
+  CombineCostModel(double maxFlopsPerByte, unsigned maxOffsets)
+      : maxFlopsPerByte(maxFlopsPerByte), maxOffsets(maxOffsets) {}
+
+  /// Operations per level of the combine tree that compute the predicate
+  static constexpr unsigned kPredicateOps = 2;
+
+  /// Return the number of operations of the longest path through the
+  /// predicated combine tree
+  static unsigned getNumComputeOps(CombineOp rootOp);
+
+  /// Return the number of distinct offsets the consumer accesses the root
+  static unsigned getNumOffsets(CombineOp rootOp, ApplyOp consumerOp);
+
+  /// Return the number of bytes stored and loaded per point to materialize
+  /// the root results used by the consumer
+  static unsigned getTrafficBytes(CombineOp rootOp, ApplyOp consumerOp);
+
+  /// Return true if lowering the combine tree in place is cheaper than
+  /// materializing its results
+  bool isIfElseProfitable(CombineOp rootOp) const;
+
+private:
+  double maxFlopsPerByte;
+  unsigned maxOffsets;
+};
+
+} // namespace stencil
+} // namespace mlir
+
+#endif // DIALECT_STENCIL_STENCILCOSTMODEL_H
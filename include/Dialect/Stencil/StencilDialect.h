@@ -28,6 +28,18 @@ public:
 
   static StringRef getStencilProgramAttrName() { return "stencil.program"; }
 
+  /// Returns the argument attribute marking a field as update of another field
+  static StringRef getUpdateAttrName() { return "stencil.update"; }
+
+  /// Returns the attribute selecting the element type of a field or apply
+  static StringRef getStorageTypeAttrName() { return "stencil.storage_type"; }
+
+  /// Returns the attribute selecting the arithmetic type of an apply
+  static StringRef getComputeTypeAttrName() { return "stencil.compute_type"; }
+
+  /// Returns the attribute keeping an operation in double precision
+  static StringRef getPreciseAttrName() { return "stencil.precise"; }
+
   static StringRef getFieldTypeName() { return "field"; }
   static StringRef getTempTypeName() { return "temp"; }
   static StringRef getResultTypeName() { return "result"; }
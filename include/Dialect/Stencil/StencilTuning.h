@@ -0,0 +1,48 @@
+#ifndef DIALECT_STENCIL_STENCILTUNING_H
+#define DIALECT_STENCIL_STENCILTUNING_H
+
+#include "mlir/Support/LLVM.h"
+#include "llvm/ADT/Optional.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace mlir {
+namespace stencil {
+
+/// This struct stores the tuned parameters of a stencil program
+struct TuningConfig {
+  Optional<unsigned> unrollFactor;
+  Optional<unsigned> unrollIndex;
+  SmallVector<int64_t, 3> tileSizes;
+};
+
+/// This class stores the tuning database written by the oec-tune tool that
+/// maps the stencil program names to their tuned parameters, for example:
+///   { "hdiff": { "unroll-factor": 2, "unroll-index": 1,
+///                "tile-sizes": [128, 1, 1] } }
+class TuningDatabase {
+public:
+  /// Parse the database stored in the given file and return nullptr
+  /// and set the error message if reading or parsing fails
+  static std::unique_ptr<TuningDatabase> load(StringRef fileName,
+                                              std::string &errorMessage);
+
+  /// Parse the database from a json string
+  static std::unique_ptr<TuningDatabase> parse(StringRef json,
+                                               std::string &errorMessage);
+
+  /// Return the tuned parameters of a stencil program if available
+  Optional<TuningConfig> lookup(StringRef programName) const;
+
+private:
+  llvm::StringMap<TuningConfig> configs;
+};
+
+} // namespace stencil
+} // namespace mlir
+
+#endif // DIALECT_STENCIL_STENCILTUNING_H
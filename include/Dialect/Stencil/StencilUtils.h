@@ -14,6 +14,8 @@
 namespace mlir {
 namespace stencil {
 
+class CastOp;
+
 /// Helper method that computes the minimum and maximum index
 int64_t min(int64_t x, int64_t y);
 int64_t max(int64_t x, int64_t y);
@@ -22,6 +24,14 @@ int64_t max(int64_t x, int64_t y);
 Index applyFunElementWise(ArrayRef<int64_t> x, ArrayRef<int64_t> y,
                           std::function<int64_t(int64_t, int64_t)> fun);
 
+/// Helper method updating the bounds and the result type of a cast op
+void updateCastShape(CastOp castOp, ArrayRef<int64_t> lb, ArrayRef<int64_t> ub);
+
+/// Helper method returning the memref dimension storing a stencil dimension
+/// for a dimension order of the lowering (ijk or kij) or none if the order
+/// is unknown (the memref dimensions start with the outermost dimension)
+Optional<int64_t> getMemRefDim(StringRef dimensionOrder, int64_t dim);
+
 /// Helper to detect an optional array attribute
 template <typename T>
 bool isOptionalArrayAttr(T x) {
@@ -0,0 +1,68 @@
+#include "Conversion/LoopsToCPU/Passes.h"
+#include "mlir/Conversion/AffineToStandard/AffineToStandard.h"
+#include "mlir/Conversion/SCFToStandard/SCFToStandard.h"
+#include "mlir/Conversion/StandardToLLVM/ConvertStandardToLLVMPass.h"
+#include "mlir/Conversion/VectorToLLVM/ConvertVectorToLLVM.h"
+#include "mlir/Dialect/SCF/Passes.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/Pass/PassManager.h"
+#include "mlir/Pass/PassOptions.h"
+#include "mlir/Pass/PassRegistry.h"
+#include "mlir/Transforms/Passes.h"
+#include <cstdint>
+#include <vector>
+
+using namespace mlir;
+
+namespace {
+
+// Options of the cpu lowering pipeline
+struct StencilToCPUPipelineOptions
+    : public PassPipelineOptions<StencilToCPUPipelineOptions> {
+  ListOption<int64_t> tileSizes{
+      *this, "tile-sizes",
+      llvm::cl::desc("Tile sizes of the parallel loops (empty = no tiling)"),
+      llvm::cl::ZeroOrMore, llvm::cl::MiscFlags::CommaSeparated};
+  Option<unsigned> vectorWidth{
+      *this, "vector-width",
+      llvm::cl::desc("Vector width of the unit-stride dimension (1 = scalar)"),
+      llvm::cl::init(4)};
+};
+
+} // namespace
+
+namespace mlir {
+void registerStencilToCPUPipeline() {
+  PassPipelineRegistration<StencilToCPUPipelineOptions>(
+      "stencil-kernel-to-cpu", "Lower kernels to multi-threaded cpu code",
+      [](OpPassManager &pm,
+         const StencilToCPUPipelineOptions &pipelineOptions) {
+        // Define the lowering options
+        LowerToLLVMOptions options = {/*useBarePtrCallConv =*/false,
+                                      /*emitCWrappers =*/true,
+                                      /*indexBitwidth =*/64,
+                                      /*useAlignedAlloc =*/true};
+
+        // Tile the parallel loops for the caches and vectorize the point loops
+        std::vector<int64_t> tileSizes(pipelineOptions.tileSizes.begin(),
+                                       pipelineOptions.tileSizes.end());
+        pm.addNestedPass<FuncOp>(createHostAllocationsPass());
+        if (!tileSizes.empty()) {
+          pm.addNestedPass<FuncOp>(createParallelLoopTilingPass(tileSizes));
+          // Fold the point loop bounds of the evenly divided dimensions
+          pm.addNestedPass<FuncOp>(createCanonicalizerPass());
+        }
+        pm.addNestedPass<FuncOp>(
+            createVectorizeInnerLoopsPass(pipelineOptions.vectorWidth));
+
+        // Distribute the tiles to the threads and lower to llvm
+        pm.addPass(createParallelLoopsToOpenMPPass());
+        pm.addPass(createCanonicalizerPass());
+        pm.addPass(createCSEPass());
+        pm.addPass(createLowerAffinePass());
+        pm.addPass(createLowerToCFGPass());
+        pm.addPass(createConvertVectorToLLVMPass());
+        pm.addPass(createLowerToLLVMPass(options));
+      });
+}
+} // namespace mlir
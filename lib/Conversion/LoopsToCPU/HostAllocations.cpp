@@ -0,0 +1,57 @@
+#include "Conversion/LoopsToCPU/Passes.h"
+#include "PassDetail.h"
+#include "mlir/Dialect/GPU/GPUDialect.h"
+#include "mlir/Dialect/StandardOps/IR/Ops.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Support/LLVM.h"
+#include "llvm/ADT/SmallVector.h"
+
+using namespace mlir;
+
+namespace {
+
+/// Replace the synchronous gpu allocations and deallocations by host
+/// allocations and deallocations (the gpu allocations are introduced by the
+/// stencil to standard lowering for the temporaries)
+struct HostAllocationsPass
+    : public HostAllocationsPassBase<HostAllocationsPass> {
+  void runOnOperation() override {
+    // Collect the allocations without async dependencies
+    SmallVector<gpu::AllocOp, 10> allocOps;
+    SmallVector<gpu::DeallocOp, 10> deallocOps;
+    getOperation().walk([&](gpu::AllocOp allocOp) {
+      if (!allocOp.asyncToken() && allocOp.asyncDependencies().empty() &&
+          allocOp.symbolOperands().empty())
+        allocOps.push_back(allocOp);
+    });
+    getOperation().walk([&](gpu::DeallocOp deallocOp) {
+      if (!deallocOp.asyncToken() && deallocOp.asyncDependencies().empty())
+        deallocOps.push_back(deallocOp);
+    });
+
+    // Replace them by host allocations
+    OpBuilder builder(getOperation().getContext());
+    for (auto allocOp : allocOps) {
+      builder.setInsertionPoint(allocOp);
+      auto hostOp = builder.create<AllocOp>(
+          allocOp.getLoc(), allocOp.memref().getType().cast<MemRefType>(),
+          allocOp.dynamicSizes());
+      allocOp.memref().replaceAllUsesWith(hostOp.getResult());
+      allocOp.erase();
+    }
+    for (auto deallocOp : deallocOps) {
+      builder.setInsertionPoint(deallocOp);
+      builder.create<DeallocOp>(deallocOp.getLoc(), deallocOp.memref());
+      deallocOp.erase();
+    }
+  }
+};
+
+} // namespace
+
+std::unique_ptr<OperationPass<FuncOp>> mlir::createHostAllocationsPass() {
+  return std::make_unique<HostAllocationsPass>();
+}
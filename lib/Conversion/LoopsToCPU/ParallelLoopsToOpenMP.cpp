@@ -0,0 +1,155 @@
+#include "Conversion/LoopsToCPU/Passes.h"
+#include "PassDetail.h"
+#include "mlir/Dialect/OpenMP/OpenMPDialect.h"
+#include "mlir/Dialect/SCF/SCF.h"
+#include "mlir/Dialect/StandardOps/IR/Ops.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/OperationSupport.h"
+#include "mlir/IR/SymbolTable.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Support/LLVM.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+
+using namespace mlir;
+
+// OpenMP runtime functions queried by the parallel regions
+constexpr char threadNumName[] = "omp_get_thread_num";
+constexpr char numThreadsName[] = "omp_get_num_threads";
+
+namespace {
+
+/// Replace the outermost parallel loops by OpenMP parallel regions that
+/// execute a contiguous chunk of the linearized loop iterations per thread
+/// (the stencil loops have uniform iteration costs and static chunking keeps
+/// neighboring tiles on the same core)
+struct ParallelLoopsToOpenMPPass
+    : public ParallelLoopsToOpenMPPassBase<ParallelLoopsToOpenMPPass> {
+  void getDependentDialects(DialectRegistry &registry) const override {
+    registry.insert<omp::OpenMPDialect>();
+  }
+
+  void runOnOperation() override;
+
+protected:
+  FuncOp getRuntimeFunction(ModuleOp moduleOp, StringRef name);
+  void convertLoop(scf::ParallelOp loop, FuncOp threadNumOp,
+                   FuncOp numThreadsOp);
+};
+
+// Helper returning the minimum of two index values
+static Value createMin(OpBuilder &builder, Location loc, Value lhs,
+                       Value rhs) {
+  auto cmpOp = builder.create<CmpIOp>(loc, CmpIPredicate::slt, lhs, rhs);
+  return builder.create<SelectOp>(loc, cmpOp, lhs, rhs);
+}
+
+FuncOp ParallelLoopsToOpenMPPass::getRuntimeFunction(ModuleOp moduleOp,
+                                                     StringRef name) {
+  if (auto funcOp = moduleOp.lookupSymbol<FuncOp>(name))
+    return funcOp;
+  OpBuilder builder(moduleOp.getBody(), moduleOp.getBody()->begin());
+  auto funcOp = builder.create<FuncOp>(
+      moduleOp.getLoc(), name,
+      builder.getFunctionType(llvm::None, builder.getI32Type()));
+  funcOp.setPrivate();
+  return funcOp;
+}
+
+void ParallelLoopsToOpenMPPass::convertLoop(scf::ParallelOp loop,
+                                            FuncOp threadNumOp,
+                                            FuncOp numThreadsOp) {
+  OpBuilder builder(loop);
+  auto loc = loop.getLoc();
+
+  // Compute the iteration counts of the loop dimensions
+  SmallVector<Value, 3> counts;
+  Value numIterations = builder.create<ConstantIndexOp>(loc, 1);
+  for (auto en : llvm::enumerate(loop.getInductionVars())) {
+    auto diffOp = builder.create<SubIOp>(loc, loop.upperBound()[en.index()],
+                                         loop.lowerBound()[en.index()]);
+    auto countOp = builder.create<SignedCeilDivIOp>(loc, diffOp,
+                                                    loop.step()[en.index()]);
+    counts.push_back(countOp);
+    numIterations = builder.create<MulIOp>(loc, numIterations, countOp);
+  }
+
+  // Introduce the parallel region
+  OperationState state(loc, omp::ParallelOp::getOperationName());
+  state.addAttribute("operand_segment_sizes",
+                     builder.getI32VectorAttr({0, 0, 0, 0, 0, 0}));
+  state.addRegion();
+  auto parallelOp = builder.createOperation(state);
+  auto block = new Block();
+  parallelOp->getRegion(0).push_back(block);
+  builder.setInsertionPointToStart(block);
+  auto terminatorOp = builder.create<omp::TerminatorOp>(loc);
+  builder.setInsertionPoint(terminatorOp);
+
+  // Compute the chunk of iterations executed by the thread
+  auto getIndex = [&](FuncOp funcOp) {
+    auto callOp = builder.create<CallOp>(loc, funcOp);
+    return builder.create<IndexCastOp>(loc, callOp.getResult(0),
+                                       builder.getIndexType());
+  };
+  auto threadNum = getIndex(threadNumOp);
+  auto numThreads = getIndex(numThreadsOp);
+  auto chunkSize =
+      builder.create<SignedCeilDivIOp>(loc, numIterations, numThreads);
+  auto begin = createMin(builder, loc,
+                         builder.create<MulIOp>(loc, threadNum, chunkSize),
+                         numIterations);
+  auto end = createMin(builder, loc,
+                       builder.create<AddIOp>(loc, begin, chunkSize),
+                       numIterations);
+  auto forOp = builder.create<scf::ForOp>(
+      loc, begin, end, builder.create<ConstantIndexOp>(loc, 1));
+
+  // Delinearize the iteration and move the loop body
+  builder.setInsertionPointToStart(forOp.getBody());
+  Value remainder = forOp.getInductionVar();
+  for (auto en : llvm::enumerate(loop.getInductionVars())) {
+    unsigned index = en.index();
+    auto offsetOp = builder.create<SignedRemIOp>(loc, remainder, counts[index]);
+    auto scaledOp =
+        builder.create<MulIOp>(loc, offsetOp, loop.step()[index]);
+    auto ivOp =
+        builder.create<AddIOp>(loc, loop.lowerBound()[index], scaledOp);
+    remainder = builder.create<SignedDivIOp>(loc, remainder, counts[index]);
+    en.value().replaceAllUsesWith(ivOp);
+  }
+  auto &bodyOps = loop.getBody()->getOperations();
+  forOp.getBody()->getOperations().splice(
+      Block::iterator(forOp.getBody()->getTerminator()), bodyOps,
+      bodyOps.begin(), std::prev(bodyOps.end()));
+  loop.erase();
+}
+
+void ParallelLoopsToOpenMPPass::runOnOperation() {
+  ModuleOp moduleOp = getOperation();
+
+  // Collect the outermost parallel loops without reductions
+  SmallVector<scf::ParallelOp, 10> loops;
+  moduleOp.walk([&](scf::ParallelOp loop) {
+    if (!loop->getParentOfType<scf::ParallelOp>() && loop.getNumResults() == 0)
+      loops.push_back(loop);
+  });
+  if (loops.empty())
+    return;
+
+  // Declare the runtime functions and convert the loops
+  auto threadNumOp = getRuntimeFunction(moduleOp, threadNumName);
+  auto numThreadsOp = getRuntimeFunction(moduleOp, numThreadsName);
+  for (auto loop : loops)
+    convertLoop(loop, threadNumOp, numThreadsOp);
+}
+
+} // namespace
+
+std::unique_ptr<OperationPass<ModuleOp>>
+mlir::createParallelLoopsToOpenMPPass() {
+  return std::make_unique<ParallelLoopsToOpenMPPass>();
+}
@@ -0,0 +1,13 @@
+#ifndef CONVERSION_LOOPSTOCPU_PASSDETAIL_H_
+#define CONVERSION_LOOPSTOCPU_PASSDETAIL_H_
+
+#include "mlir/Pass/Pass.h"
+
+namespace mlir {
+
+#define GEN_PASS_CLASSES
+#include "Conversion/LoopsToCPU/Passes.h.inc"
+
+} // end namespace mlir
+
+#endif // CONVERSION_LOOPSTOCPU_PASSDETAIL_H_
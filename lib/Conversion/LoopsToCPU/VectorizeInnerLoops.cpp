@@ -0,0 +1,259 @@
+#include "Conversion/LoopsToCPU/Passes.h"
+#include "PassDetail.h"
+#include "mlir/Dialect/Affine/IR/AffineOps.h"
+#include "mlir/Dialect/SCF/SCF.h"
+#include "mlir/Dialect/StandardOps/IR/Ops.h"
+#include "mlir/Dialect/Vector/VectorOps.h"
+#include "mlir/IR/AffineExpr.h"
+#include "mlir/IR/AffineMap.h"
+#include "mlir/IR/BlockAndValueMapping.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/OperationSupport.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Support/LLVM.h"
+#include "mlir/Support/LogicalResult.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+
+using namespace mlir;
+
+namespace {
+
+/// Vectorize the first dimension of the innermost parallel loops if it
+/// indexes the unit-stride dimension of all memory accesses. The iterations
+/// that do not fill a vector execute in a scalar remainder loop (the point
+/// loops of the tiled loop nests end at the tile boundary and a vector
+/// crossing it would write to the tile of another thread).
+struct VectorizeInnerLoopsPass
+    : public VectorizeInnerLoopsPassBase<VectorizeInnerLoopsPass> {
+  VectorizeInnerLoopsPass() = default;
+  VectorizeInnerLoopsPass(unsigned vectorWidth) {
+    this->vectorWidth = vectorWidth;
+  }
+
+  void getDependentDialects(DialectRegistry &registry) const override {
+    registry.insert<AffineDialect, vector::VectorDialect>();
+  }
+
+  void runOnOperation() override;
+
+protected:
+  LogicalResult analyzeLoop(scf::ParallelOp loop,
+                            llvm::DenseSet<Operation *> &varyingOps);
+  void vectorizeLoop(scf::ParallelOp loop,
+                     const llvm::DenseSet<Operation *> &varyingOps);
+};
+
+// Helper checking if an affine map is a sum of its operands and constants
+// and uses the varying operand once
+static bool isUnitStrideMap(AffineMap map, unsigned varyingPos) {
+  if (map.getNumResults() != 1)
+    return false;
+  unsigned count = 0;
+  bool isSum = true;
+  map.getResult(0).walk([&](AffineExpr expr) {
+    if (auto dimExpr = expr.dyn_cast<AffineDimExpr>()) {
+      if (dimExpr.getPosition() == varyingPos)
+        count++;
+      return;
+    }
+    if (expr.isa<AffineSymbolExpr>() || expr.isa<AffineConstantExpr>() ||
+        expr.getKind() == AffineExprKind::Add)
+      return;
+    isSum = false;
+  });
+  return isSum && count == 1;
+}
+
+// Helper checking if an operation is an elementwise computation
+static bool isElementwise(Operation *op) {
+  if (!isa<AddFOp, SubFOp, MulFOp, DivFOp, NegFOp, AddIOp, SubIOp, MulIOp,
+           AndOp, OrOp, XOrOp, CmpFOp, CmpIOp, SelectOp, AbsFOp, CeilFOp,
+           SqrtOp, ExpOp, LogOp, CosOp, SinOp, TanhOp, CopySignOp, RsqrtOp>(
+          op))
+    return false;
+  auto isScalar = [](Type type) { return type.isIntOrFloat(); };
+  return llvm::all_of(op->getOperandTypes(), isScalar) &&
+         llvm::all_of(op->getResultTypes(), isScalar);
+}
+
+LogicalResult
+VectorizeInnerLoopsPass::analyzeLoop(scf::ParallelOp loop,
+                                     llvm::DenseSet<Operation *> &varyingOps) {
+  // Vectorize the unit step dimensions of loops without reductions
+  if (loop.getNumResults() != 0)
+    return failure();
+  auto stepOp = loop.step().front().getDefiningOp<ConstantIndexOp>();
+  if (!stepOp || stepOp.getValue() != 1)
+    return failure();
+
+  // Compute the values that vary with the vectorized induction variable
+  // (lane indexes are the induction variable plus a uniform offset)
+  DenseSet<Value> varying, laneIndexes;
+  varying.insert(loop.getInductionVars().front());
+  laneIndexes.insert(loop.getInductionVars().front());
+  auto isVarying = [&](Value value) { return varying.count(value) != 0; };
+  auto isLaneIndex = [&](Value value) { return laneIndexes.count(value) != 0; };
+  auto hasUnitStrideIndexes = [&](ValueRange indexes) {
+    return !indexes.empty() && isLaneIndex(indexes.back()) &&
+           llvm::none_of(indexes.drop_back(), isVarying);
+  };
+  for (auto &op : loop.getBody()->without_terminator()) {
+    if (op.getNumRegions() != 0)
+      return failure();
+    if (llvm::none_of(op.getOperands(), isVarying))
+      continue;
+
+    // Keep the lane index computation scalar
+    if (auto applyOp = dyn_cast<AffineApplyOp>(op)) {
+      auto operands = applyOp.getMapOperands();
+      auto it = llvm::find_if(operands, isVarying);
+      if (llvm::count_if(operands, isVarying) != 1 || !isLaneIndex(*it) ||
+          !isUnitStrideMap(applyOp.getAffineMap(),
+                           std::distance(operands.begin(), it)))
+        return failure();
+      varying.insert(applyOp.getResult());
+      laneIndexes.insert(applyOp.getResult());
+      continue;
+    }
+    if (isa<AddIOp, SubIOp>(op) && op.getResult(0).getType().isIndex()) {
+      bool isUnitStride =
+          isa<AddIOp>(op)
+              ? isLaneIndex(op.getOperand(0)) != isLaneIndex(op.getOperand(1))
+              : isLaneIndex(op.getOperand(0));
+      if (!isUnitStride || (isVarying(op.getOperand(0)) &&
+                            isVarying(op.getOperand(1))))
+        return failure();
+      varying.insert(op.getResult(0));
+      laneIndexes.insert(op.getResult(0));
+      continue;
+    }
+
+    // Vectorize the memory accesses along the unit-stride memref dimension
+    if (auto loadOp = dyn_cast<LoadOp>(op)) {
+      if (!loadOp.getType().isIntOrFloat() || isVarying(loadOp.memref()) ||
+          !hasUnitStrideIndexes(loadOp.indices()))
+        return failure();
+    } else if (auto storeOp = dyn_cast<StoreOp>(op)) {
+      if (!storeOp.value().getType().isIntOrFloat() ||
+          isVarying(storeOp.memref()) ||
+          !hasUnitStrideIndexes(storeOp.indices()))
+        return failure();
+    } else if (!isElementwise(&op) || llvm::any_of(op.getOperands(),
+                                                   isLaneIndex)) {
+      return failure();
+    }
+    for (auto result : op.getResults())
+      varying.insert(result);
+    varyingOps.insert(&op);
+  }
+  return success();
+}
+
+void VectorizeInnerLoopsPass::vectorizeLoop(
+    scf::ParallelOp loop, const llvm::DenseSet<Operation *> &varyingOps) {
+  OpBuilder builder(loop);
+  int64_t width = vectorWidth;
+  auto getVectorType = [&](Type type) {
+    return VectorType::get({width}, type);
+  };
+
+  // Peel the iterations that do not fill a vector unless the loop bounds
+  // are constant and the iteration count is a multiple of the vector width
+  auto loc = loop.getLoc();
+  Value lb = loop.lowerBound().front(), ub = loop.upperBound().front();
+  auto lbOp = lb.getDefiningOp<ConstantIndexOp>();
+  auto ubOp = ub.getDefiningOp<ConstantIndexOp>();
+  if (!lbOp || !ubOp || (ubOp.getValue() - lbOp.getValue()) % width) {
+    auto lbExpr = builder.getAffineDimExpr(0);
+    auto ubExpr = builder.getAffineDimExpr(1);
+    auto vectorUBExpr =
+        lbExpr + (ubExpr - lbExpr).floorDiv(width) * width;
+    Value vectorUB = builder.create<AffineApplyOp>(
+        loc, AffineMap::get(2, 0, vectorUBExpr), ValueRange{lb, ub});
+    builder.setInsertionPointAfter(loop);
+    auto remainderOp = cast<scf::ParallelOp>(builder.clone(*loop));
+    remainderOp.getOperation()->setOperand(0, vectorUB);
+    loop.getOperation()->setOperand(loop.getNumLoops(), vectorUB);
+    builder.setInsertionPoint(loop);
+  }
+
+  // Execute one vector of iterations per loop iteration
+  auto stepOp = builder.create<ConstantIndexOp>(loc, width);
+  loop.getOperation()->setOperand(2 * loop.getNumLoops(), stepOp);
+
+  // Replace the varying operations by their vector counterparts
+  BlockAndValueMapping mapper;
+  auto getVector = [&](Value value) -> Value {
+    if (mapper.contains(value))
+      return mapper.lookup(value);
+    return builder.create<vector::BroadcastOp>(
+        value.getLoc(), getVectorType(value.getType()), value);
+  };
+  SmallVector<Operation *, 16> scalarOps;
+  for (auto &op : loop.getBody()->without_terminator()) {
+    if (!varyingOps.count(&op))
+      continue;
+    builder.setInsertionPoint(&op);
+    if (auto loadOp = dyn_cast<LoadOp>(op)) {
+      auto readOp = builder.create<vector::TransferReadOp>(
+          loadOp.getLoc(), getVectorType(loadOp.getType()), loadOp.memref(),
+          loadOp.indices());
+      mapper.map(loadOp.getResult(), readOp.getResult());
+    } else if (auto storeOp = dyn_cast<StoreOp>(op)) {
+      builder.create<vector::TransferWriteOp>(storeOp.getLoc(),
+                                              getVector(storeOp.value()),
+                                              storeOp.memref(),
+                                              storeOp.indices());
+    } else {
+      OperationState state(op.getLoc(), op.getName());
+      for (auto operand : op.getOperands())
+        state.addOperands(getVector(operand));
+      for (auto type : op.getResultTypes())
+        state.addTypes(getVectorType(type));
+      state.addAttributes(op.getAttrs());
+      auto vectorOp = builder.createOperation(state);
+      mapper.map(op.getResults(), vectorOp->getResults());
+    }
+    scalarOps.push_back(&op);
+  }
+
+  // Erase the scalar operations
+  for (auto op : llvm::reverse(scalarOps))
+    op->erase();
+}
+
+void VectorizeInnerLoopsPass::runOnOperation() {
+  if (vectorWidth <= 1)
+    return;
+
+  // Collect the innermost parallel loops
+  SmallVector<scf::ParallelOp, 10> loops;
+  getOperation().walk([&](scf::ParallelOp loop) {
+    auto result = loop.getBody()->walk(
+        [](scf::ParallelOp) { return WalkResult::interrupt(); });
+    if (!result.wasInterrupted())
+      loops.push_back(loop);
+  });
+
+  // Vectorize the loops supported by the analysis
+  for (auto loop : loops) {
+    llvm::DenseSet<Operation *> varyingOps;
+    if (succeeded(analyzeLoop(loop, varyingOps)))
+      vectorizeLoop(loop, varyingOps);
+  }
+}
+
+} // namespace
+
+std::unique_ptr<OperationPass<FuncOp>> mlir::createVectorizeInnerLoopsPass() {
+  return std::make_unique<VectorizeInnerLoopsPass>();
+}
+
+std::unique_ptr<OperationPass<FuncOp>>
+mlir::createVectorizeInnerLoopsPass(unsigned vectorWidth) {
+  return std::make_unique<VectorizeInnerLoopsPass>(vectorWidth);
+}
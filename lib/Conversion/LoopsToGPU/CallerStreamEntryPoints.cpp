@@ -0,0 +1,172 @@
+#include "Conversion/LoopsToGPU/Passes.h"
+#include "PassDetail.h"
+#include "mlir/Dialect/LLVMIR/LLVMDialect.h"
+#include "mlir/Dialect/LLVMIR/LLVMTypes.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/SymbolTable.h"
+#include "mlir/IR/Value.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Support/LLVM.h"
+#include "llvm/ADT/None.h"
+#include "llvm/ADT/Optional.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include <string>
+
+using namespace mlir;
+
+namespace {
+
+constexpr char cInterfacePrefix[] = "_mlir_ciface_";
+
+/// Add an entry point <name>_async to every host function that takes bare
+/// device pointers, sizes, and strides instead of memref descriptors and
+/// executes all kernels on a stream owned by the caller (the entry point
+/// does not synchronize the stream)
+struct CallerStreamEntryPointsPass
+    : public CallerStreamEntryPointsPassBase<CallerStreamEntryPointsPass> {
+  void runOnOperation() override;
+
+private:
+  void addEntryPoint(LLVM::LLVMFuncOp wrapperOp, LLVM::LLVMFuncOp funcOp);
+};
+
+// Helper returning the rank if the type points to a memref descriptor
+static Optional<unsigned> getDescriptorRank(Type type) {
+  auto pointerType = type.dyn_cast<LLVM::LLVMPointerType>();
+  if (!pointerType)
+    return llvm::None;
+  auto structType =
+      pointerType.getElementType().dyn_cast<LLVM::LLVMStructType>();
+  if (!structType || structType.getBody().size() != 5 ||
+      !structType.getBody()[1].isa<LLVM::LLVMPointerType>())
+    return llvm::None;
+  auto arrayType = structType.getBody()[3].dyn_cast<LLVM::LLVMArrayType>();
+  if (!arrayType)
+    return llvm::None;
+  return arrayType.getNumElements();
+}
+
+// Helper replacing the streams created by the host function by the caller
+// stream and removing the stream synchronizations
+static void useCallerStream(LLVM::LLVMFuncOp funcOp, Value stream) {
+  SmallVector<LLVM::CallOp, 16> callOps;
+  funcOp.walk([&](LLVM::CallOp callOp) { callOps.push_back(callOp); });
+  for (auto callOp : callOps) {
+    auto callee = callOp.callee();
+    if (!callee.hasValue())
+      continue;
+    if (callee.getValue() == "mgpuStreamCreate") {
+      callOp.getResult(0).replaceAllUsesWith(stream);
+      callOp.erase();
+      continue;
+    }
+    // All streams are the caller stream and execute in order
+    if (llvm::is_contained(ArrayRef<StringRef>{"mgpuStreamSynchronize",
+                                               "mgpuStreamDestroy",
+                                               "mgpuEventSynchronize"},
+                           callee.getValue()))
+      callOp.erase();
+  }
+}
+
+void CallerStreamEntryPointsPass::addEntryPoint(LLVM::LLVMFuncOp wrapperOp,
+                                                LLVM::LLVMFuncOp funcOp) {
+  MLIRContext *context = &getContext();
+  auto voidType = LLVM::LLVMVoidType::get(context);
+  auto indexType = LLVM::LLVMIntegerType::get(context, 64);
+  auto streamType =
+      LLVM::LLVMPointerType::get(LLVM::LLVMIntegerType::get(context, 8));
+  auto funcType = funcOp.getType().cast<LLVM::LLVMFunctionType>();
+  auto wrapperType = wrapperOp.getType().cast<LLVM::LLVMFunctionType>();
+  if (!funcType.getReturnType().isa<LLVM::LLVMVoidType>())
+    return;
+
+  // Replace the memref descriptors of the wrapper by a pointer followed by
+  // the sizes and the strides of every dimension
+  SmallVector<LLVM::LLVMType, 10> entryTypes;
+  SmallVector<Optional<unsigned>, 10> ranks;
+  for (auto paramType : wrapperType.getParams()) {
+    ranks.push_back(getDescriptorRank(paramType));
+    if (!ranks.back().hasValue()) {
+      entryTypes.push_back(paramType);
+      continue;
+    }
+    auto structType = paramType.cast<LLVM::LLVMPointerType>()
+                          .getElementType()
+                          .cast<LLVM::LLVMStructType>();
+    entryTypes.push_back(structType.getBody()[1]);
+    entryTypes.append(2 * ranks.back().getValue(), indexType);
+  }
+  entryTypes.push_back(streamType);
+
+  // Clone the host function and pass the caller stream as last argument
+  OpBuilder builder(context);
+  builder.setInsertionPointAfter(funcOp);
+  auto streamOp = cast<LLVM::LLVMFuncOp>(builder.clone(*funcOp));
+  SymbolTable::setSymbolName(streamOp, funcOp.getName().str() + "_on_stream");
+  SmallVector<LLVM::LLVMType, 16> streamTypes(funcType.getParams().begin(),
+                                              funcType.getParams().end());
+  streamTypes.push_back(streamType);
+  streamOp->setAttr(streamOp.getTypeAttrName(),
+                    TypeAttr::get(LLVM::LLVMFunctionType::get(
+                        voidType, streamTypes, false)));
+  Value stream = streamOp.getBody().front().addArgument(streamType);
+  useCallerStream(streamOp, stream);
+
+  // Build the descriptors from the pointers, the sizes, and the strides (the
+  // pointers point to the first element of the fields and the offsets are
+  // zero)
+  Location loc = funcOp.getLoc();
+  builder.setInsertionPointAfter(streamOp);
+  auto entryOp = builder.create<LLVM::LLVMFuncOp>(
+      loc, funcOp.getName().str() + "_async",
+      LLVM::LLVMFunctionType::get(voidType, entryTypes, false));
+  builder.setInsertionPointToStart(entryOp.addEntryBlock());
+  Value zero = builder.create<LLVM::ConstantOp>(loc, indexType,
+                                                builder.getI64IntegerAttr(0));
+  SmallVector<Value, 16> operands;
+  auto arguments = entryOp.getArguments();
+  unsigned pos = 0;
+  for (auto rank : ranks) {
+    if (!rank.hasValue()) {
+      operands.push_back(arguments[pos++]);
+      continue;
+    }
+    operands.append(2, arguments[pos++]);
+    operands.push_back(zero);
+    operands.append(arguments.begin() + pos,
+                    arguments.begin() + pos + 2 * rank.getValue());
+    pos += 2 * rank.getValue();
+  }
+  operands.push_back(arguments[pos]);
+  builder.create<LLVM::CallOp>(loc, TypeRange(),
+                               builder.getSymbolRefAttr(streamOp.getName()),
+                               operands);
+  builder.create<LLVM::ReturnOp>(loc, ValueRange());
+}
+
+void CallerStreamEntryPointsPass::runOnOperation() {
+  // Find the host functions by the wrappers of the C interface
+  SmallVector<std::pair<LLVM::LLVMFuncOp, LLVM::LLVMFuncOp>, 4> funcOps;
+  for (auto wrapperOp : getOperation().getOps<LLVM::LLVMFuncOp>()) {
+    if (wrapperOp.isExternal() ||
+        !wrapperOp.getName().startswith(cInterfacePrefix))
+      continue;
+    auto funcOp = getOperation().lookupSymbol<LLVM::LLVMFuncOp>(
+        wrapperOp.getName().drop_front(StringRef(cInterfacePrefix).size()));
+    if (funcOp && !funcOp.isExternal())
+      funcOps.push_back({wrapperOp, funcOp});
+  }
+  for (auto &funcOp : funcOps)
+    addEntryPoint(funcOp.first, funcOp.second);
+}
+
+} // namespace
+
+std::unique_ptr<OperationPass<ModuleOp>>
+mlir::createCallerStreamEntryPointsPass() {
+  return std::make_unique<CallerStreamEntryPointsPass>();
+}
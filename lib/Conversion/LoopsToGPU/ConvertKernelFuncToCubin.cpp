@@ -1,3 +1,4 @@
+#include "Conversion/LoopsToGPU/KernelCache.h"
 #include "Conversion/LoopsToGPU/Passes.h"
 #include "mlir/Conversion/GPUCommon/GPUCommonPass.h"
 #include "mlir/Conversion/GPUToNVVM/GPUToNVVMPass.h"
@@ -7,10 +8,23 @@
 #include "mlir/Dialect/GPU/Passes.h"
 #include "mlir/IR/BuiltinOps.h"
 #include "mlir/Pass/PassManager.h"
+#include "mlir/Pass/PassOptions.h"
 #include "mlir/Pass/PassRegistry.h"
+#include "mlir/Support/FileUtilities.h"
 #include "mlir/Target/NVVMIR.h"
 #include "mlir/Transforms/Passes.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/FileUtilities.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/Program.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/raw_ostream.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
 
 #ifdef CUDA_BACKEND_ENABLED
 #include "cuda.h"
@@ -18,8 +32,6 @@
 using namespace mlir;
 
 constexpr char tripleName[] = "nvptx64-nvidia-cuda";
-constexpr char targetChip[] = "sm_35";
-constexpr char features[] = "+ptx60";
 constexpr char gpuBinaryAnnotation[] = "nvvm.cubin";
 
 namespace {
@@ -31,6 +43,69 @@ inline void emit_cuda_error(const llvm::Twine &message, const char *buffer,
                      .concat(buffer)
                      .concat("]"));
 }
+
+// Options of the cubin lowering pipeline
+struct GPUToCUBINPipelineOptions
+    : public PassPipelineOptions<GPUToCUBINPipelineOptions> {
+  Option<std::string> targetChip{*this, "chip",
+                                 llvm::cl::desc("Target GPU architecture"),
+                                 llvm::cl::init("sm_35")};
+  Option<std::string> features{*this, "features",
+                               llvm::cl::desc("Target PTX features"),
+                               llvm::cl::init("+ptx60")};
+  Option<unsigned> jitOptLevel{
+      *this, "jit-opt-level",
+      llvm::cl::desc("Optimization level of the PTX JIT (0 to 4)"),
+      llvm::cl::init(4)};
+  Option<unsigned> maxRegisters{
+      *this, "max-registers",
+      llvm::cl::desc("Maximal number of registers per thread (0 = no limit)"),
+      llvm::cl::init(0)};
+  ListOption<std::string> fatbinArchs{
+      *this, "fatbin-archs",
+      llvm::cl::desc("Architectures of the fat binary (e.g. sm_80,sm_90)"),
+      llvm::cl::ZeroOrMore, llvm::cl::MiscFlags::CommaSeparated};
+  Option<bool> multiStream{
+      *this, "multi-stream",
+      llvm::cl::desc("Execute independent kernels on separate streams"),
+      llvm::cl::init(false)};
+  Option<bool> callerStream{
+      *this, "caller-stream",
+      llvm::cl::desc("Add entry points taking bare pointers, strides, and a "
+                     "caller-owned stream"),
+      llvm::cl::init(false)};
+};
+
+// Options passed to the PTX JIT
+struct JitOptions {
+  unsigned optLevel;
+  unsigned maxRegisters;
+};
+
+// Device context shared by all kernel compilations
+// (the context is created once by the first compilation even if the kernel
+// modules are compiled concurrently and destroyed at exit)
+struct SharedContext {
+  SharedContext() {
+    call = "cuInit";
+    if ((error = cuInit(0)) != CUDA_SUCCESS)
+      return;
+    CUdevice device;
+    call = "cuDeviceGet";
+    if ((error = cuDeviceGet(&device, 0)) != CUDA_SUCCESS)
+      return;
+    call = "cuCtxCreate";
+    error = cuCtxCreate(&context, 0, device);
+  }
+  ~SharedContext() {
+    if (context)
+      cuCtxDestroy(context);
+  }
+  CUcontext context = nullptr;
+  // Result and name of the last driver call of the context creation
+  CUresult error = CUDA_SUCCESS;
+  const char *call = "";
+};
 } // namespace
 
 #define RETURN_ON_CUDA_ERROR(expr, msg)                                        \
@@ -42,27 +117,64 @@ inline void emit_cuda_error(const llvm::Twine &message, const char *buffer,
     }                                                                          \
   }
 
-OwnedBlob compilePtxToCubin(const std::string ptx, Location loc,
-                            StringRef name) {
-  char jitErrorBuffer[4096] = {0};
+// Return the architecture name of the first device or an empty string
+static std::string getDeviceArch() {
+  CUdevice device;
+  int major, minor;
+  if (cuInit(0) != CUDA_SUCCESS || cuDeviceGet(&device, 0) != CUDA_SUCCESS ||
+      cuDeviceGetAttribute(&major,
+                           CU_DEVICE_ATTRIBUTE_COMPUTE_CAPABILITY_MAJOR,
+                           device) != CUDA_SUCCESS ||
+      cuDeviceGetAttribute(&minor,
+                           CU_DEVICE_ATTRIBUTE_COMPUTE_CAPABILITY_MINOR,
+                           device) != CUDA_SUCCESS)
+    return "";
+  return "sm_" + llvm::itostr(major * 10 + minor);
+}
 
-  RETURN_ON_CUDA_ERROR(cuInit(0), "cuInit");
+// Parse the compute capability of an architecture name (e.g. sm_80)
+static Optional<unsigned> parseComputeCapability(StringRef arch) {
+  unsigned computeCapability;
+  if (!arch.consume_front("sm_") || arch.getAsInteger(10, computeCapability))
+    return llvm::None;
+  return computeCapability;
+}
 
-  // Linking requires a device context.
-  CUdevice device;
-  RETURN_ON_CUDA_ERROR(cuDeviceGet(&device, 0), "cuDeviceGet");
-  CUcontext context;
-  RETURN_ON_CUDA_ERROR(cuCtxCreate(&context, 0, device), "cuCtxCreate");
+static OwnedBlob compilePtxToCubin(const std::string ptx, Location loc,
+                                   StringRef name, JitOptions options,
+                                   Optional<unsigned> computeCapability) {
+  char jitErrorBuffer[4096] = {0};
+
+  // Linking requires a device context that is current on every thread
+  // compiling kernels (the initialization of the static is thread-safe)
+  static SharedContext sharedContext;
+  RETURN_ON_CUDA_ERROR(sharedContext.error, sharedContext.call);
+  RETURN_ON_CUDA_ERROR(cuCtxSetCurrent(sharedContext.context),
+                       "cuCtxSetCurrent");
   CUlinkState linkState;
 
-  CUjit_option jitOptions[] = {CU_JIT_ERROR_LOG_BUFFER,
-                               CU_JIT_ERROR_LOG_BUFFER_SIZE_BYTES};
-  void *jitOptionsVals[] = {jitErrorBuffer,
-                            reinterpret_cast<void *>(sizeof(jitErrorBuffer))};
+  // Setup the jit options (target the device of the context by default)
+  auto toOptionValue = [](uintptr_t value) {
+    return reinterpret_cast<void *>(value);
+  };
+  SmallVector<CUjit_option, 5> jitOptions = {
+      CU_JIT_ERROR_LOG_BUFFER, CU_JIT_ERROR_LOG_BUFFER_SIZE_BYTES,
+      CU_JIT_OPTIMIZATION_LEVEL};
+  SmallVector<void *, 5> jitOptionsVals = {
+      jitErrorBuffer, toOptionValue(sizeof(jitErrorBuffer)),
+      toOptionValue(options.optLevel)};
+  if (options.maxRegisters != 0) {
+    jitOptions.push_back(CU_JIT_MAX_REGISTERS);
+    jitOptionsVals.push_back(toOptionValue(options.maxRegisters));
+  }
+  if (computeCapability.hasValue()) {
+    jitOptions.push_back(CU_JIT_TARGET);
+    jitOptionsVals.push_back(toOptionValue(computeCapability.getValue()));
+  }
 
-  RETURN_ON_CUDA_ERROR(cuLinkCreate(2,              /* number of jit options */
-                                    jitOptions,     /* jit options */
-                                    jitOptionsVals, /* jit option values */
+  RETURN_ON_CUDA_ERROR(cuLinkCreate(jitOptions.size(), /* number of options */
+                                    jitOptions.data(),     /* jit options */
+                                    jitOptionsVals.data(), /* option values */
                                     &linkState),
                        "cuLinkCreate");
 
@@ -91,11 +203,99 @@ OwnedBlob compilePtxToCubin(const std::string ptx, Location loc,
   return result;
 }
 
+// Write the data to a new temporary file
+static LogicalResult writeTempFile(StringRef suffix, ArrayRef<char> data,
+                                   SmallVectorImpl<char> &path) {
+  int fd = -1;
+  if (llvm::sys::fs::createTemporaryFile("kernel", suffix, fd, path))
+    return failure();
+  llvm::raw_fd_ostream os(fd, /*shouldClose=*/true);
+  os.write(data.data(), data.size());
+  return success(!os.has_error());
+}
+
+// Compile the PTX for multiple architectures and package the cubins
+// together with the PTX in a fat binary using the fatbinary tool
+static OwnedBlob compilePtxToFatbin(const std::string ptx, Location loc,
+                                    StringRef name, JitOptions options,
+                                    StringRef targetChip,
+                                    ArrayRef<std::string> archs) {
+  auto fatbinary = llvm::sys::findProgramByName("fatbinary");
+  if (!fatbinary) {
+    emitError(loc, "cannot find the fatbinary tool");
+    return {};
+  }
+
+  // Compile the cubins and store them in temporary files
+  SmallVector<SmallString<128>, 4> paths;
+  SmallVector<std::unique_ptr<llvm::FileRemover>, 4> removers;
+  SmallVector<std::string, 8> images;
+  auto addImage = [&](StringRef profile, StringRef suffix,
+                      ArrayRef<char> data) {
+    paths.emplace_back();
+    if (failed(writeTempFile(suffix, data, paths.back()))) {
+      emitError(loc, "cannot write temporary file for fat binary creation");
+      return failure();
+    }
+    removers.push_back(std::make_unique<llvm::FileRemover>(paths.back()));
+    images.push_back(("--image=profile=" + profile + ",file=" + paths.back())
+                         .str());
+    return success();
+  };
+  for (auto &arch : archs) {
+    auto computeCapability = parseComputeCapability(arch);
+    if (!computeCapability.hasValue()) {
+      emitError(loc, "expected fat binary architecture of the form sm_XX");
+      return {};
+    }
+    auto cubin = compilePtxToCubin(ptx, loc, name, options, computeCapability);
+    if (!cubin || failed(addImage(arch, "cubin", *cubin)))
+      return {};
+  }
+  // Embed the PTX to support newer architectures
+  auto computeCapability = parseComputeCapability(targetChip);
+  if (!computeCapability.hasValue()) {
+    emitError(loc, "expected target chip of the form sm_XX");
+    return {};
+  }
+  if (failed(addImage("compute_" + llvm::utostr(*computeCapability), "ptx",
+                      ArrayRef<char>(ptx.data(), ptx.size()))))
+    return {};
+
+  // Run the fatbinary tool
+  SmallString<128> fatbinPath;
+  int fd = -1;
+  if (llvm::sys::fs::createTemporaryFile("kernel", "fatbin", fd, fatbinPath)) {
+    emitError(loc, "cannot create temporary file for the fat binary");
+    return {};
+  }
+  llvm::sys::Process::SafelyCloseFileDescriptor(fd);
+  llvm::FileRemover cleanupFatbin(fatbinPath);
+  std::string createArg = (llvm::Twine("--create=") + fatbinPath).str();
+  SmallVector<StringRef, 10> args = {*fatbinary, "-64", createArg};
+  args.append(images.begin(), images.end());
+  std::string errorMessage;
+  if (llvm::sys::ExecuteAndWait(*fatbinary, args, llvm::None, {}, 0, 0,
+                                &errorMessage) != 0) {
+    emitError(loc, "fatbinary invocation failed " + errorMessage);
+    return {};
+  }
+
+  // Load the fat binary
+  auto fatbinFile = openInputFile(fatbinPath, &errorMessage);
+  if (!fatbinFile) {
+    emitError(loc, "cannot read the fat binary " + errorMessage);
+    return {};
+  }
+  return std::make_unique<std::vector<char>>(
+      fatbinFile->getBufferStart(), fatbinFile->getBufferEnd());
+}
+
 namespace mlir {
 void registerGPUToCUBINPipeline() {
-  PassPipelineRegistration<>(
+  PassPipelineRegistration<GPUToCUBINPipelineOptions>(
       "stencil-kernel-to-cubin", "Lower kernels to cubin",
-      [](OpPassManager &pm) {
+      [](OpPassManager &pm, const GPUToCUBINPipelineOptions &pipelineOptions) {
         // Initialize LLVM NVPTX backend.
         LLVMInitializeNVPTXTarget();
         LLVMInitializeNVPTXTargetInfo();
@@ -108,18 +308,47 @@ void registerGPUToCUBINPipeline() {
                                       /*indexBitwidth =*/32,
                                       /*useAlignedAlloc =*/false};
 
+        // Setup the cubin or fat binary generation
+        std::string targetChip = pipelineOptions.targetChip;
+        std::string features = pipelineOptions.features;
+        JitOptions jitOptions = {pipelineOptions.jitOptLevel,
+                                 pipelineOptions.maxRegisters};
+        std::vector<std::string> archs(pipelineOptions.fatbinArchs.begin(),
+                                       pipelineOptions.fatbinArchs.end());
+        BlobGenerator blobGenerator =
+            [=](const std::string &ptx, Location loc, StringRef name) {
+              if (!archs.empty())
+                return compilePtxToFatbin(ptx, loc, name, jitOptions,
+                                          targetChip, archs);
+              return compilePtxToCubin(ptx, loc, name, jitOptions, llvm::None);
+            };
+        // Distinguish the cached blobs of different jit configurations
+        // (without fat binary the jit targets the device of the context)
+        std::string config =
+            features + ";O" + llvm::utostr(jitOptions.optLevel) + ";maxreg=" +
+            llvm::utostr(jitOptions.maxRegisters) + ";archs=" +
+            (archs.empty() ? getDeviceArch() : llvm::join(archs, ","));
+
         // Setup the lowering pipeline
         pm.addPass(createLowerToCFGPass());
         pm.addPass(createGpuKernelOutliningPass());
+        if (pipelineOptions.multiStream)
+          pm.addPass(createStreamAssignmentPass());
         auto &kernelPm = pm.nest<gpu::GPUModuleOp>();
         kernelPm.addPass(createStripDebugInfoPass());
+        kernelPm.addPass(createPromoteWorkgroupAllocationsPass());
         kernelPm.addPass(createLowerGpuOpsToNVVMOpsPass(options.indexBitwidth));
         kernelPm.addPass(createConvertGPUKernelToBlobPass(
-            translateModuleToNVVMIR, compilePtxToCubin, tripleName, targetChip,
-            features, gpuBinaryAnnotation));
-        pm.addPass(createGpuAsyncRegionPass());
+            translateModuleToNVVMIR,
+            createCachedBlobGenerator(blobGenerator, tripleName, targetChip,
+                                      config),
+            tripleName, targetChip, features, gpuBinaryAnnotation));
+        if (!pipelineOptions.multiStream)
+          pm.addPass(createGpuAsyncRegionPass());
         pm.addPass(createGpuToLLVMConversionPass(gpuBinaryAnnotation, options));
+        if (pipelineOptions.callerStream)
+          pm.addPass(createCallerStreamEntryPointsPass());
       });
 }
 } // namespace mlir
-#endif
\ No newline at end of file
+#endif
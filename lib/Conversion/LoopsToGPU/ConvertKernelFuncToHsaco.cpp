@@ -1,3 +1,4 @@
+#include "Conversion/LoopsToGPU/KernelCache.h"
 #include "Conversion/LoopsToGPU/Passes.h"
 #include "mlir/Conversion/GPUCommon/GPUCommonPass.h"
 #include "mlir/Conversion/GPUToROCDL/GPUToROCDLPass.h"
@@ -5,13 +6,18 @@
 #include "mlir/Conversion/StandardToLLVM/ConvertStandardToLLVMPass.h"
 #include "mlir/Dialect/GPU/GPUDialect.h"
 #include "mlir/Dialect/GPU/Passes.h"
+#include "mlir/Dialect/LLVMIR/LLVMDialect.h"
+#include "mlir/ExecutionEngine/OptUtils.h"
 #include "mlir/IR/BuiltinOps.h"
 #include "mlir/Pass/Pass.h"
 #include "mlir/Pass/PassManager.h"
+#include "mlir/Pass/PassOptions.h"
 #include "mlir/Pass/PassRegistry.h"
 #include "mlir/Support/FileUtilities.h"
 #include "mlir/Target/ROCDLIR.h"
 #include "mlir/Transforms/Passes.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/Support/FileUtilities.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/TargetRegistry.h"
@@ -46,12 +52,54 @@ using namespace llvm;
 
 using Blob = SmallVector<char, 0>;
 constexpr char tripleName[] = "amdgcn-amd-amdhsa";
-constexpr char targetChip[] = "gfx1010";
-constexpr char features[] = "";
 constexpr char gpuBinaryAnnotation[] = "rocdl.hsaco";
 
-static LogicalResult assembleIsa(const std::string isa, StringRef name,
-                                 Blob &result) {
+namespace {
+// Options of the hsaco lowering pipeline
+struct GPUToHSACOPipelineOptions
+    : public PassPipelineOptions<GPUToHSACOPipelineOptions> {
+  Option<std::string> targetChip{*this, "chip",
+                                 llvm::cl::desc("Target GPU architecture"),
+                                 llvm::cl::init("gfx1010")};
+  Option<std::string> features{*this, "features",
+                               llvm::cl::desc("Target GPU features"),
+                               llvm::cl::init("")};
+  Option<unsigned> wavefrontSize{
+      *this, "wavefront-size",
+      llvm::cl::desc("Wavefront size of gfx10 and later targets (32 or 64, "
+                     "0 = native size of the target)"),
+      llvm::cl::init(0)};
+  Option<int64_t> ldsSize{
+      *this, "lds-size",
+      llvm::cl::desc("Workgroup memory (LDS) per block in bytes "
+                     "(0 = no limit)"),
+      llvm::cl::init(65536)};
+  Option<unsigned> optLevel{
+      *this, "opt-level",
+      llvm::cl::desc("Optimization level of the AMDGPU backend (0 to 3)"),
+      llvm::cl::init(3)};
+  Option<bool> multiStream{
+      *this, "multi-stream",
+      llvm::cl::desc("Execute independent kernels on separate streams"),
+      llvm::cl::init(false)};
+  Option<bool> callerStream{
+      *this, "caller-stream",
+      llvm::cl::desc("Add entry points taking bare pointers, strides, and a "
+                     "caller-owned stream"),
+      llvm::cl::init(false)};
+};
+
+// Options of the kernel translation and optimization
+struct ROCDLIROptions {
+  std::string targetChip;
+  std::string features;
+  unsigned optLevel;
+};
+} // namespace
+
+static LogicalResult assembleIsa(const std::string isa, Location loc,
+                                 StringRef name, StringRef targetChip,
+                                 StringRef features, Blob &result) {
   raw_svector_ostream os(result);
 
   std::string error;
@@ -59,7 +107,7 @@ static LogicalResult assembleIsa(const std::string isa, StringRef name,
   const Target *theTarget =
       TargetRegistry::lookupTarget(theTriple.normalize(), error);
   if (!theTarget) {
-    WithColor::error(errs(), name) << error;
+    emitError(loc, name) << ": " << error;
     return failure();
   }
 
@@ -100,7 +148,7 @@ static LogicalResult assembleIsa(const std::string isa, StringRef name,
       theTarget->createMCAsmParser(*sti, *parser, *mcii, mcOptions));
 
   if (!tap) {
-    WithColor::error(errs(), name) << "assembler initialization error.\n";
+    emitError(loc, name) << ": assembler initialization error";
     return failure();
   }
 
@@ -110,17 +158,18 @@ static LogicalResult assembleIsa(const std::string isa, StringRef name,
   return success();
 }
 
+// Serialize the lld invocations that are not reentrant (the kernel modules
+// are otherwise compiled concurrently)
 static std::mutex mutex;
-static LogicalResult createHsaco(const Blob &isaBlob, StringRef name,
-                                 Blob &hsacoBlob) {
+static LogicalResult createHsaco(const Blob &isaBlob, Location loc,
+                                 StringRef name, Blob &hsacoBlob) {
   // Save the ISA binary to a temp file.
   int tempIsaBinaryFd = -1;
   SmallString<128> tempIsaBinaryFilename;
   std::error_code ec = sys::fs::createTemporaryFile(
       "kernel", "o", tempIsaBinaryFd, tempIsaBinaryFilename);
   if (ec) {
-    WithColor::error(errs(), name)
-        << "temporary file for ISA binary creation error.\n";
+    emitError(loc, name) << ": temporary file for ISA binary creation error";
     return failure();
   }
   FileRemover cleanupIsaBinary(tempIsaBinaryFilename);
@@ -134,8 +183,8 @@ static LogicalResult createHsaco(const Blob &isaBlob, StringRef name,
   ec = sys::fs::createTemporaryFile("kernel", "hsaco", tempHsacoFD,
                                     tempHsacoFilename);
   if (ec) {
-    WithColor::error(errs(), name)
-        << "temporary file for HSA code object creation error.\n";
+    emitError(loc, name)
+        << ": temporary file for HSA code object creation error";
     return failure();
   }
   FileRemover cleanupHsaco(tempHsacoFilename);
@@ -146,15 +195,14 @@ static LogicalResult createHsaco(const Blob &isaBlob, StringRef name,
                              "-o", tempHsacoFilename.c_str()},
                             /*canEarlyExit=*/false, llvm::outs(), llvm::errs());
   if (!ret) {
-    WithColor::error(errs(), name) << "lld invocation error.\n";
+    emitError(loc, name) << ": lld invocation error";
     return failure();
   }
 
   // Load the HSA code object.
   auto hsacoFile = mlir::openInputFile(tempHsacoFilename);
   if (!hsacoFile) {
-    WithColor::error(errs(), name)
-        << "read HSA code object from temp file error.\n";
+    emitError(loc, name) << ": read HSA code object from temp file error";
     return failure();
   }
   hsacoBlob.assign(hsacoFile->getBuffer().begin(),
@@ -163,36 +211,95 @@ static LogicalResult createHsaco(const Blob &isaBlob, StringRef name,
   return success();
 }
 
+// Helper returning the major version of a gfx architecture (e.g. 9 for
+// gfx908 and gfx90a or 10 for gfx1030)
+static unsigned getGfxMajorVersion(StringRef targetChip) {
+  unsigned version = 0;
+  if (!targetChip.consume_front("gfx") || targetChip.size() < 3 ||
+      targetChip.drop_back(2).getAsInteger(10, version))
+    return 0;
+  return version;
+}
+
+// Helper returning the wavefront size of the target (the architectures
+// before gfx10 only support 64-wide wavefronts)
+static unsigned getWavefrontSize(StringRef targetChip, unsigned requested) {
+  if (getGfxMajorVersion(targetChip) < 10)
+    return 64;
+  return requested == 64 ? 64 : 32;
+}
+
 static std::unique_ptr<llvm::Module>
 compileModuleToROCDLIR(Operation *m, llvm::LLVMContext &llvmContext,
-                       StringRef name) {
+                       StringRef name, const ROCDLIROptions &rocdlOptions) {
+  // Collect the launch bounds before translating the module
+  llvm::StringMap<int64_t> maxThreads;
+  m->walk([&](LLVM::LLVMFuncOp funcOp) {
+    if (auto attr = funcOp->getAttrOfType<IntegerAttr>(
+            kernelMaxThreadsAttrName))
+      maxThreads[funcOp.getName()] = attr.getInt();
+  });
+
   auto llvmModule = translateModuleToROCDLIR(m, llvmContext, name);
   // TODO: Link with ROCm-Device-Libs in case needed (ex: the Module
   // depends on math functions).
+  if (!llvmModule)
+    return llvmModule;
+
+  // Bound the work group size by the launches which otherwise defaults to
+  // 1024 threads and limits the registers available to every thread
+  for (auto &entry : maxThreads) {
+    if (auto *llvmFunc = llvmModule->getFunction(entry.getKey()))
+      llvmFunc->addFnAttr("amdgpu-flat-work-group-size",
+                          "1, " + llvm::itostr(entry.getValue()));
+  }
+
+  // Optimize the kernels using the passes of the AMDGPU target machine
+  if (rocdlOptions.optLevel == 0)
+    return llvmModule;
+  std::string error;
+  const Target *target = TargetRegistry::lookupTarget(tripleName, error);
+  if (!target) {
+    emitError(m->getLoc(), error);
+    return nullptr;
+  }
+  std::unique_ptr<TargetMachine> targetMachine(target->createTargetMachine(
+      tripleName, rocdlOptions.targetChip, rocdlOptions.features, {}, {}));
+  llvmModule->setDataLayout(targetMachine->createDataLayout());
+  auto transformer =
+      makeOptimizingTransformer(rocdlOptions.optLevel, /*sizeLevel=*/0,
+                                targetMachine.get());
+  if (auto err = transformer(llvmModule.get())) {
+    emitError(m->getLoc(), "optimizing the kernels failed: ")
+        << llvm::toString(std::move(err));
+    return nullptr;
+  }
   return llvmModule;
 }
 
 static OwnedBlob compileISAToHsaco(const std::string isa, Location loc,
-                                   StringRef name) {
+                                   StringRef name, StringRef targetChip,
+                                   StringRef features) {
   // ISA -> ISA in binary form via MC.
   // Use lld to create HSA code object.
   Blob isaBlob;
   Blob hsacoBlob;
 
-  if (succeeded(assembleIsa(isa, name, isaBlob)) &&
-      succeeded(createHsaco(isaBlob, name, hsacoBlob)))
+  if (succeeded(
+          assembleIsa(isa, loc, name, targetChip, features, isaBlob)) &&
+      succeeded(createHsaco(isaBlob, loc, name, hsacoBlob)))
     return std::make_unique<std::vector<char>>(hsacoBlob.begin(),
                                                hsacoBlob.end());
 
-  WithColor::error(errs(), name) << "producing HSA code object error.\n";
+  emitError(loc, name) << ": producing HSA code object error";
   return {};
 }
 
 namespace mlir {
 void registerGPUToHSACOPipeline() {
-  PassPipelineRegistration<>(
+  PassPipelineRegistration<GPUToHSACOPipelineOptions>(
       "stencil-kernel-to-hsaco", "Lower kernels to hsaco",
-      [](OpPassManager &pm) {
+      [](OpPassManager &pm, const GPUToHSACOPipelineOptions &pipelineOptions) {
         // Initialize LLVM AMDGPU backend.
         LLVMInitializeAMDGPUTarget();
         LLVMInitializeAMDGPUTargetInfo();
@@ -205,18 +312,50 @@ void registerGPUToHSACOPipeline() {
                                       /*emitCWrappers =*/true,
                                       /*indexBitwidth =*/32,
                                       /*useAlignedAlloc =*/false};
+
+        // Setup the hsaco generation (gfx10 and later targets execute
+        // 64-wide wavefronts only if the wavefront size feature is set)
+        std::string targetChip = pipelineOptions.targetChip;
+        std::string features = pipelineOptions.features;
+        unsigned wavefrontSize =
+            getWavefrontSize(targetChip, pipelineOptions.wavefrontSize);
+        if (getGfxMajorVersion(targetChip) >= 10 && wavefrontSize == 64)
+          features += (features.empty() ? "" : ",") +
+                      std::string("+wavefrontsize64");
+        ROCDLIROptions rocdlOptions = {targetChip, features,
+                                       pipelineOptions.optLevel};
+        LoweringCallback loweringCallback =
+            [=](Operation *m, llvm::LLVMContext &llvmContext,
+                StringRef name) {
+              return compileModuleToROCDLIR(m, llvmContext, name,
+                                            rocdlOptions);
+            };
+        BlobGenerator blobGenerator = [=](const std::string &isa, Location loc,
+                                          StringRef name) {
+          return compileISAToHsaco(isa, loc, name, targetChip, features);
+        };
         
         // Setup the lowering pipeline
         pm.addPass(createLowerToCFGPass());
         pm.addPass(createGpuKernelOutliningPass());
+        pm.addPass(createKernelLaunchBoundsPass(wavefrontSize,
+                                                pipelineOptions.ldsSize));
+        if (pipelineOptions.multiStream)
+          pm.addPass(createStreamAssignmentPass());
         auto &kernelPm = pm.nest<gpu::GPUModuleOp>();
         kernelPm.addPass(createStripDebugInfoPass());
+        kernelPm.addPass(createPromoteWorkgroupAllocationsPass());
         kernelPm.addPass(createLowerGpuOpsToROCDLOpsPass(options.indexBitwidth));
         kernelPm.addPass(createConvertGPUKernelToBlobPass(
-            compileModuleToROCDLIR, compileISAToHsaco, tripleName, targetChip,
-            features, gpuBinaryAnnotation));
-        pm.addPass(createGpuAsyncRegionPass());
+            loweringCallback,
+            createCachedBlobGenerator(blobGenerator, tripleName, targetChip,
+                                      features),
+            tripleName, targetChip, features, gpuBinaryAnnotation));
+        if (!pipelineOptions.multiStream)
+          pm.addPass(createGpuAsyncRegionPass());
         pm.addPass(createGpuToLLVMConversionPass(gpuBinaryAnnotation, options));
+        if (pipelineOptions.callerStream)
+          pm.addPass(createCallerStreamEntryPointsPass());
       });
 }
 } // namespace mlir
@@ -0,0 +1,90 @@
+#include "Conversion/LoopsToGPU/KernelCache.h"
+#include "mlir/Conversion/GPUCommon/GPUCommonPass.h"
+#include "mlir/IR/Location.h"
+#include "mlir/Support/LLVM.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/SHA1.h"
+#include "llvm/Support/raw_ostream.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace mlir;
+using namespace llvm;
+
+// Compute the content address of a blob
+static std::string computeCacheKey(const std::string &input, StringRef triple,
+                                   StringRef targetChip, StringRef features) {
+  SHA1 hasher;
+  // Separate the components to avoid ambiguous concatenations
+  for (StringRef component : {StringRef(input), triple, targetChip, features}) {
+    hasher.update(component);
+    hasher.update(StringRef("\0", 1));
+  }
+  return toHex(hasher.final(), /*LowerCase=*/true);
+}
+
+// Load a blob from the cache if it exists
+static OwnedBlob loadCachedBlob(StringRef path) {
+  auto buffer = MemoryBuffer::getFile(path, /*FileSize=*/-1,
+                                      /*RequiresNullTerminator=*/false);
+  if (!buffer)
+    return {};
+  return std::make_unique<std::vector<char>>((*buffer)->getBufferStart(),
+                                             (*buffer)->getBufferEnd());
+}
+
+// Store a blob in the cache
+// (write a temporary file and rename it to make concurrent runs safe)
+static void storeCachedBlob(StringRef cacheDir, StringRef path,
+                            const std::vector<char> &blob) {
+  if (sys::fs::create_directories(cacheDir))
+    return;
+  int fd;
+  SmallString<128> tempPath;
+  if (sys::fs::createUniqueFile(Twine(path) + ".%%%%%%.tmp", fd, tempPath))
+    return;
+  {
+    raw_fd_ostream os(fd, /*shouldClose=*/true);
+    os.write(blob.data(), blob.size());
+    if (os.has_error()) {
+      os.clear_error();
+      sys::fs::remove(tempPath);
+      return;
+    }
+  }
+  if (sys::fs::rename(tempPath, path))
+    sys::fs::remove(tempPath);
+}
+
+BlobGenerator mlir::createCachedBlobGenerator(BlobGenerator blobGenerator,
+                                              StringRef triple,
+                                              StringRef targetChip,
+                                              StringRef features) {
+  return [blobGenerator, triple = triple.str(), targetChip = targetChip.str(),
+          features = features.str()](const std::string &input, Location loc,
+                                     StringRef name) -> OwnedBlob {
+    // Compile without caching if there is no cache directory
+    auto cacheDir = sys::Process::GetEnv(kernelCacheDirEnv);
+    if (!cacheDir || cacheDir->empty())
+      return blobGenerator(input, loc, name);
+
+    // Return the cached blob if available
+    SmallString<128> path(*cacheDir);
+    sys::path::append(path,
+                      computeCacheKey(input, triple, targetChip, features));
+    if (auto blob = loadCachedBlob(path))
+      return blob;
+
+    // Otherwise compile and cache the blob
+    auto blob = blobGenerator(input, loc, name);
+    if (blob)
+      storeCachedBlob(*cacheDir, path, *blob);
+    return blob;
+  };
+}
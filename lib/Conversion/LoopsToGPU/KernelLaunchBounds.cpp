@@ -0,0 +1,125 @@
+#include "Conversion/LoopsToGPU/Passes.h"
+#include "PassDetail.h"
+#include "mlir/Dialect/GPU/GPUDialect.h"
+#include "mlir/Dialect/StandardOps/IR/Ops.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/Matchers.h"
+#include "mlir/IR/SymbolTable.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Support/LLVM.h"
+#include "llvm/ADT/DenseMap.h"
+#include <algorithm>
+#include <cstdint>
+
+using namespace mlir;
+
+namespace {
+
+/// Annotate the kernel functions with the maximal number of threads of their
+/// launches and check the launches fit the wavefront size and the workgroup
+/// memory of the target
+struct KernelLaunchBoundsPass
+    : public KernelLaunchBoundsPassBase<KernelLaunchBoundsPass> {
+  KernelLaunchBoundsPass() = default;
+  KernelLaunchBoundsPass(unsigned wavefrontSize, int64_t workgroupMemorySize) {
+    this->wavefrontSize = wavefrontSize;
+    this->workgroupMemorySize = workgroupMemorySize;
+  }
+  void runOnOperation() override;
+};
+
+// Helper returning the number of threads if the block size is constant
+static Optional<int64_t> getNumThreads(gpu::LaunchFuncOp launchOp) {
+  int64_t numThreads = 1;
+  auto blockSize = launchOp.getBlockSizeOperandValues();
+  for (Value size : {blockSize.x, blockSize.y, blockSize.z}) {
+    APInt value;
+    if (!matchPattern(size, m_ConstantInt(&value)))
+      return llvm::None;
+    numThreads *= value.getSExtValue();
+  }
+  return numThreads;
+}
+
+// Helper computing the workgroup memory allocated by a kernel in bytes
+static int64_t getWorkgroupMemorySize(gpu::GPUFuncOp funcOp) {
+  int64_t numBytes = 0;
+  auto addSize = [&](MemRefType memRefType) {
+    if (memRefType.hasStaticShape() &&
+        memRefType.getElementType().isIntOrFloat() &&
+        memRefType.getMemorySpace() ==
+            gpu::GPUDialect::getWorkgroupAddressSpace())
+      numBytes += memRefType.getNumElements() *
+                  memRefType.getElementTypeBitWidth() / 8;
+  };
+  for (auto attribution : funcOp.getWorkgroupAttributions())
+    addSize(attribution.getType().cast<MemRefType>());
+  funcOp.walk([&](AllocOp allocOp) { addSize(allocOp.getType()); });
+  return numBytes;
+}
+
+void KernelLaunchBoundsPass::runOnOperation() {
+  ModuleOp moduleOp = getOperation();
+  if (wavefrontSize == 0) {
+    moduleOp.emitError("expected a positive wavefront size");
+    return signalPassFailure();
+  }
+
+  // Compute the maximal number of threads of every kernel (kernels launched
+  // with a dynamic block size are marked by a negative number of threads
+  // and keep the default bounds)
+  DenseMap<Operation *, int64_t> maxThreads;
+  moduleOp.walk([&](gpu::LaunchFuncOp launchOp) {
+    auto funcOp = SymbolTable::lookupNearestSymbolFrom<gpu::GPUFuncOp>(
+        launchOp, launchOp.kernel());
+    if (!funcOp)
+      return;
+    auto numThreads = getNumThreads(launchOp);
+    if (!numThreads.hasValue()) {
+      maxThreads[funcOp] = -1;
+      return;
+    }
+    if (numThreads.getValue() % wavefrontSize != 0)
+      launchOp.emitWarning("the block size ")
+          << numThreads.getValue()
+          << " is not a multiple of the wavefront size " << wavefrontSize;
+    auto it = maxThreads.try_emplace(funcOp, numThreads.getValue()).first;
+    if (it->second >= 0)
+      it->second = std::max(it->second, numThreads.getValue());
+  });
+
+  // Annotate the kernels and check the workgroup memory budget
+  bool exceedsBudget = false;
+  OpBuilder builder(moduleOp.getContext());
+  moduleOp.walk([&](gpu::GPUFuncOp funcOp) {
+    if (!funcOp.isKernel())
+      return;
+    if (maxThreads.lookup(funcOp) > 0)
+      funcOp->setAttr(kernelMaxThreadsAttrName,
+                      builder.getI64IntegerAttr(maxThreads.lookup(funcOp)));
+    int64_t numBytes = getWorkgroupMemorySize(funcOp);
+    if (workgroupMemorySize > 0 && numBytes > workgroupMemorySize) {
+      funcOp.emitOpError("allocates ")
+          << numBytes << " bytes of workgroup memory exceeding the "
+          << workgroupMemorySize << " bytes of the target";
+      exceedsBudget = true;
+    }
+  });
+  if (exceedsBudget)
+    signalPassFailure();
+}
+
+} // namespace
+
+std::unique_ptr<OperationPass<ModuleOp>> mlir::createKernelLaunchBoundsPass() {
+  return std::make_unique<KernelLaunchBoundsPass>();
+}
+
+std::unique_ptr<OperationPass<ModuleOp>>
+mlir::createKernelLaunchBoundsPass(unsigned wavefrontSize,
+                                   int64_t workgroupMemorySize) {
+  return std::make_unique<KernelLaunchBoundsPass>(wavefrontSize,
+                                                  workgroupMemorySize);
+}
@@ -0,0 +1,14 @@
+#ifndef CONVERSION_LOOPSTOGPU_PASSDETAIL_H_
+#define CONVERSION_LOOPSTOGPU_PASSDETAIL_H_
+
+#include "mlir/Dialect/GPU/GPUDialect.h"
+#include "mlir/Pass/Pass.h"
+
+namespace mlir {
+
+#define GEN_PASS_CLASSES
+#include "Conversion/LoopsToGPU/Passes.h.inc"
+
+} // end namespace mlir
+
+#endif // CONVERSION_LOOPSTOGPU_PASSDETAIL_H_
@@ -0,0 +1,46 @@
+#include "Conversion/LoopsToGPU/Passes.h"
+#include "PassDetail.h"
+#include "mlir/Dialect/GPU/GPUDialect.h"
+#include "mlir/Dialect/StandardOps/IR/Ops.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Support/LLVM.h"
+
+using namespace mlir;
+
+namespace {
+
+/// Replace the workgroup memory allocations of the kernel functions by
+/// workgroup memory attributions (the allocations are introduced by the
+/// stencil to standard lowering if the inputs are staged in workgroup memory)
+struct PromoteWorkgroupAllocationsPass
+    : public PromoteWorkgroupAllocationsPassBase<
+          PromoteWorkgroupAllocationsPass> {
+  void runOnOperation() override {
+    getOperation().walk([&](gpu::GPUFuncOp funcOp) {
+      // Collect the static workgroup memory allocations
+      SmallVector<AllocOp, 4> allocOps;
+      funcOp.walk([&](AllocOp allocOp) {
+        auto memRefType = allocOp.getType();
+        if (memRefType.hasStaticShape() &&
+            memRefType.getMemorySpace() ==
+                gpu::GPUDialect::getWorkgroupAddressSpace())
+          allocOps.push_back(allocOp);
+      });
+      // Replace the allocations by workgroup memory attributions
+      for (auto allocOp : allocOps) {
+        auto attribution = funcOp.addWorkgroupAttribution(allocOp.getType());
+        allocOp.getResult().replaceAllUsesWith(attribution);
+        allocOp.erase();
+      }
+    });
+  }
+};
+
+} // namespace
+
+std::unique_ptr<OperationPass<gpu::GPUModuleOp>>
+mlir::createPromoteWorkgroupAllocationsPass() {
+  return std::make_unique<PromoteWorkgroupAllocationsPass>();
+}
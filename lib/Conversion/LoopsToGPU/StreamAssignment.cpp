@@ -0,0 +1,333 @@
+#include "Conversion/LoopsToGPU/Passes.h"
+#include "PassDetail.h"
+#include "mlir/Dialect/GPU/GPUDialect.h"
+#include "mlir/Dialect/StandardOps/IR/Ops.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/SymbolTable.h"
+#include "mlir/IR/Value.h"
+#include "mlir/Interfaces/CallInterfaces.h"
+#include "mlir/Interfaces/SideEffectInterfaces.h"
+#include "mlir/Interfaces/ViewLikeInterface.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Support/LLVM.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include <cstdint>
+#include <limits>
+
+using namespace mlir;
+
+namespace {
+
+// Byte range of a device buffer accessed by a kernel
+struct MemoryRange {
+  Value base;
+  int64_t begin;
+  int64_t end;
+
+  bool overlaps(const MemoryRange &other) const {
+    return base == other.base && begin < other.end && other.begin < end;
+  }
+};
+
+// Access of a device buffer by an asynchronous operation
+struct Access {
+  MemoryRange range;
+  Value token;
+  bool write;
+};
+
+/// Execute the kernels of the host functions asynchronously and place
+/// independent kernels on separate streams (the pass replaces the gpu async
+/// region pass that serializes all kernels on a single stream)
+struct StreamAssignmentPass
+    : public StreamAssignmentPassBase<StreamAssignmentPass> {
+  void runOnOperation() override;
+
+private:
+  void assignStreams(Block &block);
+
+  // Stream bookkeeping
+  Value getLatestToken(Value token) const;
+  void setLatestToken(Value token, unsigned stream);
+  SmallVector<Value, 4> getDependencies(ArrayRef<Access> accesses) const;
+  Value getDependency(ArrayRef<Value> dependencies, Operation *op,
+                      OpBuilder &builder);
+  void synchronize(ArrayRef<Value> dependencies, Operation *op,
+                   OpBuilder &builder);
+  void synchronizeAll(Operation *op, OpBuilder &builder);
+
+  // Stream of every token and latest token of every stream
+  // (the latest token is null after the stream has been synchronized)
+  DenseMap<Value, unsigned> streams;
+  SmallVector<Value, 8> latestTokens;
+  SmallVector<Access, 32> accesses;
+};
+
+// Helper computing the buffer range accessed through a memref
+// (views with a constant offset access a subrange of the allocation while
+// all other views conservatively access the entire allocation)
+static MemoryRange getMemoryRange(Value memref) {
+  Operation *definingOp = memref.getDefiningOp();
+  if (auto viewOp = dyn_cast_or_null<ViewOp>(definingOp)) {
+    auto range = getMemoryRange(viewOp.source());
+    auto shiftOp = viewOp.byte_shift().getDefiningOp<ConstantIndexOp>();
+    auto viewType = viewOp.getType();
+    if (shiftOp && viewType.hasStaticShape() &&
+        viewType.getElementType().isIntOrFloat() &&
+        range.end != std::numeric_limits<int64_t>::max()) {
+      int64_t size = viewType.getNumElements() *
+                     ((viewType.getElementTypeBitWidth() + 7) / 8);
+      range.begin += shiftOp.getValue();
+      range.end = range.begin + size;
+    }
+    return range;
+  }
+  if (auto castOp = dyn_cast_or_null<MemRefCastOp>(definingOp))
+    return getMemoryRange(castOp.source());
+  if (auto viewOp = dyn_cast_or_null<ViewLikeOpInterface>(definingOp))
+    return getMemoryRange(viewOp.getViewSource());
+
+  // Compute the size of static allocations to support the arena views
+  auto memRefType = memref.getType().cast<MemRefType>();
+  if (definingOp && memRefType.hasStaticShape() &&
+      memRefType.getElementType().isIntOrFloat())
+    return {memref, 0,
+            memRefType.getNumElements() *
+                ((memRefType.getElementTypeBitWidth() + 7) / 8)};
+  return {memref, 0, std::numeric_limits<int64_t>::max()};
+}
+
+// Helper returning true if the kernel argument may be written
+static bool isWritten(Value argument) {
+  for (auto &use : argument.getUses()) {
+    Operation *user = use.getOwner();
+    if (isa<LoadOp>(user))
+      continue;
+    if (auto storeOp = dyn_cast<StoreOp>(user)) {
+      if (storeOp.memref() == argument)
+        return true;
+      continue;
+    }
+    if (isa<ViewLikeOpInterface, MemRefCastOp>(user)) {
+      if (isWritten(user->getResult(0)))
+        return true;
+      continue;
+    }
+    return true;
+  }
+  return false;
+}
+
+// Helper collecting the buffer accesses of an asynchronous operation
+static SmallVector<Access, 8> getAccesses(Operation *op) {
+  SmallVector<Access, 8> result;
+  if (auto launchOp = dyn_cast<gpu::LaunchFuncOp>(op)) {
+    // Analyze the kernel body to distinguish read and written arguments
+    auto funcOp = SymbolTable::lookupNearestSymbolFrom<gpu::GPUFuncOp>(
+        op, launchOp.kernel());
+    for (unsigned i = 0, e = launchOp.getNumKernelOperands(); i != e; ++i) {
+      Value operand = launchOp.getKernelOperand(i);
+      if (!operand.getType().isa<MemRefType>())
+        continue;
+      bool write = !funcOp || funcOp.getNumArguments() != e ||
+                   isWritten(funcOp.getArgument(i));
+      result.push_back({getMemoryRange(operand), Value(), write});
+    }
+    return result;
+  }
+  // Conservatively assume all other operations write their operands
+  for (auto operand : op->getOperands()) {
+    if (operand.getType().isa<MemRefType>())
+      result.push_back({getMemoryRange(operand), Value(), true});
+  }
+  return result;
+}
+
+// Helper replacing an operation by an asynchronous clone (the gpu ops
+// declare the async token after their other results)
+static Value makeAsync(Operation *op, Value dependency, OpBuilder &builder) {
+  cast<gpu::AsyncOpInterface>(op).addAsyncDependency(dependency);
+  SmallVector<Type, 2> resultTypes(op->result_type_begin(),
+                                   op->result_type_end());
+  resultTypes.push_back(dependency.getType());
+  auto *newOp = Operation::create(op->getLoc(), op->getName(), resultTypes,
+                                  op->getOperands(), op->getMutableAttrDict(),
+                                  op->getSuccessors());
+  builder.setInsertionPoint(op);
+  builder.insert(newOp);
+  op->replaceAllUsesWith(newOp->getResults().drop_back());
+  op->erase();
+  return cast<gpu::AsyncOpInterface>(newOp).getAsyncToken();
+}
+
+Value StreamAssignmentPass::getLatestToken(Value token) const {
+  auto it = streams.find(token);
+  return it == streams.end() ? Value() : latestTokens[it->second];
+}
+
+void StreamAssignmentPass::setLatestToken(Value token, unsigned stream) {
+  streams[token] = stream;
+  latestTokens[stream] = token;
+}
+
+SmallVector<Value, 4>
+StreamAssignmentPass::getDependencies(ArrayRef<Access> current) const {
+  // Find the conflicting accesses of the streams that are not synchronized
+  SmallVector<Value, 4> dependencies;
+  for (auto &access : accesses) {
+    if (!getLatestToken(access.token))
+      continue;
+    if (llvm::any_of(current, [&](const Access &other) {
+          return (access.write || other.write) &&
+                 access.range.overlaps(other.range);
+        }))
+      dependencies.push_back(access.token);
+  }
+  // Keep only the last dependency of every stream
+  SmallVector<Value, 4> result;
+  for (auto dependency : dependencies) {
+    unsigned stream = streams.lookup(dependency);
+    auto it = llvm::find_if(
+        result, [&](Value token) { return streams.lookup(token) == stream; });
+    if (it == result.end())
+      result.push_back(dependency);
+    else if ((*it).getDefiningOp()->isBeforeInBlock(
+                 dependency.getDefiningOp()))
+      *it = dependency;
+  }
+  return result;
+}
+
+Value StreamAssignmentPass::getDependency(ArrayRef<Value> dependencies,
+                                          Operation *op, OpBuilder &builder) {
+  // Continue the stream if the operation only depends on its latest token
+  if (dependencies.size() == 1 &&
+      getLatestToken(dependencies.front()) == dependencies.front())
+    return dependencies.front();
+
+  // Otherwise, start a new stream that waits for the dependencies right
+  // after the last dependency to avoid waiting for later unrelated kernels
+  Operation *lastOp = dependencies.front().getDefiningOp();
+  for (auto dependency : dependencies) {
+    if (lastOp->isBeforeInBlock(dependency.getDefiningOp()))
+      lastOp = dependency.getDefiningOp();
+  }
+  OpBuilder::InsertionGuard guard(builder);
+  builder.setInsertionPointAfter(lastOp);
+  auto waitOp = builder.create<gpu::WaitOp>(
+      op->getLoc(), builder.getType<gpu::AsyncTokenType>(), dependencies);
+  Value token = waitOp.asyncToken();
+  latestTokens.push_back(Value());
+  setLatestToken(token, latestTokens.size() - 1);
+  return token;
+}
+
+void StreamAssignmentPass::synchronize(ArrayRef<Value> dependencies,
+                                       Operation *op, OpBuilder &builder) {
+  if (dependencies.empty())
+    return;
+  // Wait for the latest token of the streams since the lowering destroys
+  // the streams after the synchronization
+  SmallVector<Value, 4> tokens;
+  for (auto dependency : dependencies) {
+    unsigned stream = streams.lookup(dependency);
+    tokens.push_back(latestTokens[stream]);
+    latestTokens[stream] = Value();
+  }
+  builder.setInsertionPoint(op);
+  builder.create<gpu::WaitOp>(op->getLoc(), Type(), tokens);
+}
+
+void StreamAssignmentPass::synchronizeAll(Operation *op, OpBuilder &builder) {
+  SmallVector<Value, 4> tokens;
+  for (auto token : latestTokens) {
+    if (token)
+      tokens.push_back(token);
+  }
+  synchronize(tokens, op, builder);
+}
+
+void StreamAssignmentPass::assignStreams(Block &block) {
+  OpBuilder builder(block.getParent()->getContext());
+  auto tokenType = builder.getType<gpu::AsyncTokenType>();
+  streams.clear();
+  latestTokens.clear();
+  accesses.clear();
+
+  for (auto &op : llvm::make_early_inc_range(block)) {
+    // Synchronize the streams before all host operations that may access
+    // the device buffers
+    if (!isa<gpu::AsyncOpInterface>(op)) {
+      if (op.isKnownTerminator() || op.getNumRegions() != 0 ||
+          isa<CallOpInterface>(op) ||
+          !isa<MemoryEffectOpInterface>(op)) {
+        synchronizeAll(&op, builder);
+        continue;
+      }
+      if (!MemoryEffectOpInterface::hasNoEffect(&op))
+        synchronize(getDependencies(getAccesses(&op)), &op, builder);
+      continue;
+    }
+
+    // Complete the allocations on a separate stream
+    builder.setInsertionPoint(&op);
+    if (isa<gpu::AllocOp>(op)) {
+      Value token =
+          builder.create<gpu::WaitOp>(op.getLoc(), tokenType, ValueRange())
+              .asyncToken();
+      Operation *nextOp = op.getNextNode();
+      token = makeAsync(&op, token, builder);
+      builder.setInsertionPoint(nextOp);
+      builder.create<gpu::WaitOp>(token.getLoc(), Type(), token);
+      continue;
+    }
+
+    // Execute the operation after the conflicting accesses
+    auto current = getAccesses(&op);
+    auto dependencies = getDependencies(current);
+    Value dependency;
+    if (dependencies.empty()) {
+      dependency =
+          builder.create<gpu::WaitOp>(op.getLoc(), tokenType, ValueRange())
+              .asyncToken();
+      latestTokens.push_back(Value());
+      setLatestToken(dependency, latestTokens.size() - 1);
+    } else {
+      dependency = getDependency(dependencies, &op, builder);
+    }
+    unsigned stream = streams.lookup(dependency);
+    Value token = makeAsync(&op, dependency, builder);
+    setLatestToken(token, stream);
+    for (auto &access : current) {
+      access.token = token;
+      accesses.push_back(access);
+    }
+  }
+}
+
+void StreamAssignmentPass::runOnOperation() {
+  for (auto funcOp : getOperation().getOps<FuncOp>()) {
+    // Skip the functions that execute asynchronously already
+    bool isAsync = false;
+    funcOp.walk([&](gpu::AsyncOpInterface asyncOp) {
+      if (isa<gpu::WaitOp>(asyncOp.getOperation()) ||
+          asyncOp.getAsyncToken())
+        isAsync = true;
+    });
+    if (isAsync)
+      continue;
+    for (auto &block : funcOp.getBlocks())
+      assignStreams(block);
+  }
+}
+
+} // namespace
+
+std::unique_ptr<OperationPass<ModuleOp>> mlir::createStreamAssignmentPass() {
+  return std::make_unique<StreamAssignmentPass>();
+}
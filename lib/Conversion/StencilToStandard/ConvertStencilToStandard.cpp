@@ -1,5 +1,6 @@
 #include "Conversion/StencilToStandard/ConvertStencilToStandard.h"
 #include "Conversion/StencilToStandard/Passes.h"
+#include "Dialect/Stencil/StencilAnalysis.h"
 #include "Dialect/Stencil/StencilDialect.h"
 #include "Dialect/Stencil/StencilOps.h"
 #include "Dialect/Stencil/StencilTypes.h"
@@ -15,6 +16,7 @@
 #include "mlir/IR/BuiltinOps.h"
 #include "mlir/IR/MLIRContext.h"
 #include "mlir/IR/PatternMatch.h"
+#include "mlir/IR/SymbolTable.h"
 #include "mlir/IR/TypeRange.h"
 #include "mlir/IR/UseDefLists.h"
 #include "mlir/IR/Value.h"
@@ -23,15 +25,21 @@
 #include "mlir/Support/LLVM.h"
 #include "mlir/Support/LogicalResult.h"
 #include "mlir/Transforms/DialectConversion.h"
+#include "llvm/ADT/APFloat.h"
+#include "llvm/ADT/APInt.h"
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/None.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/iterator_range.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/MathExtras.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 #include <cstdint>
 #include <functional>
 #include <iterator>
+#include <map>
+#include <numeric>
 #include <tuple>
 
 using namespace mlir;
@@ -40,6 +48,81 @@ using namespace scf;
 
 namespace {
 
+// Attributes tagging the output allocations of fused reductions
+constexpr char cReduceKindAttr[] = "stencil.reduce_kind";
+constexpr char cReduceAllocationAttr[] = "stencil.reduce_allocation";
+// Attribute tagging the private accumulators of the reduced results
+constexpr char cReduceAccumulatorAttr[] = "stencil.reduce_accumulator";
+
+// Helper returning the neutral element of the combining function
+static Value createIdentity(StringRef kind, Type type, Location loc,
+                            OpBuilder &builder) {
+  if (auto floatType = type.dyn_cast<FloatType>()) {
+    if (kind == "add")
+      return builder.create<ConstantOp>(loc, builder.getFloatAttr(type, 0.0));
+    auto inf = APFloat::getInf(floatType.getFloatSemantics(), kind == "max");
+    return builder.create<ConstantOp>(loc, builder.getFloatAttr(type, inf));
+  }
+  unsigned width = type.getIntOrFloatBitWidth();
+  APInt value = kind == "add"   ? APInt(width, 0)
+                : kind == "max" ? APInt::getSignedMinValue(width)
+                                : APInt::getSignedMaxValue(width);
+  return builder.create<ConstantOp>(loc, builder.getIntegerAttr(type, value));
+}
+
+// Helper combining two values with the combining function
+static Value createCombine(StringRef kind, Value lhs, Value rhs, Location loc,
+                           OpBuilder &builder) {
+  bool isFloat = lhs.getType().isa<FloatType>();
+  if (kind == "add") {
+    if (isFloat)
+      return builder.create<AddFOp>(loc, lhs, rhs);
+    return builder.create<AddIOp>(loc, lhs, rhs);
+  }
+  Value cmpOp;
+  if (isFloat)
+    cmpOp = builder.create<CmpFOp>(
+        loc, kind == "max" ? CmpFPredicate::OGT : CmpFPredicate::OLT, lhs, rhs);
+  else
+    cmpOp = builder.create<CmpIOp>(
+        loc, kind == "max" ? CmpIPredicate::sgt : CmpIPredicate::slt, lhs, rhs);
+  return builder.create<SelectOp>(loc, cmpOp, lhs, rhs);
+}
+
+// Helper combining a value atomically with the memory location
+// (use the native atomics if available and a compare and swap loop otherwise)
+static void createAtomicCombine(StringRef kind, Value value, Value memref,
+                                ValueRange indices, Location loc,
+                                OpBuilder &builder) {
+  bool isFloat = value.getType().isa<FloatType>();
+  if (kind == "add" || !isFloat) {
+    AtomicRMWKind rmwKind = kind == "max"   ? AtomicRMWKind::maxs
+                            : kind == "min" ? AtomicRMWKind::mins
+                            : isFloat       ? AtomicRMWKind::addf
+                                            : AtomicRMWKind::addi;
+    builder.create<AtomicRMWOp>(loc, value.getType(), rmwKind, value, memref,
+                                indices);
+    return;
+  }
+  auto atomicOp = builder.create<GenericAtomicRMWOp>(loc, memref, indices);
+  OpBuilder::InsertionGuard guard(builder);
+  builder.setInsertionPointToEnd(&atomicOp.body().front());
+  Value result =
+      createCombine(kind, value, atomicOp.getCurrentValue(), loc, builder);
+  builder.create<AtomicYieldOp>(loc, result);
+}
+
+// Helper returning the private accumulator of a return op operand if the
+// loop nest accumulates the reduction per thread
+static Value getAccumulator(ParallelOp parallelOp, unsigned operandNumber) {
+  for (auto allocaOp : parallelOp.getBody()->getOps<AllocaOp>()) {
+    auto attr = allocaOp->getAttrOfType<IntegerAttr>(cReduceAccumulatorAttr);
+    if (attr && attr.getInt() == operandNumber)
+      return allocaOp.getResult();
+  }
+  return nullptr;
+}
+
 //===----------------------------------------------------------------------===//
 // Rewriting Pattern
 //===----------------------------------------------------------------------===//
@@ -63,8 +146,21 @@ public:
                           funcOp.getType().getResults());
 
     // Replace the function by a function with an updated signature
+    // (keep the attributes of the functions calling the stencil programs)
+    SmallVector<NamedAttribute, 4> attrs;
+    if (!StencilDialect::isStencilProgram(funcOp)) {
+      for (auto attr : funcOp.getAttrs()) {
+        if (attr.first != SymbolTable::getSymbolAttrName() &&
+            attr.first != FuncOp::getTypeAttrName())
+          attrs.push_back(attr);
+      }
+    }
     auto newFuncOp =
-        rewriter.create<FuncOp>(loc, funcOp.getName(), funcType, llvm::None);
+        rewriter.create<FuncOp>(loc, funcOp.getName(), funcType, attrs);
+    if (funcOp.isExternal()) {
+      rewriter.eraseOp(funcOp);
+      return success();
+    }
     rewriter.inlineRegionBefore(funcOp.getBody(), newFuncOp.getBody(),
                                 newFuncOp.end());
 
@@ -75,6 +171,26 @@ public:
   }
 };
 
+class CallOpLowering : public StencilOpToStdPattern<CallOp> {
+public:
+  using StencilOpToStdPattern<CallOp>::StencilOpToStdPattern;
+
+  LogicalResult
+  matchAndRewrite(Operation *operation, ArrayRef<Value> operands,
+                  ConversionPatternRewriter &rewriter) const override {
+    auto callOp = cast<CallOp>(operation);
+
+    // Replace the call by a call taking the converted operands
+    SmallVector<Type, 4> resultTypes;
+    if (failed(typeConverter.convertTypes(callOp.getResultTypes(),
+                                          resultTypes)))
+      return failure();
+    rewriter.replaceOpWithNewOp<CallOp>(operation, callOp.getCallee(),
+                                        resultTypes, operands);
+    return success();
+  }
+};
+
 class YieldOpLowering : public StencilOpToStdPattern<scf::YieldOp> {
 public:
   using StencilOpToStdPattern<scf::YieldOp>::StencilOpToStdPattern;
@@ -210,6 +326,16 @@ public:
   }
 };
 
+/// This struct stores the accesses to the same column of an apply op operand
+/// (the vertical offsets of the accesses span the vertical window)
+struct VerticalWindow {
+  unsigned index;
+  Index offset;
+  int64_t kmin;
+  int64_t kmax;
+  SmallVector<stencil::AccessOp, 4> accessOps;
+};
+
 class ApplyOpLowering : public StencilOpToStdPattern<stencil::ApplyOp> {
 public:
   using StencilOpToStdPattern<stencil::ApplyOp>::StencilOpToStdPattern;
@@ -224,10 +350,401 @@ public:
       return std::make_tuple(bufferOp.temp(),
                              cast<ShapeOp>(bufferOp.getOperation()));
     }
+    if (auto reduceOp = getUserOp<stencil::ReduceOp>(value)) {
+      return std::make_tuple(reduceOp.temp(),
+                             cast<ShapeOp>(reduceOp.getOperation()));
+    }
+    if (auto scanOp = getUserOp<stencil::ScanOp>(value)) {
+      return std::make_tuple(scanOp.temp(),
+                             cast<ShapeOp>(scanOp.getOperation()));
+    }
     llvm_unreachable("expected a valid storage operation");
     return std::make_tuple(nullptr, nullptr);
   }
 
+  // Check if the operand can be staged in workgroup memory
+  bool isStagingPossible(stencil::ApplyOp applyOp, unsigned index,
+                         const AccessExtents &extents) const {
+    auto arg = applyOp.getBody()->getArgument(index);
+    auto tempType = arg.getType().dyn_cast<TempType>();
+    if (!tempType || !extents.lookupExtent(applyOp.getOperation(),
+                                           applyOp.getOperand(index)))
+      return false;
+    // Require all dimensions are allocated and the accesses are static
+    // (unless the dynamic accesses are trusted to stay within their bounds)
+    return llvm::all_of(tempType.getAllocation(), [](bool x) { return x; }) &&
+           (options.stageDynAccess ||
+            llvm::none_of(arg.getUsers(), [](Operation *op) {
+              return isa<stencil::DynAccessOp>(op);
+            }));
+  }
+
+  // Lower the apply op to a tile loop and a point loop and stage the inputs
+  // including their halo in workgroup memory before computing the points
+  void lowerToStagedLoopNest(stencil::ApplyOp applyOp, ArrayRef<Value> operands,
+                             ValueRange lbs, ValueRange ubs,
+                             ConversionPatternRewriter &rewriter) const {
+    auto loc = applyOp.getLoc();
+    auto shapeOp = cast<ShapeOp>(applyOp.getOperation());
+    int64_t rank = shapeOp.getRank();
+
+    // Compute the bounds of the point loop
+    SmallVector<Value, 3> zeros, ones, tileSizes;
+    for (int64_t i = 0; i != rank; ++i) {
+      zeros.push_back(rewriter.create<ConstantIndexOp>(loc, 0));
+      ones.push_back(rewriter.create<ConstantIndexOp>(loc, 1));
+      tileSizes.push_back(
+          rewriter.create<ConstantIndexOp>(loc, options.tileSizes[i]));
+    }
+
+    // Replace the stencil apply operation by a tile loop
+    auto tileOp = rewriter.create<ParallelOp>(loc, lbs, ubs, tileSizes);
+    rewriter.setInsertionPointToStart(tileOp.getBody());
+
+    // Allocate workgroup memory for the tile and the halo of the inputs
+    struct StagedInput {
+      unsigned index;
+      Value buffer;
+      Index inputLB;
+      Index negative;
+      Index positive;
+      Index shape;
+    };
+    SmallVector<StagedInput, 10> stagedInputs;
+    AccessExtents extents(applyOp.getOperation());
+    int64_t stagedBytes = 0;
+    for (unsigned i = 0, e = applyOp.getNumOperands(); i != e; ++i) {
+      if (!isStagingPossible(applyOp, i, extents))
+        continue;
+      auto extent =
+          extents.lookupExtent(applyOp.getOperation(), applyOp.getOperand(i));
+      StagedInput input;
+      input.index = i;
+      input.inputLB = valueToLB[applyOp.getBody()->getArgument(i)];
+      input.negative = extent->negative;
+      input.positive = extent->positive;
+      input.shape = applyFunElementWise(
+          options.tileSizes,
+          applyFunElementWise(extent->positive, extent->negative,
+                              std::minus<int64_t>()),
+          std::plus<int64_t>());
+      // Order the buffer dimensions like the memref dimensions
+      Index memRefShape;
+      SmallVector<bool, 3> allocation(rank, true);
+      for (auto dim : options.getMemRefDims(allocation))
+        memRefShape.push_back(input.shape[dim]);
+      auto elementType =
+          applyOp.getOperand(i).getType().cast<TempType>().getElementType();
+      // Read the inputs that exceed the workgroup memory budget from memory
+      int64_t numBytes =
+          std::accumulate(input.shape.begin(), input.shape.end(),
+                          int64_t{elementType.getIntOrFloatBitWidth() / 8},
+                          std::multiplies<int64_t>());
+      if (options.workgroupMemorySize > 0 &&
+          stagedBytes + numBytes > options.workgroupMemorySize)
+        continue;
+      stagedBytes += numBytes;
+      auto bufferType =
+          MemRefType::get(memRefShape, elementType, {},
+                          gpu::GPUDialect::getWorkgroupAddressSpace());
+      input.buffer = rewriter.create<AllocOp>(loc, bufferType);
+      stagedInputs.push_back(input);
+    }
+
+    // Introduce the point loop and compute the index variables
+    auto pointOp = rewriter.create<ParallelOp>(loc, zeros, tileSizes, ones);
+    rewriter.setInsertionPointToStart(pointOp.getBody());
+    auto fwdExpr = rewriter.getAffineDimExpr(0) + rewriter.getAffineDimExpr(1);
+    auto fwdMap = AffineMap::get(2, 0, fwdExpr);
+    SmallVector<Value, 3> inductionVars;
+    for (int64_t i = 0; i != rank; ++i) {
+      SmallVector<Value, 2> params = {tileOp.getInductionVars()[i],
+                                      pointOp.getInductionVars()[i]};
+      inductionVars.push_back(
+          rewriter.create<AffineApplyOp>(loc, fwdMap, params));
+    }
+
+    // Linearize the point index to distribute the copies among the threads
+    // (use standard operations since the induction variable computation
+    // searches the affine apply operations of the point loop)
+    int64_t numThreads = std::accumulate(options.tileSizes.begin(),
+                                         options.tileSizes.end(), int64_t{1},
+                                         std::multiplies<int64_t>());
+    Value threadId = pointOp.getInductionVars()[rank - 1];
+    for (int64_t i = rank - 2; i >= 0; --i) {
+      threadId = rewriter.create<AddIOp>(
+          loc, rewriter.create<MulIOp>(loc, threadId, tileSizes[i]),
+          pointOp.getInductionVars()[i]);
+    }
+    auto threadStep = rewriter.create<ConstantIndexOp>(loc, numThreads);
+
+    // Copy the input tiles including their halo to workgroup memory
+    for (auto &input : stagedInputs) {
+      int64_t volume =
+          std::accumulate(input.shape.begin(), input.shape.end(), int64_t{1},
+                          std::multiplies<int64_t>());
+      auto forOp = rewriter.create<ForOp>(
+          loc, threadId, rewriter.create<ConstantIndexOp>(loc, volume),
+          threadStep);
+      rewriter.setInsertionPointToStart(forOp.getBody());
+
+      // Delinearize the copy index and compute the input index
+      Value linear = forOp.getInductionVar();
+      Value inBounds;
+      SmallVector<Value, 3> srcValues, dstValues;
+      for (int64_t i = 0; i != rank; ++i) {
+        auto size = rewriter.create<ConstantIndexOp>(loc, input.shape[i]);
+        Value local = rewriter.create<SignedRemIOp>(loc, linear, size);
+        linear = rewriter.create<SignedDivIOp>(loc, linear, size);
+        auto shift = rewriter.create<ConstantIndexOp>(
+            loc, input.negative[i] - input.inputLB[i]);
+        Value src = rewriter.create<AddIOp>(
+            loc,
+            rewriter.create<AddIOp>(loc, tileOp.getInductionVars()[i], shift),
+            local);
+        // Skip the points beyond the halo of the last tile
+        auto bound = rewriter.create<ConstantIndexOp>(
+            loc, shapeOp.getUB()[i] + input.positive[i] - input.inputLB[i]);
+        Value cmpOp =
+            rewriter.create<CmpIOp>(loc, CmpIPredicate::slt, src, bound);
+        inBounds =
+            inBounds ? rewriter.create<AndOp>(loc, inBounds, cmpOp).getResult()
+                     : cmpOp;
+        srcValues.push_back(src);
+        dstValues.push_back(local);
+      }
+      // Order the indices like the memref dimensions
+      SmallVector<Value, 3> srcIndex, dstIndex;
+      SmallVector<bool, 3> allocation(rank, true);
+      for (auto dim : options.getMemRefDims(allocation)) {
+        srcIndex.push_back(srcValues[dim]);
+        dstIndex.push_back(dstValues[dim]);
+      }
+      auto ifOp = rewriter.create<scf::IfOp>(loc, TypeRange(), inBounds, false);
+      rewriter.setInsertionPointToStart(ifOp.getBody(0));
+      auto loadOp =
+          rewriter.create<mlir::LoadOp>(loc, operands[input.index], srcIndex);
+      rewriter.create<mlir::StoreOp>(loc, loadOp.getResult(), input.buffer,
+                                     dstIndex);
+      rewriter.setInsertionPointAfter(forOp);
+    }
+    if (!stagedInputs.empty())
+      rewriter.create<gpu::BarrierOp>(loc);
+
+    // Compute the points of the tile that are part of the domain
+    Value inDomain;
+    for (int64_t i = 0; i != rank; ++i) {
+      Value cmpOp = rewriter.create<CmpIOp>(loc, CmpIPredicate::slt,
+                                            inductionVars[i], ubs[i]);
+      inDomain =
+          inDomain ? rewriter.create<AndOp>(loc, inDomain, cmpOp).getResult()
+                   : cmpOp;
+    }
+    auto guardOp =
+        rewriter.create<scf::IfOp>(loc, TypeRange(), inDomain, false);
+
+    // Convert the signature of the apply op body
+    // (access the staged inputs relative to the tile origin)
+    SmallVector<Value, 10> inputs(operands.begin(), operands.end());
+    for (auto &input : stagedInputs) {
+      inputs[input.index] = input.buffer;
+      valueToLB[applyOp.getBody()->getArgument(input.index)] = input.negative;
+    }
+    TypeConverter::SignatureConversion result(applyOp.getNumOperands());
+    for (auto &en : llvm::enumerate(inputs)) {
+      result.remapInput(en.index(), en.value());
+    }
+    rewriter.applySignatureConversion(&applyOp.region(), result);
+    rewriter.mergeBlockBefore(applyOp.getBody(),
+                              guardOp.getBody(0)->getTerminator());
+  }
+
+  // Check if all results are reduced along the vertical dimension
+  bool isVerticalReduction(stencil::ApplyOp applyOp) const {
+    return llvm::all_of(applyOp.getResults(), [&](Value result) {
+      Value temp;
+      ShapeOp shapeOp;
+      std::tie(temp, shapeOp) = getShapeAndTemporary(result);
+      auto reduceOp = dyn_cast<stencil::ReduceOp>(shapeOp.getOperation());
+      return reduceOp && !reduceOp.field()
+                              .getType()
+                              .cast<GridType>()
+                              .getAllocation()[kKDimension];
+    });
+  }
+
+  // Collect the vertical windows that span more than one vertical offset
+  SmallVector<VerticalWindow, 4>
+  getVerticalWindows(stencil::ApplyOp applyOp) const {
+    std::map<std::tuple<unsigned, int64_t, int64_t>, VerticalWindow> windows;
+    applyOp.walk([&](stencil::AccessOp accessOp) {
+      auto arg = accessOp.temp().cast<BlockArgument>();
+      auto tempType = arg.getType().cast<TempType>();
+      if (!tempType.getAllocation()[kKDimension])
+        return;
+      // Group the accesses by operand and horizontal offset
+      auto offset = cast<OffsetOp>(accessOp.getOperation()).getOffset();
+      auto &window = windows[std::make_tuple(
+          arg.getArgNumber(), offset[kIDimension], offset[kJDimension])];
+      if (window.accessOps.empty()) {
+        window.index = arg.getArgNumber();
+        window.offset = offset;
+        window.kmin = offset[kKDimension];
+        window.kmax = offset[kKDimension];
+      }
+      window.kmin = min(window.kmin, offset[kKDimension]);
+      window.kmax = max(window.kmax, offset[kKDimension]);
+      window.accessOps.push_back(accessOp);
+    });
+    SmallVector<VerticalWindow, 4> result;
+    for (auto &window : windows) {
+      if (window.second.kmin < window.second.kmax)
+        result.push_back(window.second);
+    }
+    return result;
+  }
+
+  // Lower the apply op to a parallel loop over the horizontal dimensions and
+  // a sequential loop over the vertical dimension that carries the values of
+  // the vertical windows from one iteration to the next (if the outputs of
+  // vertical reductions are set, every thread accumulates its column in
+  // private memory and combines the result atomically after the loop)
+  void lowerToSequentialLoopNest(stencil::ApplyOp applyOp,
+                                 ArrayRef<Value> operands, ValueRange lbs,
+                                 ValueRange ubs, ValueRange steps,
+                                 ArrayRef<VerticalWindow> windows,
+                                 ValueRange reduceOutputs,
+                                 ConversionPatternRewriter &rewriter) const {
+    auto loc = applyOp.getLoc();
+    auto returnOp = cast<stencil::ReturnOp>(applyOp.getBody()->getTerminator());
+
+    // Access the top of every window once per iteration
+    SmallVector<Value, 4> topValues;
+    SmallVector<Index, 4> windowLBs;
+    rewriter.setInsertionPointToStart(applyOp.getBody());
+    for (auto &window : windows) {
+      auto arg = applyOp.getBody()->getArgument(window.index);
+      Index offset = window.offset;
+      offset[kKDimension] = window.kmax;
+      topValues.push_back(
+          rewriter.create<stencil::AccessOp>(loc, arg, offset).getResult());
+      windowLBs.push_back(valueToLB[arg]);
+    }
+
+    // Convert the signature of the apply op body
+    TypeConverter::SignatureConversion result(applyOp.getNumOperands());
+    for (auto &en : llvm::enumerate(applyOp.getOperands())) {
+      result.remapInput(en.index(), operands[en.index()]);
+    }
+    rewriter.applySignatureConversion(&applyOp.region(), result);
+
+    // Replace the stencil apply operation by a horizontal parallel loop
+    rewriter.setInsertionPoint(applyOp);
+    auto parallelOp = rewriter.create<ParallelOp>(
+        loc, lbs.take_front(kKDimension), ubs.take_front(kKDimension),
+        steps.take_front(kKDimension));
+    rewriter.setInsertionPointToStart(parallelOp.getBody());
+    auto fwdMap = AffineMap::get(1, 0, rewriter.getAffineDimExpr(0));
+    SmallVector<Value, 3> inductionVars;
+    for (auto inductionVar : parallelOp.getInductionVars()) {
+      inductionVars.push_back(
+          rewriter.create<AffineApplyOp>(loc, fwdMap, inductionVar));
+    }
+    inductionVars.push_back(lbs[kKDimension]);
+
+    // Load the window values of the first vertical iteration
+    SmallVector<Value, 8> initValues;
+    for (auto en : llvm::enumerate(windows)) {
+      auto &window = en.value();
+      auto tempType =
+          applyOp.getOperand(window.index).getType().cast<TempType>();
+      for (int64_t k = window.kmin; k != window.kmax; ++k) {
+        Index offset = window.offset;
+        offset[kKDimension] = k;
+        auto loadOffset = computeIndexValues(
+            inductionVars,
+            applyFunElementWise(offset, windowLBs[en.index()],
+                                std::minus<int64_t>()),
+            tempType.getAllocation(), rewriter);
+        initValues.push_back(rewriter.create<mlir::LoadOp>(
+            loc, operands[window.index], loadOffset));
+      }
+    }
+
+    // Initialize an accumulator for every return op operand of a reduction
+    SmallVector<Value, 4> accumulators;
+    unsigned unrollFac = returnOp.getUnrollFac();
+    for (auto en : llvm::enumerate(returnOp.getOperands())) {
+      if (reduceOutputs.empty())
+        break;
+      auto allocOp = reduceOutputs[en.index() / unrollFac].getDefiningOp();
+      auto kindAttr = allocOp->getAttrOfType<StringAttr>(cReduceKindAttr);
+      auto elementType =
+          en.value().getType().cast<ResultType>().getResultType();
+      auto allocaOp =
+          rewriter.create<AllocaOp>(loc, MemRefType::get({}, elementType));
+      allocaOp->setAttr(cReduceAccumulatorAttr,
+                        rewriter.getI64IntegerAttr(en.index()));
+      rewriter.create<mlir::StoreOp>(
+          loc, createIdentity(kindAttr.getValue(), elementType, loc, rewriter),
+          allocaOp);
+      accumulators.push_back(allocaOp);
+    }
+
+    // Introduce the vertical loop and move the body
+    auto forOp =
+        rewriter.create<ForOp>(loc, lbs[kKDimension], ubs[kKDimension],
+                               steps[kKDimension], initValues);
+    rewriter.mergeBlocks(applyOp.getBody(), forOp.getBody(), llvm::None);
+    rewriter.setInsertionPointToStart(forOp.getBody());
+    rewriter.create<AffineApplyOp>(loc, fwdMap, forOp.getInductionVar());
+
+    // Replace the accesses by the window values and shift the window
+    SmallVector<Value, 8> yieldValues;
+    auto iterArgs = forOp.getRegionIterArgs();
+    unsigned position = 0;
+    for (auto en : llvm::enumerate(windows)) {
+      auto &window = en.value();
+      auto getWindowValue = [&](int64_t k) -> Value {
+        if (k == window.kmax)
+          return topValues[en.index()];
+        return iterArgs[position + k - window.kmin];
+      };
+      for (auto accessOp : window.accessOps) {
+        auto offset = cast<OffsetOp>(accessOp.getOperation()).getOffset();
+        rewriter.replaceOp(accessOp, getWindowValue(offset[kKDimension]));
+      }
+      for (int64_t k = window.kmin + 1; k <= window.kmax; ++k)
+        yieldValues.push_back(getWindowValue(k));
+      position += window.kmax - window.kmin;
+    }
+    rewriter.setInsertionPointToEnd(forOp.getBody());
+    rewriter.create<scf::YieldOp>(loc, yieldValues);
+
+    // Combine the accumulators with the outputs once per thread
+    rewriter.setInsertionPointAfter(forOp);
+    for (auto en : llvm::enumerate(accumulators)) {
+      Value output = reduceOutputs[en.index() / unrollFac];
+      auto allocOp = output.getDefiningOp();
+      auto kindAttr = allocOp->getAttrOfType<StringAttr>(cReduceKindAttr);
+      SmallVector<bool, 3> allocation;
+      for (auto attr :
+           allocOp->getAttrOfType<ArrayAttr>(cReduceAllocationAttr))
+        allocation.push_back(attr.cast<BoolAttr>().getValue());
+      // Compute the store offset like the store result lowering
+      Value partial = rewriter.create<mlir::LoadOp>(loc, en.value());
+      auto lb = valueToLB[returnOp.getOperand(en.index())];
+      llvm::transform(lb, lb.begin(), std::negate<int64_t>());
+      lb = applyFunElementWise(lb, returnOp.getUnrollOffset(en.index() %
+                                                            unrollFac),
+                               std::plus<int64_t>());
+      auto storeOffset =
+          computeIndexValues(inductionVars, lb, allocation, rewriter);
+      createAtomicCombine(kindAttr.getValue(), partial, output, storeOffset,
+                          loc, rewriter);
+    }
+  }
+
   LogicalResult
   matchAndRewrite(Operation *operation, ArrayRef<Value> operands,
                   ConversionPatternRewriter &rewriter) const override {
@@ -242,16 +759,40 @@ public:
       ShapeOp shapeOp;
       std::tie(temp, shapeOp) = getShapeAndTemporary(result);
       auto oldType = temp.getType().cast<TempType>();
-      auto tempType =
-          TempType::get(oldType.getElementType(), oldType.getAllocation(),
-                        shapeOp.getLB(), shapeOp.getUB());
+      // Allocate only the output dimensions if the result is reduced
+      auto allocation = oldType.getAllocation();
+      auto reduceOp = dyn_cast<stencil::ReduceOp>(shapeOp.getOperation());
+      if (reduceOp)
+        allocation =
+            reduceOp.field().getType().cast<GridType>().getAllocation();
+      auto tempType = TempType::get(oldType.getElementType(), allocation,
+                                    shapeOp.getLB(), shapeOp.getUB());
       auto allocType = typeConverter.convertType(tempType).cast<MemRefType>();
       assert(allocType.hasStaticShape() &&
              "expected buffer to have a static shape");
+      // Pad the unit-stride dimension of the buffers to the alignment
+      // (the accesses index the buffer relative to its lower bound and never
+      // touch the padding)
+      if (isa<stencil::BufferOp>(shapeOp.getOperation()) &&
+          options.leadingDimAlignment > 0 && allocType.getRank() > 0) {
+        int64_t elementBytes =
+            llvm::divideCeil(allocType.getElementTypeBitWidth(), 8);
+        int64_t elements =
+            std::max<int64_t>(options.leadingDimAlignment / elementBytes, 1);
+        auto paddedShape = llvm::to_vector<3>(allocType.getShape());
+        paddedShape.back() = llvm::alignTo(paddedShape.back(), elements);
+        allocType = MemRefType::get(paddedShape, allocType.getElementType());
+      }
       auto segAttr = rewriter.getNamedAttr(
           "operand_segment_sizes", rewriter.getI32VectorAttr({0, 0, 0}));
       auto allocOp = rewriter.create<gpu::AllocOp>(loc, TypeRange(allocType),
                                                    ValueRange(), segAttr);
+      // Tag the outputs of reductions to combine the results atomically
+      if (reduceOp) {
+        allocOp->setAttr(cReduceKindAttr, reduceOp.kindAttr());
+        allocOp->setAttr(cReduceAllocationAttr,
+                         rewriter.getBoolArrayAttr(allocation));
+      }
       newResults.push_back(allocOp.getResult(0));
     }
 
@@ -268,6 +809,44 @@ public:
       steps.push_back(rewriter.create<ConstantIndexOp>(loc, step));
     }
 
+    // Compute all ensemble members in an additional innermost parallel loop
+    // (the loop has no halo and is mapped after the grid dimensions)
+    if (options.ensembleSize > 0) {
+      lbs.push_back(rewriter.create<ConstantIndexOp>(loc, 0));
+      ubs.push_back(
+          rewriter.create<ConstantIndexOp>(loc, options.ensembleSize));
+      steps.push_back(rewriter.create<ConstantIndexOp>(loc, 1));
+    }
+
+    // Stage the inputs in workgroup memory if tile sizes are set
+    if (!options.tileSizes.empty()) {
+      lowerToStagedLoopNest(applyOp, operands, lbs, ubs, rewriter);
+      rewriter.replaceOp(applyOp, newResults);
+      return success();
+    }
+
+    // Cache the vertical windows if the vertical loop is sequential and
+    // accumulate the vertical reductions per thread instead of combining
+    // every point atomically with the output
+    bool verticalReduction =
+        options.ensembleSize == 0 && isVerticalReduction(applyOp);
+    if ((options.verticalCaching || verticalReduction) &&
+        shapeOp.getRank() == kIndexSize &&
+        (!returnOp.unroll().hasValue() ||
+         returnOp.getUnroll()[kKDimension] == 1)) {
+      SmallVector<VerticalWindow, 4> windows;
+      if (options.verticalCaching)
+        windows = getVerticalWindows(applyOp);
+      if (!windows.empty() || verticalReduction) {
+        lowerToSequentialLoopNest(
+            applyOp, operands, lbs, ubs, steps, windows,
+            verticalReduction ? ValueRange(newResults) : ValueRange(),
+            rewriter);
+        rewriter.replaceOp(applyOp, newResults);
+        return success();
+      }
+    }
+
     // Convert the signature of the apply op body
     // (access the apply op operands and introduce the loop indicies)
     TypeConverter::SignatureConversion result(applyOp.getNumOperands());
@@ -313,19 +892,20 @@ public:
 
     // Iterate over all return op operands of the result
     for (auto opOperand : valueToReturnOpOperands[resultOp.res()]) {
-      // Get the return op and the parallel op
+      // Get the return op and the outermost parallel op
       auto returnOp = cast<stencil::ReturnOp>(opOperand->getOwner());
       auto parallelOp = returnOp->getParentOfType<ParallelOp>();
+      while (parallelOp && parallelOp->getParentOfType<ParallelOp>())
+        parallelOp = parallelOp->getParentOfType<ParallelOp>();
 
       // Check the parent has been lowered
-      if (!isa<ParallelOp>(returnOp->getParentOp()))
+      if (isa<stencil::ApplyOp>(returnOp->getParentOp()))
         return failure();
 
       // Store the result in case there is something to store
       if (resultOp.operands().size() == 1) {
-        // Compute unroll factor and dimension
+        // Compute unroll factor
         auto unrollFac = returnOp.getUnrollFac();
-        size_t unrollDim = returnOp.getUnrollDim();
 
         // Get the output buffer
         gpu::AllocOp allocOp;
@@ -341,7 +921,10 @@ public:
         // Compute the static store offset
         auto lb = valueToLB[opOperand->get()];
         llvm::transform(lb, lb.begin(), std::negate<int64_t>());
-        lb[unrollDim] += opOperand->getOperandNumber() % unrollFac;
+        auto unrollOffset = returnOp.getUnrollOffset(
+            opOperand->getOperandNumber() % unrollFac);
+        for (size_t i = 0, e = lb.size(); i != e; ++i)
+          lb[i] += unrollOffset[i];
 
         // Set the insertion point to the defining op if possible
         auto result = resultOp.operands().front();
@@ -350,12 +933,41 @@ public:
           rewriter.setInsertionPointAfter(result.getDefiningOp());
 
         // Compute the index values and introduce the store operation
+        // (combine the result atomically with the output of reductions)
         auto inductionVars = getInductionVars(operation);
         SmallVector<bool, 3> allocation(lb.size(), true);
+        auto kindAttr = allocOp->getAttrOfType<StringAttr>(cReduceKindAttr);
+        if (kindAttr) {
+          auto allocationAttr =
+              allocOp->getAttrOfType<ArrayAttr>(cReduceAllocationAttr);
+          llvm::transform(
+              allocationAttr, allocation.begin(),
+              [](Attribute attr) { return attr.cast<BoolAttr>().getValue(); });
+        }
+        // (combine the result with the private accumulator instead if the
+        // loop nest accumulates the reduction per thread)
+        Value accumulator;
+        if (kindAttr)
+          accumulator =
+              getAccumulator(parallelOp, opOperand->getOperandNumber());
+        if (accumulator) {
+          Value current = rewriter.create<mlir::LoadOp>(loc, accumulator);
+          rewriter.create<mlir::StoreOp>(
+              loc,
+              createCombine(kindAttr.getValue(), result, current, loc,
+                            rewriter),
+              accumulator);
+          continue;
+        }
         auto storeOffset =
             computeIndexValues(inductionVars, lb, allocation, rewriter);
-        rewriter.create<mlir::StoreOp>(loc, result, allocOp.getResult(0),
-                                       storeOffset);
+        if (kindAttr)
+          createAtomicCombine(kindAttr.getValue(), result,
+                              allocOp.getResult(0), storeOffset, loc,
+                              rewriter);
+        else
+          rewriter.create<mlir::StoreOp>(loc, result, allocOp.getResult(0),
+                                         storeOffset);
       }
     }
 
@@ -398,6 +1010,19 @@ public:
         applyFunElementWise(offsetOp.getOffset(), valueToLB[accessOp.temp()],
                             std::minus<int64_t>());
     auto tempType = accessOp.temp().getType().cast<TempType>();
+
+    // Index the inputs staged in workgroup memory relative to the tile origin
+    // (use standard operations to keep the induction variables unique)
+    auto memRefType = operands[0].getType().cast<MemRefType>();
+    if (memRefType.getMemorySpace() ==
+        gpu::GPUDialect::getWorkgroupAddressSpace()) {
+      auto pointOp = operation->getParentOfType<ParallelOp>();
+      auto tileOp = pointOp->getParentOfType<ParallelOp>();
+      for (auto en : llvm::enumerate(tileOp.getInductionVars())) {
+        inductionVars[en.index()] = rewriter.create<SubIOp>(
+            accessOp.getLoc(), inductionVars[en.index()], en.value());
+      }
+    }
     auto loadOffset = computeIndexValues(inductionVars, totalOffset,
                                          tempType.getAllocation(), rewriter);
 
@@ -424,11 +1049,24 @@ public:
     assert(inductionVars.size() == dynAccessOp.offset().size() &&
            "expected loop nest and access offset to have the same size");
 
+    // Index the inputs staged in workgroup memory relative to the tile origin
+    SmallVector<Value, 3> offsetValues = dynAccessOp.offset();
+    auto memRefType = operands[0].getType().cast<MemRefType>();
+    if (memRefType.getMemorySpace() ==
+        gpu::GPUDialect::getWorkgroupAddressSpace()) {
+      auto pointOp = operation->getParentOfType<ParallelOp>();
+      auto tileOp = pointOp->getParentOfType<ParallelOp>();
+      for (auto en : llvm::enumerate(tileOp.getInductionVars())) {
+        offsetValues[en.index()] = rewriter.create<SubIOp>(
+            dynAccessOp.getLoc(), offsetValues[en.index()], en.value());
+      }
+    }
+
     // Add the negative lower bound to the offset
     auto tempType = dynAccessOp.temp().getType().cast<TempType>();
     auto tempLB = valueToLB[dynAccessOp.temp()];
     llvm::transform(tempLB, tempLB.begin(), std::negate<int64_t>());
-    auto loadOffset = computeIndexValues(dynAccessOp.offset(), tempLB,
+    auto loadOffset = computeIndexValues(offsetValues, tempLB,
                                          tempType.getAllocation(), rewriter);
 
     // Replace the access op by a load op
@@ -501,6 +1139,128 @@ public:
   }
 };
 
+class ReduceOpLowering : public StencilOpToStdPattern<stencil::ReduceOp> {
+public:
+  using StencilOpToStdPattern<stencil::ReduceOp>::StencilOpToStdPattern;
+
+  LogicalResult
+  matchAndRewrite(Operation *operation, ArrayRef<Value> operands,
+                  ConversionPatternRewriter &rewriter) const override {
+    auto loc = operation->getLoc();
+    auto reduceOp = cast<stencil::ReduceOp>(operation);
+
+    // Get the field type
+    auto fieldType = reduceOp.field().getType().cast<FieldType>();
+
+    // Compute the shape of the subview
+    auto subViewShape =
+        computeSubViewShape(fieldType, operation, valueToLB[reduceOp.field()]);
+
+    // Replace the allocation by a subview (the apply op combines its results
+    // atomically with the output and writes no intermediate buffer)
+    auto allocOp = operands[0].getDefiningOp();
+    rewriter.setInsertionPoint(allocOp);
+    Value output = operands[1];
+    if (!std::get<1>(subViewShape).empty())
+      output = rewriter.create<SubViewOp>(
+          loc, operands[1], std::get<0>(subViewShape),
+          std::get<1>(subViewShape), std::get<2>(subViewShape));
+
+    // Initialize the output with the neutral element before the apply op
+    Value identity = createIdentity(reduceOp.kind(),
+                                    fieldType.getElementType(), loc, rewriter);
+    SmallVector<Value, 4> lbs, ubs, steps;
+    for (auto size : std::get<1>(subViewShape)) {
+      lbs.push_back(rewriter.create<ConstantIndexOp>(loc, 0));
+      ubs.push_back(rewriter.create<ConstantIndexOp>(loc, size));
+      steps.push_back(rewriter.create<ConstantIndexOp>(loc, 1));
+    }
+    if (lbs.empty()) {
+      rewriter.create<mlir::StoreOp>(loc, identity, output, ValueRange());
+    } else {
+      auto parallelOp = rewriter.create<ParallelOp>(loc, lbs, ubs, steps);
+      rewriter.setInsertionPointToStart(parallelOp.getBody());
+      rewriter.create<mlir::StoreOp>(loc, identity, output,
+                                     parallelOp.getInductionVars());
+    }
+    rewriter.replaceOp(allocOp, output);
+    rewriter.eraseOp(operation);
+    return success();
+  }
+};
+
+class ScanOpLowering : public StencilOpToStdPattern<stencil::ScanOp> {
+public:
+  using StencilOpToStdPattern<stencil::ScanOp>::StencilOpToStdPattern;
+
+  LogicalResult
+  matchAndRewrite(Operation *operation, ArrayRef<Value> operands,
+                  ConversionPatternRewriter &rewriter) const override {
+    auto loc = operation->getLoc();
+    auto scanOp = cast<stencil::ScanOp>(operation);
+
+    // Get the field type
+    auto fieldType = scanOp.field().getType().cast<FieldType>();
+
+    // Compute the shape of the subview
+    auto subViewShape =
+        computeSubViewShape(fieldType, operation, valueToLB[scanOp.field()]);
+    auto subViewOp = rewriter.create<SubViewOp>(
+        loc, operands[1], std::get<0>(subViewShape), std::get<1>(subViewShape),
+        std::get<2>(subViewShape));
+
+    // Compute the memref dimension of the scan dimension
+    auto memRefDims = options.getMemRefDims(fieldType.getAllocation());
+    unsigned scanDim = std::distance(memRefDims.begin(),
+                                     llvm::find(memRefDims, scanOp.dim()));
+    if (options.ensembleSize > 0)
+      scanDim++;
+
+    // Iterate over the other dimensions in parallel
+    Value zero = rewriter.create<ConstantIndexOp>(loc, 0);
+    Value one = rewriter.create<ConstantIndexOp>(loc, 1);
+    SmallVector<Value, 4> lbs, ubs, steps;
+    for (auto en : llvm::enumerate(std::get<1>(subViewShape))) {
+      if (en.index() == scanDim)
+        continue;
+      lbs.push_back(zero);
+      ubs.push_back(rewriter.create<ConstantIndexOp>(loc, en.value()));
+      steps.push_back(one);
+    }
+    SmallVector<Value, 4> inductionVars;
+    if (!lbs.empty()) {
+      auto parallelOp = rewriter.create<ParallelOp>(loc, lbs, ubs, steps);
+      rewriter.setInsertionPointToStart(parallelOp.getBody());
+      inductionVars.append(parallelOp.getInductionVars().begin(),
+                           parallelOp.getInductionVars().end());
+    }
+
+    // Accumulate the values sequentially along the scan dimension
+    auto elementType = fieldType.getElementType();
+    Value identity = createIdentity(scanOp.kind(), elementType, loc, rewriter);
+    auto forOp = rewriter.create<ForOp>(
+        loc, zero,
+        rewriter.create<ConstantIndexOp>(loc,
+                                         std::get<1>(subViewShape)[scanDim]),
+        one, ValueRange(identity));
+    rewriter.setInsertionPointToStart(forOp.getBody());
+    inductionVars.insert(inductionVars.begin() + scanDim,
+                         forOp.getInductionVar());
+    Value value =
+        rewriter.create<mlir::LoadOp>(loc, operands[0], inductionVars);
+    Value prefix = createCombine(scanOp.kind(), forOp.getRegionIterArgs()[0],
+                                 value, loc, rewriter);
+    rewriter.create<mlir::StoreOp>(loc, prefix, subViewOp, inductionVars);
+    rewriter.create<scf::YieldOp>(loc, prefix);
+
+    // Free the buffer after the scan
+    rewriter.setInsertionPoint(operation);
+    rewriter.create<gpu::DeallocOp>(loc, TypeRange(), ValueRange(operands[0]));
+    rewriter.eraseOp(operation);
+    return success();
+  }
+};
+
 //===----------------------------------------------------------------------===//
 // Conversion Target
 //===----------------------------------------------------------------------===//
@@ -512,7 +1272,13 @@ public:
 
   bool isDynamicallyLegal(Operation *op) const override {
     if (auto funcOp = dyn_cast<FuncOp>(op)) {
-      return !StencilDialect::isStencilProgram(funcOp);
+      return !StencilDialect::isStencilProgram(funcOp) &&
+             llvm::none_of(funcOp.getType().getInputs(),
+                           [](Type type) { return type.isa<GridType>(); });
+    }
+    if (auto callOp = dyn_cast<CallOp>(op)) {
+      return llvm::none_of(callOp.getOperandTypes(),
+                           [](Type type) { return type.isa<GridType>(); });
     }
     if (auto ifOp = dyn_cast<scf::IfOp>(op)) {
       return llvm::none_of(ifOp.getResultTypes(),
@@ -554,6 +1320,8 @@ Index StencilToStandardPass::findLB(Value value) {
       return cast<ShapeOp>(storeOp.getOperation()).getLB();
     if (auto bufferOp = dyn_cast<stencil::BufferOp>(op))
       return cast<ShapeOp>(bufferOp.getOperation()).getLB();
+    if (isa<stencil::ReduceOp, stencil::ScanOp>(op))
+      return cast<ShapeOp>(op).getLB();
   }
   return {};
 }
@@ -605,7 +1373,8 @@ void StencilToStandardPass::runOnOperation() {
     for (auto result : applyOp.getResults()) {
       unsigned storageOps = 0;
       for (auto user : result.getUsers()) {
-        if (isa<stencil::BufferOp>(user) || isa<stencil::StoreOp>(user)) {
+        if (isa<stencil::BufferOp, stencil::StoreOp, stencil::ReduceOp,
+                stencil::ScanOp>(user)) {
           storageOps++;
         }
       }
@@ -633,23 +1402,95 @@ void StencilToStandardPass::runOnOperation() {
   if (storeMappingResult.wasInterrupted())
     return signalPassFailure();
 
-  StencilTypeConverter typeConverter(module.getContext());
-  populateStencilToStdConversionPatterns(typeConverter, valueToLB,
-                                         valueToReturnOpOperands, patterns);
+  // Check the tile sizes if the inputs are staged in workgroup memory
+  StencilToStdOptions options;
+  options.tileSizes.assign(tileSizes.begin(), tileSizes.end());
+  options.verticalCaching = verticalCaching;
+  options.stageDynAccess = stageDynAccess;
+  options.workgroupMemorySize = workgroupMemorySize;
+  options.leadingDimAlignment = leadingDimAlignment;
+  options.ensembleSize = ensembleSize;
+  if (dimensionOrder == "kij") {
+    options.dimensionOrder = {kKDimension, kIDimension, kJDimension};
+  } else if (dimensionOrder != "ijk") {
+    module.emitError("expected ijk or kij dimension order");
+    return signalPassFailure();
+  }
+  if (options.leadingDimAlignment < 0) {
+    module.emitError("expected a non-negative leading dimension alignment");
+    return signalPassFailure();
+  }
+  if (options.ensembleSize < 0) {
+    module.emitError("expected a non-negative ensemble size");
+    return signalPassFailure();
+  }
+  if (options.workgroupMemorySize < 0) {
+    module.emitError("expected a non-negative workgroup memory size");
+    return signalPassFailure();
+  }
+  if (options.ensembleSize > 0 &&
+      (!options.tileSizes.empty() || options.verticalCaching)) {
+    module.emitError("expected no workgroup staging or vertical caching if "
+                     "computing ensembles");
+    return signalPassFailure();
+  }
+  if (!options.tileSizes.empty() && options.verticalCaching) {
+    module.emitError("expected either workgroup staging or vertical caching");
+    return signalPassFailure();
+  }
+  if (!options.tileSizes.empty()) {
+    if (options.tileSizes.size() != kIndexSize ||
+        llvm::any_of(options.tileSizes, [](int64_t x) { return x <= 0; })) {
+      module.emitError("expected three positive workgroup tile sizes");
+      return signalPassFailure();
+    }
+    auto unrollResult = module.walk([&](stencil::ReturnOp returnOp) {
+      if (returnOp.getUnrollFac() > 1) {
+        returnOp.emitOpError("expected no unrolling if staging the inputs");
+        return WalkResult::interrupt();
+      }
+      return WalkResult::advance();
+    });
+    if (unrollResult.wasInterrupted())
+      return signalPassFailure();
+  }
+
+  StencilTypeConverter typeConverter(module.getContext(), options);
+  populateStencilToStdConversionPatterns(
+      typeConverter, valueToLB, valueToReturnOpOperands, options, patterns);
 
   StencilToStdTarget target(*(module.getContext()));
   target.addLegalDialect<AffineDialect>();
   target.addLegalDialect<StandardOpsDialect>();
   target.addLegalDialect<SCFDialect>();
   target.addDynamicallyLegalOp<FuncOp>();
+  target.addDynamicallyLegalOp<CallOp>();
   target.addDynamicallyLegalOp<scf::IfOp>();
   target.addDynamicallyLegalOp<scf::YieldOp>();
   target.addLegalOp<ModuleOp, ModuleTerminatorOp>();
   target.addLegalOp<gpu::AllocOp>();
   target.addLegalOp<gpu::DeallocOp>();
+  target.addLegalOp<gpu::BarrierOp>();
   if (failed(applyFullConversion(module, target, std::move(patterns)))) {
     signalPassFailure();
+    return;
   }
+  module.walk([](AllocaOp allocaOp) {
+    allocaOp->removeAttr(cReduceAccumulatorAttr);
+  });
+
+  // Count the temporaries allocated by the lowering
+  module.walk([&](gpu::AllocOp allocOp) {
+    auto memRefType = allocOp.memref().getType().cast<MemRefType>();
+    numAllocs++;
+    if (!memRefType.hasStaticShape())
+      return;
+    int64_t numBytes = memRefType.getNumElements() *
+                       memRefType.getElementTypeBitWidth() / 8;
+    numAllocBytes += numBytes;
+    if (emitRemarks)
+      allocOp.emitRemark("allocated a temporary of ") << numBytes << " bytes";
+  });
 }
 
 } // namespace
@@ -661,23 +1502,27 @@ namespace stencil {
 void populateStencilToStdConversionPatterns(
     StencilTypeConverter &typeConveter, DenseMap<Value, Index> &valueToLB,
     DenseMap<Value, SmallVector<OpOperand *, 10>> &valueToReturnOpOperands,
+    const StencilToStdOptions &options,
     mlir::OwningRewritePatternList &patterns) {
-  patterns.insert<FuncOpLowering, IfOpLowering, YieldOpLowering, CastOpLowering,
-                  LoadOpLowering, ApplyOpLowering, BufferOpLowering,
-                  ReturnOpLowering, StoreResultOpLowering, AccessOpLowering,
-                  DynAccessOpLowering, IndexOpLowering, StoreOpLowering>(
-      typeConveter, valueToLB, valueToReturnOpOperands);
+  patterns.insert<FuncOpLowering, CallOpLowering, IfOpLowering,
+                  YieldOpLowering, CastOpLowering, LoadOpLowering,
+                  ApplyOpLowering, BufferOpLowering, ReturnOpLowering,
+                  StoreResultOpLowering, AccessOpLowering, DynAccessOpLowering,
+                  IndexOpLowering, StoreOpLowering, ReduceOpLowering,
+                  ScanOpLowering>(
+      typeConveter, valueToLB, valueToReturnOpOperands, options);
 }
 
 //===----------------------------------------------------------------------===//
 // Stencil Type Converter
 //===----------------------------------------------------------------------===//
 
-StencilTypeConverter::StencilTypeConverter(MLIRContext *context_)
-    : context(context_) {
+StencilTypeConverter::StencilTypeConverter(MLIRContext *context_,
+                                           const StencilToStdOptions &options)
+    : context(context_), options(options) {
   // Add a type conversion for the stencil field type
-  addConversion([&](GridType type) {
-    return MemRefType::get(type.getMemRefShape(), type.getElementType());
+  addConversion([this](GridType type) {
+    return MemRefType::get(getMemRefShape(type), type.getElementType());
   });
   addConversion([&](Type type) -> Optional<Type> {
     if (auto gridType = type.dyn_cast<GridType>())
@@ -686,6 +1531,39 @@ StencilTypeConverter::StencilTypeConverter(MLIRContext *context_)
   });
 }
 
+SmallVector<int64_t, 3>
+StencilTypeConverter::getMemRefShape(GridType type) const {
+  SmallVector<int64_t, 3> result;
+  auto shape = type.getShape();
+  for (auto dim : options.getMemRefDims(type.getAllocation())) {
+    result.push_back(GridType::isDynamic(shape[dim]) ? ShapedType::kDynamicSize
+                                                     : shape[dim]);
+  }
+  // Prepend the ensemble dimension
+  if (options.ensembleSize > 0) {
+    bool isDynamic = llvm::any_of(
+        result, [](int64_t x) { return x == ShapedType::kDynamicSize; });
+    result.insert(result.begin(), isDynamic ? ShapedType::kDynamicSize
+                                            : options.ensembleSize);
+  }
+  return result;
+}
+
+//===----------------------------------------------------------------------===//
+// Stencil Lowering Options
+//===----------------------------------------------------------------------===//
+
+SmallVector<unsigned, 3>
+StencilToStdOptions::getMemRefDims(ArrayRef<bool> allocation) const {
+  // Skip the dimensions of the order that are not allocated
+  SmallVector<unsigned, 3> result;
+  for (auto dim : llvm::reverse(dimensionOrder)) {
+    if (dim < allocation.size() && allocation[dim])
+      result.push_back(dim);
+  }
+  return result;
+}
+
 //===----------------------------------------------------------------------===//
 // Stencil Pattern Base Class
 //===----------------------------------------------------------------------===//
@@ -694,10 +1572,10 @@ StencilToStdPattern::StencilToStdPattern(
     StringRef rootOpName, StencilTypeConverter &typeConverter,
     DenseMap<Value, Index> &valueToLB,
     DenseMap<Value, SmallVector<OpOperand *, 10>> &valueToReturnOpOperands,
-    PatternBenefit benefit)
+    const StencilToStdOptions &options, PatternBenefit benefit)
     : ConversionPattern(rootOpName, benefit, typeConverter.getContext()),
       typeConverter(typeConverter), valueToLB(valueToLB),
-      valueToReturnOpOperands(valueToReturnOpOperands) {}
+      valueToReturnOpOperands(valueToReturnOpOperands), options(options) {}
 
 Index StencilToStdPattern::computeShape(ShapeOp shapeOp) const {
   return applyFunElementWise(shapeOp.getUB(), shapeOp.getLB(),
@@ -732,21 +1610,36 @@ StencilToStdPattern::getInductionVars(Operation *operation) const {
   return inductionVariables;
 }
 
+Value StencilToStdPattern::getEnsembleMember(Operation *operation) const {
+  // Get the outermost parallel loop
+  auto parallelOp = dyn_cast<ParallelOp>(operation);
+  if (!parallelOp)
+    parallelOp = operation->getParentOfType<ParallelOp>();
+  while (parallelOp && parallelOp->getParentOfType<ParallelOp>())
+    parallelOp = parallelOp->getParentOfType<ParallelOp>();
+  assert(parallelOp && "expected the ensemble loop");
+
+  // The ensemble loop is the innermost loop dimension
+  return parallelOp.getInductionVars().back();
+}
+
 std::tuple<Index, Index, Index>
 StencilToStdPattern::computeSubViewShape(FieldType fieldType, ShapeOp shapeOp,
                                          Index castLB) const {
   auto shape = computeShape(shapeOp);
-  Index revShape, revOffset, revStrides;
-  for (auto en : llvm::enumerate(fieldType.getAllocation())) {
-    // Insert values at the front to convert from column- to row-major
-    if (en.value()) {
-      revShape.insert(revShape.begin(), shape[en.index()]);
-      revStrides.insert(revStrides.begin(), 1);
-      revOffset.insert(revOffset.begin(),
-                       shapeOp.getLB()[en.index()] - castLB[en.index()]);
-    }
+  Index memRefShape, memRefOffset, memRefStrides;
+  if (options.ensembleSize > 0) {
+    memRefShape.push_back(options.ensembleSize);
+    memRefStrides.push_back(1);
+    memRefOffset.push_back(0);
+  }
+  // Order the values like the memref dimensions
+  for (auto dim : options.getMemRefDims(fieldType.getAllocation())) {
+    memRefShape.push_back(shape[dim]);
+    memRefStrides.push_back(1);
+    memRefOffset.push_back(shapeOp.getLB()[dim] - castLB[dim]);
   }
-  return std::make_tuple(revOffset, revShape, revStrides);
+  return std::make_tuple(memRefOffset, memRefShape, memRefStrides);
 }
 
 SmallVector<Value, 3> StencilToStdPattern::computeIndexValues(
@@ -756,16 +1649,16 @@ SmallVector<Value, 3> StencilToStdPattern::computeIndexValues(
   auto expr = rewriter.getAffineDimExpr(0) + rewriter.getAffineDimExpr(1);
   auto map = AffineMap::get(2, 0, expr);
   SmallVector<Value, 3> resOffset;
-  for (auto en : llvm::enumerate(allocation)) {
-    // Insert values at the front to convert from column- to row-major
-    if (en.value()) {
-      SmallVector<Value, 2> params = {
-          inductionVars[en.index()],
-          rewriter.create<ConstantIndexOp>(loc, offset[en.index()])
-              .getResult()};
-      auto affineApplyOp = rewriter.create<AffineApplyOp>(loc, map, params);
-      resOffset.insert(resOffset.begin(), affineApplyOp.getResult());
-    }
+  if (options.ensembleSize > 0)
+    resOffset.push_back(
+        getEnsembleMember(rewriter.getInsertionBlock()->getParentOp()));
+  // Order the values like the memref dimensions
+  for (auto dim : options.getMemRefDims(allocation)) {
+    SmallVector<Value, 2> params = {
+        inductionVars[dim],
+        rewriter.create<ConstantIndexOp>(loc, offset[dim]).getResult()};
+    auto affineApplyOp = rewriter.create<AffineApplyOp>(loc, map, params);
+    resOffset.push_back(affineApplyOp.getResult());
   }
   return resOffset;
 }
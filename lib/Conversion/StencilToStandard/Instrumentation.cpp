@@ -0,0 +1,138 @@
+#include "Conversion/StencilToStandard/Passes.h"
+#include "PassDetail.h"
+#include "mlir/Dialect/LLVMIR/LLVMDialect.h"
+#include "mlir/Dialect/SCF/SCF.h"
+#include "mlir/Dialect/StandardOps/IR/Ops.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/Location.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/Value.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Support/LLVM.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/raw_ostream.h"
+#include <cstdint>
+#include <string>
+
+using namespace mlir;
+
+// Profiler runtime functions called before and after every kernel
+constexpr char beginFuncName[] = "oecProfilerBegin";
+constexpr char endFuncName[] = "oecProfilerEnd";
+
+namespace {
+
+struct InstrumentationPass
+    : public InstrumentationPassBase<InstrumentationPass> {
+  void getDependentDialects(DialectRegistry &registry) const override {
+    registry.insert<LLVM::LLVMDialect>();
+  }
+  void runOnOperation() override;
+};
+
+// Helper printing the source location of an apply op
+static void printLocation(Location loc, llvm::raw_ostream &os) {
+  if (auto fileLoc = loc.dyn_cast<FileLineColLoc>()) {
+    os << " (" << fileLoc.getFilename() << ":" << fileLoc.getLine() << ":"
+       << fileLoc.getColumn() << ")";
+  } else if (auto nameLoc = loc.dyn_cast<NameLoc>()) {
+    os << " (" << nameLoc.getName() << ")";
+  } else if (auto callLoc = loc.dyn_cast<CallSiteLoc>()) {
+    printLocation(callLoc.getCallee(), os);
+  } else if (auto fusedLoc = loc.dyn_cast<FusedLoc>()) {
+    if (!fusedLoc.getLocations().empty())
+      printLocation(fusedLoc.getLocations().front(), os);
+  }
+}
+
+// Helper estimating the bytes moved by a kernel
+// (every memref accessed by the kernel is loaded or stored once per point)
+static int64_t getTrafficBytes(scf::ParallelOp loop) {
+  int64_t numPoints = 1;
+  for (auto bounds : llvm::zip(loop.lowerBound(), loop.upperBound())) {
+    auto lbOp = std::get<0>(bounds).getDefiningOp<ConstantIndexOp>();
+    auto ubOp = std::get<1>(bounds).getDefiningOp<ConstantIndexOp>();
+    if (!lbOp || !ubOp)
+      return 0;
+    numPoints *= ubOp.getValue() - lbOp.getValue();
+  }
+  llvm::SetVector<Value> memrefs;
+  loop.walk([&](LoadOp loadOp) { memrefs.insert(loadOp.memref()); });
+  loop.walk([&](StoreOp storeOp) { memrefs.insert(storeOp.memref()); });
+  int64_t pointBytes = 0;
+  for (auto memref : memrefs) {
+    // Skip the workgroup memory buffers
+    auto memRefType = memref.getType().cast<MemRefType>();
+    if (memRefType.getMemorySpace() != 0 ||
+        !memRefType.getElementType().isIntOrFloat())
+      continue;
+    pointBytes += llvm::divideCeil(memRefType.getElementTypeBitWidth(), 8);
+  }
+  return numPoints * pointBytes;
+}
+
+void InstrumentationPass::runOnOperation() {
+  ModuleOp moduleOp = getOperation();
+  OpBuilder builder(moduleOp.getContext());
+  FuncOp beginFuncOp, endFuncOp;
+  unsigned numKernels = 0;
+  for (auto funcOp : moduleOp.getOps<FuncOp>()) {
+    if (funcOp.isExternal())
+      continue;
+    // Collect the outermost parallel loops introduced by the apply lowering
+    SmallVector<scf::ParallelOp, 10> loops;
+    funcOp.walk([&](scf::ParallelOp loop) {
+      if (!loop->getParentOfType<scf::ParallelOp>())
+        loops.push_back(loop);
+    });
+
+    for (auto en : llvm::enumerate(loops)) {
+      auto loop = en.value();
+      auto loc = loop.getLoc();
+      builder.setInsertionPoint(loop);
+
+      // Tag the kernel with the function name and the apply location
+      std::string name;
+      llvm::raw_string_ostream os(name);
+      os << funcOp.getName() << "/apply" << en.index();
+      printLocation(loc, os);
+      os << '\0';
+      std::string globalName = "oec_kernel_name" + std::to_string(numKernels++);
+      Value namePtr = LLVM::createGlobalString(
+          loc, builder, globalName, os.str(), LLVM::Linkage::Internal);
+      auto bytesOp = builder.create<ConstantIntOp>(loc, getTrafficBytes(loop),
+                                                   64);
+
+      // Declare the runtime functions
+      if (!beginFuncOp) {
+        OpBuilder moduleBuilder(moduleOp.getBody(),
+                                moduleOp.getBody()->begin());
+        beginFuncOp = moduleBuilder.create<FuncOp>(
+            moduleOp.getLoc(), beginFuncName,
+            builder.getFunctionType({namePtr.getType(), bytesOp.getType()},
+                                    llvm::None));
+        endFuncOp = moduleBuilder.create<FuncOp>(
+            moduleOp.getLoc(), endFuncName,
+            builder.getFunctionType(namePtr.getType(), llvm::None));
+        beginFuncOp.setPrivate();
+        endFuncOp.setPrivate();
+      }
+
+      // Call the runtime before and after the kernel
+      builder.create<CallOp>(loc, beginFuncOp,
+                             ValueRange({namePtr, bytesOp.getResult()}));
+      builder.setInsertionPointAfter(loop);
+      builder.create<CallOp>(loc, endFuncOp, namePtr);
+    }
+  }
+}
+
+} // namespace
+
+std::unique_ptr<OperationPass<ModuleOp>> mlir::createInstrumentationPass() {
+  return std::make_unique<InstrumentationPass>();
+}
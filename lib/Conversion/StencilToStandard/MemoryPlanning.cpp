@@ -0,0 +1,194 @@
+#include "Conversion/StencilToStandard/Passes.h"
+#include "PassDetail.h"
+#include "mlir/Dialect/GPU/GPUDialect.h"
+#include "mlir/Dialect/StandardOps/IR/Ops.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/SymbolTable.h"
+#include "mlir/IR/Value.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Support/LLVM.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/MathExtras.h"
+#include <algorithm>
+#include <cstdint>
+
+using namespace mlir;
+
+// Argument attribute marking the workspace argument
+constexpr char workspaceAttrName[] = "stencil.workspace";
+
+namespace {
+
+// This struct stores the lifetime and the arena offset of a temporary
+struct Temporary {
+  gpu::AllocOp allocOp;
+  gpu::DeallocOp deallocOp;
+  unsigned begin;
+  unsigned end;
+  int64_t size;
+  int64_t offset;
+};
+
+struct MemoryPlanningPass
+    : public MemoryPlanningPassBase<MemoryPlanningPass> {
+  void runOnOperation() override;
+
+protected:
+  void planFunction(FuncOp funcOp);
+  SmallVector<Temporary, 10> collectTemporaries(Block &block);
+  int64_t computeOffsets(MutableArrayRef<Temporary> temporaries);
+};
+
+// Helper returning the allocation size in bytes if the allocation is planable
+static Optional<int64_t> getAllocationSize(gpu::AllocOp allocOp) {
+  auto memRefType = allocOp.memref().getType().cast<MemRefType>();
+  if (allocOp.getOperation()->getNumOperands() != 0 || allocOp.asyncToken() ||
+      !memRefType.hasStaticShape() || !memRefType.getAffineMaps().empty() ||
+      memRefType.getMemorySpace() != 0 ||
+      !memRefType.getElementType().isIntOrFloat())
+    return llvm::None;
+  int64_t elementBytes =
+      llvm::divideCeil(memRefType.getElementTypeBitWidth(), 8);
+  return memRefType.getNumElements() * elementBytes;
+}
+
+SmallVector<Temporary, 10>
+MemoryPlanningPass::collectTemporaries(Block &block) {
+  // Number the operations to compute the lifetimes
+  DenseMap<Operation *, unsigned> positions;
+  for (auto &en : llvm::enumerate(block.getOperations()))
+    positions[&en.value()] = en.index();
+
+  // Collect the allocations freed in the same block
+  SmallVector<Temporary, 10> temporaries;
+  for (auto allocOp : block.getOps<gpu::AllocOp>()) {
+    auto size = getAllocationSize(allocOp);
+    if (!size.hasValue())
+      continue;
+    int64_t alignedSize = llvm::alignTo(size.getValue(), alignment);
+    Temporary temporary = {allocOp, nullptr, positions[allocOp.getOperation()],
+                           static_cast<unsigned>(block.getOperations().size()),
+                           alignedSize, 0};
+    for (auto user : allocOp.memref().getUsers()) {
+      if (auto deallocOp = dyn_cast<gpu::DeallocOp>(user)) {
+        if (deallocOp->getBlock() == &block) {
+          temporary.deallocOp = deallocOp;
+          temporary.end = positions[deallocOp];
+        }
+      }
+    }
+    temporaries.push_back(temporary);
+  }
+  return temporaries;
+}
+
+int64_t
+MemoryPlanningPass::computeOffsets(MutableArrayRef<Temporary> temporaries) {
+  // Place the largest temporaries first
+  SmallVector<Temporary *, 10> order;
+  for (auto &temporary : temporaries)
+    order.push_back(&temporary);
+  std::stable_sort(order.begin(), order.end(), [](Temporary *x, Temporary *y) {
+    return x->size > y->size;
+  });
+
+  // Place every temporary at the lowest offset that does not overlap with
+  // the placed temporaries of overlapping lifetime
+  int64_t arenaSize = 0;
+  SmallVector<Temporary *, 10> placed;
+  for (auto temporary : order) {
+    SmallVector<Temporary *, 10> conflicts;
+    for (auto other : placed) {
+      if (temporary->begin <= other->end && other->begin <= temporary->end)
+        conflicts.push_back(other);
+    }
+    std::sort(conflicts.begin(), conflicts.end(),
+              [](Temporary *x, Temporary *y) { return x->offset < y->offset; });
+    int64_t offset = 0;
+    for (auto other : conflicts) {
+      if (offset + temporary->size <= other->offset)
+        break;
+      offset = std::max(offset, other->offset + other->size);
+    }
+    temporary->offset = offset;
+    arenaSize = std::max(arenaSize, offset + temporary->size);
+    placed.push_back(temporary);
+  }
+  return arenaSize;
+}
+
+void MemoryPlanningPass::planFunction(FuncOp funcOp) {
+  // Pass the arena as an argument only if no call has to be updated
+  bool useWorkspaceArg =
+      workspaceArg && SymbolTable::symbolKnownUseEmpty(funcOp, getOperation());
+
+  // Plan the temporaries allocated at the top-level of the function
+  Block &block = funcOp.getBody().front();
+  auto temporaries = collectTemporaries(block);
+  if (temporaries.empty() || (temporaries.size() == 1 && !useWorkspaceArg))
+    return;
+  int64_t arenaSize = computeOffsets(temporaries);
+
+  // Allocate the arena or pass it as an additional argument
+  OpBuilder builder(funcOp.getContext());
+  auto loc = funcOp.getLoc();
+  auto arenaType = MemRefType::get({arenaSize}, builder.getIntegerType(8));
+  Value arena;
+  if (useWorkspaceArg) {
+    arena = block.addArgument(arenaType);
+    SmallVector<Type, 10> inputs(funcOp.getType().getInputs().begin(),
+                                 funcOp.getType().getInputs().end());
+    inputs.push_back(arenaType);
+    funcOp.setType(FunctionType::get(funcOp.getContext(), inputs,
+                                     funcOp.getType().getResults()));
+    funcOp.setArgAttr(funcOp.getNumArguments() - 1, workspaceAttrName,
+                      builder.getUnitAttr());
+  } else {
+    builder.setInsertionPointToStart(&block);
+    auto segAttr = builder.getNamedAttr("operand_segment_sizes",
+                                        builder.getI32VectorAttr({0, 0, 0}));
+    arena = builder
+                .create<gpu::AllocOp>(loc, TypeRange(arenaType), ValueRange(),
+                                      segAttr)
+                .getResult(0);
+    builder.setInsertionPoint(block.getTerminator());
+    builder.create<gpu::DeallocOp>(loc, TypeRange(), ValueRange(arena));
+  }
+
+  // Replace the allocations by views of the arena
+  for (auto &temporary : temporaries) {
+    builder.setInsertionPoint(temporary.allocOp);
+    auto offset =
+        builder.create<ConstantIndexOp>(temporary.allocOp.getLoc(),
+                                        temporary.offset);
+    auto viewOp = builder.create<ViewOp>(temporary.allocOp.getLoc(),
+                                         temporary.allocOp.memref().getType(),
+                                         arena, offset, ValueRange());
+    if (temporary.deallocOp)
+      temporary.deallocOp.erase();
+    temporary.allocOp.memref().replaceAllUsesWith(viewOp.getResult());
+    temporary.allocOp.erase();
+  }
+}
+
+void MemoryPlanningPass::runOnOperation() {
+  if (alignment <= 0)
+    return;
+  // Plan the functions in the module pass since the workspace argument
+  // changes the function signatures
+  for (auto funcOp : getOperation().getOps<FuncOp>()) {
+    if (!funcOp.isExternal())
+      planFunction(funcOp);
+  }
+}
+
+} // namespace
+
+std::unique_ptr<OperationPass<ModuleOp>> mlir::createMemoryPlanningPass() {
+  return std::make_unique<MemoryPlanningPass>();
+}
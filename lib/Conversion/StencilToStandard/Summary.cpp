@@ -0,0 +1,127 @@
+#include "Conversion/StencilToStandard/Passes.h"
+#include "Dialect/Stencil/StencilOps.h"
+#include "Dialect/Stencil/StencilTypes.h"
+#include "PassDetail.h"
+#include "mlir/Dialect/GPU/GPUDialect.h"
+#include "mlir/Dialect/SCF/SCF.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Support/LLVM.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <system_error>
+
+using namespace mlir;
+using namespace stencil;
+
+namespace {
+
+/// Print one json object per function that counts the stencil and the
+/// lowered operations to compare the programs at different pipeline stages
+struct SummaryPass : public SummaryPassBase<SummaryPass> {
+  void runOnOperation() override;
+
+protected:
+  void printSummary(FuncOp funcOp, llvm::raw_ostream &os);
+};
+
+// Helper computing the size of a temporary with a static shape in bytes
+static int64_t getTempBytes(TempType tempType) {
+  if (!tempType.hasStaticShape() ||
+      !tempType.getElementType().isIntOrFloat())
+    return 0;
+  int64_t numBytes = tempType.getElementType().getIntOrFloatBitWidth() / 8;
+  for (auto size : tempType.getShape())
+    numBytes *= GridType::isScalar(size) ? 1 : size;
+  return numBytes;
+}
+
+void SummaryPass::printSummary(FuncOp funcOp, llvm::raw_ostream &os) {
+  int64_t numApplies = 0, numAccesses = 0, numDynAccesses = 0;
+  int64_t numBuffers = 0, numStores = 0, numUnrolled = 0, maxUnroll = 1;
+  int64_t tempBytes = 0, numAllocs = 0, allocBytes = 0;
+  int64_t numParallelLoops = 0, numLaunches = 0;
+  funcOp.walk([&](Operation *op) {
+    if (auto applyOp = dyn_cast<stencil::ApplyOp>(op)) {
+      numApplies++;
+      for (auto result : applyOp.getResults())
+        if (auto tempType = result.getType().dyn_cast<TempType>())
+          tempBytes += getTempBytes(tempType);
+    } else if (auto returnOp = dyn_cast<stencil::ReturnOp>(op)) {
+      if (returnOp.unroll().hasValue()) {
+        numUnrolled++;
+        maxUnroll = std::max<int64_t>(maxUnroll, returnOp.getUnrollFac());
+      }
+    } else if (auto allocOp = dyn_cast<gpu::AllocOp>(op)) {
+      auto memRefType = allocOp.memref().getType().cast<MemRefType>();
+      numAllocs++;
+      if (memRefType.hasStaticShape())
+        allocBytes += memRefType.getNumElements() *
+                      memRefType.getElementTypeBitWidth() / 8;
+    } else if (auto loop = dyn_cast<scf::ParallelOp>(op)) {
+      // Only count the outermost parallel loops
+      if (!loop->getParentOfType<scf::ParallelOp>())
+        numParallelLoops++;
+    }
+    numAccesses += isa<stencil::AccessOp>(op);
+    numDynAccesses += isa<stencil::DynAccessOp>(op);
+    numBuffers += isa<stencil::BufferOp>(op);
+    numStores += isa<stencil::StoreOp>(op);
+    numLaunches += isa<gpu::LaunchOp, gpu::LaunchFuncOp>(op);
+  });
+
+  llvm::json::OStream json(os);
+  json.object([&]() {
+    json.attribute("label", label);
+    json.attribute("function", funcOp.getName());
+    json.attribute("applies", numApplies);
+    json.attribute("accesses", numAccesses);
+    json.attribute("dyn_accesses", numDynAccesses);
+    json.attribute("buffers", numBuffers);
+    json.attribute("stores", numStores);
+    json.attribute("unrolled", numUnrolled);
+    json.attribute("max_unroll", maxUnroll);
+    json.attribute("temp_bytes", tempBytes);
+    json.attribute("allocs", numAllocs);
+    json.attribute("alloc_bytes", allocBytes);
+    json.attribute("parallel_loops", numParallelLoops);
+    json.attribute("launches", numLaunches);
+  });
+  os << "\n";
+}
+
+void SummaryPass::runOnOperation() {
+  ModuleOp moduleOp = getOperation();
+
+  // Append to the output file to collect the summaries of several runs
+  std::unique_ptr<llvm::raw_fd_ostream> file;
+  if (!output.empty()) {
+    std::error_code ec;
+    file = std::make_unique<llvm::raw_fd_ostream>(output, ec,
+                                                  llvm::sys::fs::OF_Append);
+    if (ec) {
+      moduleOp.emitError("cannot open the summary file ")
+          << output << ": " << ec.message();
+      return signalPassFailure();
+    }
+  }
+  llvm::raw_ostream &os = file ? *file : llvm::errs();
+  for (auto funcOp : moduleOp.getOps<FuncOp>()) {
+    if (!funcOp.isExternal())
+      printSummary(funcOp, os);
+  }
+  os.flush();
+  markAllAnalysesPreserved();
+}
+
+} // namespace
+
+std::unique_ptr<OperationPass<ModuleOp>> mlir::createSummaryPass() {
+  return std::make_unique<SummaryPass>();
+}
@@ -1,4 +1,5 @@
 #include "Dialect/Stencil/Passes.h"
+#include "Dialect/Stencil/StencilCostModel.h"
 #include "Dialect/Stencil/StencilDialect.h"
 #include "Dialect/Stencil/StencilOps.h"
 #include "Dialect/Stencil/StencilTypes.h"
@@ -22,6 +23,7 @@
 #include "mlir/Transforms/GreedyPatternRewriteDriver.h"
 #include "mlir/Transforms/Passes.h"
 #include "mlir/Transforms/Utils.h"
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallVector.h"
 
@@ -72,8 +74,10 @@ struct FuseRewrite : public CombineOpPattern {
         cast<stencil::ReturnOp>(applyOp2.getBody()->getTerminator());
 
     // Check both apply operations have the same unroll configuration if any
+    // (the last unrolled iteration identifies the factors of all dimensions)
     if (returnOp1.getUnrollFac() != returnOp2.getUnrollFac() ||
-        returnOp1.getUnrollDim() != returnOp2.getUnrollDim()) {
+        returnOp1.getUnrollOffset(returnOp1.getUnrollFac() - 1) !=
+            returnOp2.getUnrollOffset(returnOp2.getUnrollFac() - 1)) {
       combineOp.emitWarning("expected matching unroll configurations");
       return failure();
     }
@@ -248,8 +252,10 @@ struct IfElseRewrite : public CombineOpPattern {
     auto upperReturnOp =
         cast<stencil::ReturnOp>(upperOp.getBody()->getTerminator());
     // Check both apply operations have the same unroll configuration if any
+    // (the last unrolled iteration identifies the factors of all dimensions)
     if (lowerReturnOp.getUnrollFac() != upperReturnOp.getUnrollFac() ||
-        lowerReturnOp.getUnrollDim() != upperReturnOp.getUnrollDim()) {
+        lowerReturnOp.getUnrollOffset(lowerReturnOp.getUnrollFac() - 1) !=
+            upperReturnOp.getUnrollOffset(upperReturnOp.getUnrollFac() - 1)) {
       combineOp.emitWarning("expected matching unroll configurations");
       return failure();
     }
@@ -330,6 +336,29 @@ struct InternalIfElseRewrite : public IfElseRewrite {
   }
 };
 
+// Pattern replacing stencil.combine ops by if/else if the cost model
+// prefers the lowering in place to materializing the combine tree
+struct ProfitableIfElseRewrite : public IfElseRewrite {
+  ProfitableIfElseRewrite(MLIRContext *context,
+                          const DenseSet<Operation *> *rootOps,
+                          PatternBenefit benefit = 1)
+      : IfElseRewrite(context, benefit), rootOps(rootOps) {}
+
+  LogicalResult matchAndRewrite(stencil::CombineOp combineOp,
+                                PatternRewriter &rewriter) const override {
+    // Lower the entire combine tree if the cost model selected its root
+    auto rootOp = combineOp.getCombineTreeRoot().getOperation();
+    if (!rootOps->count(rootOp))
+      return failure();
+
+    // Run the standard if else rewrite
+    return IfElseRewrite::matchAndRewrite(combineOp, rewriter);
+  }
+
+  // Roots of the combine trees the cost model selected for the lowering
+  const DenseSet<Operation *> *rootOps;
+};
+
 struct CombineToIfElsePass
     : public CombineToIfElsePassBase<CombineToIfElsePass> {
 
@@ -356,6 +385,26 @@ void CombineToIfElsePass::runOnFunction() {
     return signalPassFailure();
   }
 
+  // Lower only the combine trees consumed by an apply op that recomputes
+  // them cheaper than materializing their results if the cost model is set
+  // (decide before the lowering that changes the operations of the tree)
+  if (useCostModel && !prepareOnly) {
+    OwningRewritePatternList prepPatterns;
+    prepPatterns.insert<EmptyStoreRewrite, FuseRewrite>(&getContext());
+    applyPatternsAndFoldGreedily(funcOp, std::move(prepPatterns));
+    CombineCostModel costModel(maxFlopsPerByte, maxOffsets);
+    DenseSet<Operation *> rootOps;
+    funcOp.walk([&](stencil::CombineOp combineOp) {
+      if (combineOp.getCombineTreeRoot() == combineOp &&
+          costModel.isIfElseProfitable(combineOp))
+        rootOps.insert(combineOp.getOperation());
+    });
+    OwningRewritePatternList patterns;
+    patterns.insert<ProfitableIfElseRewrite>(&getContext(), &rootOps);
+    applyPatternsAndFoldGreedily(funcOp, std::move(patterns));
+    return;
+  }
+
   // Populate the pattern list depending on the config
   OwningRewritePatternList patterns;
   if (prepareOnly) {
@@ -0,0 +1,350 @@
+#include "Dialect/Stencil/Passes.h"
+#include "Dialect/Stencil/StencilDialect.h"
+#include "Dialect/Stencil/StencilOps.h"
+#include "Dialect/Stencil/StencilTypes.h"
+#include "Dialect/Stencil/StencilUtils.h"
+#include "PassDetail.h"
+#include "mlir/Dialect/StandardOps/IR/Ops.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/Diagnostics.h"
+#include "mlir/IR/SymbolTable.h"
+#include "mlir/IR/Value.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Support/LLVM.h"
+#include "mlir/Support/LogicalResult.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include <algorithm>
+#include <cstdint>
+#include <string>
+
+using namespace mlir;
+using namespace stencil;
+
+// Halo exchange runtime functions called by the distributed programs
+constexpr char beginFuncPrefix[] = "oecHaloExchangeBegin";
+constexpr char endFuncName[] = "oecHaloExchangeEnd";
+
+// Horizontal dimensions distributed across the ranks
+constexpr int64_t kDistributedDims[] = {kIDimension, kJDimension};
+
+namespace {
+
+// This struct stores the halo of a field exchanged before the computation
+struct FieldHalo {
+  unsigned argument;
+  stencil::CastOp castOp;
+  Index lower;
+  Index upper;
+};
+
+struct DomainDecompositionPass
+    : public DomainDecompositionPassBase<DomainDecompositionPass> {
+  void runOnOperation() override;
+
+protected:
+  LogicalResult decomposeProgram(FuncOp funcOp);
+  FuncOp getBeginFunc(FuncOp funcOp, Type fieldType);
+  FuncOp getEndFunc(FuncOp funcOp);
+};
+
+// Helper returning the name suffix of the runtime function of a field type
+static Optional<StringRef> getElementTypeSuffix(Type fieldType) {
+  auto elementType = fieldType.cast<GridType>().getElementType();
+  if (elementType.isF64())
+    return StringRef("F64");
+  if (elementType.isF32())
+    return StringRef("F32");
+  return llvm::None;
+}
+
+FuncOp DomainDecompositionPass::getBeginFunc(FuncOp funcOp, Type fieldType) {
+  std::string name =
+      (beginFuncPrefix + getElementTypeSuffix(fieldType).getValue()).str();
+  ModuleOp moduleOp = getOperation();
+  if (auto beginFuncOp = moduleOp.lookupSymbol<FuncOp>(name))
+    return beginFuncOp;
+
+  // Declare the runtime function taking the field, the message tag, the
+  // memref dimensions storing the distributed dimensions, the number of
+  // ranks, the local domain origin and size of the field memref, and the
+  // lower and upper halo widths of the distributed dimensions
+  OpBuilder builder(funcOp);
+  SmallVector<Type, 14> inputs = {fieldType};
+  inputs.append(13, builder.getI64Type());
+  auto beginFuncOp = builder.create<FuncOp>(
+      funcOp.getLoc(), name, builder.getFunctionType(inputs, llvm::None));
+  beginFuncOp.setPrivate();
+  beginFuncOp->setAttr("llvm.emit_c_interface", builder.getUnitAttr());
+  return beginFuncOp;
+}
+
+FuncOp DomainDecompositionPass::getEndFunc(FuncOp funcOp) {
+  ModuleOp moduleOp = getOperation();
+  if (auto endFuncOp = moduleOp.lookupSymbol<FuncOp>(endFuncName))
+    return endFuncOp;
+  OpBuilder builder(funcOp);
+  auto endFuncOp = builder.create<FuncOp>(
+      funcOp.getLoc(), endFuncName,
+      builder.getFunctionType(llvm::None, llvm::None));
+  endFuncOp.setPrivate();
+  endFuncOp->setAttr("llvm.emit_c_interface", builder.getUnitAttr());
+  return endFuncOp;
+}
+
+LogicalResult DomainDecompositionPass::decomposeProgram(FuncOp funcOp) {
+  // Verify the program does not depend on the global position
+  auto result = funcOp.walk([&](Operation *op) {
+    if (isa<stencil::CombineOp, stencil::IndexOp>(op)) {
+      op->emitOpError("expected no position dependent ops in distributed "
+                      "programs");
+      return WalkResult::interrupt();
+    }
+    if (auto loadOp = dyn_cast<stencil::LoadOp>(op)) {
+      if (!cast<ShapeOp>(op).hasShape()) {
+        loadOp.emitOpError("execute domain decomposition after shape "
+                           "inference");
+        return WalkResult::interrupt();
+      }
+    }
+    return WalkResult::advance();
+  });
+  if (result.wasInterrupted())
+    return failure();
+
+  // Compute the global domain written by the stores
+  SmallVector<stencil::StoreOp, 4> storeOps;
+  funcOp.walk([&](stencil::StoreOp storeOp) { storeOps.push_back(storeOp); });
+  if (storeOps.empty())
+    return success();
+  Index lb = cast<ShapeOp>(storeOps.front().getOperation()).getLB();
+  Index ub = cast<ShapeOp>(storeOps.front().getOperation()).getUB();
+  for (auto storeOp : storeOps) {
+    auto shapeOp = cast<ShapeOp>(storeOp.getOperation());
+    for (auto dim : kDistributedDims) {
+      if (shapeOp.getLB()[dim] != lb[dim] || shapeOp.getUB()[dim] != ub[dim]) {
+        storeOp.emitOpError("expected all stores to write the same "
+                            "horizontal domain");
+        return failure();
+      }
+    }
+  }
+
+  // Compute the local domain size of the ranks
+  Index size(kIndexSize, 0), shrink(kIndexSize, 0);
+  for (auto en : llvm::enumerate(kDistributedDims)) {
+    int64_t dim = en.value();
+    int64_t global = ub[dim] - lb[dim];
+    if (global % ranks[en.index()] != 0) {
+      funcOp.emitOpError("expected the domain size to be divisible by the "
+                         "number of ranks");
+      return failure();
+    }
+    size[dim] = global / ranks[en.index()];
+    shrink[dim] = global - size[dim];
+  }
+
+  // Compute the halo of the loaded fields using the inferred load shapes
+  SmallVector<FieldHalo, 8> halos;
+  Index lower(kIndexSize, 0), upper(kIndexSize, 0);
+  for (auto en : llvm::enumerate(funcOp.getArguments())) {
+    for (auto user : en.value().getUsers()) {
+      auto castOp = dyn_cast<stencil::CastOp>(user);
+      if (!castOp)
+        continue;
+      FieldHalo halo = {static_cast<unsigned>(en.index()), castOp,
+                        Index(kIndexSize, 0), Index(kIndexSize, 0)};
+      for (auto castUser : castOp.res().getUsers()) {
+        auto loadOp = dyn_cast<stencil::LoadOp>(castUser);
+        if (!loadOp)
+          continue;
+        auto shapeOp = cast<ShapeOp>(loadOp.getOperation());
+        for (auto dim : kDistributedDims) {
+          halo.lower[dim] =
+              std::max(halo.lower[dim], lb[dim] - shapeOp.getLB()[dim]);
+          halo.upper[dim] =
+              std::max(halo.upper[dim], shapeOp.getUB()[dim] - ub[dim]);
+        }
+      }
+      if (llvm::all_of(kDistributedDims, [&](int64_t dim) {
+            return halo.lower[dim] == 0 && halo.upper[dim] == 0;
+          }))
+        continue;
+
+      // Verify the halo is provided by the direct neighbors
+      auto fieldType = castOp.res().getType().cast<FieldType>();
+      if (fieldType.getRank() != kIndexSize ||
+          llvm::any_of(fieldType.getShape(), GridType::isScalar) ||
+          !getElementTypeSuffix(fieldType)) {
+        castOp.emitOpError("expected exchanged fields to be three "
+                           "dimensional f32 or f64 fields");
+        return failure();
+      }
+      for (auto dim : kDistributedDims) {
+        if (halo.lower[dim] > size[dim] || halo.upper[dim] > size[dim]) {
+          castOp.emitOpError("expected the halo to be smaller than the "
+                             "local domain");
+          return failure();
+        }
+        lower[dim] = std::max(lower[dim], halo.lower[dim]);
+        upper[dim] = std::max(upper[dim], halo.upper[dim]);
+      }
+      halos.push_back(halo);
+    }
+  }
+
+  // Shrink the fields and stores to the local domain and clear the inferred
+  // shapes that have to be recomputed by another shape inference run
+  funcOp.walk([&](stencil::CastOp castOp) {
+    auto shapeOp = cast<ShapeOp>(castOp.getOperation());
+    Index castUB = shapeOp.getUB();
+    for (auto dim : kDistributedDims)
+      castUB[dim] -= shrink[dim];
+    updateCastShape(castOp, shapeOp.getLB(), castUB);
+  });
+  for (auto storeOp : storeOps) {
+    auto shapeOp = cast<ShapeOp>(storeOp.getOperation());
+    Index storeUB = shapeOp.getUB();
+    for (auto dim : kDistributedDims)
+      storeUB[dim] -= shrink[dim];
+    shapeOp.updateShape(shapeOp.getLB(), storeUB);
+  }
+  funcOp.walk([](ShapeOp shapeOp) { shapeOp.clearInferredShape(); });
+  funcOp.walk([](stencil::ApplyOp applyOp) { applyOp.updateArgumentTypes(); });
+  for (auto dim : kDistributedDims)
+    ub[dim] = lb[dim] + size[dim];
+
+  // Split the local domain into the interior that does not access the halo
+  // and the boundary strips computed after the halo exchange
+  SmallVector<std::pair<Index, Index>, 5> domains;
+  bool split = overlap && !halos.empty() &&
+               llvm::all_of(kDistributedDims, [&](int64_t dim) {
+                 return size[dim] > lower[dim] + upper[dim];
+               });
+  if (split) {
+    Index innerLB = lb, innerUB = ub;
+    for (auto dim : kDistributedDims) {
+      innerLB[dim] += lower[dim];
+      innerUB[dim] -= upper[dim];
+    }
+    domains.push_back({innerLB, innerUB});
+    // Compute the strips along the i-dimension on the full j-range
+    // and the strips along the j-dimension on the interior i-range
+    auto addStrip = [&](Index stripLB, Index stripUB) {
+      if (llvm::all_of(kDistributedDims, [&](int64_t dim) {
+            return stripLB[dim] < stripUB[dim];
+          }))
+        domains.push_back({stripLB, stripUB});
+    };
+    Index stripLB = lb, stripUB = ub;
+    stripUB[kIDimension] = innerLB[kIDimension];
+    addStrip(stripLB, stripUB);
+    stripLB[kIDimension] = innerUB[kIDimension];
+    stripUB[kIDimension] = ub[kIDimension];
+    addStrip(stripLB, stripUB);
+    stripLB = innerLB;
+    stripUB = innerUB;
+    stripLB[kJDimension] = lb[kJDimension];
+    stripUB[kJDimension] = innerLB[kJDimension];
+    addStrip(stripLB, stripUB);
+    stripLB[kJDimension] = innerUB[kJDimension];
+    stripUB[kJDimension] = ub[kJDimension];
+    addStrip(stripLB, stripUB);
+  } else {
+    domains.push_back({lb, ub});
+  }
+
+  // Clone the program for every domain
+  SmallVector<FuncOp, 5> programs;
+  OpBuilder builder(funcOp.getContext());
+  builder.setInsertionPointAfter(funcOp);
+  for (auto en : llvm::enumerate(domains)) {
+    auto programOp = cast<FuncOp>(builder.clone(*funcOp));
+    std::string suffix = !split ? "_local"
+                         : en.index() == 0
+                             ? "_interior"
+                             : "_boundary" + std::to_string(en.index() - 1);
+    SymbolTable::setSymbolName(programOp, funcOp.getName().str() + suffix);
+    programOp.setPrivate();
+    programOp.walk([&](stencil::StoreOp storeOp) {
+      auto shapeOp = cast<ShapeOp>(storeOp.getOperation());
+      Index storeLB = shapeOp.getLB(), storeUB = shapeOp.getUB();
+      for (auto dim : kDistributedDims) {
+        storeLB[dim] = en.value().first[dim];
+        storeUB[dim] = en.value().second[dim];
+      }
+      shapeOp.updateShape(storeLB, storeUB);
+    });
+    programs.push_back(programOp);
+  }
+
+  // Replace the program body by the halo exchange and the program calls
+  Block &entryBlock = funcOp.getBody().front();
+  Location loc = funcOp.getLoc();
+  while (!entryBlock.empty())
+    entryBlock.back().erase();
+  funcOp->removeAttr(StencilDialect::getStencilProgramAttrName());
+  builder.setInsertionPointToEnd(&entryBlock);
+  auto createIndex = [&](int64_t value) -> Value {
+    return builder.create<ConstantIntOp>(loc, value, 64);
+  };
+  for (auto &halo : halos) {
+    Value field = funcOp.getArgument(halo.argument);
+    auto castLB = cast<ShapeOp>(halo.castOp.getOperation()).getLB();
+    SmallVector<Value, 14> operands = {field, createIndex(halo.argument)};
+    for (auto dim : kDistributedDims)
+      operands.push_back(
+          createIndex(getMemRefDim(dimensionOrder, dim).getValue()));
+    for (auto rank : ranks)
+      operands.push_back(createIndex(rank));
+    for (auto dim : kDistributedDims)
+      operands.push_back(createIndex(lb[dim] - castLB[dim]));
+    for (auto dim : kDistributedDims)
+      operands.push_back(createIndex(size[dim]));
+    for (auto dim : kDistributedDims)
+      operands.push_back(createIndex(halo.lower[dim]));
+    for (auto dim : kDistributedDims)
+      operands.push_back(createIndex(halo.upper[dim]));
+    builder.create<CallOp>(loc, getBeginFunc(funcOp, field.getType()),
+                           operands);
+  }
+  for (auto en : llvm::enumerate(programs)) {
+    // Wait for the halo after computing the interior
+    if (!halos.empty() && en.index() == (split ? 1 : 0))
+      builder.create<CallOp>(loc, getEndFunc(funcOp), ValueRange());
+    builder.create<CallOp>(loc, en.value(), funcOp.getArguments());
+  }
+  builder.create<ReturnOp>(loc);
+  return success();
+}
+
+void DomainDecompositionPass::runOnOperation() {
+  if (ranks.size() != 2 ||
+      llvm::any_of(ranks, [](int64_t x) { return x <= 0; })) {
+    getOperation().emitError("expected two positive numbers of ranks");
+    return signalPassFailure();
+  }
+  if (!getMemRefDim(dimensionOrder, kIDimension).hasValue()) {
+    getOperation().emitError("expected ijk or kij dimension order");
+    return signalPassFailure();
+  }
+
+  SmallVector<FuncOp, 4> funcOps;
+  for (auto funcOp : getOperation().getOps<FuncOp>()) {
+    if (StencilDialect::isStencilProgram(funcOp))
+      funcOps.push_back(funcOp);
+  }
+  for (auto funcOp : funcOps) {
+    if (failed(decomposeProgram(funcOp)))
+      return signalPassFailure();
+  }
+}
+
+} // namespace
+
+std::unique_ptr<OperationPass<ModuleOp>> mlir::createDomainDecompositionPass() {
+  return std::make_unique<DomainDecompositionPass>();
+}
@@ -0,0 +1,195 @@
+#include "Dialect/Stencil/Passes.h"
+#include "Dialect/Stencil/StencilDialect.h"
+#include "Dialect/Stencil/StencilOps.h"
+#include "Dialect/Stencil/StencilTypes.h"
+#include "Dialect/Stencil/StencilUtils.h"
+#include "PassDetail.h"
+#include "mlir/Dialect/SCF/SCF.h"
+#include "mlir/Dialect/StandardOps/IR/Ops.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/SymbolTable.h"
+#include "mlir/IR/Value.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Support/LLVM.h"
+#include "mlir/Support/LogicalResult.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include <cstdint>
+#include <functional>
+#include <string>
+
+using namespace mlir;
+using namespace stencil;
+
+namespace {
+
+struct DomainSpecializationPass
+    : public DomainSpecializationPassBase<DomainSpecializationPass> {
+  void getDependentDialects(DialectRegistry &registry) const override {
+    registry.insert<scf::SCFDialect>();
+  }
+  void runOnOperation() override;
+
+protected:
+  LogicalResult specializeProgram(FuncOp funcOp, ArrayRef<Index> sizes);
+};
+
+// Helper returning the name suffix of a domain size
+static std::string getSizeSuffix(ArrayRef<int64_t> size) {
+  std::string suffix;
+  for (auto en : llvm::enumerate(size))
+    suffix += (en.index() == 0 ? "_" : "x") + std::to_string(en.value());
+  return suffix;
+}
+
+LogicalResult
+DomainSpecializationPass::specializeProgram(FuncOp funcOp,
+                                            ArrayRef<Index> sizes) {
+  // Verify the program does not depend on the global position
+  auto result = funcOp.walk([&](Operation *op) {
+    if (isa<stencil::CombineOp, stencil::IndexOp>(op)) {
+      op->emitOpError("expected no position dependent ops in specialized "
+                      "programs");
+      return WalkResult::interrupt();
+    }
+    return WalkResult::advance();
+  });
+  if (result.wasInterrupted())
+    return failure();
+
+  // Compute the domain written by the stores
+  SmallVector<stencil::StoreOp, 4> storeOps;
+  funcOp.walk([&](stencil::StoreOp storeOp) { storeOps.push_back(storeOp); });
+  if (storeOps.empty())
+    return success();
+  Index lb = cast<ShapeOp>(storeOps.front().getOperation()).getLB();
+  Index ub = cast<ShapeOp>(storeOps.front().getOperation()).getUB();
+  for (auto storeOp : storeOps) {
+    auto shapeOp = cast<ShapeOp>(storeOp.getOperation());
+    if (shapeOp.getLB() != lb || shapeOp.getUB() != ub) {
+      storeOp.emitOpError("expected all stores to write the same domain");
+      return failure();
+    }
+  }
+  Index domainSize = applyFunElementWise(ub, lb, std::minus<int64_t>());
+  if (domainSize.size() != kIndexSize) {
+    funcOp.emitOpError("expected three dimensional domains");
+    return failure();
+  }
+
+  // Clone the program for every domain size that differs from the original
+  // one and move the upper bounds of the fields and stores along
+  SmallVector<std::pair<Index, FuncOp>, 4> variants;
+  OpBuilder builder(funcOp.getContext());
+  builder.setInsertionPointAfter(funcOp);
+  for (auto &size : sizes) {
+    if (size == domainSize ||
+        llvm::any_of(variants, [&](std::pair<Index, FuncOp> &variant) {
+          return variant.first == size;
+        }))
+      continue;
+    Index delta = applyFunElementWise(size, domainSize, std::minus<int64_t>());
+    auto programOp = cast<FuncOp>(builder.clone(*funcOp));
+    SymbolTable::setSymbolName(programOp,
+                               funcOp.getName().str() + getSizeSuffix(size));
+    programOp.setPrivate();
+    result = programOp.walk([&](stencil::CastOp castOp) {
+      auto shapeOp = cast<ShapeOp>(castOp.getOperation());
+      Index castUB = applyFunElementWise(shapeOp.getUB(), delta,
+                                         std::plus<int64_t>());
+      if (llvm::any_of(llvm::zip(shapeOp.getLB(), castUB),
+                       [&](std::tuple<int64_t, int64_t> x) {
+                         return std::get<0>(x) >= std::get<1>(x);
+                       })) {
+        castOp.emitOpError("expected the specialized field to be non-empty");
+        return WalkResult::interrupt();
+      }
+      updateCastShape(castOp, shapeOp.getLB(), castUB);
+      return WalkResult::advance();
+    });
+    if (result.wasInterrupted())
+      return failure();
+    programOp.walk([&](stencil::StoreOp storeOp) {
+      auto shapeOp = cast<ShapeOp>(storeOp.getOperation());
+      shapeOp.updateShape(lb, applyFunElementWise(lb, size,
+                                                  std::plus<int64_t>()));
+    });
+    // Clear the inferred shapes that have to be recomputed by another shape
+    // inference run
+    programOp.walk([](ShapeOp shapeOp) {
+      if (!isa<stencil::CastOp, stencil::StoreOp>(shapeOp.getOperation()))
+        shapeOp.clearInferredShape();
+    });
+    programOp.walk(
+        [](stencil::ApplyOp applyOp) { applyOp.updateArgumentTypes(); });
+    variants.push_back({size, programOp});
+  }
+  if (variants.empty())
+    return success();
+
+  // Introduce a dispatcher that takes the domain size in front of the fields
+  // and calls the matching variant or the original program and aborts if
+  // neither of them computes the domain size
+  variants.push_back({domainSize, funcOp});
+  Location loc = funcOp.getLoc();
+  SmallVector<Type, 10> inputs(kIndexSize, builder.getIndexType());
+  inputs.append(funcOp.getType().getInputs().begin(),
+                funcOp.getType().getInputs().end());
+  builder.setInsertionPoint(funcOp);
+  auto dispatchOp = builder.create<FuncOp>(
+      loc, funcOp.getName().str() + "_dispatch",
+      builder.getFunctionType(inputs, llvm::None));
+  builder.setInsertionPointToStart(dispatchOp.addEntryBlock());
+  auto arguments = dispatchOp.getArguments();
+  auto fields = arguments.drop_front(kIndexSize);
+  for (auto &variant : variants) {
+    Value match;
+    for (auto en : llvm::enumerate(variant.first)) {
+      Value cmpOp = builder.create<CmpIOp>(
+          loc, CmpIPredicate::eq, arguments[en.index()],
+          builder.create<ConstantIndexOp>(loc, en.value()));
+      match = match ? builder.create<AndOp>(loc, match, cmpOp).getResult()
+                    : cmpOp;
+    }
+    auto ifOp = builder.create<scf::IfOp>(loc, TypeRange(), match, true);
+    builder.setInsertionPointToStart(ifOp.getBody(0));
+    builder.create<CallOp>(loc, variant.second, fields);
+    builder.setInsertionPointToStart(ifOp.getBody(1));
+  }
+  Value falseOp = builder.create<ConstantIntOp>(loc, 0, 1);
+  builder.create<AssertOp>(loc, falseOp, "unexpected domain size");
+  builder.setInsertionPointToEnd(&dispatchOp.getBody().front());
+  builder.create<ReturnOp>(loc);
+  return success();
+}
+
+void DomainSpecializationPass::runOnOperation() {
+  if (domainSizes.empty() || domainSizes.size() % kIndexSize != 0 ||
+      llvm::any_of(domainSizes, [](int64_t x) { return x <= 0; })) {
+    getOperation().emitError("expected triples of positive domain sizes");
+    return signalPassFailure();
+  }
+  SmallVector<Index, 4> sizes;
+  for (size_t i = 0, e = domainSizes.size(); i != e; i += kIndexSize)
+    sizes.push_back(Index(domainSizes.begin() + i,
+                          domainSizes.begin() + i + kIndexSize));
+
+  SmallVector<FuncOp, 4> funcOps;
+  for (auto funcOp : getOperation().getOps<FuncOp>()) {
+    if (StencilDialect::isStencilProgram(funcOp))
+      funcOps.push_back(funcOp);
+  }
+  for (auto funcOp : funcOps) {
+    if (failed(specializeProgram(funcOp, sizes)))
+      return signalPassFailure();
+  }
+}
+
+} // namespace
+
+std::unique_ptr<OperationPass<ModuleOp>>
+mlir::createDomainSpecializationPass() {
+  return std::make_unique<DomainSpecializationPass>();
+}
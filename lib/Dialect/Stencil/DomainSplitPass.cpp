@@ -1,4 +1,5 @@
 #include "Dialect/Stencil/Passes.h"
+#include "Dialect/Stencil/StencilAnalysis.h"
 #include "Dialect/Stencil/StencilDialect.h"
 #include "Dialect/Stencil/StencilOps.h"
 #include "PassDetail.h"
@@ -12,11 +13,14 @@
 #include "mlir/Pass/Pass.h"
 #include "mlir/Support/LLVM.h"
 #include "mlir/Transforms/Passes.h"
+#include "llvm/ADT/SmallPtrSet.h"
 
 using namespace mlir;
 using namespace stencil;
 
-void splitOnDomains(FuncOp funcOp) {
+// The split functions collect the cloned ops and the ops with replaced
+// operands to update the extent analysis
+void splitOnDomains(FuncOp funcOp, SmallPtrSetImpl<Operation *> &modifiedOps) {
   // Maps to remember domains associated with every operation
   llvm::DenseMap<Operation *, Index> negative;
   llvm::DenseMap<Operation *, Index> positive;
@@ -84,6 +88,7 @@ void splitOnDomains(FuncOp funcOp) {
       // For every domain construct one copy of the op
       for (size_t i = 1, e = domains.size(); i < e; i++) {
         Operation *clonedOp = builder.clone(*op);
+        modifiedOps.insert(clonedOp);
         // Add domain of new op to global map
         negative[clonedOp] = std::get<0>(domains[i]);
         positive[clonedOp] = std::get<1>(domains[i]);
@@ -93,10 +98,13 @@ void splitOnDomains(FuncOp funcOp) {
           std::get<0>(res.value())
               .replaceUsesWithIf(std::get<1>(res.value()),
                                  [&](OpOperand &operand) {
-                                   return std::get<0>(useToDomain[&operand]) ==
-                                              std::get<0>(domains[i]) &&
-                                          std::get<1>(useToDomain[&operand]) ==
-                                              std::get<1>(domains[i]);
+                                   if (std::get<0>(useToDomain[&operand]) !=
+                                           std::get<0>(domains[i]) ||
+                                       std::get<1>(useToDomain[&operand]) !=
+                                           std::get<1>(domains[i]))
+                                     return false;
+                                   modifiedOps.insert(operand.getOwner());
+                                   return true;
                                  });
         }
       }
@@ -104,7 +112,8 @@ void splitOnDomains(FuncOp funcOp) {
   }
 }
 
-void splitOnLastCombines(FuncOp funcOp) {
+void splitOnLastCombines(FuncOp funcOp,
+                         SmallPtrSetImpl<Operation *> &modifiedOps) {
   // Map to remember the closest downstream stencil combine for every operation
   llvm::DenseMap<Operation *, Operation *> lastCombine;
 
@@ -158,6 +167,7 @@ void splitOnLastCombines(FuncOp funcOp) {
       // For every combine construct one copy of the op
       for (size_t i = 1, e = combines.size(); i < e; i++) {
         Operation *clonedOp = builder.clone(*op);
+        modifiedOps.insert(clonedOp);
         // Add combine of new op to global map
         if (dyn_cast<CombineOp>(*op)) {
           lastCombine[clonedOp] = clonedOp;
@@ -170,7 +180,10 @@ void splitOnLastCombines(FuncOp funcOp) {
           std::get<0>(res.value())
               .replaceUsesWithIf(std::get<1>(res.value()),
                                  [&](OpOperand &operand) {
-                                   return useToCombine[&operand] == combines[i];
+                                   if (useToCombine[&operand] != combines[i])
+                                     return false;
+                                   modifiedOps.insert(operand.getOwner());
+                                   return true;
                                  });
         }
       }
@@ -204,9 +217,20 @@ void DomainSplitPass::runOnFunction() {
     return;
   }
 
-  splitOnDomains(funcOp);
+  SmallPtrSet<Operation *, 16> modifiedOps;
+  splitOnDomains(funcOp, modifiedOps);
   //funcOp.dump();
-  splitOnLastCombines(funcOp);
+  splitOnLastCombines(funcOp, modifiedOps);
+
+  // Update the cached extent analysis for the modified apply ops instead of
+  // invalidating it
+  if (auto extents = getCachedAnalysis<AccessExtents>()) {
+    for (auto op : modifiedOps) {
+      if (auto applyOp = dyn_cast<stencil::ApplyOp>(op))
+        extents->get().update(applyOp);
+    }
+  }
+  markAnalysesPreserved<AccessExtents>();
 }
 
 } // namespace
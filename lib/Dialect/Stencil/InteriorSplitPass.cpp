@@ -0,0 +1,241 @@
+#include "Dialect/Stencil/Passes.h"
+#include "Dialect/Stencil/StencilDialect.h"
+#include "Dialect/Stencil/StencilOps.h"
+#include "Dialect/Stencil/StencilTypes.h"
+#include "Dialect/Stencil/StencilUtils.h"
+#include "PassDetail.h"
+#include "mlir/Dialect/SCF/SCF.h"
+#include "mlir/Dialect/StandardOps/IR/Ops.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/Matchers.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/PatternMatch.h"
+#include "mlir/IR/Value.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Support/LLVM.h"
+#include "mlir/Transforms/GreedyPatternRewriteDriver.h"
+#include "llvm/ADT/None.h"
+#include "llvm/ADT/Optional.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/ErrorHandling.h"
+#include <cstdint>
+#include <limits>
+
+using namespace mlir;
+using namespace stencil;
+
+namespace {
+
+// Comparison of the position in one dimension with a constant
+// (cmpi of a stencil.index op and a constant as introduced by the if/else
+// lowering of the combine ops or written by the user for boundary handling)
+struct PositionCondition {
+  CmpIOp cmpOp;
+  int64_t dim;
+  int64_t offset;
+  int64_t constant;
+  bool isIndexLHS;
+
+  // Evaluate the condition at the given position
+  bool evaluate(int64_t pos) const {
+    int64_t lhs = isIndexLHS ? pos + offset : constant;
+    int64_t rhs = isIndexLHS ? constant : pos + offset;
+    switch (cmpOp.getPredicate()) {
+    case CmpIPredicate::eq:
+      return lhs == rhs;
+    case CmpIPredicate::ne:
+      return lhs != rhs;
+    case CmpIPredicate::slt:
+      return lhs < rhs;
+    case CmpIPredicate::sle:
+      return lhs <= rhs;
+    case CmpIPredicate::sgt:
+      return lhs > rhs;
+    case CmpIPredicate::sge:
+      return lhs >= rhs;
+    case CmpIPredicate::ult:
+      return static_cast<uint64_t>(lhs) < static_cast<uint64_t>(rhs);
+    case CmpIPredicate::ule:
+      return static_cast<uint64_t>(lhs) <= static_cast<uint64_t>(rhs);
+    case CmpIPredicate::ugt:
+      return static_cast<uint64_t>(lhs) > static_cast<uint64_t>(rhs);
+    case CmpIPredicate::uge:
+      return static_cast<uint64_t>(lhs) >= static_cast<uint64_t>(rhs);
+    }
+    llvm_unreachable("unexpected comparison predicate");
+  }
+
+  // Return the first position inside the range lb to ub (exclusive) at which
+  // the condition changes its value (the value may only change if the
+  // shifted position crosses the constant or zero for unsigned comparisons)
+  Optional<int64_t> getSplitPoint(int64_t lb, int64_t ub) const {
+    SmallVector<int64_t, 3> candidates = {-offset, constant - offset,
+                                          constant - offset + 1};
+    llvm::sort(candidates);
+    for (auto point : candidates) {
+      if (point > lb && point < ub && evaluate(point - 1) != evaluate(point))
+        return point;
+    }
+    return llvm::None;
+  }
+};
+
+// Helper to match a position condition
+static Optional<PositionCondition> matchPositionCondition(CmpIOp cmpOp) {
+  for (unsigned i = 0; i != 2; ++i) {
+    auto indexOp = cmpOp.getOperand(i).getDefiningOp<stencil::IndexOp>();
+    auto constOp = cmpOp.getOperand(1 - i).getDefiningOp<ConstantIndexOp>();
+    if (indexOp && constOp) {
+      int64_t dim = indexOp.dim();
+      auto offset = cast<OffsetOp>(indexOp.getOperation()).getOffset();
+      return PositionCondition{cmpOp, dim, offset[dim], constOp.getValue(),
+                               i == 0};
+    }
+  }
+  return llvm::None;
+}
+
+// Helper to check if the results of an apply op flow into another apply op
+static bool isInternal(Operation *op) {
+  return llvm::any_of(op->getUsers(), [](Operation *user) {
+    return isa<stencil::ApplyOp>(user) ||
+           (isa<stencil::CombineOp>(user) && isInternal(user));
+  });
+}
+
+// Inline the if/else ops that have a constant condition
+static void inlineStaticBranches(stencil::ApplyOp applyOp) {
+  SmallVector<scf::IfOp, 4> ifOps;
+  applyOp.walk([&](scf::IfOp ifOp) { ifOps.push_back(ifOp); });
+  for (auto ifOp : ifOps) {
+    bool isTrue = matchPattern(ifOp.condition(), m_One());
+    if (!isTrue && !matchPattern(ifOp.condition(), m_Zero()))
+      continue;
+    Region &region = isTrue ? ifOp.thenRegion() : ifOp.elseRegion();
+    if (region.empty()) {
+      ifOp.erase();
+      continue;
+    }
+    // Move the operations of the taken branch in front of the if op
+    Block &block = region.front();
+    auto yieldOp = cast<scf::YieldOp>(block.getTerminator());
+    ifOp.getOperation()->replaceAllUsesWith(yieldOp.getOperands());
+    ifOp.getOperation()->getBlock()->getOperations().splice(
+        Block::iterator(ifOp), block.getOperations(), block.begin(),
+        std::prev(block.end()));
+    ifOp.erase();
+  }
+}
+
+// Specialize the apply op for the domain lb to ub and split it recursively
+// until all position conditions are uniform on the domain of every copy
+static void splitApplyOp(stencil::ApplyOp applyOp, Index lb, Index ub) {
+  // Collect the position conditions
+  SmallVector<PositionCondition, 4> conditions;
+  applyOp.walk([&](CmpIOp cmpOp) {
+    if (auto condition = matchPositionCondition(cmpOp))
+      conditions.push_back(condition.getValue());
+  });
+
+  // Replace the uniform conditions by constants and find a split point
+  OpBuilder builder(applyOp);
+  Optional<std::pair<int64_t, int64_t>> split;
+  for (auto &condition : conditions) {
+    int64_t lower = lb[condition.dim];
+    int64_t upper = ub[condition.dim];
+    if (auto point = condition.getSplitPoint(lower, upper)) {
+      if (!split)
+        split = std::make_pair(condition.dim, point.getValue());
+      continue;
+    }
+    // Evaluate the condition at an arbitrary position of the domain
+    int64_t pos = lower;
+    if (lower == std::numeric_limits<int64_t>::min())
+      pos = upper == std::numeric_limits<int64_t>::max() ? 0 : upper - 1;
+    builder.setInsertionPoint(condition.cmpOp);
+    auto constOp = builder.create<ConstantIntOp>(
+        condition.cmpOp.getLoc(), condition.evaluate(pos), 1);
+    condition.cmpOp.getResult().replaceAllUsesWith(constOp.getResult());
+    condition.cmpOp.erase();
+  }
+  inlineStaticBranches(applyOp);
+  if (!split)
+    return;
+
+  // Split the apply op and combine the results of the two copies
+  int64_t dim = split.getValue().first;
+  int64_t point = split.getValue().second;
+  builder.setInsertionPoint(applyOp);
+  Operation *op = applyOp.getOperation();
+  auto lowerOp = cast<stencil::ApplyOp>(builder.clone(*op));
+  auto upperOp = cast<stencil::ApplyOp>(builder.clone(*op));
+  auto combineOp = builder.create<stencil::CombineOp>(
+      applyOp.getLoc(), applyOp.getResultTypes(), dim, point,
+      lowerOp.getResults(), upperOp.getResults(), ValueRange(), ValueRange(),
+      applyOp.lbAttr(), applyOp.ubAttr());
+  op->replaceAllUsesWith(combineOp.getResults());
+  op->erase();
+
+  // Update the shapes of the copies if the shapes are known
+  Index lowerUB = ub;
+  Index upperLB = lb;
+  lowerUB[dim] = point;
+  upperLB[dim] = point;
+  auto lowerShapeOp = cast<ShapeOp>(lowerOp.getOperation());
+  auto upperShapeOp = cast<ShapeOp>(upperOp.getOperation());
+  if (lowerShapeOp.hasShape()) {
+    lowerShapeOp.updateShape(lb, lowerUB);
+    upperShapeOp.updateShape(upperLB, ub);
+  }
+  splitApplyOp(lowerOp, lb, lowerUB);
+  splitApplyOp(upperOp, upperLB, ub);
+}
+
+struct InteriorSplitPass : public InteriorSplitPassBase<InteriorSplitPass> {
+
+  void runOnFunction() override;
+};
+
+void InteriorSplitPass::runOnFunction() {
+  FuncOp funcOp = getFunction();
+
+  // Only run on functions marked as stencil programs
+  if (!StencilDialect::isStencilProgram(funcOp))
+    return;
+
+  // Collect the apply ops that write to a storage
+  // (the apply ops consumed by other apply ops have no storage)
+  SmallVector<stencil::ApplyOp, 10> applyOps;
+  funcOp.walk([&](stencil::ApplyOp applyOp) {
+    auto returnOp =
+        cast<stencil::ReturnOp>(applyOp.getBody()->getTerminator());
+    if (returnOp.getUnrollFac() != 1 || isInternal(applyOp.getOperation()))
+      return;
+    applyOps.push_back(applyOp);
+  });
+
+  // Split the apply ops at the positions the conditions change
+  for (auto applyOp : applyOps) {
+    Index lb(kIndexSize, std::numeric_limits<int64_t>::min());
+    Index ub(kIndexSize, std::numeric_limits<int64_t>::max());
+    auto shapeOp = cast<ShapeOp>(applyOp.getOperation());
+    if (shapeOp.hasShape()) {
+      lb = shapeOp.getLB();
+      ub = shapeOp.getUB();
+    }
+    splitApplyOp(applyOp, lb, ub);
+  }
+
+  // Fold the selects and remove the unused arguments of the copies
+  OwningRewritePatternList patterns;
+  stencil::ApplyOp::getCanonicalizationPatterns(patterns, &getContext());
+  applyPatternsAndFoldGreedily(funcOp, std::move(patterns));
+}
+
+} // namespace
+
+std::unique_ptr<OperationPass<FuncOp>> mlir::createInteriorSplitPass() {
+  return std::make_unique<InteriorSplitPass>();
+}
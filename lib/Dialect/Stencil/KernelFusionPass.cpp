@@ -0,0 +1,221 @@
+#include "Dialect/Stencil/Passes.h"
+#include "Dialect/Stencil/StencilCostModel.h"
+#include "Dialect/Stencil/StencilDialect.h"
+#include "Dialect/Stencil/StencilOps.h"
+#include "Dialect/Stencil/StencilTypes.h"
+#include "PassDetail.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/PatternMatch.h"
+#include "mlir/IR/Value.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Support/LLVM.h"
+#include "mlir/Transforms/GreedyPatternRewriteDriver.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/raw_ostream.h"
+#include <string>
+
+using namespace mlir;
+using namespace stencil;
+
+namespace {
+
+struct KernelFusionPass : public KernelFusionPassBase<KernelFusionPass> {
+
+  void runOnFunction() override;
+};
+
+// Helper checking if the operation depends on the results of another one
+static bool dependsOn(Operation *op, Operation *producerOp) {
+  SmallVector<Operation *, 16> workList = {producerOp};
+  DenseSet<Operation *> visited;
+  while (!workList.empty()) {
+    Operation *currOp = workList.pop_back_val();
+    for (auto user : currOp->getUsers()) {
+      if (user == op)
+        return true;
+      if (visited.insert(user).second)
+        workList.push_back(user);
+    }
+  }
+  return false;
+}
+
+// Helper checking if the two apply ops can execute in one kernel
+// (the first apply op executes before the second one)
+static bool isFusionPossible(stencil::ApplyOp applyOp1,
+                             stencil::ApplyOp applyOp2) {
+  // Both apply ops compute the same domain
+  auto shapeOp1 = cast<ShapeOp>(applyOp1.getOperation());
+  auto shapeOp2 = cast<ShapeOp>(applyOp2.getOperation());
+  if (shapeOp1.hasShape() != shapeOp2.hasShape() ||
+      (shapeOp1.hasShape() && (shapeOp1.getLB() != shapeOp2.getLB() ||
+                               shapeOp1.getUB() != shapeOp2.getUB())))
+    return false;
+  // The second apply op does not depend on the first one
+  if (dependsOn(applyOp2.getOperation(), applyOp1.getOperation()))
+    return false;
+  // The results of the first apply op are used after the second one
+  return llvm::all_of(applyOp1.getOperation()->getUsers(), [&](Operation *op) {
+    return applyOp2.getOperation()->isBeforeInBlock(op);
+  });
+}
+
+// Fuse two apply ops into one apply op returning the results of both
+static stencil::ApplyOp fuseApplyOps(stencil::ApplyOp applyOp1,
+                                     stencil::ApplyOp applyOp2) {
+  // Compute the operands and result types of the fused apply op
+  SmallVector<Value, 10> newOperands = applyOp1.getOperands();
+  newOperands.append(applyOp2.getOperands().begin(),
+                     applyOp2.getOperands().end());
+  SmallVector<Type, 10> newResultTypes(applyOp1.getResultTypes().begin(),
+                                       applyOp1.getResultTypes().end());
+  newResultTypes.append(applyOp2.getResultTypes().begin(),
+                        applyOp2.getResultTypes().end());
+
+  // Introduce the fused apply op in front of the second apply op
+  OpBuilder builder(applyOp2);
+  auto loc = builder.getFusedLoc({applyOp1.getLoc(), applyOp2.getLoc()});
+  auto newOp = builder.create<stencil::ApplyOp>(
+      loc, newResultTypes, newOperands, applyOp1.lb(), applyOp1.ub());
+
+  // Move the bodies to the fused apply op and concatenate the results
+  SmallVector<Value, 10> newReturnOperands;
+  unsigned numArguments = 0;
+  for (auto applyOp : {applyOp1, applyOp2}) {
+    for (auto arg : applyOp.getBody()->getArguments())
+      arg.replaceAllUsesWith(newOp.getBody()->getArgument(numArguments++));
+    auto returnOp =
+        cast<stencil::ReturnOp>(applyOp.getBody()->getTerminator());
+    newReturnOperands.append(returnOp.getOperands().begin(),
+                             returnOp.getOperands().end());
+    returnOp.erase();
+    newOp.getBody()->getOperations().splice(
+        newOp.getBody()->end(), applyOp.getBody()->getOperations());
+  }
+  builder.setInsertionPointToEnd(newOp.getBody());
+  builder.create<stencil::ReturnOp>(loc, newReturnOperands, nullptr);
+
+  // Replace the results of the fused apply ops
+  applyOp1.getOperation()->replaceAllUsesWith(
+      newOp.getResults().take_front(applyOp1.getNumResults()));
+  applyOp2.getOperation()->replaceAllUsesWith(
+      newOp.getResults().take_back(applyOp2.getNumResults()));
+  applyOp1.erase();
+  applyOp2.erase();
+  return newOp;
+}
+
+void KernelFusionPass::runOnFunction() {
+  FuncOp funcOp = getFunction();
+  // Only run on functions marked as stencil programs
+  if (!StencilDialect::isStencilProgram(funcOp))
+    return;
+
+  // Verify unrolling has not been executed
+  auto result = funcOp.walk([&](stencil::ReturnOp returnOp) {
+    if (returnOp.unroll().hasValue()) {
+      returnOp.emitOpError("execute stencil unrolling after kernel fusion");
+      return WalkResult::interrupt();
+    }
+    return WalkResult::advance();
+  });
+  if (result.wasInterrupted())
+    return signalPassFailure();
+
+  // Name the apply ops by their position to explain the clustering
+  SmallVector<stencil::ApplyOp, 16> applyOps;
+  DenseMap<Operation *, std::string> names;
+  unsigned trafficBytes = 0;
+  funcOp.walk([&](stencil::ApplyOp applyOp) {
+    if (applyOp.getOperation()->getParentRegion() != &funcOp.getBody())
+      return;
+    names[applyOp.getOperation()] = "apply" + std::to_string(applyOps.size());
+    trafficBytes += FusionCostModel::getTrafficBytes(applyOp);
+    applyOps.push_back(applyOp);
+  });
+  std::string dumpMessage;
+  llvm::raw_string_ostream dumpStream(dumpMessage);
+  for (auto applyOp : applyOps)
+    dumpStream << "  " << names[applyOp.getOperation()] << " at "
+               << applyOp.getLoc() << "\n";
+
+  // Fuse the pair of apply ops that saves the most memory traffic until no
+  // fusion fits the register and input budgets
+  FusionCostModel costModel(maxRegisters, maxInputs);
+  while (true) {
+    unsigned bestBytes = 0;
+    stencil::ApplyOp bestOp1, bestOp2;
+    for (auto it1 = applyOps.begin(); it1 != applyOps.end(); ++it1) {
+      for (auto it2 = std::next(it1); it2 != applyOps.end(); ++it2) {
+        auto applyOp1 = *it1;
+        auto applyOp2 = *it2;
+        if (applyOp2.getOperation()->isBeforeInBlock(applyOp1))
+          std::swap(applyOp1, applyOp2);
+        unsigned sharedBytes =
+            FusionCostModel::getSharedBytes(applyOp1, applyOp2);
+        if (sharedBytes > bestBytes &&
+            costModel.isFusionProfitable(applyOp1, applyOp2) &&
+            isFusionPossible(applyOp1, applyOp2)) {
+          bestBytes = sharedBytes;
+          bestOp1 = applyOp1;
+          bestOp2 = applyOp2;
+        }
+      }
+    }
+    if (!bestOp1)
+      break;
+
+    // Record the decision and fuse the apply ops
+    std::string name = "{" + names[bestOp1.getOperation()] + ", " +
+                       names[bestOp2.getOperation()] + "}";
+    dumpStream << "  fuse " << names[bestOp1.getOperation()] << " and "
+               << names[bestOp2.getOperation()] << ": saves " << bestBytes
+               << " bytes/point, "
+               << FusionCostModel::getNumRegisters(bestOp1, bestOp2)
+               << " registers, "
+               << FusionCostModel::getNumInputs(bestOp1, bestOp2)
+               << " inputs\n";
+    llvm::erase_if(applyOps, [&](stencil::ApplyOp applyOp) {
+      return applyOp == bestOp1 || applyOp == bestOp2;
+    });
+    auto newOp = fuseApplyOps(bestOp1, bestOp2);
+    names[newOp.getOperation()] = name;
+    numFused++;
+    if (emitRemarks)
+      newOp.emitRemark("fused ")
+          << name << " saving " << bestBytes << " bytes/point";
+    applyOps.push_back(newOp);
+  }
+
+  // Remove the duplicate arguments of the fused apply ops
+  OwningRewritePatternList patterns;
+  stencil::ApplyOp::getCanonicalizationPatterns(patterns, &getContext());
+  applyPatternsAndFoldGreedily(funcOp, std::move(patterns));
+
+  // Print the kernels and the memory traffic before and after the fusion
+  if (dumpClusters) {
+    unsigned fusedBytes = 0;
+    unsigned numKernels = 0;
+    funcOp.walk([&](stencil::ApplyOp applyOp) {
+      if (applyOp.getOperation()->getParentRegion() != &funcOp.getBody())
+        return;
+      fusedBytes += FusionCostModel::getTrafficBytes(applyOp);
+      numKernels++;
+    });
+    llvm::errs() << "kernel fusion of @" << funcOp.getName() << "\n"
+                 << dumpStream.str() << "  " << numKernels
+                 << " kernels, traffic " << trafficBytes << " -> "
+                 << fusedBytes << " bytes/point\n";
+  }
+}
+
+} // namespace
+
+std::unique_ptr<OperationPass<FuncOp>> mlir::createKernelFusionPass() {
+  return std::make_unique<KernelFusionPass>();
+}
@@ -32,21 +32,23 @@ namespace {
 struct PeelRewrite : public stencil::ApplyOpPattern {
   using ApplyOpPattern::ApplyOpPattern;
 
-  LogicalResult makePeelIteration(stencil::ApplyOp applyOp, int64_t peelSize,
+  LogicalResult makePeelIteration(stencil::ApplyOp applyOp, size_t unrollDim,
+                                  int64_t peelSize,
                                   PatternRewriter &rewriter) const {
     // Get shape and terminator of the apply operation
     auto returnOp = cast<stencil::ReturnOp>(applyOp.getBody()->getTerminator());
     auto shapeOp = cast<ShapeOp>(applyOp.getOperation());
 
     // Compute count of left or right empty stores
+    auto unrollFac = returnOp.getUnroll()[unrollDim];
     auto leftCount = peelSize < 0 ? -peelSize : 0;
-    auto rightCount = peelSize > 0 ? returnOp.getUnrollFac() - peelSize
-                                   : returnOp.getUnrollFac();
+    auto rightCount = peelSize > 0 ? unrollFac - peelSize : unrollFac;
     // Create empty store for all iterations that exceed the trip count
     unsigned numOfOperands = 0;
     SmallVector<Value, 16> newOperands;
     for (auto en : llvm::enumerate(returnOp.getOperands())) {
-      int64_t unrollIdx = en.index() % returnOp.getUnrollFac();
+      int64_t unrollIdx = returnOp.getUnrollOffset(
+          en.index() % returnOp.getUnrollFac())[unrollDim];
       if (unrollIdx < leftCount || unrollIdx >= rightCount) {
         auto resultOp = en.value().getDefiningOp();
         numOfOperands += resultOp->getNumOperands();
@@ -58,7 +60,7 @@ struct PeelRewrite : public stencil::ApplyOpPattern {
     // Extend the shape for negative peel sizes
     if (peelSize < 0) {
       auto lb = shapeOp.getLB();
-      lb[returnOp.getUnrollDim()] += peelSize;
+      lb[unrollDim] += peelSize;
       shapeOp.updateShape(lb, shapeOp.getUB());
       return success();
     }
@@ -66,11 +68,11 @@ struct PeelRewrite : public stencil::ApplyOpPattern {
   }
 
   LogicalResult addPeelIteration(stencil::ApplyOp applyOp,
-                                 stencil::ReturnOp returnOp, int64_t peelSize,
+                                 stencil::ReturnOp returnOp, size_t unrollDim,
+                                 int64_t peelSize,
                                  PatternRewriter &rewriter) const {
-    // Get the unroll factor and dimension
-    auto unrollFac = returnOp.getUnrollFac();
-    auto unrollDim = returnOp.getUnrollDim();
+    // Get the unroll factor of the dimension
+    auto unrollFac = returnOp.getUnroll()[unrollDim];
 
     // Compute the domain size
     auto shapeOp = cast<ShapeOp>(applyOp.getOperation());
@@ -78,7 +80,7 @@ struct PeelRewrite : public stencil::ApplyOpPattern {
 
     // Introduce peel iterations
     if (domainSize <= unrollFac) {
-      return makePeelIteration(applyOp, peelSize, rewriter);
+      return makePeelIteration(applyOp, unrollDim, peelSize, rewriter);
     } else {
       // Clone a peel and a body operation
       auto leftOp = cast<stencil::ApplyOp>(rewriter.clone(*applyOp));
@@ -98,7 +100,7 @@ struct PeelRewrite : public stencil::ApplyOpPattern {
 
       // Remove stores that exceed the domain
       auto peelOp = peelSize < 0 ? leftOp : rightOp;
-      makePeelIteration(peelOp, peelSize, rewriter);
+      makePeelIteration(peelOp, unrollDim, peelSize, rewriter);
 
       // Introduce a stencil combine to replace the apply operation
       auto combineOp = rewriter.create<stencil::CombineOp>(
@@ -117,28 +119,37 @@ struct PeelRewrite : public stencil::ApplyOpPattern {
     auto shapeOp = cast<ShapeOp>(applyOp.getOperation());
 
     // Compute the domain size
-    auto unrollDim = returnOp.getUnrollDim();
-    auto unrollFac = returnOp.getUnrollFac();
-    if (unrollFac == 1)
+    if (returnOp.getUnrollFac() == 1)
       return failure();
 
     // Get the combine tree root and determine to base offset
     auto rootOp = applyOp.getCombineTreeRootShape();
-    auto rootOrigin = rootOp.getLB()[unrollDim];
-
-    // Add left or right peel iterations if the bound is unaligned
-    auto leftSize = (shapeOp.getLB()[unrollDim] - rootOrigin) % unrollFac;
-    auto rightSize = (shapeOp.getUB()[unrollDim] - rootOrigin) % unrollFac;
-    if (leftSize != 0)
-      return addPeelIteration(applyOp, returnOp, -leftSize, rewriter);
-    if (rightSize != 0)
-      return addPeelIteration(applyOp, returnOp, unrollFac - rightSize,
-                              rewriter);
+
+    // Add left or right peel iterations if the bound of an unrolled
+    // dimension is unaligned (peel one dimension after the other)
+    for (auto en : llvm::enumerate(returnOp.getUnroll())) {
+      auto unrollDim = en.index();
+      auto unrollFac = en.value();
+      if (unrollFac == 1)
+        continue;
+      auto rootOrigin = rootOp.getLB()[unrollDim];
+      auto leftSize = (shapeOp.getLB()[unrollDim] - rootOrigin) % unrollFac;
+      auto rightSize = (shapeOp.getUB()[unrollDim] - rootOrigin) % unrollFac;
+      if (leftSize != 0 && succeeded(addPeelIteration(applyOp, returnOp,
+                                                      unrollDim, -leftSize,
+                                                      rewriter)))
+        return success();
+      if (rightSize != 0 &&
+          succeeded(addPeelIteration(applyOp, returnOp, unrollDim,
+                                     unrollFac - rightSize, rewriter)))
+        return success();
+    }
     return failure();
   }
 };
 
 // Fuse peel loops of neighboring apply operations in unroll direction
+// (the combine dimension has to be one of the unrolled dimensions)
 struct FuseRewrite : public stencil::CombineOpPattern {
   using CombineOpPattern::CombineOpPattern;
 
@@ -159,6 +170,7 @@ struct FuseRewrite : public stencil::CombineOpPattern {
   // Create an apply operation that fuses the left and right peel iterations
   stencil::ApplyOp fusePeelIterations(stencil::ApplyOp leftOp,
                                       stencil::ApplyOp rightOp,
+                                      size_t unrollDim,
                                       PatternRewriter &rewriter) const {
     // Compute the operands of the fused apply op
     // (run canonicalization after the pass to cleanup arguments)
@@ -186,7 +198,6 @@ struct FuseRewrite : public stencil::CombineOpPattern {
         newOp.getBody()->getArguments().take_back(rightOp.getNumOperands()));
 
     // Compute the split between left and right op operands
-    auto unrollDim = leftReturnOp.getUnrollDim();
     auto unrollFac = leftReturnOp.getUnrollFac();
     unsigned split = cast<ShapeOp>(leftOp.getOperation()).getUB()[unrollDim] -
                      cast<ShapeOp>(leftOp.getOperation()).getLB()[unrollDim];
@@ -194,7 +205,8 @@ struct FuseRewrite : public stencil::CombineOpPattern {
     // Update the operands of the second return operation
     SmallVector<Value, 10> newReturnOperands = rightReturnOp.getOperands();
     for (auto en : llvm::enumerate(leftReturnOp.getOperands())) {
-      if (en.index() % unrollFac < split)
+      if (leftReturnOp.getUnrollOffset(en.index() % unrollFac)[unrollDim] <
+          split)
         newReturnOperands[en.index()] = en.value();
     }
     rewriter.updateRootInPlace(rightReturnOp, [&]() {
@@ -238,29 +250,30 @@ struct FuseRewrite : public stencil::CombineOpPattern {
     if (!leftOp || !rightOp)
       return failure();
 
-    // Check if the shapes overlap
+    // Check if the shapes overlap in the unrolled combine dimension
     auto returnOp = cast<stencil::ReturnOp>(leftOp.getBody()->getTerminator());
-    if (returnOp.getUnrollFac() == 1)
+    size_t unrollDim = combineOp.dim();
+    if (returnOp.getUnrollFac() == 1 || returnOp.getUnroll()[unrollDim] == 1)
       return failure();
-    if (cast<ShapeOp>(leftOp.getOperation()).getLB()[returnOp.getUnrollDim()] !=
-        cast<ShapeOp>(rightOp.getOperation()).getLB()[returnOp.getUnrollDim()])
+    if (cast<ShapeOp>(leftOp.getOperation()).getLB()[unrollDim] !=
+        cast<ShapeOp>(rightOp.getOperation()).getLB()[unrollDim])
       return failure();
 
     // Merge the two apply operations in case they overlap
-    auto newOp = fusePeelIterations(leftOp, rightOp, rewriter);
+    auto newOp = fusePeelIterations(leftOp, rightOp, unrollDim, rewriter);
     auto newShape = cast<ShapeOp>(newOp.getOperation());
 
     // Update the shape of the left and right combines
     for (auto leftCombineOp : leftCombineOps) {
       auto leftShape = cast<ShapeOp>(leftCombineOp);
       auto ub = leftShape.getUB();
-      ub[returnOp.getUnrollDim()] = newShape.getLB()[returnOp.getUnrollDim()];
+      ub[unrollDim] = newShape.getLB()[unrollDim];
       leftShape.updateShape(leftShape.getLB(), ub);
     }
     for (auto rightCombineOp : rightCombineOps) {
       auto rightShape = cast<ShapeOp>(rightCombineOp);
       auto lb = rightShape.getLB();
-      lb[returnOp.getUnrollDim()] = newShape.getUB()[returnOp.getUnrollDim()];
+      lb[unrollDim] = newShape.getUB()[unrollDim];
       rightShape.updateShape(lb, rightShape.getUB());
     }
 
@@ -283,7 +296,6 @@ struct FuseRewrite : public stencil::CombineOpPattern {
     // Replace the combine op by the results computed by the fused apply
     SmallVector<Value, 10> newResults = newOp.getResults();
     auto currShape = cast<ShapeOp>(newOp.getOperation());
-    auto unrollDim = returnOp.getUnrollDim();
     if (!leftOperands.empty()) {
       // Introduce a combine ob to connect to the left combine subtree
       auto newCombineOp = rewriter.create<stencil::CombineOp>(
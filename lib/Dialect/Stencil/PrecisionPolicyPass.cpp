@@ -0,0 +1,320 @@
+#include "Dialect/Stencil/Passes.h"
+#include "Dialect/Stencil/StencilDialect.h"
+#include "Dialect/Stencil/StencilOps.h"
+#include "Dialect/Stencil/StencilTypes.h"
+#include "PassDetail.h"
+#include "mlir/Dialect/SCF/SCF.h"
+#include "mlir/Dialect/StandardOps/IR/Ops.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/SymbolTable.h"
+#include "mlir/IR/Value.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Support/LLVM.h"
+#include "mlir/Support/LogicalResult.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringSwitch.h"
+
+using namespace mlir;
+using namespace stencil;
+
+namespace {
+
+struct PrecisionPolicyPass
+    : public PrecisionPolicyPassBase<PrecisionPolicyPass> {
+
+  void runOnOperation() override;
+
+protected:
+  LogicalResult updateProgram(FuncOp funcOp);
+  LogicalResult updateStorageTypes(FuncOp funcOp, Type storageType);
+  LogicalResult updateComputeTypes(stencil::ApplyOp applyOp,
+                                   Type computeType);
+};
+
+// Helper parsing the floating point type names
+static Type parseFloatType(StringRef name, MLIRContext *context) {
+  return llvm::StringSwitch<Type>(name)
+      .Case("f16", FloatType::getF16(context))
+      .Case("f32", FloatType::getF32(context))
+      .Case("f64", FloatType::getF64(context))
+      .Default(Type());
+}
+
+// Helper returning a field or temp type with another element type
+static Type getGridType(Type type, Type elementType) {
+  if (auto fieldType = type.dyn_cast<FieldType>())
+    return FieldType::get(elementType, fieldType.getShape());
+  return TempType::get(elementType, type.cast<GridType>().getShape());
+}
+
+// Helper converting a floating point value to the given type
+static Value convertFloat(OpBuilder &builder, Location loc, Value value,
+                          Type type) {
+  auto valueType = value.getType().cast<FloatType>();
+  auto floatType = type.cast<FloatType>();
+  if (valueType == floatType)
+    return value;
+  if (valueType.getWidth() < floatType.getWidth())
+    return builder.create<FPExtOp>(loc, value, floatType);
+  return builder.create<FPTruncOp>(loc, value, floatType);
+}
+
+// Helper checking if an operation is kept in double precision
+static bool isPrecise(Operation *op) {
+  return !!op->getAttr(StencilDialect::getPreciseAttrName());
+}
+
+LogicalResult PrecisionPolicyPass::updateStorageTypes(FuncOp funcOp,
+                                                      Type storageType) {
+  // Change the element type of the fields and their casts and loads
+  SmallVector<Type, 10> inputTypes;
+  DenseMap<Value, Type> storedTypes;
+  for (auto arg : funcOp.getArguments()) {
+    auto fieldType = arg.getType().dyn_cast<FieldType>();
+    auto attr = funcOp.getArgAttrOfType<TypeAttr>(
+        arg.getArgNumber(), StencilDialect::getStorageTypeAttrName());
+    Type elementType = attr ? attr.getValue() : storageType;
+    if (fieldType && elementType &&
+        fieldType.getElementType() != elementType) {
+      if (!elementType.isa<FloatType>() ||
+          !fieldType.getElementType().isa<FloatType>())
+        return funcOp.emitOpError("expected floating point storage types");
+      arg.setType(getGridType(fieldType, elementType));
+      for (auto user : arg.getUsers()) {
+        auto castOp = dyn_cast<stencil::CastOp>(user);
+        if (!castOp)
+          return user->emitOpError("expected field to be used by a cast op");
+        castOp.res().setType(getGridType(castOp.getType(), elementType));
+        for (auto castUser : castOp.res().getUsers()) {
+          if (auto loadOp = dyn_cast<stencil::LoadOp>(castUser)) {
+            loadOp.res().setType(getGridType(loadOp.getType(), elementType));
+            continue;
+          }
+          if (auto storeOp = dyn_cast<stencil::StoreOp>(castUser)) {
+            if (!storeOp.temp().getDefiningOp<stencil::ApplyOp>())
+              return storeOp.emitOpError(
+                  "expected stored value to be computed by an apply op");
+            storedTypes[storeOp.temp()] = elementType;
+          }
+        }
+      }
+    }
+    inputTypes.push_back(arg.getType());
+  }
+  // The calls of the program cannot convert the fields they pass
+  if (llvm::makeArrayRef(inputTypes) != funcOp.getType().getInputs() &&
+      !SymbolTable::symbolKnownUseEmpty(funcOp, getOperation()))
+    return funcOp.emitOpError("expected no calls of a program changing "
+                              "its storage types");
+  funcOp.setType(FunctionType::get(inputTypes, funcOp.getType().getResults(),
+                                   funcOp.getContext()));
+
+  // Change the element type of the apply op results
+  auto result = funcOp.walk([&](stencil::ApplyOp applyOp) {
+    auto attr = applyOp.getOperation()->getAttrOfType<TypeAttr>(
+        StencilDialect::getStorageTypeAttrName());
+    for (auto result : applyOp.getResults()) {
+      Type elementType = attr ? attr.getValue() : Type();
+      if (storedTypes.count(result)) {
+        if (elementType && elementType != storedTypes[result]) {
+          applyOp.emitOpError("expected storage type to match the field");
+          return WalkResult::interrupt();
+        }
+        elementType = storedTypes[result];
+      }
+      if (!elementType)
+        continue;
+      result.setType(getGridType(result.getType(), elementType));
+    }
+    return WalkResult::advance();
+  });
+  if (result.wasInterrupted())
+    return failure();
+
+  // Update the apply op arguments and check no combine op forwards the values
+  result = funcOp.walk([&](Operation *op) {
+    if (auto applyOp = dyn_cast<stencil::ApplyOp>(op)) {
+      for (auto en : llvm::enumerate(applyOp.getOperandTypes()))
+        applyOp.getBody()->getArgument(en.index()).setType(en.value());
+    }
+    if (auto combineOp = dyn_cast<stencil::CombineOp>(op)) {
+      for (unsigned i = 0, e = combineOp.lower().size(); i != e; ++i) {
+        auto elementType = combineOp.getResult(i).getType().cast<GridType>();
+        auto lowerType = combineOp.lower()[i].getType();
+        auto upperType = combineOp.upper()[i].getType();
+        if (lowerType.cast<GridType>().getElementType() !=
+                elementType.getElementType() ||
+            upperType.cast<GridType>().getElementType() !=
+                elementType.getElementType()) {
+          combineOp.emitOpError("expected storage types to match");
+          return WalkResult::interrupt();
+        }
+      }
+    }
+    return WalkResult::advance();
+  });
+  return failure(result.wasInterrupted());
+}
+
+LogicalResult PrecisionPolicyPass::updateComputeTypes(stencil::ApplyOp applyOp,
+                                                      Type computeType) {
+  OpBuilder builder(applyOp);
+  Type preciseType = builder.getF64Type();
+
+  // Remember the floating point types before the update
+  DenseMap<Value, Type> originalTypes;
+  applyOp.getBody()->walk([&](Operation *op) {
+    for (auto result : op->getResults())
+      originalTypes[result] = result.getType();
+    for (auto &region : op->getRegions())
+      for (auto arg : region.getArguments())
+        originalTypes[arg] = arg.getType();
+  });
+  for (auto arg : applyOp.getBody()->getArguments())
+    originalTypes[arg] = arg.getType();
+
+  // Update the result types of the operations
+  auto result = applyOp.getBody()->walk([&](Operation *op) {
+    // Accesses return the element type of the temporaries
+    if (isa<stencil::AccessOp, stencil::DynAccessOp>(op)) {
+      auto tempType = op->getOperand(0).getType().cast<GridType>();
+      op->getResult(0).setType(tempType.getElementType());
+      return WalkResult::advance();
+    }
+    // Results are stored with the element type of the apply op results
+    if (auto storeResultOp = dyn_cast<stencil::StoreResultOp>(op)) {
+      auto returnOpOperands = storeResultOp.getReturnOpOperands();
+      auto returnOp = cast<stencil::ReturnOp>(
+          returnOpOperands.getValue().front()->getOwner());
+      unsigned index = returnOpOperands.getValue().front()->getOperandNumber() /
+                       returnOp.getUnrollFac();
+      auto elementType = applyOp.getResult(index)
+                             .getType()
+                             .cast<GridType>()
+                             .getElementType();
+      storeResultOp.res().setType(ResultType::get(elementType));
+      return WalkResult::advance();
+    }
+    // Keep the types of explicit conversions
+    if (isa<FPExtOp, FPTruncOp>(op))
+      return WalkResult::advance();
+    Type type = isPrecise(op) ? preciseType : computeType;
+    if (!type)
+      return WalkResult::advance();
+    for (auto result : op->getResults()) {
+      if (result.getType().isa<FloatType>())
+        result.setType(type);
+    }
+    for (auto &region : op->getRegions()) {
+      for (auto arg : region.getArguments()) {
+        if (arg.getType().isa<FloatType>())
+          arg.setType(type);
+      }
+    }
+    // Convert the constant values
+    if (auto constantOp = dyn_cast<ConstantOp>(op)) {
+      if (auto floatAttr = constantOp.getValue().dyn_cast<FloatAttr>())
+        op->setAttr("value",
+                    builder.getFloatAttr(type, floatAttr.getValueAsDouble()));
+    }
+    // Check the operation is supported
+    if (op->getNumRegions() != 0 && !isa<scf::IfOp, scf::ForOp>(op)) {
+      op->emitOpError("unexpected operation with regions");
+      return WalkResult::interrupt();
+    }
+    return WalkResult::advance();
+  });
+  if (result.wasInterrupted())
+    return failure();
+
+  // Forward the stencil result types yielded by the if ops
+  applyOp.getBody()->walk([&](scf::YieldOp yieldOp) {
+    for (auto en : llvm::enumerate(yieldOp.getOperands())) {
+      if (en.value().getType().isa<ResultType>())
+        yieldOp->getParentOp()->getResult(en.index()).setType(
+            en.value().getType());
+    }
+  });
+
+  // Insert conversions if the operand types do not match the expected types
+  applyOp.getBody()->walk([&](Operation *op) {
+    builder.setInsertionPoint(op);
+    for (auto &operand : op->getOpOperands()) {
+      Value value = operand.get();
+      if (!value.getType().isa<FloatType>())
+        continue;
+      Type expectedType = computeType ? computeType : originalTypes[value];
+      if (auto storeResultOp = dyn_cast<stencil::StoreResultOp>(op))
+        expectedType =
+            storeResultOp.res().getType().cast<ResultType>().getResultType();
+      else if (isa<scf::YieldOp>(op))
+        expectedType =
+            op->getParentOp()->getResult(operand.getOperandNumber()).getType();
+      else if (isa<FPExtOp, FPTruncOp>(op))
+        expectedType = originalTypes[value];
+      else if (isPrecise(op))
+        expectedType = preciseType;
+      if (expectedType && expectedType.isa<FloatType>())
+        operand.set(convertFloat(builder, op->getLoc(), value, expectedType));
+    }
+  });
+  return success();
+}
+
+LogicalResult PrecisionPolicyPass::updateProgram(FuncOp funcOp) {
+  // Parse the default storage and compute types
+  Type defaultStorageType = parseFloatType(storageType, &getContext());
+  Type defaultComputeType = parseFloatType(computeType, &getContext());
+  if ((!storageType.empty() && !defaultStorageType) ||
+      (!computeType.empty() && !defaultComputeType)) {
+    return funcOp.emitOpError("expected f16, f32, or f64 precision");
+  }
+
+  // Change the storage types at the field and apply op boundaries
+  if (failed(updateStorageTypes(funcOp, defaultStorageType)))
+    return failure();
+
+  // Change the compute types and convert the values at the load and store
+  // boundaries (precise apply ops compute in double precision)
+  auto result = funcOp.walk([&](stencil::ApplyOp applyOp) {
+    Type computeType = defaultComputeType;
+    Operation *op = applyOp.getOperation();
+    if (auto attr = op->getAttrOfType<TypeAttr>(
+            StencilDialect::getComputeTypeAttrName()))
+      computeType = attr.getValue();
+    if (isPrecise(op))
+      computeType = FloatType::getF64(&getContext());
+    if (computeType && !computeType.isa<FloatType>()) {
+      applyOp.emitOpError("expected floating point compute type");
+      return WalkResult::interrupt();
+    }
+    if (failed(updateComputeTypes(applyOp, computeType)))
+      return WalkResult::interrupt();
+    return WalkResult::advance();
+  });
+  return failure(result.wasInterrupted());
+}
+
+void PrecisionPolicyPass::runOnOperation() {
+  // Only run on functions marked as stencil programs (the pass runs on the
+  // module since it changes the program signatures)
+  SmallVector<FuncOp, 4> funcOps;
+  for (auto funcOp : getOperation().getOps<FuncOp>()) {
+    if (StencilDialect::isStencilProgram(funcOp))
+      funcOps.push_back(funcOp);
+  }
+  for (auto funcOp : funcOps) {
+    if (failed(updateProgram(funcOp)))
+      return signalPassFailure();
+  }
+}
+
+} // namespace
+
+std::unique_ptr<OperationPass<ModuleOp>> mlir::createPrecisionPolicyPass() {
+  return std::make_unique<PrecisionPolicyPass>();
+}
@@ -1,4 +1,5 @@
 #include "Dialect/Stencil/Passes.h"
+#include "Dialect/Stencil/StencilAnalysis.h"
 #include "Dialect/Stencil/StencilDialect.h"
 #include "Dialect/Stencil/StencilOps.h"
 #include "Dialect/Stencil/StencilTypes.h"
@@ -9,6 +10,7 @@
 #include "mlir/Pass/Pass.h"
 #include "mlir/Support/LLVM.h"
 #include "mlir/Support/LogicalResult.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/STLExtras.h"
 
@@ -17,78 +19,6 @@ using namespace stencil;
 
 namespace {
 
-/// This class computes for every stencil apply operand
-/// the minimal bounding box containing all access offsets
-class AccessExtents {
-  // This struct stores the positive and negative extends
-  struct Extent {
-    Index negative;
-    Index positive;
-  };
-
-public:
-  AccessExtents(Operation *op) {
-    // Walk all apply ops of the stencil program
-    op->walk([&](stencil::ApplyOp applyOp) {
-      auto operation = applyOp.getOperation();
-      // Compute mapping between operands and block arguments
-      llvm::DenseMap<Value, Value> argToOperand;
-      for (size_t i = 0, e = applyOp.operands().size(); i != e; ++i) {
-        argToOperand[applyOp.getBody()->getArgument(i)] = applyOp.operands()[i];
-      }
-      // Walk the access operations and update the extent
-      applyOp.walk([&](ExtentOp extentOp) {
-        Index lb, ub;
-        std::tie(lb, ub) = extentOp.getAccessExtent();
-        auto temp = extentOp.getTemp();
-        if (extents[operation].count(argToOperand[temp]) == 0) {
-          // Initialize the extents with the current offset
-          extents[operation][argToOperand[temp]].negative = lb;
-          extents[operation][argToOperand[temp]].positive = ub;
-        } else {
-          // Extend the extents with the current offset
-          auto &negative = extents[operation][argToOperand[temp]].negative;
-          auto &positive = extents[operation][argToOperand[temp]].positive;
-          negative = applyFunElementWise(negative, lb, min);
-          positive = applyFunElementWise(positive, ub, max);
-        }
-      });
-      // Subtract the unroll factor minus one from the positive extent
-      auto returnOp =
-          cast<stencil::ReturnOp>(applyOp.getBody()->getTerminator());
-      if (returnOp.unroll().hasValue()) {
-        auto unrollDim = returnOp.getUnrollDim();
-        auto unrollFac = returnOp.getUnrollFac();
-        // Limit the unroll factor to the loop length if available
-        auto shapeOp = cast<ShapeOp>(applyOp.getOperation());
-        if (shapeOp.hasShape()) {
-          unrollFac = min(unrollFac, shapeOp.getUB()[unrollDim] -
-                                         shapeOp.getLB()[unrollDim]);
-        }
-        for (auto operand : applyOp.getOperands()) {
-          if (extents[operation].count(operand) == 1) {
-            auto &positive = extents[operation][operand].positive;
-            positive[unrollDim] -= unrollFac - 1;
-          }
-        }
-      }
-    });
-  }
-
-  const Extent *lookupExtent(Operation *op, Value value) const {
-    auto operation = extents.find(op);
-    if (operation == extents.end())
-      return nullptr;
-    auto extent = operation->second.find(value);
-    if (extent == operation->second.end())
-      return nullptr;
-    return &extent->second;
-  }
-
-private:
-  llvm::DenseMap<Operation *, llvm::DenseMap<Value, Extent>> extents;
-};
-
 struct ShapeInferencePass : public ShapeInferencePassBase<ShapeInferencePass> {
 
   void runOnFunction() override;
@@ -107,6 +37,10 @@ protected:
   LogicalResult updateBounds(OpOperand &use, const AccessExtents &extents,
                              Index &lower, Index &upper);
   LogicalResult inferShapes(ShapeOp shapeOp, const AccessExtents &extents);
+
+  // Result shapes of the apply and combine ops computed during the storage
+  // extension (avoids recomputing the shapes of shared combine chains)
+  DenseMap<Value, std::tuple<Index, Index>> resultShapes;
 };
 
 /// Update the shape given updated bounds
@@ -182,6 +116,10 @@ LogicalResult ShapeInferencePass::inferShapes(ShapeOp shapeOp,
 /// Compute the shape for a given result of a defining op
 std::tuple<Index, Index>
 ShapeInferencePass::getResultShape(Operation *definingOp, Value result) {
+  // Return the shape if it has been computed before
+  auto it = resultShapes.find(result);
+  if (it != resultShapes.end())
+    return it->second;
   // If the defining op is an apply op return its shape
   if (auto applyOp = dyn_cast<stencil::ApplyOp>(definingOp)) {
     auto shapeOp = cast<ShapeOp>(applyOp.getOperation());
@@ -208,20 +146,26 @@ ShapeInferencePass::getResultShape(Operation *definingOp, Value result) {
       std::tie(lb2, ub2) =
           getResultShape(combineOp.upper()[num.getValue()].getDefiningOp(),
                          combineOp.upper()[num.getValue()]);
-      return std::make_tuple(applyFunElementWise(lb1, lb2, min),
-                             applyFunElementWise(ub1, ub2, max));
+      auto shape = std::make_tuple(applyFunElementWise(lb1, lb2, min),
+                                   applyFunElementWise(ub1, ub2, max));
+      resultShapes[result] = shape;
+      return shape;
     }
     // If the result is a lower extra result compute the shape recursively
     if (auto num = combineOp.getLowerExtraOperandNumber(resultNumber)) {
-      return getResultShape(
+      auto shape = getResultShape(
           combineOp.lowerext()[num.getValue()].getDefiningOp(),
           combineOp.lowerext()[num.getValue()]);
+      resultShapes[result] = shape;
+      return shape;
     }
     // If the result is an upper extra result compute the shape recursively
     if (auto num = combineOp.getUpperExtraOperandNumber(resultNumber)) {
-      return getResultShape(
+      auto shape = getResultShape(
           combineOp.upperext()[num.getValue()].getDefiningOp(),
           combineOp.upperext()[num.getValue()]);
+      resultShapes[result] = shape;
+      return shape;
     }
   }
   llvm_unreachable("expected an apply or a combine op");
@@ -281,7 +225,8 @@ void ShapeInferencePass::runOnFunction() {
   if (!stencil::StencilDialect::isStencilProgram(funcOp))
     return;
 
-  // Compute the extent analysis
+  // Get the extent analysis (reuse the cached analysis if it has been
+  // preserved by the previous passes)
   AccessExtents &extents = getAnalysis<AccessExtents>();
 
   // Go through the operations in reverse order
@@ -302,6 +247,7 @@ void ShapeInferencePass::runOnFunction() {
 
   // Extend the shape of stores if the flag is set
   if (extendStorage) {
+    resultShapes.clear();
     // Update the store shapes and issue a warning
     funcOp.walk([&](stencil::StoreOp storeOp) {
       if (succeeded(extendStorageShape(storeOp.getOperation(), storeOp.temp())))
@@ -313,6 +259,14 @@ void ShapeInferencePass::runOnFunction() {
       extendStorageShape(bufferOp.getOperation(), bufferOp.temp());
     });
   }
+
+  // Update the extents of the unrolled apply ops that depend on the inferred
+  // loop bounds and preserve the analysis for the following passes
+  funcOp.walk([&](stencil::ReturnOp returnOp) {
+    if (returnOp.unroll().hasValue())
+      extents.update(returnOp->getParentOfType<stencil::ApplyOp>());
+  });
+  markAnalysesPreserved<AccessExtents>();
 }
 
 std::unique_ptr<OperationPass<FuncOp>> mlir::createShapeInferencePass() {
@@ -0,0 +1,314 @@
+#include "Dialect/Stencil/Passes.h"
+#include "Dialect/Stencil/StencilDialect.h"
+#include "Dialect/Stencil/StencilOps.h"
+#include "Dialect/Stencil/StencilTypes.h"
+#include "Dialect/Stencil/StencilUtils.h"
+#include "PassDetail.h"
+#include "mlir/Dialect/StandardOps/IR/Ops.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/SymbolTable.h"
+#include "mlir/IR/Value.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Support/LLVM.h"
+#include "mlir/Support/LogicalResult.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include <algorithm>
+#include <cstdint>
+#include <string>
+
+using namespace mlir;
+using namespace stencil;
+
+// Slab streaming runtime functions called by the streamed programs
+constexpr char prefetchFuncPrefix[] = "oecSlabPrefetch";
+constexpr char ensembleFuncInfix[] = "Ensemble";
+constexpr char waitFuncName[] = "oecSlabWait";
+
+namespace {
+
+// This struct stores the rows of a field transferred for every slab
+struct FieldSlab {
+  unsigned argument;
+  stencil::CastOp castOp;
+  bool isInput;
+  int64_t lower;
+  int64_t upper;
+};
+
+struct SlabStreamingPass : public SlabStreamingPassBase<SlabStreamingPass> {
+  void runOnOperation() override;
+
+protected:
+  LogicalResult streamProgram(FuncOp funcOp);
+  LogicalResult computeMemRefDim();
+  FuncOp getPrefetchFunc(FuncOp funcOp, Type fieldType);
+  FuncOp getWaitFunc(FuncOp funcOp);
+
+  // Streamed dimension of the lowered field memrefs
+  int64_t memRefDim;
+};
+
+// Helper returning the name suffix of the runtime function of a field type
+static Optional<StringRef> getElementTypeSuffix(Type fieldType) {
+  auto elementType = fieldType.cast<GridType>().getElementType();
+  if (elementType.isF64())
+    return StringRef("F64");
+  if (elementType.isF32())
+    return StringRef("F32");
+  return llvm::None;
+}
+
+FuncOp SlabStreamingPass::getPrefetchFunc(FuncOp funcOp, Type fieldType) {
+  // The ensemble fields lower to memrefs with an additional outer dimension
+  StringRef infix = ensembleSize > 0 ? ensembleFuncInfix : "";
+  std::string name = (prefetchFuncPrefix + infix +
+                      getElementTypeSuffix(fieldType).getValue())
+                         .str();
+  ModuleOp moduleOp = getOperation();
+  if (auto prefetchFuncOp = moduleOp.lookupSymbol<FuncOp>(name))
+    return prefetchFuncOp;
+
+  // Declare the runtime function taking the field, the streamed dimension
+  // of the field memref, the first row and the number of rows transferred,
+  // and the direction of the transfer
+  OpBuilder builder(funcOp);
+  SmallVector<Type, 5> inputs = {fieldType};
+  inputs.append(4, builder.getI64Type());
+  auto prefetchFuncOp = builder.create<FuncOp>(
+      funcOp.getLoc(), name, builder.getFunctionType(inputs, llvm::None));
+  prefetchFuncOp.setPrivate();
+  prefetchFuncOp->setAttr("llvm.emit_c_interface", builder.getUnitAttr());
+  return prefetchFuncOp;
+}
+
+FuncOp SlabStreamingPass::getWaitFunc(FuncOp funcOp) {
+  ModuleOp moduleOp = getOperation();
+  if (auto waitFuncOp = moduleOp.lookupSymbol<FuncOp>(waitFuncName))
+    return waitFuncOp;
+  OpBuilder builder(funcOp);
+  auto waitFuncOp = builder.create<FuncOp>(
+      funcOp.getLoc(), waitFuncName,
+      builder.getFunctionType(builder.getI64Type(), llvm::None));
+  waitFuncOp.setPrivate();
+  waitFuncOp->setAttr("llvm.emit_c_interface", builder.getUnitAttr());
+  return waitFuncOp;
+}
+
+LogicalResult SlabStreamingPass::streamProgram(FuncOp funcOp) {
+  // Verify the slabs of the program can be computed independently
+  auto result = funcOp.walk([&](Operation *op) {
+    if (isa<stencil::ReduceOp>(op)) {
+      op->emitOpError("expected no reductions in streamed programs");
+      return WalkResult::interrupt();
+    }
+    if (auto scanOp = dyn_cast<stencil::ScanOp>(op)) {
+      if (static_cast<int64_t>(scanOp.dim()) == dim) {
+        scanOp.emitOpError("expected no scans along the streamed dimension");
+        return WalkResult::interrupt();
+      }
+    }
+    if (auto combineOp = dyn_cast<stencil::CombineOp>(op)) {
+      if (static_cast<int64_t>(combineOp.dim()) == dim) {
+        combineOp.emitOpError("expected no combines along the streamed "
+                              "dimension");
+        return WalkResult::interrupt();
+      }
+    }
+    if (auto loadOp = dyn_cast<stencil::LoadOp>(op)) {
+      if (!cast<ShapeOp>(op).hasShape()) {
+        loadOp.emitOpError("execute slab streaming after shape inference");
+        return WalkResult::interrupt();
+      }
+    }
+    return WalkResult::advance();
+  });
+  if (result.wasInterrupted())
+    return failure();
+
+  // Compute the range of the streamed dimension written by the stores
+  SmallVector<stencil::StoreOp, 4> storeOps;
+  funcOp.walk([&](stencil::StoreOp storeOp) { storeOps.push_back(storeOp); });
+  if (storeOps.empty())
+    return success();
+  int64_t lb = cast<ShapeOp>(storeOps.front().getOperation()).getLB()[dim];
+  int64_t ub = cast<ShapeOp>(storeOps.front().getOperation()).getUB()[dim];
+  for (auto storeOp : storeOps) {
+    auto shapeOp = cast<ShapeOp>(storeOp.getOperation());
+    if (shapeOp.getLB()[dim] != lb || shapeOp.getUB()[dim] != ub) {
+      storeOp.emitOpError("expected all stores to write the same range of "
+                          "the streamed dimension");
+      return failure();
+    }
+  }
+  int64_t numSlabs = (ub - lb + slabSize - 1) / slabSize;
+  if (numSlabs <= 1)
+    return success();
+
+  // Compute the rows of the fields transferred for every slab using the
+  // inferred load shapes for the inputs and the store bounds for the outputs
+  SmallVector<FieldSlab, 8> slabs;
+  for (auto en : llvm::enumerate(funcOp.getArguments())) {
+    for (auto user : en.value().getUsers()) {
+      auto castOp = dyn_cast<stencil::CastOp>(user);
+      if (!castOp)
+        continue;
+      FieldSlab slab = {static_cast<unsigned>(en.index()), castOp, false, 0,
+                        0};
+      bool isOutput = false;
+      for (auto castUser : castOp.res().getUsers()) {
+        isOutput |= isa<stencil::StoreOp>(castUser);
+        auto loadOp = dyn_cast<stencil::LoadOp>(castUser);
+        if (!loadOp)
+          continue;
+        auto shapeOp = cast<ShapeOp>(loadOp.getOperation());
+        slab.isInput = true;
+        slab.lower = std::max(slab.lower, lb - shapeOp.getLB()[dim]);
+        slab.upper = std::max(slab.upper, shapeOp.getUB()[dim] - ub);
+      }
+      if (slab.isInput && isOutput) {
+        castOp.emitOpError("expected streamed fields to be either loaded or "
+                           "stored");
+        return failure();
+      }
+
+      // Stream only the three dimensional fields, the other fields are
+      // migrated on demand
+      auto fieldType = castOp.res().getType().cast<FieldType>();
+      if (fieldType.getRank() != kIndexSize ||
+          llvm::any_of(fieldType.getShape(), GridType::isScalar) ||
+          !getElementTypeSuffix(fieldType))
+        continue;
+      if (slab.isInput || isOutput)
+        slabs.push_back(slab);
+    }
+  }
+
+  // Clone the program for every slab and restrict the stores to the slab
+  // (the clones keep the global coordinates of the fields)
+  SmallVector<FuncOp, 8> programs;
+  OpBuilder builder(funcOp.getContext());
+  builder.setInsertionPointAfter(funcOp);
+  for (int64_t n = 0; n != numSlabs; ++n) {
+    auto programOp = cast<FuncOp>(builder.clone(*funcOp));
+    SymbolTable::setSymbolName(programOp, funcOp.getName().str() + "_slab" +
+                                              std::to_string(n));
+    programOp.setPrivate();
+    programOp.walk([&](stencil::StoreOp storeOp) {
+      auto shapeOp = cast<ShapeOp>(storeOp.getOperation());
+      Index storeLB = shapeOp.getLB(), storeUB = shapeOp.getUB();
+      storeLB[dim] = lb + n * slabSize;
+      storeUB[dim] = std::min(ub, lb + (n + 1) * slabSize);
+      shapeOp.updateShape(storeLB, storeUB);
+    });
+    // Clear the inferred shapes that have to be recomputed by another shape
+    // inference run
+    programOp.walk([](ShapeOp shapeOp) {
+      if (!isa<stencil::CastOp, stencil::StoreOp>(shapeOp.getOperation()))
+        shapeOp.clearInferredShape();
+    });
+    programOp.walk(
+        [](stencil::ApplyOp applyOp) { applyOp.updateArgumentTypes(); });
+    programs.push_back(programOp);
+  }
+
+  // Replace the program body by the slab computations that prefetch the
+  // inputs of the next slab and stream back the outputs of the current one
+  Block &entryBlock = funcOp.getBody().front();
+  Location loc = funcOp.getLoc();
+  while (!entryBlock.empty())
+    entryBlock.back().erase();
+  funcOp->removeAttr(StencilDialect::getStencilProgramAttrName());
+  builder.setInsertionPointToEnd(&entryBlock);
+  auto createIndex = [&](int64_t value) -> Value {
+    return builder.create<ConstantIntOp>(loc, value, 64);
+  };
+  auto prefetch = [&](int64_t n, bool isInput) {
+    for (auto &slab : slabs) {
+      if (slab.isInput != isInput)
+        continue;
+      // Clamp the rows relative to the field origin to the field extent
+      auto shapeOp = cast<ShapeOp>(slab.castOp.getOperation());
+      int64_t castLB = shapeOp.getLB()[dim], castUB = shapeOp.getUB()[dim];
+      int64_t begin = std::max(castLB, lb + n * slabSize - slab.lower);
+      int64_t end =
+          std::min(castUB, std::min(ub, lb + (n + 1) * slabSize) + slab.upper);
+      if (begin >= end)
+        continue;
+      Value field = funcOp.getArgument(slab.argument);
+      SmallVector<Value, 5> operands = {
+          field, createIndex(memRefDim), createIndex(begin - castLB),
+          createIndex(end - begin), createIndex(isInput)};
+      builder.create<CallOp>(loc, getPrefetchFunc(funcOp, field.getType()),
+                             operands);
+    }
+  };
+  prefetch(0, true);
+  builder.create<CallOp>(loc, getWaitFunc(funcOp), createIndex(1));
+  for (auto en : llvm::enumerate(programs)) {
+    int64_t n = en.index();
+    if (n + 1 != numSlabs)
+      prefetch(n + 1, true);
+    builder.create<CallOp>(loc, en.value(), funcOp.getArguments());
+    prefetch(n, false);
+    // Wait for the inputs of the next slab
+    if (n + 1 != numSlabs)
+      builder.create<CallOp>(loc, getWaitFunc(funcOp), createIndex(1));
+  }
+  builder.create<CallOp>(loc, getWaitFunc(funcOp), createIndex(0));
+  builder.create<ReturnOp>(loc);
+  return success();
+}
+
+LogicalResult SlabStreamingPass::computeMemRefDim() {
+  // Compute the memref dimension like the stencil to standard lowering
+  auto result = getMemRefDim(dimensionOrder, dim);
+  if (!result.hasValue())
+    return getOperation().emitError("expected ijk or kij dimension order");
+  if (ensembleSize < 0)
+    return getOperation().emitError("expected a non-negative ensemble size");
+  // Transferring the rows of the unit-stride dimension splits every slab
+  // into single elements
+  if (result.getValue() == kIndexSize - 1)
+    return getOperation().emitError("expected the streamed dimension not to "
+                                    "be the unit-stride memref dimension");
+
+  // The ensemble dimension precedes the memref dimensions of the order
+  memRefDim = result.getValue();
+  if (ensembleSize > 0)
+    ++memRefDim;
+  return success();
+}
+
+void SlabStreamingPass::runOnOperation() {
+  if (slabSize <= 0) {
+    getOperation().emitError("expected a positive slab size");
+    return signalPassFailure();
+  }
+  if (dim != kJDimension && dim != kKDimension) {
+    getOperation().emitError("expected to stream along the j or the k "
+                             "dimension");
+    return signalPassFailure();
+  }
+  if (failed(computeMemRefDim()))
+    return signalPassFailure();
+
+  SmallVector<FuncOp, 4> funcOps;
+  for (auto funcOp : getOperation().getOps<FuncOp>()) {
+    if (StencilDialect::isStencilProgram(funcOp))
+      funcOps.push_back(funcOp);
+  }
+  for (auto funcOp : funcOps) {
+    if (failed(streamProgram(funcOp)))
+      return signalPassFailure();
+  }
+}
+
+} // namespace
+
+std::unique_ptr<OperationPass<ModuleOp>> mlir::createSlabStreamingPass() {
+  return std::make_unique<SlabStreamingPass>();
+}
@@ -0,0 +1,80 @@
+#include "Dialect/Stencil/StencilAnalysis.h"
+#include "Dialect/Stencil/StencilOps.h"
+#include "Dialect/Stencil/StencilUtils.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/Value.h"
+#include "mlir/Support/LLVM.h"
+#include "llvm/ADT/STLExtras.h"
+#include <tuple>
+
+using namespace mlir;
+using namespace stencil;
+
+AccessExtents::AccessExtents(Operation *op) {
+  // Walk all apply ops of the stencil program
+  op->walk([&](stencil::ApplyOp applyOp) { update(applyOp); });
+}
+
+void AccessExtents::update(stencil::ApplyOp applyOp) {
+  auto operation = applyOp.getOperation();
+  extents.erase(operation);
+  // Compute mapping between operands and block arguments
+  llvm::DenseMap<Value, Value> argToOperand;
+  for (size_t i = 0, e = applyOp.operands().size(); i != e; ++i) {
+    argToOperand[applyOp.getBody()->getArgument(i)] = applyOp.operands()[i];
+  }
+  // Walk the access operations and update the extent
+  applyOp.walk([&](ExtentOp extentOp) {
+    Index lb, ub;
+    std::tie(lb, ub) = extentOp.getAccessExtent();
+    auto temp = extentOp.getTemp();
+    if (extents[operation].count(argToOperand[temp]) == 0) {
+      // Initialize the extents with the current offset
+      extents[operation][argToOperand[temp]].negative = lb;
+      extents[operation][argToOperand[temp]].positive = ub;
+    } else {
+      // Extend the extents with the current offset
+      auto &negative = extents[operation][argToOperand[temp]].negative;
+      auto &positive = extents[operation][argToOperand[temp]].positive;
+      negative = applyFunElementWise(negative, lb, min);
+      positive = applyFunElementWise(positive, ub, max);
+    }
+  });
+  // Subtract the unroll factor minus one from the positive extent
+  auto returnOp = cast<stencil::ReturnOp>(applyOp.getBody()->getTerminator());
+  // (of every unrolled dimension)
+  if (returnOp.unroll().hasValue()) {
+    auto unroll = returnOp.getUnroll();
+    for (auto en : llvm::enumerate(unroll)) {
+      auto unrollDim = en.index();
+      auto unrollFac = en.value();
+      if (unrollFac == 1)
+        continue;
+      // Limit the unroll factor to the loop length if available
+      auto shapeOp = cast<ShapeOp>(applyOp.getOperation());
+      if (shapeOp.hasShape()) {
+        unrollFac = min(unrollFac, shapeOp.getUB()[unrollDim] -
+                                       shapeOp.getLB()[unrollDim]);
+      }
+      for (auto operand : applyOp.getOperands()) {
+        if (extents[operation].count(operand) == 1) {
+          auto &positive = extents[operation][operand].positive;
+          positive[unrollDim] -= unrollFac - 1;
+        }
+      }
+    }
+  }
+}
+
+void AccessExtents::erase(Operation *op) { extents.erase(op); }
+
+const AccessExtents::Extent *AccessExtents::lookupExtent(Operation *op,
+                                                         Value value) const {
+  auto operation = extents.find(op);
+  if (operation == extents.end())
+    return nullptr;
+  auto extent = operation->second.find(value);
+  if (extent == operation->second.end())
+    return nullptr;
+  return &extent->second;
+}
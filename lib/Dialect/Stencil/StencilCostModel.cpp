@@ -0,0 +1,340 @@
+#include "Dialect/Stencil/StencilCostModel.h"
+#include "Dialect/Stencil/StencilOps.h"
+#include "Dialect/Stencil/StencilTypes.h"
+#include "mlir/Dialect/StandardOps/IR/Ops.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/Value.h"
+#include "mlir/Support/LLVM.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/STLExtras.h"
+#include <algorithm>
+#include <set>
+
+using namespace mlir;
+using namespace stencil;
+
+// Helper method returning the consumer arguments that access the producer
+static SmallVector<Value, 10> getProducerArgs(ApplyOp producerOp,
+                                              ApplyOp consumerOp) {
+  SmallVector<Value, 10> producerArgs;
+  for (auto en : llvm::enumerate(consumerOp.getOperands())) {
+    if (en.value().getDefiningOp() == producerOp.getOperation())
+      producerArgs.push_back(consumerOp.getBody()->getArgument(en.index()));
+  }
+  return producerArgs;
+}
+
+unsigned InliningCostModel::getNumOffsets(ApplyOp producerOp,
+                                          ApplyOp consumerOp) {
+  // Every distinct offset and every dynamic access clones the entire producer
+  std::set<Index> offsets;
+  unsigned numDynAccesses = 0;
+  for (auto arg : getProducerArgs(producerOp, consumerOp)) {
+    for (auto user : arg.getUsers()) {
+      if (auto offsetOp = dyn_cast<OffsetOp>(user))
+        offsets.insert(offsetOp.getOffset());
+      if (isa<DynAccessOp>(user))
+        numDynAccesses++;
+    }
+  }
+  return offsets.size() + numDynAccesses;
+}
+
+unsigned InliningCostModel::getNumComputeOps(ApplyOp applyOp) {
+  // Count all operations except for the accesses and the constants
+  unsigned numComputeOps = 0;
+  applyOp.getBody()->walk([&](Operation *op) {
+    if (!isa<AccessOp>(op) && !isa<StoreResultOp>(op) && !isa<ReturnOp>(op) &&
+        !isa<ConstantOp>(op))
+      numComputeOps++;
+  });
+  return numComputeOps;
+}
+
+unsigned InliningCostModel::getTrafficBytes(ApplyOp producerOp,
+                                            ApplyOp consumerOp) {
+  // Materializing a result costs one store and at least one load per point
+  llvm::DenseSet<Value> results;
+  for (auto operand : consumerOp.getOperands()) {
+    if (operand.getDefiningOp() == producerOp.getOperation())
+      results.insert(operand);
+  }
+  unsigned trafficBytes = 0;
+  for (auto result : results) {
+    auto elementType = result.getType().cast<TempType>().getElementType();
+    unsigned elementBytes = elementType.isIntOrFloat()
+                                ? (elementType.getIntOrFloatBitWidth() + 7) / 8
+                                : 8;
+    trafficBytes += 2 * elementBytes;
+  }
+  return trafficBytes;
+}
+
+bool InliningCostModel::isInliningProfitable(ApplyOp producerOp,
+                                             ApplyOp consumerOp) const {
+  // Limit the number of clones to bound the register pressure
+  unsigned numOffsets = getNumOffsets(producerOp, consumerOp);
+  if (numOffsets > maxOffsets)
+    return false;
+  // Inlining at a single offset does not introduce recomputation
+  if (numOffsets <= 1)
+    return true;
+  // Compare the recomputation to the memory traffic saved
+  unsigned trafficBytes = getTrafficBytes(producerOp, consumerOp);
+  if (trafficBytes == 0)
+    return false;
+  double recomputeFlops = (numOffsets - 1) * getNumComputeOps(producerOp);
+  return recomputeFlops / trafficBytes <= maxFlopsPerByte;
+}
+
+// Helper method returning the 32-bit registers needed to store a value
+static unsigned getValueRegisters(Type type) {
+  if (type.isIndex())
+    return 2;
+  if (type.isIntOrFloat())
+    return (type.getIntOrFloatBitWidth() + 31) / 32;
+  return 0;
+}
+
+unsigned UnrollingCostModel::getAccessRegisters(ApplyOp applyOp,
+                                                unsigned factor,
+                                                unsigned index) {
+  // The unrolled iterations share the accesses at the same offset
+  unsigned accessRegisters = 0;
+  for (auto arg : applyOp.getBody()->getArguments()) {
+    auto tempType = arg.getType().dyn_cast<TempType>();
+    if (!tempType)
+      continue;
+    std::set<Index> offsets;
+    unsigned numDynAccesses = 0;
+    for (auto user : arg.getUsers()) {
+      if (auto accessOp = dyn_cast<AccessOp>(user)) {
+        Index offset = cast<OffsetOp>(accessOp.getOperation()).getOffset();
+        for (unsigned i = 0; i != factor; ++i) {
+          offsets.insert(offset);
+          offset[index]++;
+        }
+      }
+      if (isa<DynAccessOp>(user))
+        numDynAccesses += factor;
+    }
+    accessRegisters += (offsets.size() + numDynAccesses) *
+                       getValueRegisters(tempType.getElementType());
+  }
+  return accessRegisters;
+}
+
+unsigned UnrollingCostModel::getLiveRegisters(ApplyOp applyOp) {
+  // Number the operations of the body and compute the last use of every value
+  Block *body = applyOp.getBody();
+  llvm::DenseMap<Operation *, unsigned> positions;
+  unsigned numOps = 0;
+  for (auto &op : body->getOperations())
+    positions[&op] = numOps++;
+  SmallVector<int, 16> liveRegisters(numOps + 1, 0);
+  for (auto &op : body->getOperations()) {
+    if (isa<AccessOp>(op) || isa<ConstantOp>(op))
+      continue;
+    for (auto result : op.getResults()) {
+      unsigned lastUse = positions[&op];
+      for (auto user : result.getUsers()) {
+        if (auto ancestor = body->findAncestorOpInBlock(*user))
+          lastUse = std::max(lastUse, positions[ancestor]);
+      }
+      // The value is live after its definition until the last use
+      int registers = getValueRegisters(result.getType());
+      liveRegisters[positions[&op]] += registers;
+      liveRegisters[lastUse] -= registers;
+    }
+  }
+  // Accumulate the live ranges and return the maximum
+  int maxRegisters = 0, currRegisters = 0;
+  for (auto registers : liveRegisters) {
+    currRegisters += registers;
+    maxRegisters = std::max(maxRegisters, currRegisters);
+  }
+  return maxRegisters;
+}
+
+unsigned UnrollingCostModel::getNumRegisters(ApplyOp applyOp, unsigned factor,
+                                             unsigned index) {
+  return kBaseRegisters + getAccessRegisters(applyOp, factor, index) +
+         factor * getLiveRegisters(applyOp);
+}
+
+unsigned UnrollingCostModel::getUnrollFactor(ApplyOp applyOp,
+                                             unsigned maxFactor,
+                                             unsigned index) const {
+  // Do not unroll beyond the domain size if the shape is known
+  auto shapeOp = cast<ShapeOp>(applyOp.getOperation());
+  if (shapeOp.hasShape()) {
+    int64_t domainSize = shapeOp.getUB()[index] - shapeOp.getLB()[index];
+    maxFactor = std::min<int64_t>(maxFactor, std::max<int64_t>(domainSize, 1));
+  }
+  // Select the factor with the least access registers per point
+  unsigned bestFactor = 1;
+  unsigned bestRegisters = getAccessRegisters(applyOp, 1, index);
+  for (unsigned factor = 2; factor <= maxFactor; factor *= 2) {
+    if (getNumRegisters(applyOp, factor, index) > maxRegisters)
+      break;
+    unsigned registers = getAccessRegisters(applyOp, factor, index);
+    if (registers * bestFactor < bestRegisters * factor) {
+      bestFactor = factor;
+      bestRegisters = registers;
+    }
+  }
+  return bestFactor;
+}
+
+// Helper method returning the bytes per element of a field or temporary
+static unsigned getElementBytes(Type type) {
+  auto elementType = type.cast<GridType>().getElementType();
+  return elementType.isIntOrFloat()
+             ? (elementType.getIntOrFloatBitWidth() + 7) / 8
+             : 8;
+}
+
+unsigned FusionCostModel::getTrafficBytes(ApplyOp applyOp) {
+  // Every distinct input is loaded and every result is stored once
+  llvm::DenseSet<Value> inputs;
+  unsigned trafficBytes = 0;
+  for (auto operand : applyOp.getOperands()) {
+    if (operand.getType().isa<TempType>() && inputs.insert(operand).second)
+      trafficBytes += getElementBytes(operand.getType());
+  }
+  for (auto result : applyOp.getResults())
+    trafficBytes += getElementBytes(result.getType());
+  return trafficBytes;
+}
+
+unsigned FusionCostModel::getSharedBytes(ApplyOp applyOp1, ApplyOp applyOp2) {
+  llvm::DenseSet<Value> inputs(applyOp1.getOperands().begin(),
+                               applyOp1.getOperands().end());
+  llvm::DenseSet<Value> shared;
+  unsigned sharedBytes = 0;
+  for (auto operand : applyOp2.getOperands()) {
+    if (operand.getType().isa<TempType>() && inputs.count(operand) &&
+        shared.insert(operand).second)
+      sharedBytes += getElementBytes(operand.getType());
+  }
+  return sharedBytes;
+}
+
+unsigned FusionCostModel::getNumRegisters(ApplyOp applyOp1, ApplyOp applyOp2) {
+  // Assume the fused apply op keeps the values of both apply ops live
+  return UnrollingCostModel::getNumRegisters(applyOp1, 1, 0) +
+         UnrollingCostModel::getNumRegisters(applyOp2, 1, 0) -
+         UnrollingCostModel::kBaseRegisters;
+}
+
+unsigned FusionCostModel::getNumInputs(ApplyOp applyOp1, ApplyOp applyOp2) {
+  llvm::DenseSet<Value> inputs;
+  for (auto operand : applyOp1.getOperands())
+    inputs.insert(operand);
+  for (auto operand : applyOp2.getOperands())
+    inputs.insert(operand);
+  return inputs.size();
+}
+
+bool FusionCostModel::isFusionProfitable(ApplyOp applyOp1,
+                                         ApplyOp applyOp2) const {
+  return getSharedBytes(applyOp1, applyOp2) > 0 &&
+         getNumRegisters(applyOp1, applyOp2) <= maxRegisters &&
+         getNumInputs(applyOp1, applyOp2) <= maxInputs;
+}
+
+// Helper method returning the operations of the longest path through the
+// combine tree rooted at the operation
+static unsigned getTreeOps(Operation *op) {
+  if (auto applyOp = dyn_cast<ApplyOp>(op))
+    return InliningCostModel::getNumComputeOps(applyOp);
+  auto combineOp = dyn_cast<CombineOp>(op);
+  if (!combineOp)
+    return 0;
+  unsigned numOps = 0;
+  for (auto operand : combineOp.getOperands()) {
+    if (auto definingOp = operand.getDefiningOp())
+      numOps = std::max(numOps, getTreeOps(definingOp));
+  }
+  return numOps + CombineCostModel::kPredicateOps;
+}
+
+// Helper method returning the consumer arguments that access the root
+static SmallVector<Value, 10> getRootArgs(CombineOp rootOp,
+                                          ApplyOp consumerOp) {
+  SmallVector<Value, 10> rootArgs;
+  for (auto en : llvm::enumerate(consumerOp.getOperands())) {
+    if (en.value().getDefiningOp() == rootOp.getOperation())
+      rootArgs.push_back(consumerOp.getBody()->getArgument(en.index()));
+  }
+  return rootArgs;
+}
+
+unsigned CombineCostModel::getNumComputeOps(CombineOp rootOp) {
+  return getTreeOps(rootOp.getOperation());
+}
+
+unsigned CombineCostModel::getNumOffsets(CombineOp rootOp,
+                                         ApplyOp consumerOp) {
+  std::set<Index> offsets;
+  for (auto arg : getRootArgs(rootOp, consumerOp)) {
+    for (auto user : arg.getUsers()) {
+      if (auto offsetOp = dyn_cast<OffsetOp>(user))
+        offsets.insert(offsetOp.getOffset());
+    }
+  }
+  return offsets.size();
+}
+
+unsigned CombineCostModel::getTrafficBytes(CombineOp rootOp,
+                                           ApplyOp consumerOp) {
+  // Materializing a result costs one store and at least one load per point
+  llvm::DenseSet<Value> results;
+  for (auto operand : consumerOp.getOperands()) {
+    if (operand.getDefiningOp() == rootOp.getOperation())
+      results.insert(operand);
+  }
+  unsigned trafficBytes = 0;
+  for (auto result : results)
+    trafficBytes += 2 * getElementBytes(result.getType());
+  return trafficBytes;
+}
+
+bool CombineCostModel::isIfElseProfitable(CombineOp rootOp) const {
+  // Results written by a store need no buffer and the inlining only removes
+  // the buffer of a single consumer
+  SmallVector<ApplyOp, 4> consumerOps;
+  for (auto user : rootOp.getOperation()->getUsers()) {
+    auto applyOp = dyn_cast<ApplyOp>(user);
+    if (!applyOp)
+      return false;
+    if (!llvm::is_contained(consumerOps, applyOp))
+      consumerOps.push_back(applyOp);
+  }
+  if (consumerOps.size() != 1)
+    return false;
+  auto consumerOp = consumerOps.front();
+
+  // Dynamic offsets prevent the inlining of the lowered combine tree
+  for (auto arg : getRootArgs(rootOp, consumerOp)) {
+    if (llvm::any_of(arg.getUsers(),
+                     [](Operation *op) { return isa<DynAccessOp>(op); }))
+      return false;
+  }
+
+  // Limit the number of clones to bound the register pressure
+  unsigned numOffsets = getNumOffsets(rootOp, consumerOp);
+  if (numOffsets > maxOffsets)
+    return false;
+  // Lowering in place at a single offset does not introduce recomputation
+  if (numOffsets <= 1)
+    return true;
+  // Compare the recomputation of the predicated tree to the memory traffic
+  // of the buffer
+  unsigned trafficBytes = getTrafficBytes(rootOp, consumerOp);
+  if (trafficBytes == 0)
+    return false;
+  double recomputeFlops = (numOffsets - 1) * getNumComputeOps(rootOp);
+  return recomputeFlops / trafficBytes <= maxFlopsPerByte;
+}
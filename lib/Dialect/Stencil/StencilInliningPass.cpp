@@ -1,4 +1,6 @@
 #include "Dialect/Stencil/Passes.h"
+#include "Dialect/Stencil/StencilAnalysis.h"
+#include "Dialect/Stencil/StencilCostModel.h"
 #include "Dialect/Stencil/StencilDialect.h"
 #include "Dialect/Stencil/StencilOps.h"
 #include "Dialect/Stencil/StencilTypes.h"
@@ -24,21 +26,47 @@
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/None.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/IR/Value.h"
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 #include <cstdint>
+#include <functional>
+#include <memory>
+#include <tuple>
 
 using namespace mlir;
 using namespace stencil;
 
 namespace {
 
+// Counters of the inlining decisions accumulated by the patterns
+struct InliningReport {
+  bool emitRemarks = false;
+  unsigned numInlined = 0;
+  unsigned numOffsets = 0;
+  unsigned numRerouted = 0;
+  // Apply ops introduced by the patterns
+  SmallPtrSet<Operation *, 16> newOps;
+};
+
 // Base class for the stencil inlining patterns
 struct StencilInliningPattern : public ApplyOpPattern {
-  StencilInliningPattern(MLIRContext *context, PatternBenefit benefit = 1)
-      : ApplyOpPattern(context, benefit){};
+  StencilInliningPattern(MLIRContext *context,
+                         const InliningCostModel *costModel = nullptr,
+                         InliningReport *report = nullptr,
+                         bool inlineDynAccess = false,
+                         PatternBenefit benefit = 1)
+      : ApplyOpPattern(context, benefit), costModel(costModel),
+        report(report), inlineDynAccess(inlineDynAccess){};
+
+  // Check if the cost model accepts the inlining if there is a cost model
+  bool isStencilInliningProfitable(stencil::ApplyOp producerOp,
+                                   stencil::ApplyOp consumerOp) const {
+    return !costModel ||
+           costModel->isInliningProfitable(producerOp, consumerOp);
+  }
 
   // Check if the the apply operation is the only consumer
   bool hasSingleConsumer(stencil::ApplyOp producerOp,
@@ -59,7 +87,10 @@ struct StencilInliningPattern : public ApplyOpPattern {
     if (containsEmptyStores)
       return false;
 
-    // Do not inline producers accessed at dynamic offsets
+    // Do not inline producers accessed at dynamic offsets unless the
+    // dynamic offsets are trusted to stay within the bounds of the accesses
+    if (inlineDynAccess)
+      return true;
     for (auto operand : llvm::enumerate(consumerOp.operands())) {
       if (operand.value().getDefiningOp() == producerOp &&
           llvm::any_of(
@@ -86,6 +117,13 @@ struct StencilInliningPattern : public ApplyOpPattern {
     }
     return true;
   }
+
+  // Cost model used to decide if an edge is inlined or materialized
+  const InliningCostModel *costModel;
+  // Report counting the inlining decisions if set
+  InliningReport *report;
+  // Inline producers accessed at dynamic offsets
+  bool inlineDynAccess;
 };
 
 // Pattern rerouting output edge via consumer
@@ -101,6 +139,12 @@ struct RerouteRewrite : public StencilInliningPattern {
     auto clonedOp = rewriter.cloneWithoutRegions(producerOp);
     rewriter.inlineRegionBefore(producerOp.region(), clonedOp.region(),
                                 clonedOp.region().begin());
+    if (report) {
+      report->numRerouted++;
+      if (report->emitRemarks)
+        consumerOp.emitRemark("rerouted the producer at ")
+            << LocationAttr(producerOp.getLoc());
+    }
 
     // Compute operand and result lists for the new consumer
     SmallVector<Value, 10> newOperands = consumerOp.getOperands();
@@ -165,6 +209,10 @@ struct RerouteRewrite : public StencilInliningPattern {
     }
     rewriter.create<stencil::ReturnOp>(returnOp.getLoc(), retOperands, nullptr);
     rewriter.eraseOp(returnOp);
+    if (report) {
+      report->newOps.insert(clonedOp);
+      report->newOps.insert(newOp);
+    }
 
     // Compute the replacement values for the producer results
     SmallVector<Value, 10> repResults =
@@ -195,7 +243,8 @@ struct RerouteRewrite : public StencilInliningPattern {
               continue;
 
             if (isStencilInliningPossible(producerOp, applyOp) &&
-                isStencilReroutingPossible(producerOp, applyOp))
+                isStencilReroutingPossible(producerOp, applyOp) &&
+                isStencilInliningProfitable(producerOp, applyOp))
               return redirectStore(producerOp, applyOp, rewriter);
           }
         }
@@ -206,7 +255,8 @@ struct RerouteRewrite : public StencilInliningPattern {
       if (auto producerOp =
               dyn_cast_or_null<stencil::ApplyOp>(operand.getDefiningOp())) {
         if (isStencilInliningPossible(producerOp, applyOp) &&
-            isStencilReroutingPossible(producerOp, applyOp))
+            isStencilReroutingPossible(producerOp, applyOp) &&
+            isStencilInliningProfitable(producerOp, applyOp))
           return redirectStore(producerOp, applyOp, rewriter);
       }
     }
@@ -219,6 +269,57 @@ struct RerouteRewrite : public StencilInliningPattern {
 struct InliningRewrite : public StencilInliningPattern {
   using StencilInliningPattern::StencilInliningPattern;
 
+  // Helper method evaluating the inlined producer ops at the position of a
+  // dynamic access instead of the position of the consumer
+  void evaluateAtPosition(ArrayRef<Operation *> ops,
+                          stencil::DynAccessOp dynAccessOp,
+                          PatternRewriter &rewriter) const {
+    Index dynLB, dynUB;
+    std::tie(dynLB, dynUB) = dynAccessOp.getAccessExtent();
+    auto loc = dynAccessOp.getLoc();
+    // Helper shifting the dynamic position by a constant offset
+    auto getPosition = [&](unsigned dim, int64_t offset) -> Value {
+      Value position = dynAccessOp.offset()[dim];
+      if (offset == 0)
+        return position;
+      return rewriter.create<AddIOp>(
+          loc, position, rewriter.create<ConstantIndexOp>(loc, offset));
+    };
+    for (auto op : ops) {
+      rewriter.setInsertionPoint(op);
+      // Replace the accesses by dynamic accesses relative to the position
+      if (auto accessOp = dyn_cast<stencil::AccessOp>(op)) {
+        Index offset = cast<OffsetOp>(op).getOffset();
+        SmallVector<Value, 3> positions;
+        for (auto en : llvm::enumerate(offset))
+          positions.push_back(getPosition(en.index(), en.value()));
+        auto newOp = rewriter.create<stencil::DynAccessOp>(
+            accessOp.getLoc(), accessOp.temp(), positions,
+            applyFunElementWise(dynLB, offset, std::plus<int64_t>()),
+            applyFunElementWise(dynUB, offset, std::plus<int64_t>()));
+        rewriter.replaceOp(accessOp, newOp.getResult());
+      }
+      // Replace the index ops by the shifted position
+      if (auto indexOp = dyn_cast<stencil::IndexOp>(op)) {
+        Index offset = cast<OffsetOp>(op).getOffset();
+        rewriter.replaceOp(indexOp,
+                           getPosition(indexOp.dim(), offset[indexOp.dim()]));
+      }
+      // Widen the bounds of the dynamic accesses by the bounds of the
+      // position of the producer
+      if (auto nestedOp = dyn_cast<stencil::DynAccessOp>(op)) {
+        Index lb, ub;
+        std::tie(lb, ub) = nestedOp.getAccessExtent();
+        rewriter.updateRootInPlace(nestedOp, [&]() {
+          nestedOp.lbAttr(rewriter.getI64ArrayAttr(
+              applyFunElementWise(lb, dynLB, std::plus<int64_t>())));
+          nestedOp.ubAttr(rewriter.getI64ArrayAttr(
+              applyFunElementWise(ub, dynUB, std::plus<int64_t>())));
+        });
+      }
+    }
+  }
+
   // Helper method inlining the producer computation
   LogicalResult inlineProducer(stencil::ApplyOp producerOp,
                                stencil::ApplyOp consumerOp,
@@ -281,6 +382,7 @@ struct InliningRewrite : public StencilInliningPattern {
 
     // Walk accesses of producer results and replace them by computation
     DenseMap<Value, SmallVector<std::tuple<Index, Value>, 10>> inliningCache;
+    unsigned numOffsets = 0;
     rewriter.setInsertionPoint(buildOp);
     buildOp.walk([&](stencil::AccessOp accessOp) {
       if (replacementIndex.count(accessOp.temp()) != 0) {
@@ -315,12 +417,55 @@ struct InliningRewrite : public StencilInliningPattern {
         // Cache the result of the inlined producer
         inliningCache[accessOp.temp()].push_back(
             std::make_tuple(offset, operand));
+        numOffsets++;
       }
     });
 
+    // Clone the producer at the position of every dynamic access
+    SmallVector<stencil::DynAccessOp, 10> dynAccessOps;
+    buildOp.walk([&](stencil::DynAccessOp dynAccessOp) {
+      if (replacementIndex.count(dynAccessOp.temp()) != 0)
+        dynAccessOps.push_back(dynAccessOp);
+    });
+    for (auto dynAccessOp : dynAccessOps) {
+      rewriter.setInsertionPoint(buildOp);
+      auto clonedOp = cast<stencil::ApplyOp>(rewriter.clone(*producerOp));
+      // Collect the producer ops that depend on the position
+      SmallVector<Operation *, 10> positionOps;
+      clonedOp.getBody()->walk([&](Operation *op) {
+        if (isa<stencil::AccessOp, stencil::IndexOp, stencil::DynAccessOp>(
+                op))
+          positionOps.push_back(op);
+      });
+      rewriter.mergeBlockBefore(clonedOp.getBody(), dynAccessOp,
+                                buildOp.getBody()->getArguments().take_front(
+                                    producerOp.getNumOperands()));
+      rewriter.eraseOp(clonedOp);
+      evaluateAtPosition(positionOps, dynAccessOp, rewriter);
+      // Replace the dynamic access by the result of return operation
+      auto returnOp =
+          cast<stencil::ReturnOp>(dynAccessOp.getOperation()->getPrevNode());
+      auto operand =
+          returnOp.getOperand(replacementIndex[dynAccessOp.temp()]);
+      rewriter.replaceOp(dynAccessOp, operand);
+      rewriter.eraseOp(returnOp);
+      numOffsets++;
+    }
+    rewriter.setInsertionPoint(buildOp);
+    if (report) {
+      report->numInlined++;
+      report->numOffsets += numOffsets;
+      if (report->emitRemarks)
+        consumerOp.emitRemark("inlined the producer at ")
+            << LocationAttr(producerOp.getLoc()) << " at " << numOffsets
+            << " offsets";
+    }
+
     // Clean unused and duplicate arguments of the build op
     auto newOp = cleanupOpArguments(buildOp, rewriter);
     assert(newOp && "expected op to have unused producer consumer edges");
+    if (report)
+      report->newOps.insert(newOp);
 
     // Update the all uses and cleanup temporary ops
     rewriter.replaceOp(consumerOp, newOp.getResults());
@@ -337,7 +482,8 @@ struct InliningRewrite : public StencilInliningPattern {
               dyn_cast_or_null<stencil::ApplyOp>(operand.getDefiningOp())) {
         // Try the next producer if inlining the current one is not possible
         if (isStencilInliningPossible(producerOp, applyOp) &&
-            hasSingleConsumer(producerOp, applyOp)) {
+            hasSingleConsumer(producerOp, applyOp) &&
+            isStencilInliningProfitable(producerOp, applyOp)) {
           return inlineProducer(producerOp, applyOp, producerOp.getResults(),
                                 rewriter);
         }
@@ -369,9 +515,46 @@ void StencilInliningPass::runOnFunction() {
   if (result.wasInterrupted())
     return signalPassFailure();
  
+  // Materialize the edges the cost model rejects if enabled
+  std::unique_ptr<InliningCostModel> costModel;
+  if (useCostModel)
+    costModel = std::make_unique<InliningCostModel>(maxFlopsPerByte,
+                                                    maxOffsets);
+
+  InliningReport report;
+  report.emitRemarks = emitRemarks;
   OwningRewritePatternList patterns;
-  patterns.insert<InliningRewrite, RerouteRewrite>(&getContext());
+  patterns.insert<InliningRewrite, RerouteRewrite>(
+      &getContext(), costModel.get(), &report, inlineDynAccess);
+  SmallPtrSet<Operation *, 16> oldOps;
+  funcOp.walk([&](stencil::ApplyOp applyOp) { oldOps.insert(applyOp); });
   applyPatternsAndFoldGreedily(funcOp, std::move(patterns));
+
+  // Update the cached extent analysis for the apply ops introduced by the
+  // patterns and for the apply ops that consume their results since the
+  // replaced producer results were the keys of their extents
+  if (auto extents = getCachedAnalysis<AccessExtents>()) {
+    SmallPtrSet<Operation *, 16> currentOps;
+    funcOp.walk([&](stencil::ApplyOp applyOp) {
+      currentOps.insert(applyOp);
+      if (report.newOps.count(applyOp.getOperation()) ||
+          llvm::any_of(applyOp.operands(), [&](Value operand) {
+            return report.newOps.count(operand.getDefiningOp());
+          }))
+        extents->get().update(applyOp);
+    });
+    // Remove the extents of the erased apply ops
+    for (auto ops : {&oldOps, &report.newOps}) {
+      for (auto op : *ops) {
+        if (!currentOps.count(op))
+          extents->get().erase(op);
+      }
+    }
+  }
+  markAnalysesPreserved<AccessExtents>();
+  numInlined += report.numInlined;
+  numInlinedOffsets += report.numOffsets;
+  numRerouted += report.numRerouted;
 }
 
 } // namespace
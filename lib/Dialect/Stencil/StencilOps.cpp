@@ -394,6 +394,99 @@ stencil::CombineOp stencil::CombineOp::getCombineTreeRoot() {
   return cast<stencil::CombineOp>(curr);
 }
 
+//===----------------------------------------------------------------------===//
+// stencil.reduce / stencil.scan
+//===----------------------------------------------------------------------===//
+
+// Helper to verify the kind, the temp, and the field of a reduce or scan op
+static LogicalResult verifyOutputOp(Operation *op, StringRef kind, Value temp,
+                                    Value field) {
+  if (!llvm::is_contained(ArrayRef<StringRef>{"add", "max", "min"}, kind))
+    return op->emitOpError("expected add, max, or min as combining function");
+
+  // Check the field and temp types
+  auto fieldType = field.getType().cast<stencil::GridType>();
+  auto tempType = temp.getType().cast<stencil::GridType>();
+  if (!fieldType.hasStaticShape())
+    return op->emitOpError("expected fields to have static shape");
+  if (fieldType.getRank() != tempType.getRank())
+    return op->emitOpError("the field and temp types have different rank");
+  if (fieldType.getElementType() != tempType.getElementType())
+    return op->emitOpError(
+        "the field and temp types have different element types");
+  if (!fieldType.getElementType().isSignlessIntOrFloat())
+    return op->emitOpError("expected integer or float elements");
+
+  // Ensure the shape matches the temp and field types
+  auto shapeOp = cast<ShapeOp>(op);
+  if (!fieldType.hasLargerOrEqualShape(shapeOp.getLB(), shapeOp.getUB()))
+    return op->emitOpError(
+        "expected the field type to be larger than the op shape");
+  if (!tempType.hasLargerOrEqualShape(shapeOp.getLB(), shapeOp.getUB()))
+    return op->emitOpError(
+        "expected the temp type to be larger than the op shape");
+
+  // Check the temp is computed only for the operation and the field is
+  // written only by the operation
+  if (!isa_and_nonnull<stencil::ApplyOp, stencil::CombineOp>(
+          temp.getDefiningOp()))
+    return op->emitOpError(
+        "output temp not result of an apply or a combine op");
+  if (!temp.hasOneUse())
+    return op->emitOpError("expected the output temp to have one use");
+  if (llvm::any_of(field.getUsers(), [](Operation *user) {
+        return isa<stencil::LoadOp>(user);
+      }))
+    return op->emitOpError("an output cannot be an input");
+  if (llvm::count_if(field.getUsers(), [](Operation *user) {
+        return isa<stencil::StoreOp, stencil::ReduceOp, stencil::ScanOp>(
+            user);
+      }) != 1)
+    return op->emitOpError("multiple stores to the same output");
+  if (!isa_and_nonnull<stencil::CastOp>(field.getDefiningOp()))
+    return op->emitOpError(
+        "expected the defining op of the field is a cast operation");
+  return success();
+}
+
+static LogicalResult verify(stencil::ReduceOp op) {
+  if (failed(verifyOutputOp(op.getOperation(), op.kind(), op.temp(),
+                            op.field())))
+    return failure();
+
+  // Check the field dimensions are a strict subset of the temp dimensions
+  auto fieldAllocation =
+      op.field().getType().cast<stencil::GridType>().getAllocation();
+  auto tempAllocation =
+      op.temp().getType().cast<stencil::GridType>().getAllocation();
+  if (llvm::any_of(llvm::zip(fieldAllocation, tempAllocation),
+                   [](std::tuple<bool, bool> x) {
+                     return std::get<0>(x) && !std::get<1>(x);
+                   }))
+    return op.emitOpError("expected the field dimensions to be allocated in "
+                          "the temp");
+  if (fieldAllocation == tempAllocation)
+    return op.emitOpError("expected at least one reduced dimension");
+  return success();
+}
+
+static LogicalResult verify(stencil::ScanOp op) {
+  if (failed(verifyOutputOp(op.getOperation(), op.kind(), op.temp(),
+                            op.field())))
+    return failure();
+
+  // Check the field and temp have the same dimensions including the scan one
+  auto fieldAllocation =
+      op.field().getType().cast<stencil::GridType>().getAllocation();
+  auto tempAllocation =
+      op.temp().getType().cast<stencil::GridType>().getAllocation();
+  if (fieldAllocation != tempAllocation)
+    return op.emitOpError("the field and temp types have different allocation");
+  if (op.dim() >= fieldAllocation.size() || !fieldAllocation[op.dim()])
+    return op.emitOpError("expected the scan dimension to be allocated");
+  return success();
+}
+
 //===----------------------------------------------------------------------===//
 // Canonicalization
 //===----------------------------------------------------------------------===//
@@ -0,0 +1,87 @@
+#include "Dialect/Stencil/StencilTuning.h"
+#include "Dialect/Stencil/StencilDialect.h"
+#include "mlir/Support/FileUtilities.h"
+#include "mlir/Support/LLVM.h"
+#include "llvm/ADT/Twine.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <cstdint>
+
+using namespace mlir;
+using namespace stencil;
+
+std::unique_ptr<TuningDatabase>
+TuningDatabase::load(StringRef fileName, std::string &errorMessage) {
+  auto file = openInputFile(fileName, &errorMessage);
+  if (!file)
+    return nullptr;
+  auto database = parse(file->getBuffer(), errorMessage);
+  if (!database)
+    errorMessage = (fileName + ": " + errorMessage).str();
+  return database;
+}
+
+// Helper reading an unsigned configuration parameter
+static bool parseUnsigned(const llvm::json::Object &object, StringRef key,
+                          Optional<unsigned> &value) {
+  const llvm::json::Value *param = object.get(key);
+  if (!param)
+    return true;
+  auto integer = param->getAsInteger();
+  if (!integer || *integer < 0)
+    return false;
+  value = static_cast<unsigned>(*integer);
+  return true;
+}
+
+std::unique_ptr<TuningDatabase>
+TuningDatabase::parse(StringRef json, std::string &errorMessage) {
+  auto value = llvm::json::parse(json);
+  if (!value) {
+    errorMessage = llvm::toString(value.takeError());
+    return nullptr;
+  }
+  auto *programs = value->getAsObject();
+  if (!programs) {
+    errorMessage = "expected the tuning database to be an object";
+    return nullptr;
+  }
+
+  // Parse the configurations of the stencil programs
+  auto database = std::make_unique<TuningDatabase>();
+  for (auto &program : *programs) {
+    auto *object = program.second.getAsObject();
+    TuningConfig config;
+    if (!object ||
+        !parseUnsigned(*object, "unroll-factor", config.unrollFactor) ||
+        !parseUnsigned(*object, "unroll-index", config.unrollIndex)) {
+      errorMessage = ("invalid configuration of program '" +
+                      StringRef(program.first) + "'")
+                         .str();
+      return nullptr;
+    }
+    if (auto *tileSizes = object->getArray("tile-sizes")) {
+      for (auto &tileSize : *tileSizes) {
+        auto integer = tileSize.getAsInteger();
+        if (!integer || *integer <= 0 ||
+            static_cast<int64_t>(config.tileSizes.size()) == kIndexSize) {
+          errorMessage = ("invalid tile sizes of program '" +
+                          StringRef(program.first) + "'")
+                             .str();
+          return nullptr;
+        }
+        config.tileSizes.push_back(*integer);
+      }
+    }
+    database->configs[StringRef(program.first)] = config;
+  }
+  return database;
+}
+
+Optional<TuningConfig> TuningDatabase::lookup(StringRef programName) const {
+  auto it = configs.find(programName);
+  if (it == configs.end())
+    return llvm::None;
+  return it->second;
+}
@@ -1,6 +1,9 @@
 #include "Dialect/Stencil/Passes.h"
+#include "Dialect/Stencil/StencilAnalysis.h"
+#include "Dialect/Stencil/StencilCostModel.h"
 #include "Dialect/Stencil/StencilDialect.h"
 #include "Dialect/Stencil/StencilOps.h"
+#include "Dialect/Stencil/StencilTuning.h"
 #include "Dialect/Stencil/StencilTypes.h"
 #include "Dialect/Stencil/StencilUtils.h"
 #include "PassDetail.h"
@@ -17,6 +20,13 @@
 #include "mlir/Support/LLVM.h"
 #include "mlir/Transforms/Passes.h"
 #include "mlir/Transforms/Utils.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
+#include <functional>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <utility>
 
 using namespace mlir;
 using namespace stencil;
@@ -29,12 +39,22 @@ struct StencilUnrollingPass
   void runOnFunction() override;
 
 protected:
-  void unrollStencilApply(stencil::ApplyOp applyOp);
+  void unrollAndShareAccesses(stencil::ApplyOp applyOp,
+                              ArrayRef<int64_t> factors);
+  unsigned unrollStencilApply(stencil::ApplyOp applyOp,
+                              ArrayRef<int64_t> factors);
+  unsigned eliminateSharedAccesses(stencil::ApplyOp applyOp);
   void addPeelIteration(stencil::ApplyOp applyOp);
 
   void makePeelIteration(stencil::ReturnOp returnOp, unsigned tripCount);
   stencil::ReturnOp cloneBody(stencil::ApplyOp from, stencil::ApplyOp to,
                               OpBuilder &builder);
+  const TuningDatabase *getTuningDatabase(FuncOp funcOp);
+
+  // Tuning database parsed by the first function and reused by the later
+  // functions (shared by the copies of the pass instance)
+  std::shared_ptr<TuningDatabase> database;
+  std::string databaseError;
 };
 
 stencil::ReturnOp StencilUnrollingPass::cloneBody(stencil::ApplyOp from,
@@ -54,9 +74,12 @@ stencil::ReturnOp StencilUnrollingPass::cloneBody(stencil::ApplyOp from,
   return cast<stencil::ReturnOp>(last);
 }
 
-void StencilUnrollingPass::unrollStencilApply(stencil::ApplyOp applyOp) {
+unsigned StencilUnrollingPass::unrollStencilApply(stencil::ApplyOp applyOp,
+                                                  ArrayRef<int64_t> factors) {
   // Setup the builder and
   OpBuilder b(applyOp);
+  unsigned factor = std::accumulate(factors.begin(), factors.end(), 1,
+                                    std::multiplies<int64_t>());
 
   // Prepare a clone containing a single iteration and an argument mapper
   auto clonedOp = applyOp.clone();
@@ -66,16 +89,25 @@ void StencilUnrollingPass::unrollStencilApply(stencil::ApplyOp applyOp) {
       cast<stencil::ReturnOp>(applyOp.getBody()->getTerminator())};
 
   // Keep unrolling until there is one returnOp for every iteration
+  // (the first unrolled dimension varies fastest)
   b.setInsertionPointToEnd(applyOp.getBody());
-  while (loopIterations.size() < unrollFactor) {
+  unsigned numClonedOps = 0;
+  Index current(kIndexSize, 0);
+  while (loopIterations.size() < factor) {
     // Update the offsets of the clone
-    clonedOp.getBody()->walk([&](stencil::ShiftOp shiftOp) {
-      Index offset(kIndexSize, 0);
-      offset[unrollIndex] = 1;
-      shiftOp.shiftByOffset(offset);
-    });
+    Index next(kIndexSize, 0);
+    unsigned iteration = loopIterations.size();
+    for (auto en : llvm::enumerate(factors)) {
+      next[en.index()] = iteration % en.value();
+      iteration /= en.value();
+    }
+    Index offset = applyFunElementWise(next, current, std::minus<int64_t>());
+    current = next;
+    clonedOp.getBody()->walk(
+        [&](stencil::ShiftOp shiftOp) { shiftOp.shiftByOffset(offset); });
     // Clone the body and store the return op
     loopIterations.push_back(cloneBody(clonedOp, applyOp, b));
+    numClonedOps += clonedOp.getBody()->getOperations().size() - 1;
   }
   clonedOp.erase();
 
@@ -91,10 +123,54 @@ void StencilUnrollingPass::unrollStencilApply(stencil::ApplyOp applyOp) {
   }
 
   // Create a new return op returning all results
-  SmallVector<int64_t, kIndexSize> unroll(kIndexSize, 1);
-  unroll[unrollIndex] = unrollFactor;
   b.create<stencil::ReturnOp>(loopIterations.front().getLoc(), newResults,
-                              b.getI64ArrayAttr(unroll));
+                              b.getI64ArrayAttr(factors));
+  return numClonedOps;
+}
+
+unsigned
+StencilUnrollingPass::eliminateSharedAccesses(stencil::ApplyOp applyOp) {
+  // Replace the accesses of the unrolled iterations that load the same
+  // element of the same temporary by the first access in the body
+  DenseMap<std::pair<Value, Attribute>, stencil::AccessOp> accessOps;
+  unsigned numShared = 0;
+  for (auto accessOp : llvm::make_early_inc_range(
+           applyOp.getBody()->getOps<stencil::AccessOp>())) {
+    auto key = std::make_pair(accessOp.temp(), accessOp.offset());
+    auto it = accessOps.find(key);
+    if (it == accessOps.end()) {
+      accessOps[key] = accessOp;
+      continue;
+    }
+    accessOp.getResult().replaceAllUsesWith(it->second.getResult());
+    accessOp.erase();
+    numShared++;
+  }
+  return numShared;
+}
+
+void StencilUnrollingPass::unrollAndShareAccesses(stencil::ApplyOp applyOp,
+                                                  ArrayRef<int64_t> factors) {
+  unsigned numCloned = unrollStencilApply(applyOp, factors);
+  unsigned numShared = eliminateSharedAccesses(applyOp);
+  numUnrolled++;
+  numClonedOps += numCloned;
+  numSharedAccesses += numShared;
+  if (emitRemarks) {
+    auto remark = applyOp.emitRemark("unrolled by [");
+    llvm::interleave(
+        factors, [&](int64_t x) { remark << x; }, [&]() { remark << ", "; });
+    remark << "] cloning " << numCloned << " operations and sharing "
+           << numShared << " accesses";
+  }
+}
+
+const TuningDatabase *StencilUnrollingPass::getTuningDatabase(FuncOp funcOp) {
+  if (!database && databaseError.empty())
+    database = TuningDatabase::load(tuningDatabase, databaseError);
+  if (!database)
+    funcOp.emitError(databaseError);
+  return database.get();
 }
 
 void StencilUnrollingPass::runOnFunction() {
@@ -103,21 +179,84 @@ void StencilUnrollingPass::runOnFunction() {
   if (!StencilDialect::isStencilProgram(funcOp))
     return;
 
+  // Use the tuned unrolling parameters if available
+  // (the unroll factors of all dimensions override the tuned parameters)
+  unsigned factor = unrollFactor;
+  unsigned index = unrollIndex;
+  if (!tuningDatabase.empty()) {
+    auto database = getTuningDatabase(funcOp);
+    if (!database) {
+      signalPassFailure();
+      return;
+    }
+    if (auto config = database->lookup(funcOp.getName())) {
+      factor = config->unrollFactor.getValueOr(factor);
+      index = config->unrollIndex.getValueOr(index);
+    }
+  }
+
   // Check for valid unrolling indexes
-  if (unrollIndex == 0) {
+  if (index >= kIndexSize) {
+    funcOp.emitError("expected the unrolling index to be smaller than ")
+        << kIndexSize;
+    signalPassFailure();
+    return;
+  }
+  if (index == 0) {
     funcOp.emitError("unrolling the innermost loop is not supported");
     signalPassFailure();
     return;
   }
+  Index factors(kIndexSize, 1);
+  factors[index] = factor;
+  if (!unrollFactors.empty()) {
+    if (unrollFactors.size() != kIndexSize ||
+        llvm::any_of(unrollFactors, [](unsigned x) { return x == 0; })) {
+      funcOp.emitError("expected ")
+          << kIndexSize << " positive unroll factors";
+      signalPassFailure();
+      return;
+    }
+    if (unrollFactors[kIDimension] != 1) {
+      funcOp.emitError("unrolling the innermost loop is not supported");
+      signalPassFailure();
+      return;
+    }
+    if (adaptive) {
+      funcOp.emitError("expected a single unroll factor in adaptive mode");
+      signalPassFailure();
+      return;
+    }
+    factors.assign(unrollFactors.begin(), unrollFactors.end());
+  }
 
   // Collect the stencil apply operations
   SmallVector<stencil::ApplyOp, 16> workList;
   funcOp.walk([&](stencil::ApplyOp applyOp) { workList.push_back(applyOp); });
 
   // Unroll the stencil apply operations
+  // (the adaptive mode selects the factor per apply op, which may leave
+  // odd iterations handled by the peel odd iterations pass)
+  UnrollingCostModel costModel(maxRegisters);
   for (auto applyOp : workList) {
-    unrollStencilApply(applyOp);
+    if (adaptive) {
+      unsigned applyFactor = costModel.getUnrollFactor(applyOp, factor, index);
+      if (applyFactor > 1) {
+        factors[index] = applyFactor;
+        unrollAndShareAccesses(applyOp, factors);
+      }
+      continue;
+    }
+    unrollAndShareAccesses(applyOp, factors);
+  }
+
+  // Update the cached extent analysis since the unrolling modifies the apply
+  // ops in place
+  if (auto extents = getCachedAnalysis<AccessExtents>()) {
+    for (auto applyOp : workList)
+      extents->get().update(applyOp);
   }
+  markAnalysesPreserved<AccessExtents>();
 }
 
 } // namespace
@@ -1,7 +1,12 @@
 #include "Dialect/Stencil/StencilUtils.h"
+#include "Dialect/Stencil/StencilOps.h"
+#include "Dialect/Stencil/StencilTypes.h"
+#include "mlir/IR/Builders.h"
 #include "mlir/Support/LLVM.h"
+#include "llvm/ADT/SmallVector.h"
 #include <cstdint>
 #include <functional>
+#include <iterator>
 
 namespace mlir {
 namespace stencil {
@@ -20,5 +25,32 @@ Index applyFunElementWise(ArrayRef<int64_t> x, ArrayRef<int64_t> y,
   return result;
 }
 
+Optional<int64_t> getMemRefDim(StringRef dimensionOrder, int64_t dim) {
+  SmallVector<int64_t, 3> order;
+  if (dimensionOrder == "ijk")
+    order = {kIDimension, kJDimension, kKDimension};
+  else if (dimensionOrder == "kij")
+    order = {kKDimension, kIDimension, kJDimension};
+  else
+    return llvm::None;
+  // The order starts with the unit-stride dimension
+  return kIndexSize - 1 - std::distance(order.begin(), llvm::find(order, dim));
+}
+
+void updateCastShape(CastOp castOp, ArrayRef<int64_t> lb,
+                     ArrayRef<int64_t> ub) {
+  OpBuilder builder(castOp);
+  castOp->setAttr(CastOp::getLBAttrName(), builder.getI64ArrayAttr(lb));
+  castOp->setAttr(CastOp::getUBAttrName(), builder.getI64ArrayAttr(ub));
+  auto oldType = castOp.res().getType().cast<FieldType>();
+  SmallVector<int64_t, 3> shape;
+  for (auto en : llvm::enumerate(oldType.getShape())) {
+    shape.push_back(GridType::isScalar(en.value())
+                        ? en.value()
+                        : ub[en.index()] - lb[en.index()]);
+  }
+  castOp.res().setType(FieldType::get(oldType.getElementType(), shape));
+}
+
 } // namespace stencil
 } // namespace mlir
@@ -21,6 +21,7 @@
 #include "mlir/Transforms/GreedyPatternRewriteDriver.h"
 #include "mlir/Transforms/Passes.h"
 #include "mlir/Transforms/Utils.h"
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallVector.h"
 #include <cstdint>
@@ -123,10 +124,34 @@ void StorageMaterializationPass::runOnFunction() {
   if (!StencilDialect::isStencilProgram(funcOp))
     return;
 
+  // Remember the existing buffers to count the materialized ones
+  DenseSet<Operation *> bufferOps;
+  funcOp.walk([&](stencil::BufferOp bufferOp) {
+    bufferOps.insert(bufferOp.getOperation());
+  });
+
   // Poppulate the pattern list depending on the config
   OwningRewritePatternList patterns;
   patterns.insert<ApplyOpRewrite, CombineOpRewrite>(&getContext());
   applyPatternsAndFoldGreedily(funcOp, std::move(patterns));
+
+  funcOp.walk([&](stencil::BufferOp bufferOp) {
+    if (bufferOps.count(bufferOp.getOperation()))
+      return;
+    numBuffers++;
+    if (!emitRemarks)
+      return;
+    auto tempType = bufferOp.getType().cast<TempType>();
+    if (!tempType.hasStaticShape()) {
+      bufferOp.emitRemark("materialized a temporary of unknown size");
+      return;
+    }
+    int64_t numBytes = tempType.getElementType().getIntOrFloatBitWidth() / 8;
+    for (auto size : tempType.getShape())
+      numBytes *= GridType::isScalar(size) ? 1 : size;
+    bufferOp.emitRemark("materialized a temporary of ")
+        << numBytes << " bytes";
+  });
 }
 
 } // namespace
@@ -0,0 +1,248 @@
+#include "Dialect/Stencil/Passes.h"
+#include "Dialect/Stencil/StencilAnalysis.h"
+#include "Dialect/Stencil/StencilDialect.h"
+#include "Dialect/Stencil/StencilOps.h"
+#include "Dialect/Stencil/StencilTypes.h"
+#include "Dialect/Stencil/StencilUtils.h"
+#include "PassDetail.h"
+#include "mlir/Dialect/StandardOps/IR/Ops.h"
+#include "mlir/IR/BlockAndValueMapping.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/Diagnostics.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/Value.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Support/LLVM.h"
+#include "mlir/Support/LogicalResult.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include <cstdint>
+
+using namespace mlir;
+using namespace stencil;
+
+namespace {
+
+// This struct stores a field updated by the time step
+struct FieldUpdate {
+  stencil::CastOp inputOp;
+  stencil::CastOp outputOp;
+  stencil::StoreOp storeOp;
+  SmallVector<stencil::LoadOp, 2> loadOps;
+};
+
+struct TemporalBlockingPass
+    : public TemporalBlockingPassBase<TemporalBlockingPass> {
+  void runOnFunction() override;
+
+protected:
+  LogicalResult collectFieldUpdates(FuncOp funcOp,
+                                    SmallVectorImpl<FieldUpdate> &updates);
+  Value createBoundaryApply(OpBuilder &builder, Value updated, Value original,
+                            stencil::StoreOp storeOp, ArrayRef<bool> halo);
+};
+
+// Helper returning the unique cast op of a field argument
+static stencil::CastOp getCastOp(Value arg) {
+  if (!arg.hasOneUse())
+    return nullptr;
+  return dyn_cast<stencil::CastOp>(*arg.getUsers().begin());
+}
+
+LogicalResult TemporalBlockingPass::collectFieldUpdates(
+    FuncOp funcOp, SmallVectorImpl<FieldUpdate> &updates) {
+  for (unsigned i = 0, e = funcOp.getNumArguments(); i != e; ++i) {
+    auto attr = funcOp.getArgAttrOfType<IntegerAttr>(
+        i, StencilDialect::getUpdateAttrName());
+    if (!attr)
+      continue;
+    // Verify the update attribute references another argument
+    int64_t input = attr.getInt();
+    if (input < 0 || input >= static_cast<int64_t>(e) ||
+        input == static_cast<int64_t>(i))
+      return funcOp.emitOpError("expected the update attribute of argument ")
+             << i << " to reference another argument";
+    FieldUpdate update;
+    update.inputOp = getCastOp(funcOp.getArgument(input));
+    update.outputOp = getCastOp(funcOp.getArgument(i));
+    if (!update.inputOp || !update.outputOp)
+      return funcOp.emitOpError("expected the updated fields to have one "
+                                "cast op");
+    // Verify the output field is stored once and the input field is only
+    // loaded with the stored temporary type
+    for (auto user : update.outputOp.getResult().getUsers()) {
+      auto storeOp = dyn_cast<stencil::StoreOp>(user);
+      if (!storeOp || update.storeOp)
+        return update.outputOp.emitOpError(
+            "expected the updated field to be stored once");
+      update.storeOp = storeOp;
+    }
+    if (!update.storeOp)
+      return update.outputOp.emitOpError(
+          "expected the updated field to be stored once");
+    for (auto user : update.inputOp.getResult().getUsers()) {
+      auto loadOp = dyn_cast<stencil::LoadOp>(user);
+      if (!loadOp || loadOp.getType() != update.storeOp.temp().getType())
+        return user->emitOpError("expected the field to be loaded with the "
+                                 "type of its update");
+      update.loadOps.push_back(loadOp);
+    }
+    updates.push_back(update);
+  }
+
+  // Verify all stores write an updated field
+  auto result = funcOp.walk([&](stencil::StoreOp storeOp) {
+    if (llvm::none_of(updates, [&](FieldUpdate &update) {
+          return update.storeOp == storeOp;
+        })) {
+      storeOp.emitOpError("expected the stored field to have an update");
+      return WalkResult::interrupt();
+    }
+    return WalkResult::advance();
+  });
+  return failure(result.wasInterrupted());
+}
+
+// Introduce an apply op that takes the updated values inside the store domain
+// and the original values on the boundary outside of the store domain
+Value TemporalBlockingPass::createBoundaryApply(OpBuilder &builder,
+                                                Value updated, Value original,
+                                                stencil::StoreOp storeOp,
+                                                ArrayRef<bool> halo) {
+  auto loc = storeOp.getLoc();
+  auto shapeOp = cast<ShapeOp>(storeOp.getOperation());
+  auto applyOp = builder.create<stencil::ApplyOp>(
+      loc, TypeRange(updated.getType()), ValueRange({updated, original}),
+      llvm::None, llvm::None);
+
+  // Check if the point is inside the store domain
+  OpBuilder::InsertionGuard guard(builder);
+  builder.setInsertionPointToStart(applyOp.getBody());
+  Index zeroOffset = {0, 0, 0};
+  Value inside;
+  for (auto en : llvm::enumerate(halo)) {
+    if (!en.value())
+      continue;
+    auto indexOp =
+        builder.create<stencil::IndexOp>(loc, en.index(), zeroOffset);
+    auto lb = builder.create<ConstantIndexOp>(loc, shapeOp.getLB()[en.index()]);
+    auto ub = builder.create<ConstantIndexOp>(loc, shapeOp.getUB()[en.index()]);
+    Value cmpOp = builder.create<AndOp>(
+        loc, builder.create<CmpIOp>(loc, CmpIPredicate::sge, indexOp, lb),
+        builder.create<CmpIOp>(loc, CmpIPredicate::slt, indexOp, ub));
+    inside =
+        inside ? builder.create<AndOp>(loc, inside, cmpOp).getResult() : cmpOp;
+  }
+
+  // Select the updated or the original value
+  auto updatedOp = builder.create<stencil::AccessOp>(
+      loc, applyOp.getBody()->getArgument(0), zeroOffset);
+  auto originalOp = builder.create<stencil::AccessOp>(
+      loc, applyOp.getBody()->getArgument(1), zeroOffset);
+  auto selectOp =
+      builder.create<SelectOp>(loc, inside, updatedOp, originalOp);
+  auto resultOp = builder.create<stencil::StoreResultOp>(loc, selectOp);
+  builder.create<stencil::ReturnOp>(loc, resultOp.getResult(), nullptr);
+  return applyOp.getResult(0);
+}
+
+void TemporalBlockingPass::runOnFunction() {
+  FuncOp funcOp = getFunction();
+  // Only run on functions marked as stencil programs
+  if (!StencilDialect::isStencilProgram(funcOp))
+    return;
+
+  if (timeSteps == 0) {
+    funcOp.emitOpError("expected a positive number of time steps");
+    return signalPassFailure();
+  }
+
+  // Verify shape inference has not been executed
+  auto result = funcOp.walk([&](stencil::ApplyOp applyOp) {
+    if (cast<ShapeOp>(applyOp.getOperation()).hasShape()) {
+      applyOp.emitOpError("execute temporal blocking before shape inference");
+      return WalkResult::interrupt();
+    }
+    return WalkResult::advance();
+  });
+  if (result.wasInterrupted())
+    return signalPassFailure();
+
+  // Collect the fields updated by the time step
+  SmallVector<FieldUpdate, 4> updates;
+  if (failed(collectFieldUpdates(funcOp, updates)))
+    return signalPassFailure();
+  if (updates.empty() || timeSteps == 1)
+    return;
+
+  // Compute the dimensions accessed with a halo
+  // (only they require the boundary of the updated fields)
+  auto &extents = getAnalysis<AccessExtents>();
+  SmallVector<bool, 3> halo(kIndexSize, false);
+  funcOp.walk([&](stencil::ApplyOp applyOp) {
+    for (auto operand : applyOp.getOperands()) {
+      if (auto extent = extents.lookupExtent(applyOp, operand)) {
+        for (int64_t i = 0; i != kIndexSize; ++i)
+          halo[i] = halo[i] || extent->negative[i] != 0 ||
+                    extent->positive[i] != 0;
+      }
+    }
+  });
+
+  // Collect the operations of the time step
+  SmallVector<Operation *, 16> stepOps;
+  for (auto &op : funcOp.getBody().front().without_terminator()) {
+    if (!isa<stencil::CastOp>(op))
+      stepOps.push_back(&op);
+  }
+
+  // Append the time steps and replace the loads of the updated fields by
+  // the temporaries computed by the previous time step
+  OpBuilder builder(funcOp.getBody().front().getTerminator());
+  SmallVector<stencil::StoreOp, 4> currStores, prevStores;
+  for (auto &update : updates)
+    currStores.push_back(update.storeOp);
+  for (unsigned t = 1; t != timeSteps; ++t) {
+    BlockAndValueMapping mapper;
+    for (auto en : llvm::enumerate(updates)) {
+      auto &update = en.value();
+      if (update.loadOps.empty())
+        continue;
+      Value temp = currStores[en.index()].temp();
+      if (llvm::any_of(halo, [](bool x) { return x; }))
+        temp = createBoundaryApply(builder, temp, update.loadOps.front(),
+                                   update.storeOp, halo);
+      for (auto loadOp : update.loadOps)
+        mapper.map(loadOp.getResult(), temp);
+    }
+    // Clone the time step and reuse the loads of the other fields
+    SmallVector<stencil::StoreOp, 4> nextStores(updates.size());
+    for (auto op : stepOps) {
+      if (auto loadOp = dyn_cast<stencil::LoadOp>(op)) {
+        if (!mapper.contains(loadOp.getResult()))
+          mapper.map(loadOp.getResult(), loadOp.getResult());
+        continue;
+      }
+      auto clonedOp = builder.clone(*op, mapper);
+      if (auto storeOp = dyn_cast<stencil::StoreOp>(clonedOp)) {
+        auto it = llvm::find_if(updates, [&](FieldUpdate &update) {
+          return update.storeOp.getOperation() == op;
+        });
+        nextStores[std::distance(updates.begin(), it)] = storeOp;
+      }
+    }
+    prevStores.append(currStores.begin(), currStores.end());
+    currStores = nextStores;
+  }
+
+  // Store only the results of the last time step
+  for (auto storeOp : prevStores)
+    storeOp.erase();
+}
+
+} // namespace
+
+std::unique_ptr<OperationPass<FuncOp>> mlir::createTemporalBlockingPass() {
+  return std::make_unique<TemporalBlockingPass>();
+}
@@ -0,0 +1,285 @@
+// Runtime of the stencil-domain-decomposition pass that exchanges the halos
+// of the distributed fields with the neighbor ranks using MPI (the ranks of
+// MPI_COMM_WORLD form a row-major grid and the application initializes MPI)
+
+#include "mlir/ExecutionEngine/CRunnerUtils.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mpi.h>
+#include <vector>
+
+#ifdef CUDA_BACKEND_ENABLED
+#include "cuda.h"
+#endif
+#ifdef ROCM_BACKEND_ENABLED
+#include "hip/hip_runtime.h"
+#endif
+
+namespace {
+
+// Box of a field memref (the last memref dimension has unit stride)
+struct Box {
+  int64_t begin[3];
+  int64_t size[3];
+
+  int64_t getNumElements() const { return size[0] * size[1] * size[2]; }
+};
+
+// Return true if the pointer references device memory
+static bool isDevicePointer(const void *ptr) {
+#ifdef CUDA_BACKEND_ENABLED
+  CUmemorytype type;
+  if (cuPointerGetAttribute(&type, CU_POINTER_ATTRIBUTE_MEMORY_TYPE,
+                            reinterpret_cast<CUdeviceptr>(ptr)) ==
+      CUDA_SUCCESS)
+    return type == CU_MEMORYTYPE_DEVICE;
+#endif
+#ifdef ROCM_BACKEND_ENABLED
+  hipPointerAttribute_t attributes;
+  if (hipPointerGetAttributes(&attributes, ptr) == hipSuccess)
+    return attributes.memoryType == hipMemoryTypeDevice;
+#endif
+  (void)ptr;
+  return false;
+}
+
+// Copy a box of the field to or from a contiguous buffer
+template <typename T>
+static void copyBox(StridedMemRefType<T, 3> *field, const Box &box, T *buffer,
+                    bool pack) {
+  T *data = field->data + field->offset;
+  if (isDevicePointer(data)) {
+#ifdef CUDA_BACKEND_ENABLED
+    CUDA_MEMCPY3D params;
+    std::memset(&params, 0, sizeof(params));
+    CUdeviceptr device = reinterpret_cast<CUdeviceptr>(data);
+    size_t pitch = field->strides[1] * sizeof(T);
+    size_t height = field->strides[0] / field->strides[1];
+    if (pack) {
+      params.srcMemoryType = CU_MEMORYTYPE_DEVICE;
+      params.srcDevice = device;
+      params.srcXInBytes = box.begin[2] * sizeof(T);
+      params.srcY = box.begin[1];
+      params.srcZ = box.begin[0];
+      params.srcPitch = pitch;
+      params.srcHeight = height;
+      params.dstMemoryType = CU_MEMORYTYPE_HOST;
+      params.dstHost = buffer;
+      params.dstPitch = box.size[2] * sizeof(T);
+      params.dstHeight = box.size[1];
+    } else {
+      params.srcMemoryType = CU_MEMORYTYPE_HOST;
+      params.srcHost = buffer;
+      params.srcPitch = box.size[2] * sizeof(T);
+      params.srcHeight = box.size[1];
+      params.dstMemoryType = CU_MEMORYTYPE_DEVICE;
+      params.dstDevice = device;
+      params.dstXInBytes = box.begin[2] * sizeof(T);
+      params.dstY = box.begin[1];
+      params.dstZ = box.begin[0];
+      params.dstPitch = pitch;
+      params.dstHeight = height;
+    }
+    params.WidthInBytes = box.size[2] * sizeof(T);
+    params.Height = box.size[1];
+    params.Depth = box.size[0];
+    if (cuMemcpy3D(&params) != CUDA_SUCCESS)
+      std::fprintf(stderr, "oec halo exchange: cuMemcpy3D failed\n");
+    return;
+#endif
+#ifdef ROCM_BACKEND_ENABLED
+    hipMemcpy3DParms params;
+    std::memset(&params, 0, sizeof(params));
+    hipPitchedPtr device = make_hipPitchedPtr(
+        data, field->strides[1] * sizeof(T), field->sizes[2],
+        field->strides[0] / field->strides[1]);
+    hipPitchedPtr host = make_hipPitchedPtr(buffer, box.size[2] * sizeof(T),
+                                            box.size[2], box.size[1]);
+    hipPos position =
+        make_hipPos(box.begin[2] * sizeof(T), box.begin[1], box.begin[0]);
+    if (pack) {
+      params.srcPtr = device;
+      params.srcPos = position;
+      params.dstPtr = host;
+      params.kind = hipMemcpyDeviceToHost;
+    } else {
+      params.srcPtr = host;
+      params.dstPtr = device;
+      params.dstPos = position;
+      params.kind = hipMemcpyHostToDevice;
+    }
+    params.extent =
+        make_hipExtent(box.size[2] * sizeof(T), box.size[1], box.size[0]);
+    if (hipMemcpy3D(&params) != hipSuccess)
+      std::fprintf(stderr, "oec halo exchange: hipMemcpy3D failed\n");
+    return;
+#endif
+  }
+
+  // Copy the rows of the box on the host
+  for (int64_t k = 0; k != box.size[0]; ++k) {
+    for (int64_t j = 0; j != box.size[1]; ++j) {
+      T *row = data + (box.begin[0] + k) * field->strides[0] +
+               (box.begin[1] + j) * field->strides[1];
+      T *packed = buffer + (k * box.size[1] + j) * box.size[2];
+      for (int64_t i = 0; i != box.size[2]; ++i) {
+        T *element = row + (box.begin[2] + i) * field->strides[2];
+        if (pack)
+          packed[i] = *element;
+        else
+          *element = packed[i];
+      }
+    }
+  }
+}
+
+class HaloExchange {
+public:
+  template <typename T>
+  void begin(StridedMemRefType<T, 3> *field, int64_t tag,
+             const int64_t dims[2], const int64_t ranks[2],
+             const int64_t origin[2], const int64_t size[2],
+             const int64_t lower[2], const int64_t upper[2]) {
+    int rank, numRanks;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &numRanks);
+    if (numRanks != ranks[0] * ranks[1]) {
+      std::fprintf(stderr,
+                   "oec halo exchange: expected %lld ranks but got %d\n",
+                   static_cast<long long>(ranks[0] * ranks[1]), numRanks);
+      MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    int64_t coords[2] = {rank % ranks[0], rank / ranks[0]};
+
+    // Exchange the halo with the eight neighbors including the corners
+    for (int64_t di = -1; di <= 1; ++di) {
+      for (int64_t dj = -1; dj <= 1; ++dj) {
+        int64_t dirs[2] = {di, dj};
+        if (di == 0 && dj == 0)
+          continue;
+        int64_t neighbor[2] = {coords[0] + di, coords[1] + dj};
+        if (neighbor[0] < 0 || neighbor[0] >= ranks[0] || neighbor[1] < 0 ||
+            neighbor[1] >= ranks[1])
+          continue;
+        int neighborRank = neighbor[1] * ranks[0] + neighbor[0];
+
+        // Compute the sent and received boxes (memref dimension dims[d]
+        // stores the distributed dimension d and the boxes span the other
+        // memref dimension)
+        Box send, recv;
+        for (int m = 0; m != 3; ++m) {
+          send.begin[m] = recv.begin[m] = 0;
+          send.size[m] = recv.size[m] = field->sizes[m];
+        }
+        for (int d = 0; d != 2; ++d) {
+          int64_t m = dims[d];
+          if (dirs[d] < 0) {
+            send.begin[m] = origin[d];
+            send.size[m] = upper[d];
+            recv.begin[m] = origin[d] - lower[d];
+            recv.size[m] = lower[d];
+          } else if (dirs[d] > 0) {
+            send.begin[m] = origin[d] + size[d] - lower[d];
+            send.size[m] = lower[d];
+            recv.begin[m] = origin[d] + size[d];
+            recv.size[m] = upper[d];
+          } else {
+            send.begin[m] = recv.begin[m] = origin[d];
+            send.size[m] = recv.size[m] = size[d];
+          }
+        }
+
+        // The tags identify the field and the direction of the sender
+        int sendTag = static_cast<int>(tag * 9 + (di + 1) * 3 + (dj + 1));
+        int recvTag = static_cast<int>(tag * 9 + (1 - di) * 3 + (1 - dj));
+        if (send.getNumElements() > 0) {
+          auto buffer = std::make_shared<std::vector<T>>(
+              send.getNumElements());
+          copyBox(field, send, buffer->data(), true);
+          requests.emplace_back();
+          MPI_Isend(buffer->data(), buffer->size() * sizeof(T), MPI_BYTE,
+                    neighborRank, sendTag, MPI_COMM_WORLD, &requests.back());
+          buffers.push_back(buffer);
+        }
+        if (recv.getNumElements() > 0) {
+          auto buffer = std::make_shared<std::vector<T>>(
+              recv.getNumElements());
+          requests.emplace_back();
+          MPI_Irecv(buffer->data(), buffer->size() * sizeof(T), MPI_BYTE,
+                    neighborRank, recvTag, MPI_COMM_WORLD, &requests.back());
+          buffers.push_back(buffer);
+          StridedMemRefType<T, 3> view = *field;
+          unpacks.push_back([view, recv, buffer]() mutable {
+            copyBox(&view, recv, buffer->data(), false);
+          });
+        }
+      }
+    }
+  }
+
+  void end() {
+    // Wait for all messages and unpack the received halos
+    MPI_Waitall(static_cast<int>(requests.size()), requests.data(),
+                MPI_STATUSES_IGNORE);
+    for (auto &unpack : unpacks)
+      unpack();
+    requests.clear();
+    buffers.clear();
+    unpacks.clear();
+  }
+
+private:
+  std::vector<MPI_Request> requests;
+  std::vector<std::shared_ptr<void>> buffers;
+  std::vector<std::function<void()>> unpacks;
+};
+
+HaloExchange &getHaloExchange() {
+  static HaloExchange exchange;
+  return exchange;
+}
+
+template <typename T>
+void beginHaloExchange(StridedMemRefType<T, 3> *field, int64_t tag,
+                       int64_t dimI, int64_t dimJ, int64_t ranksI,
+                       int64_t ranksJ, int64_t originI, int64_t originJ,
+                       int64_t sizeI, int64_t sizeJ, int64_t lowerI,
+                       int64_t lowerJ, int64_t upperI, int64_t upperJ) {
+  if (dimI < 0 || dimI > 2 || dimJ < 0 || dimJ > 2 || dimI == dimJ) {
+    std::fprintf(stderr, "oec halo exchange: invalid memref dimensions\n");
+    MPI_Abort(MPI_COMM_WORLD, 1);
+  }
+  int64_t dims[2] = {dimI, dimJ};
+  int64_t ranks[2] = {ranksI, ranksJ};
+  int64_t origin[2] = {originI, originJ};
+  int64_t size[2] = {sizeI, sizeJ};
+  int64_t lower[2] = {lowerI, lowerJ};
+  int64_t upper[2] = {upperI, upperJ};
+  getHaloExchange().begin(field, tag, dims, ranks, origin, size, lower,
+                          upper);
+}
+
+} // namespace
+
+extern "C" void _mlir_ciface_oecHaloExchangeBeginF64(
+    StridedMemRefType<double, 3> *field, int64_t tag, int64_t dimI,
+    int64_t dimJ, int64_t ranksI, int64_t ranksJ, int64_t originI,
+    int64_t originJ, int64_t sizeI, int64_t sizeJ, int64_t lowerI,
+    int64_t lowerJ, int64_t upperI, int64_t upperJ) {
+  beginHaloExchange(field, tag, dimI, dimJ, ranksI, ranksJ, originI, originJ,
+                    sizeI, sizeJ, lowerI, lowerJ, upperI, upperJ);
+}
+
+extern "C" void _mlir_ciface_oecHaloExchangeBeginF32(
+    StridedMemRefType<float, 3> *field, int64_t tag, int64_t dimI,
+    int64_t dimJ, int64_t ranksI, int64_t ranksJ, int64_t originI,
+    int64_t originJ, int64_t sizeI, int64_t sizeJ, int64_t lowerI,
+    int64_t lowerJ, int64_t upperI, int64_t upperJ) {
+  beginHaloExchange(field, tag, dimI, dimJ, ranksI, ranksJ, originI, originJ,
+                    sizeI, sizeJ, lowerI, lowerJ, upperI, upperJ);
+}
+
+extern "C" void _mlir_ciface_oecHaloExchangeEnd() { getHaloExchange().end(); }
@@ -0,0 +1,125 @@
+// Runtime of the stencil-instrument pass that aggregates the execution time,
+// the launch count, and the bytes moved per kernel and prints a report at
+// exit (set OEC_PROFILE_FILE to write the report to a file instead of stderr)
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef CUDA_BACKEND_ENABLED
+#include "cuda.h"
+#endif
+#ifdef ROCM_BACKEND_ENABLED
+#include "hip/hip_runtime.h"
+#endif
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Kernel statistics aggregated over all launches
+struct KernelStats {
+  int64_t launches = 0;
+  int64_t bytes = 0;
+  double totalTime = 0.0;
+  Clock::time_point start;
+};
+
+class Profiler {
+public:
+  ~Profiler() { report(); }
+
+  void begin(const char *name, int64_t bytes) {
+    synchronize();
+    std::lock_guard<std::mutex> lock(mutex);
+    auto &stats = kernels[name];
+    stats.launches++;
+    stats.bytes += bytes;
+    stats.start = Clock::now();
+  }
+
+  void end(const char *name) {
+    synchronize();
+    auto stop = Clock::now();
+    std::lock_guard<std::mutex> lock(mutex);
+    auto &stats = kernels[name];
+    stats.totalTime +=
+        std::chrono::duration<double, std::milli>(stop - stats.start).count();
+  }
+
+private:
+  // Wait for the device to finish the kernels launched asynchronously
+  static void synchronize() {
+#ifdef CUDA_BACKEND_ENABLED
+    CUcontext context = nullptr;
+    if (cuCtxGetCurrent(&context) == CUDA_SUCCESS && context)
+      cuCtxSynchronize();
+#endif
+#ifdef ROCM_BACKEND_ENABLED
+    (void)hipDeviceSynchronize();
+#endif
+  }
+
+  void report() {
+    if (kernels.empty())
+      return;
+    FILE *file = stderr;
+    if (const char *fileName = std::getenv("OEC_PROFILE_FILE"))
+      file = std::fopen(fileName, "w");
+    if (!file)
+      return;
+
+    // Sort the kernels by decreasing total time
+    std::vector<std::pair<std::string, KernelStats>> sorted(kernels.begin(),
+                                                            kernels.end());
+    std::stable_sort(sorted.begin(), sorted.end(),
+                     [](const std::pair<std::string, KernelStats> &x,
+                        const std::pair<std::string, KernelStats> &y) {
+                       return x.second.totalTime > y.second.totalTime;
+                     });
+    double totalTime = 0.0;
+    for (auto &kernel : sorted)
+      totalTime += kernel.second.totalTime;
+
+    std::fprintf(file, "===--- oec kernel profile ---===\n");
+    std::fprintf(file, "%12s %7s %9s %12s %10s  %s\n", "time (ms)", "share",
+                 "launches", "mean (ms)", "GB/s", "kernel");
+    for (auto &kernel : sorted) {
+      auto &stats = kernel.second;
+      double bandwidth =
+          stats.totalTime > 0.0 ? stats.bytes / (stats.totalTime * 1e6) : 0.0;
+      std::fprintf(file, "%12.4f %6.2f%% %9lld %12.4f %10.2f  %s\n",
+                   stats.totalTime,
+                   totalTime > 0.0 ? 100.0 * stats.totalTime / totalTime : 0.0,
+                   static_cast<long long>(stats.launches),
+                   stats.totalTime / stats.launches, bandwidth,
+                   kernel.first.c_str());
+    }
+    std::fprintf(file, "%12.4f %6.2f%%  total\n", totalTime, 100.0);
+    if (file != stderr)
+      std::fclose(file);
+  }
+
+  std::map<std::string, KernelStats> kernels;
+  std::mutex mutex;
+};
+
+Profiler &getProfiler() {
+  static Profiler profiler;
+  return profiler;
+}
+
+} // namespace
+
+extern "C" void oecProfilerBegin(const char *name, int64_t bytes) {
+  getProfiler().begin(name, bytes);
+}
+
+extern "C" void oecProfilerEnd(const char *name) { getProfiler().end(name); }
@@ -0,0 +1,162 @@
+// Runtime of the stencil-slab-streaming pass that migrates the slabs of the
+// fields between the host and the device (the fields are allocated in managed
+// memory and the prefetches of each direction execute on a separate stream)
+
+#include "mlir/ExecutionEngine/CRunnerUtils.h"
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+#ifdef CUDA_BACKEND_ENABLED
+#include "cuda.h"
+#endif
+#ifdef ROCM_BACKEND_ENABLED
+#include "hip/hip_runtime.h"
+#endif
+
+namespace {
+
+class SlabStreaming {
+public:
+  // Prefetch a contiguous range of a managed allocation to the device or to
+  // the host (prefetching memory that is not managed fails and is ignored)
+  void prefetch(const void *ptr, size_t bytes, bool toDevice) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!initialize())
+      return;
+#ifdef CUDA_BACKEND_ENABLED
+    cuCtxPushCurrent(context);
+    unsigned isManaged = 0;
+    CUdeviceptr address = reinterpret_cast<CUdeviceptr>(ptr);
+    if (cuPointerGetAttribute(&isManaged, CU_POINTER_ATTRIBUTE_IS_MANAGED,
+                              address) == CUDA_SUCCESS &&
+        isManaged)
+      cuMemPrefetchAsync(address, bytes, toDevice ? device : CU_DEVICE_CPU,
+                         streams[toDevice]);
+    cuCtxPopCurrent(nullptr);
+#endif
+#ifdef ROCM_BACKEND_ENABLED
+    (void)hipMemPrefetchAsync(ptr, bytes, toDevice ? device : hipCpuDeviceId,
+                              streams[toDevice]);
+#endif
+    (void)ptr;
+    (void)bytes;
+    (void)toDevice;
+  }
+
+  // Wait for the prefetches of one direction
+  void wait(bool toDevice) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!initialized)
+      return;
+#ifdef CUDA_BACKEND_ENABLED
+    cuCtxPushCurrent(context);
+    cuStreamSynchronize(streams[toDevice]);
+    cuCtxPopCurrent(nullptr);
+#endif
+#ifdef ROCM_BACKEND_ENABLED
+    (void)hipStreamSynchronize(streams[toDevice]);
+#endif
+    (void)toDevice;
+  }
+
+private:
+  // Create the streams on the device used by the programs
+  bool initialize() {
+    if (initialized)
+      return true;
+#ifdef CUDA_BACKEND_ENABLED
+    if (cuInit(0) != CUDA_SUCCESS || cuDeviceGet(&device, 0) != CUDA_SUCCESS ||
+        cuDevicePrimaryCtxRetain(&context, device) != CUDA_SUCCESS)
+      return false;
+    cuCtxPushCurrent(context);
+    for (auto &stream : streams)
+      cuStreamCreate(&stream, CU_STREAM_NON_BLOCKING);
+    cuCtxPopCurrent(nullptr);
+#endif
+#ifdef ROCM_BACKEND_ENABLED
+    if (hipGetDevice(&device) != hipSuccess)
+      return false;
+    for (auto &stream : streams)
+      (void)hipStreamCreateWithFlags(&stream, hipStreamNonBlocking);
+#endif
+    initialized = true;
+    return true;
+  }
+
+#ifdef CUDA_BACKEND_ENABLED
+  CUdevice device;
+  CUcontext context;
+  CUstream streams[2];
+#endif
+#ifdef ROCM_BACKEND_ENABLED
+  int device;
+  hipStream_t streams[2];
+#endif
+  bool initialized = false;
+  std::mutex mutex;
+};
+
+SlabStreaming &getSlabStreaming() {
+  static SlabStreaming slabStreaming;
+  return slabStreaming;
+}
+
+// Prefetch the rows [begin, begin + size) of one memref dimension of a field
+// (the pass selects the dimension according to the memref layout of the
+// lowering and the inner dimensions of a row are contiguous)
+template <typename T, int N>
+static void prefetchSlab(StridedMemRefType<T, N> *field, int64_t dim,
+                         int64_t begin, int64_t size, bool toDevice) {
+  if (dim < 0 || dim >= N || begin < 0 || size <= 0 ||
+      begin + size > field->sizes[dim])
+    return;
+  int64_t numRows = 1;
+  for (int64_t i = 0; i < dim; ++i)
+    numRows *= field->sizes[i];
+  size_t bytes = size * field->strides[dim] * sizeof(T);
+  for (int64_t row = 0; row < numRows; ++row) {
+    // Compute the offset of the slab in the current outer row
+    int64_t offset = field->offset + begin * field->strides[dim];
+    for (int64_t i = dim - 1, rest = row; i >= 0; --i) {
+      offset += (rest % field->sizes[i]) * field->strides[i];
+      rest /= field->sizes[i];
+    }
+    getSlabStreaming().prefetch(field->data + offset, bytes, toDevice);
+  }
+}
+
+} // namespace
+
+extern "C" void
+_mlir_ciface_oecSlabPrefetchF64(StridedMemRefType<double, 3> *field,
+                                int64_t dim, int64_t begin, int64_t size,
+                                int64_t toDevice) {
+  prefetchSlab(field, dim, begin, size, toDevice != 0);
+}
+
+extern "C" void
+_mlir_ciface_oecSlabPrefetchF32(StridedMemRefType<float, 3> *field,
+                                int64_t dim, int64_t begin, int64_t size,
+                                int64_t toDevice) {
+  prefetchSlab(field, dim, begin, size, toDevice != 0);
+}
+
+// Entry points of the ensemble fields that have an outer ensemble dimension
+extern "C" void
+_mlir_ciface_oecSlabPrefetchEnsembleF64(StridedMemRefType<double, 4> *field,
+                                        int64_t dim, int64_t begin,
+                                        int64_t size, int64_t toDevice) {
+  prefetchSlab(field, dim, begin, size, toDevice != 0);
+}
+
+extern "C" void
+_mlir_ciface_oecSlabPrefetchEnsembleF32(StridedMemRefType<float, 4> *field,
+                                        int64_t dim, int64_t begin,
+                                        int64_t size, int64_t toDevice) {
+  prefetchSlab(field, dim, begin, size, toDevice != 0);
+}
+
+extern "C" void _mlir_ciface_oecSlabWait(int64_t toDevice) {
+  getSlabStreaming().wait(toDevice != 0);
+}
@@ -19,6 +19,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "Conversion/LoopsToCPU/Passes.h"
 #include "Conversion/LoopsToGPU/Passes.h"
 #include "Conversion/StencilToStandard/Passes.h"
 #include "Dialect/Stencil/Passes.h"
@@ -49,8 +50,11 @@ int main(int argc, char **argv) {
   // Register the stencil passes
   registerStencilPasses();
   registerStencilConversionPasses();
+  registerLoopsToCPUPasses();
+  registerLoopsToGPUPasses();
 
   // Register the stencil pipelines
+  registerStencilToCPUPipeline();
 #ifdef CUDA_BACKEND_ENABLED
   registerGPUToCUBINPipeline();
 #endif
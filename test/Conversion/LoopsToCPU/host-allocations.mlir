@@ -0,0 +1,18 @@
+// RUN: oec-opt %s --stencil-host-allocations | FileCheck %s
+
+// CHECK-LABEL: func @temporaries
+func @temporaries(%arg0: index) {
+  // CHECK-NEXT: [[STATIC:%.*]] = alloc() : memref<8x8x8xf64>
+  %0 = gpu.alloc () : memref<8x8x8xf64>
+  // CHECK-NEXT: [[DYNAMIC:%.*]] = alloc(%{{.*}}) : memref<?xf64>
+  %1 = gpu.alloc (%arg0) : memref<?xf64>
+  // CHECK-NEXT: dealloc [[STATIC]] : memref<8x8x8xf64>
+  gpu.dealloc %0 : memref<8x8x8xf64>
+  // CHECK-NEXT: dealloc [[DYNAMIC]] : memref<?xf64>
+  gpu.dealloc %1 : memref<?xf64>
+  // CHECK-NEXT: [[TOKEN:%.*]] = gpu.wait async
+  %2 = gpu.wait async
+  // CHECK-NEXT: gpu.alloc async {{\[}}[[TOKEN]]] () : memref<4xf64>
+  %3, %4 = gpu.alloc async [%2] () : memref<4xf64>
+  return
+}
@@ -0,0 +1,51 @@
+// RUN: oec-opt %s --stencil-parallel-loops-to-openmp | FileCheck %s
+
+// CHECK: func private @omp_get_num_threads() -> i32
+// CHECK: func private @omp_get_thread_num() -> i32
+
+// CHECK-LABEL: func @chunking
+func @chunking(%arg0: memref<32x64xf64>) {
+  %c0 = constant 0 : index
+  %c1 = constant 1 : index
+  %c4 = constant 4 : index
+  %c32 = constant 32 : index
+  %c64 = constant 64 : index
+  %cst = constant 1.000000e+00 : f64
+  //      CHECK: [[COUNTI:%.*]] = ceildivi_signed %{{.*}}, %{{.*}} : index
+  //      CHECK: [[COUNTJ:%.*]] = ceildivi_signed %{{.*}}, %{{.*}} : index
+  //      CHECK: [[COUNT:%.*]] = muli %{{.*}}, [[COUNTJ]] : index
+  //      CHECK: omp.parallel
+  //      CHECK: [[THREADNUM:%.*]] = call @omp_get_thread_num() : () -> i32
+  // CHECK-NEXT: [[THREAD:%.*]] = index_cast [[THREADNUM]] : i32 to index
+  // CHECK-NEXT: [[NUMTHREADS:%.*]] = call @omp_get_num_threads() : () -> i32
+  // CHECK-NEXT: [[THREADS:%.*]] = index_cast [[NUMTHREADS]] : i32 to index
+  // CHECK-NEXT: [[CHUNK:%.*]] = ceildivi_signed [[COUNT]], [[THREADS]] : index
+  // CHECK-NEXT: [[START:%.*]] = muli [[THREAD]], [[CHUNK]] : index
+  // CHECK-NEXT: [[CMP0:%.*]] = cmpi "slt", [[START]], [[COUNT]] : index
+  // CHECK-NEXT: [[BEGIN:%.*]] = select [[CMP0]], [[START]], [[COUNT]] : index
+  // CHECK-NEXT: [[STOP:%.*]] = addi [[BEGIN]], [[CHUNK]] : index
+  // CHECK-NEXT: [[CMP1:%.*]] = cmpi "slt", [[STOP]], [[COUNT]] : index
+  // CHECK-NEXT: [[END:%.*]] = select [[CMP1]], [[STOP]], [[COUNT]] : index
+  //      CHECK: scf.for [[IV:%.*]] = [[BEGIN]] to [[END]] step %{{.*}} {
+  // CHECK-NEXT: [[OFFSETI:%.*]] = remi_signed [[IV]], [[COUNTI]] : index
+  // CHECK-NEXT: [[SCALEDI:%.*]] = muli [[OFFSETI]], %{{.*}} : index
+  // CHECK-NEXT: [[I:%.*]] = addi %{{.*}}, [[SCALEDI]] : index
+  // CHECK-NEXT: [[REST:%.*]] = divi_signed [[IV]], [[COUNTI]] : index
+  // CHECK-NEXT: [[OFFSETJ:%.*]] = remi_signed [[REST]], [[COUNTJ]] : index
+  // CHECK-NEXT: [[SCALEDJ:%.*]] = muli [[OFFSETJ]], %{{.*}} : index
+  // CHECK-NEXT: [[J:%.*]] = addi %{{.*}}, [[SCALEDJ]] : index
+  //      CHECK: scf.parallel ([[POINT:%.*]]) =
+  // CHECK-NEXT: [[INDEX:%.*]] = addi [[I]], [[POINT]] : index
+  // CHECK-NEXT: store %{{.*}}, %{{.*}}{{\[}}[[J]], [[INDEX]]] : memref<32x64xf64>
+  //      CHECK: omp.terminator
+  //  CHECK-NOT: scf.parallel ({{.*}}, {{.*}})
+  scf.parallel (%arg1, %arg2) = (%c0, %c0) to (%c64, %c32) step (%c4, %c1) {
+    scf.parallel (%arg3) = (%c0) to (%c4) step (%c1) {
+      %0 = addi %arg1, %arg3 : index
+      store %cst, %arg0[%arg2, %0] : memref<32x64xf64>
+      scf.yield
+    }
+    scf.yield
+  }
+  return
+}
@@ -0,0 +1,61 @@
+// RUN: oec-opt %s -split-input-file --stencil-vectorize-inner-loops='vector-width=4' | FileCheck %s
+
+// CHECK-LABEL: func @vectorize
+func @vectorize(%arg0: memref<8x16xf64>, %arg1: memref<8x16xf64>) {
+  %c0 = constant 0 : index
+  %c1 = constant 1 : index
+  %c8 = constant 8 : index
+  %c16 = constant 16 : index
+  %cst = constant 2.000000e+00 : f64
+  //      CHECK: [[STEP:%.*]] = constant 4 : index
+  //  CHECK-NOT: affine.apply
+  //      CHECK: scf.parallel ([[I:%.*]], [[J:%.*]]) = (%{{.*}}, %{{.*}}) to (%{{.*}}, %{{.*}}) step ([[STEP]], %{{.*}}) {
+  //      CHECK: [[VALUE:%.*]] = vector.transfer_read %{{.*}}{{\[}}[[J]], [[I]]]
+  //      CHECK: [[FACTOR:%.*]] = vector.broadcast %{{.*}} : f64 to vector<4xf64>
+  // CHECK-NEXT: [[RESULT:%.*]] = mulf [[VALUE]], [[FACTOR]] : vector<4xf64>
+  // CHECK-NEXT: vector.transfer_write [[RESULT]], %{{.*}}{{\[}}[[J]], [[I]]]
+  //  CHECK-NOT: scf.parallel
+  //      CHECK: return
+  scf.parallel (%arg2, %arg3) = (%c0, %c0) to (%c16, %c8) step (%c1, %c1) {
+    %0 = load %arg0[%arg3, %arg2] : memref<8x16xf64>
+    %1 = mulf %0, %cst : f64
+    store %1, %arg1[%arg3, %arg2] : memref<8x16xf64>
+    scf.yield
+  }
+  return
+}
+
+// -----
+
+// CHECK: #[[VECTORMAP:map[0-9]*]] = affine_map<(d0, d1) -> ({{.*}}floordiv 4{{.*}})>
+#map = affine_map<(d0, d1, d2) -> (d0, d1 - d2)>
+
+// CHECK-LABEL: func @tile_tail
+func @tile_tail(%arg0: memref<16xf64>) {
+  %c0 = constant 0 : index
+  %c1 = constant 1 : index
+  %c6 = constant 6 : index
+  %c16 = constant 16 : index
+  %cst = constant 1.000000e+00 : f64
+  //      CHECK: scf.parallel ([[TILE:%.*]]) =
+  //      CHECK: [[UB:%.*]] = affine.min
+  // CHECK-NEXT: [[VECTORUB:%.*]] = affine.apply #[[VECTORMAP]](%{{.*}}, [[UB]])
+  // CHECK-NEXT: [[STEP:%.*]] = constant 4 : index
+  // CHECK-NEXT: scf.parallel ([[POINT:%.*]]) = (%{{.*}}) to ([[VECTORUB]]) step ([[STEP]]) {
+  // CHECK-NEXT: [[INDEX:%.*]] = addi [[POINT]], [[TILE]] : index
+  // CHECK-NEXT: [[VALUE:%.*]] = vector.broadcast %{{.*}} : f64 to vector<4xf64>
+  // CHECK-NEXT: vector.transfer_write [[VALUE]], %{{.*}}{{\[}}[[INDEX]]]
+  //      CHECK: scf.parallel ([[REMAINDER:%.*]]) = ([[VECTORUB]]) to ([[UB]]) step (%{{.*}}) {
+  // CHECK-NEXT: [[INDEX:%.*]] = addi [[REMAINDER]], [[TILE]] : index
+  // CHECK-NEXT: store %{{.*}}, %{{.*}}{{\[}}[[INDEX]]] : memref<16xf64>
+  scf.parallel (%arg1) = (%c0) to (%c16) step (%c6) {
+    %0 = affine.min #map(%c6, %c16, %arg1)
+    scf.parallel (%arg2) = (%c0) to (%0) step (%c1) {
+      %1 = addi %arg2, %arg1 : index
+      store %cst, %arg0[%1] : memref<16xf64>
+      scf.yield
+    }
+    scf.yield
+  }
+  return
+}
@@ -0,0 +1,36 @@
+// RUN: oec-opt %s -stencil-caller-stream-entry-points | FileCheck %s
+
+module {
+  llvm.func @mgpuStreamCreate() -> !llvm.ptr<i8>
+  llvm.func @mgpuStreamSynchronize(!llvm.ptr<i8>)
+  llvm.func @mgpuStreamDestroy(!llvm.ptr<i8>)
+  llvm.func @launch(!llvm.ptr<i8>, !llvm.ptr<double>)
+
+  llvm.func @laplace(%arg0: !llvm.ptr<double>, %arg1: !llvm.ptr<double>, %arg2: !llvm.i64, %arg3: !llvm.i64, %arg4: !llvm.i64, %arg5: !llvm.i64, %arg6: !llvm.i64, %arg7: !llvm.i64, %arg8: !llvm.i64) {
+    %0 = llvm.call @mgpuStreamCreate() : () -> !llvm.ptr<i8>
+    llvm.call @launch(%0, %arg1) : (!llvm.ptr<i8>, !llvm.ptr<double>) -> ()
+    llvm.call @mgpuStreamSynchronize(%0) : (!llvm.ptr<i8>) -> ()
+    llvm.call @mgpuStreamDestroy(%0) : (!llvm.ptr<i8>) -> ()
+    llvm.return
+  }
+
+  llvm.func @_mlir_ciface_laplace(%arg0: !llvm.ptr<struct<(ptr<double>, ptr<double>, i64, array<3 x i64>, array<3 x i64>)>>) {
+    llvm.return
+  }
+}
+
+// The clone of the host function executes the kernels on the caller stream
+// CHECK-LABEL: llvm.func @laplace_on_stream
+//  CHECK-SAME: %{{.*}}: !llvm.i64, [[STREAM:%[a-z0-9]+]]: !llvm.ptr<i8>)
+//   CHECK-NOT: mgpuStreamCreate
+//       CHECK: llvm.call @launch([[STREAM]], %{{.*}})
+//   CHECK-NOT: mgpuStreamSynchronize
+//   CHECK-NOT: mgpuStreamDestroy
+//       CHECK: llvm.return
+
+// The entry point builds the descriptor from the pointer, sizes, and strides
+// CHECK-LABEL: llvm.func @laplace_async
+//  CHECK-SAME: ([[PTR:%[a-z0-9]+]]: !llvm.ptr<double>, [[S0:%[a-z0-9]+]]: !llvm.i64, [[S1:%[a-z0-9]+]]: !llvm.i64, [[S2:%[a-z0-9]+]]: !llvm.i64, [[T0:%[a-z0-9]+]]: !llvm.i64, [[T1:%[a-z0-9]+]]: !llvm.i64, [[T2:%[a-z0-9]+]]: !llvm.i64, [[STREAM:%[a-z0-9]+]]: !llvm.ptr<i8>)
+//  CHECK-NEXT: [[ZERO:%[a-z0-9]+]] = llvm.mlir.constant(0 : i64) : !llvm.i64
+//  CHECK-NEXT: llvm.call @laplace_on_stream([[PTR]], [[PTR]], [[ZERO]], [[S0]], [[S1]], [[S2]], [[T0]], [[T1]], [[T2]], [[STREAM]])
+//  CHECK-NEXT: llvm.return
@@ -0,0 +1,49 @@
+// RUN: oec-opt %s -split-input-file -verify-diagnostics -stencil-kernel-launch-bounds='wavefront-size=32 workgroup-memory-size=1024' | FileCheck %s
+
+module attributes {gpu.container_module} {
+  gpu.module @kernels {
+    // The kernels are annotated with the maximal number of threads
+    // CHECK-LABEL: gpu.func @aligned
+    //  CHECK-SAME: stencil.max_threads = 64 : i64
+    gpu.func @aligned(%arg0: memref<8xf64>) kernel {
+      gpu.return
+    }
+    // CHECK-LABEL: gpu.func @unaligned
+    //  CHECK-SAME: stencil.max_threads = 24 : i64
+    gpu.func @unaligned(%arg0: memref<8xf64>) kernel {
+      gpu.return
+    }
+    // Kernels launched with a dynamic block size keep the default bounds
+    // CHECK-LABEL: gpu.func @dynamic
+    //   CHECK-NOT: stencil.max_threads
+    gpu.func @dynamic(%arg0: memref<8xf64>) kernel {
+      gpu.return
+    }
+  }
+
+  func @launches(%arg0: memref<8xf64>, %arg1: index) {
+    %c1 = constant 1 : index
+    %c4 = constant 4 : index
+    %c6 = constant 6 : index
+    %c8 = constant 8 : index
+    %c16 = constant 16 : index
+    gpu.launch_func @kernels::@aligned blocks in (%c1, %c1, %c1) threads in (%c8, %c4, %c1) args(%arg0 : memref<8xf64>)
+    gpu.launch_func @kernels::@aligned blocks in (%c1, %c1, %c1) threads in (%c16, %c4, %c1) args(%arg0 : memref<8xf64>)
+    // expected-warning @+1 {{the block size 24 is not a multiple of the wavefront size 32}}
+    gpu.launch_func @kernels::@unaligned blocks in (%c1, %c1, %c1) threads in (%c6, %c4, %c1) args(%arg0 : memref<8xf64>)
+    gpu.launch_func @kernels::@dynamic blocks in (%c1, %c1, %c1) threads in (%c8, %c4, %c1) args(%arg0 : memref<8xf64>)
+    gpu.launch_func @kernels::@dynamic blocks in (%c1, %c1, %c1) threads in (%arg1, %c4, %c1) args(%arg0 : memref<8xf64>)
+    return
+  }
+}
+
+// -----
+
+module attributes {gpu.container_module} {
+  gpu.module @kernels {
+    // expected-error @+1 {{allocates 2048 bytes of workgroup memory exceeding the 1024 bytes of the target}}
+    gpu.func @oversized(%arg0: memref<8xf64>) workgroup(%arg1 : memref<256xf64, 3>) kernel {
+      gpu.return
+    }
+  }
+}
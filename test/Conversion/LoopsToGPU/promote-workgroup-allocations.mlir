@@ -0,0 +1,19 @@
+// RUN: oec-opt %s -pass-pipeline='gpu.module(stencil-promote-workgroup-allocations)' | FileCheck %s
+
+module attributes {gpu.container_module} {
+  gpu.module @kernels {
+    // CHECK-LABEL: gpu.func @staged
+    //  CHECK-SAME: workgroup([[BUFFER:%.*]] : memref<1x2x6xf64, 3>)
+    //   CHECK-NOT: alloc
+    //       CHECK: store %{{.*}}, [[BUFFER]][%{{.*}}, %{{.*}}, %{{.*}}] : memref<1x2x6xf64, 3>
+    //       CHECK: alloc(%{{.*}}) : memref<?xf64, 3>
+    gpu.func @staged(%arg0: memref<8x8x8xf64>, %arg1: index) kernel {
+      %c0 = constant 0 : index
+      %0 = alloc() : memref<1x2x6xf64, 3>
+      %1 = load %arg0[%c0, %c0, %c0] : memref<8x8x8xf64>
+      store %1, %0[%c0, %c0, %c0] : memref<1x2x6xf64, 3>
+      %2 = alloc(%arg1) : memref<?xf64, 3>
+      gpu.return
+    }
+  }
+}
@@ -0,0 +1,73 @@
+// RUN: oec-opt %s -stencil-stream-assignment | FileCheck %s
+
+module attributes {gpu.container_module} {
+  gpu.module @kernels {
+    gpu.func @write(%arg0: memref<8xf64>) kernel {
+      %c0 = constant 0 : index
+      %cst = constant 1.0 : f64
+      store %cst, %arg0[%c0] : memref<8xf64>
+      gpu.return
+    }
+    gpu.func @copy(%arg0: memref<8xf64>, %arg1: memref<8xf64>) kernel {
+      %c0 = constant 0 : index
+      %0 = load %arg0[%c0] : memref<8xf64>
+      store %0, %arg1[%c0] : memref<8xf64>
+      gpu.return
+    }
+  }
+
+  // CHECK-LABEL: func @streams
+  func @streams(%arg0: memref<8xf64>, %arg1: memref<8xf64>, %arg2: memref<8xf64>) -> f64 {
+    %c0 = constant 0 : index
+    %c1 = constant 1 : index
+    // Independent kernels start separate streams
+    //      CHECK: [[T0:%.*]] = gpu.wait async
+    // CHECK-NEXT: [[T1:%.*]] = gpu.launch_func async {{\[}}[[T0]]] @kernels::@write {{.*}} args(%arg0 : memref<8xf64>)
+    // CHECK-NEXT: [[T2:%.*]] = gpu.wait async
+    // CHECK-NEXT: [[T3:%.*]] = gpu.launch_func async {{\[}}[[T2]]] @kernels::@write {{.*}} args(%arg1 : memref<8xf64>)
+    gpu.launch_func @kernels::@write blocks in (%c1, %c1, %c1) threads in (%c1, %c1, %c1) args(%arg0 : memref<8xf64>)
+    gpu.launch_func @kernels::@write blocks in (%c1, %c1, %c1) threads in (%c1, %c1, %c1) args(%arg1 : memref<8xf64>)
+    // A kernel depending on the latest token of one stream continues it
+    // CHECK-NEXT: [[T4:%.*]] = gpu.launch_func async {{\[}}[[T1]]] @kernels::@copy {{.*}} args(%arg0 : memref<8xf64>, %arg2 : memref<8xf64>)
+    gpu.launch_func @kernels::@copy blocks in (%c1, %c1, %c1) threads in (%c1, %c1, %c1) args(%arg0 : memref<8xf64>, %arg2 : memref<8xf64>)
+    // A kernel depending on multiple streams starts a new stream that waits
+    // for the producer of %arg1 and the previous writer of %arg2
+    // CHECK-NEXT: [[T5:%.*]] = gpu.wait async {{\[}}[[T3]], [[T4]]]
+    // CHECK-NEXT: [[T6:%.*]] = gpu.launch_func async {{\[}}[[T5]]] @kernels::@copy {{.*}} args(%arg1 : memref<8xf64>, %arg2 : memref<8xf64>)
+    gpu.launch_func @kernels::@copy blocks in (%c1, %c1, %c1) threads in (%c1, %c1, %c1) args(%arg1 : memref<8xf64>, %arg2 : memref<8xf64>)
+    // A host access synchronizes only the streams accessing the buffer
+    // CHECK-NEXT: gpu.wait {{\[}}[[T4]]]
+    // CHECK-NEXT: load %arg0
+    %0 = load %arg0[%c0] : memref<8xf64>
+    // CHECK-NEXT: gpu.wait {{\[}}[[T3]], [[T6]]]
+    // CHECK-NEXT: return
+    return %0 : f64
+  }
+
+  // The allocations return the async token after the memref
+  // CHECK-LABEL: func @temporary
+  //       CHECK: [[T0:%.*]] = gpu.wait async
+  //  CHECK-NEXT: [[BUFFER:%.*]], [[T1:%.*]] = gpu.alloc async {{\[}}[[T0]]] () : memref<8xf64>
+  //  CHECK-NEXT: gpu.wait {{\[}}[[T1]]]
+  //  CHECK-NEXT: [[T2:%.*]] = gpu.wait async
+  //  CHECK-NEXT: gpu.launch_func async {{\[}}[[T2]]] @kernels::@write {{.*}} args([[BUFFER]] : memref<8xf64>)
+  func @temporary(%arg0: memref<8xf64>) {
+    %c1 = constant 1 : index
+    %0 = gpu.alloc () : memref<8xf64>
+    gpu.launch_func @kernels::@write blocks in (%c1, %c1, %c1) threads in (%c1, %c1, %c1) args(%0 : memref<8xf64>)
+    gpu.launch_func @kernels::@copy blocks in (%c1, %c1, %c1) threads in (%c1, %c1, %c1) args(%0 : memref<8xf64>, %arg0 : memref<8xf64>)
+    return
+  }
+
+  // CHECK-LABEL: func @async
+  //  CHECK-NEXT: constant
+  //  CHECK-NEXT: gpu.wait async
+  //  CHECK-NEXT: gpu.launch_func async
+  //  CHECK-NEXT: return
+  func @async(%arg0: memref<8xf64>) {
+    %c1 = constant 1 : index
+    %0 = gpu.wait async
+    %1 = gpu.launch_func async [%0] @kernels::@write blocks in (%c1, %c1, %c1) threads in (%c1, %c1, %c1) args(%arg0 : memref<8xf64>)
+    return
+  }
+}
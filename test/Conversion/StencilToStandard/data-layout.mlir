@@ -0,0 +1,52 @@
+// RUN: oec-opt %s -split-input-file --convert-stencil-to-std='dimension-order=kij' | FileCheck %s
+// RUN: oec-opt %s -split-input-file --convert-stencil-to-std='leading-dim-alignment=64' | FileCheck --check-prefix=PAD %s
+// RUN: oec-opt %s -split-input-file --convert-stencil-to-std='dimension-order=kij leading-dim-alignment=64' | FileCheck --check-prefix=KIJPAD %s
+
+// CHECK-LABEL: @cast_layout
+// PAD-LABEL: @cast_layout
+func @cast_layout(%arg0: !stencil.field<?x?x?xf64>) attributes {stencil.program} {
+  // CHECK: %{{.*}} = memref_cast %{{.*}} : memref<?x?x?xf64> to memref<77x7x777xf64>
+  // PAD: %{{.*}} = memref_cast %{{.*}} : memref<?x?x?xf64> to memref<777x77x7xf64>
+  %0 = stencil.cast %arg0 ([0, 0, 0]:[7, 77, 777]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<7x77x777xf64>
+  return
+}
+
+// -----
+
+// CHECK-LABEL: @load_layout
+func @load_layout(%arg0: !stencil.field<?x?x?xf64>) attributes {stencil.program} {
+  %0 = stencil.cast %arg0 ([0, 0, 0]:[11, 12, 13]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<11x12x13xf64>
+  // CHECK: %{{.*}} = subview %{{.*}}[2, 1, 3] [9, 9, 9] [1, 1, 1] : memref<12x11x13xf64> to memref<9x9x9xf64, #map{{[0-9]*}}>
+  %1 = stencil.load %0 ([1, 2, 3]:[10, 11, 12]) : (!stencil.field<11x12x13xf64>) -> !stencil.temp<9x9x9xf64>
+  return
+}
+
+// -----
+
+// CHECK: [[MAP1:#map[0-9]*]] = affine_map<(d0, d1) -> (d0 + d1)>
+
+// CHECK-LABEL: @buffer_layout
+// PAD-LABEL: @buffer_layout
+// KIJPAD-LABEL: @buffer_layout
+func @buffer_layout(%arg0 : f64) attributes {stencil.program} {
+  // CHECK: [[TEMP:%.*]] = gpu.alloc () : memref<6x4x10xf64>
+  // PAD: [[TEMP:%.*]] = gpu.alloc () : memref<10x6x8xf64>
+  // KIJPAD: [[TEMP:%.*]] = gpu.alloc () : memref<6x4x16xf64>
+  // CHECK: scf.parallel
+  %0 = stencil.apply (%arg1 = %arg0 : f64) -> !stencil.temp<4x6x10xf64> {
+    // CHECK-DAG: [[C0:%.*]] = constant 0 : index
+    // CHECK-DAG: [[C1:%.*]] = constant 1 : index
+    // CHECK-DAG: [[C2:%.*]] = constant 2 : index
+    // CHECK-DAG: [[IDX0:%.*]] = affine.apply [[MAP1]](%{{.*}}, [[C0]])
+    // CHECK-DAG: [[IDX1:%.*]] = affine.apply [[MAP1]](%{{.*}}, [[C1]])
+    // CHECK-DAG: [[IDX2:%.*]] = affine.apply [[MAP1]](%{{.*}}, [[C2]])
+    // CHECK: store %{{.*}}, [[TEMP]]{{\[}}[[IDX1]], [[IDX0]], [[IDX2]]] : memref<6x4x10xf64>
+    // PAD: store %{{.*}}, [[TEMP]]{{\[}}%{{.*}}, %{{.*}}, %{{.*}}] : memref<10x6x8xf64>
+    %1 = stencil.store_result %arg1 : (f64) -> !stencil.result<f64>
+    stencil.return %1 : !stencil.result<f64>
+  } to ([0, -1, -2]:[4, 5, 8])
+  %1 = stencil.buffer %0([0, -1, -2]:[4, 5, 8]) : (!stencil.temp<4x6x10xf64>) -> !stencil.temp<4x6x10xf64>
+  // CHECK: gpu.dealloc [[TEMP]] : memref<6x4x10xf64>
+  // PAD: gpu.dealloc [[TEMP]] : memref<10x6x8xf64>
+  return
+}
@@ -0,0 +1,42 @@
+// RUN: oec-opt %s -split-input-file --convert-stencil-to-std='ensemble-size=16' | FileCheck %s
+
+// CHECK-LABEL: @ensemble_cast
+// CHECK: (%{{.*}}: memref<?x?x?x?xf64>) {
+func @ensemble_cast(%arg0: !stencil.field<?x?x?xf64>) attributes {stencil.program} {
+  // CHECK: %{{.*}} = memref_cast %{{.*}} : memref<?x?x?x?xf64> to memref<16x777x77x7xf64>
+  %0 = stencil.cast %arg0 ([0, 0, 0]:[7, 77, 777]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<7x77x777xf64>
+  return
+}
+
+// -----
+
+// CHECK: [[MAP0:#map[0-9]*]] = affine_map<(d0) -> (d0)>
+// CHECK: [[MAP1:#map[0-9]*]] = affine_map<(d0, d1) -> (d0 + d1)>
+
+// CHECK-LABEL: @ensemble_access
+func @ensemble_access(%arg0: !stencil.field<?x?x?xf64>) attributes {stencil.program} {
+  %0 = stencil.cast %arg0 ([0, 0, 0]:[10, 10, 10]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<10x10x10xf64>
+  // CHECK: [[VIEW:%.*]] = subview %{{.*}}[0, 0, 0, 0] [16, 10, 10, 10] [1, 1, 1, 1]
+  %1 = stencil.load %0 ([0, 0, 0]:[10, 10, 10]) : (!stencil.field<10x10x10xf64>) -> !stencil.temp<10x10x10xf64>
+  // CHECK: [[TEMP:%.*]] = gpu.alloc () : memref<16x7x7x7xf64>
+  // CHECK-DAG: [[C16:%.*]] = constant 16 : index
+  // CHECK: scf.parallel ([[ARG0:%.*]], [[ARG1:%.*]], [[ARG2:%.*]], [[MEMBER:%.*]]) = ({{.*}}) to ({{.*}}, {{.*}}, {{.*}}, [[C16]]) step ({{.*}}) {
+  %2 = stencil.apply (%arg1 = %1 : !stencil.temp<10x10x10xf64>) -> !stencil.temp<7x7x7xf64> {
+    // CHECK-DAG: [[IV0:%.*]] = affine.apply [[MAP0]]([[ARG0]])
+    // CHECK-DAG: [[IV1:%.*]] = affine.apply [[MAP0]]([[ARG1]])
+    // CHECK-DAG: [[IV2:%.*]] = affine.apply [[MAP0]]([[ARG2]])
+    // CHECK-DAG: [[C0:%.*]] = constant 0 : index
+    // CHECK-DAG: [[O0:%.*]] = affine.apply [[MAP1]]([[IV0]], [[C0]])
+    // CHECK-DAG: [[C1:%.*]] = constant 1 : index
+    // CHECK-DAG: [[O1:%.*]] = affine.apply [[MAP1]]([[IV1]], [[C1]])
+    // CHECK-DAG: [[C2:%.*]] = constant 2 : index
+    // CHECK-DAG: [[O2:%.*]] = affine.apply [[MAP1]]([[IV2]], [[C2]])
+    // CHECK: [[VALUE:%.*]] = load [[VIEW]]{{\[}}[[MEMBER]], [[O2]], [[O1]], [[O0]]{{[]]}}
+    // CHECK: store [[VALUE]], [[TEMP]]{{\[}}[[MEMBER]], %{{.*}}, %{{.*}}, %{{.*}}{{[]]}} : memref<16x7x7x7xf64>
+    %4 = stencil.access %arg1[0, 1, 2] : (!stencil.temp<10x10x10xf64>) -> f64
+    %5 = stencil.store_result %4 : (f64) -> !stencil.result<f64>
+    stencil.return %5 : !stencil.result<f64>
+  } to ([0, 0, 0]:[7, 7, 7])
+  %3 = stencil.buffer %2([0, 0, 0]:[7, 7, 7]) : (!stencil.temp<7x7x7xf64>) -> !stencil.temp<7x7x7xf64>
+  return
+}
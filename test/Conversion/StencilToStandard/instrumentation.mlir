@@ -0,0 +1,35 @@
+// RUN: oec-opt %s --convert-stencil-to-std --stencil-instrument | FileCheck %s
+
+// CHECK-DAG: func private @oecProfilerBegin(!llvm.ptr<i8>, i64)
+// CHECK-DAG: func private @oecProfilerEnd(!llvm.ptr<i8>)
+// CHECK-DAG: llvm.mlir.global internal constant @oec_kernel_name0("laplace/apply0 ({{.*}}instrumentation.mlir:{{[0-9]+}}:{{[0-9]+}})\00")
+// CHECK-DAG: llvm.mlir.global internal constant @oec_kernel_name1("laplace/apply1 ({{.*}}instrumentation.mlir:{{[0-9]+}}:{{[0-9]+}})\00")
+
+// CHECK-LABEL: @laplace
+func @laplace(%arg0: !stencil.field<?x?x?xf64>, %arg1: !stencil.field<?x?x?xf64>) attributes {stencil.program} {
+  %0 = stencil.cast %arg0([-1, -1, 0] : [65, 65, 60]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<66x66x60xf64>
+  %1 = stencil.cast %arg1([-1, -1, 0] : [65, 65, 60]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<66x66x60xf64>
+  %2 = stencil.load %0([-1, -1, 0] : [65, 65, 60]) : (!stencil.field<66x66x60xf64>) -> !stencil.temp<66x66x60xf64>
+  // CHECK: [[NAME0:%.*]] = llvm.getelementptr
+  // CHECK: [[BYTES0:%.*]] = constant 3932160 : i64
+  // CHECK: call @oecProfilerBegin([[NAME0]], [[BYTES0]]) : (!llvm.ptr<i8>, i64) -> ()
+  // CHECK-NEXT: scf.parallel
+  %3 = stencil.apply (%arg2 = %2 : !stencil.temp<66x66x60xf64>) -> !stencil.temp<64x64x60xf64> {
+    %5 = stencil.access %arg2 [-1, 0, 0] : (!stencil.temp<66x66x60xf64>) -> f64
+    %6 = stencil.access %arg2 [1, 0, 0] : (!stencil.temp<66x66x60xf64>) -> f64
+    %7 = addf %5, %6 : f64
+    %8 = stencil.store_result %7 : (f64) -> !stencil.result<f64>
+    stencil.return %8 : !stencil.result<f64>
+  } to ([0, 0, 0] : [64, 64, 60])
+  // CHECK: call @oecProfilerEnd([[NAME0]]) : (!llvm.ptr<i8>) -> ()
+  // CHECK: [[NAME1:%.*]] = llvm.getelementptr
+  // CHECK: call @oecProfilerBegin([[NAME1]], %{{.*}}) : (!llvm.ptr<i8>, i64) -> ()
+  %4 = stencil.apply (%arg2 = %3 : !stencil.temp<64x64x60xf64>) -> !stencil.temp<64x64x60xf64> {
+    %5 = stencil.access %arg2 [0, 0, 0] : (!stencil.temp<64x64x60xf64>) -> f64
+    %6 = stencil.store_result %5 : (f64) -> !stencil.result<f64>
+    stencil.return %6 : !stencil.result<f64>
+  } to ([0, 0, 0] : [64, 64, 60])
+  // CHECK: call @oecProfilerEnd([[NAME1]]) : (!llvm.ptr<i8>) -> ()
+  stencil.store %4 to %1([0, 0, 0] : [64, 64, 60]) : !stencil.temp<64x64x60xf64> to !stencil.field<66x66x60xf64>
+  return
+}
@@ -0,0 +1,54 @@
+// RUN: oec-opt %s -split-input-file --stencil-memory-planning | FileCheck %s
+// RUN: oec-opt %s -split-input-file --stencil-memory-planning='workspace-arg=true' | FileCheck %s --check-prefix=WORKSPACE
+
+// CHECK-LABEL: func @disjoint_lifetimes
+// WORKSPACE-LABEL: func @disjoint_lifetimes
+// WORKSPACE-SAME: %{{.*}}: memref<6144xi8> {stencil.workspace}
+func @disjoint_lifetimes(%arg0: f64) {
+  // CHECK: [[ARENA:%.*]] = gpu.alloc () : memref<6144xi8>
+  // WORKSPACE-NOT: gpu.alloc
+  %c0 = constant 0 : index
+  // CHECK: view [[ARENA]]{{\[}}%{{.*}}][] : memref<6144xi8> to memref<8x8x8xf64>
+  %0 = gpu.alloc () : memref<8x8x8xf64>
+  store %arg0, %0[%c0, %c0, %c0] : memref<8x8x8xf64>
+  // CHECK: [[OFF1:%.*]] = constant 4096 : index
+  // CHECK: view [[ARENA]]{{\[}}[[OFF1]]][] : memref<6144xi8> to memref<8x8xf64>
+  %1 = gpu.alloc () : memref<8x8xf64>
+  store %arg0, %1[%c0, %c0] : memref<8x8xf64>
+  gpu.dealloc %1 : memref<8x8xf64>
+  // CHECK: [[OFF2:%.*]] = constant 4096 : index
+  // CHECK: view [[ARENA]]{{\[}}[[OFF2]]][] : memref<6144xi8> to memref<4x8x8xf64>
+  %2 = gpu.alloc () : memref<4x8x8xf64>
+  store %arg0, %2[%c0, %c0, %c0] : memref<4x8x8xf64>
+  gpu.dealloc %2 : memref<4x8x8xf64>
+  gpu.dealloc %0 : memref<8x8x8xf64>
+  // CHECK-NOT: gpu.dealloc %{{.*}} : memref<{{.*}}xf64>
+  // CHECK: gpu.dealloc [[ARENA]] : memref<6144xi8>
+  // WORKSPACE-NOT: gpu.dealloc
+  return
+}
+
+// -----
+
+// Functions with callers keep the arena allocation to match their calls
+// WORKSPACE-LABEL: func @callee
+// WORKSPACE-SAME: (%{{.*}}: f64) {
+// WORKSPACE: [[ARENA:%.*]] = gpu.alloc () : memref<512xi8>
+// WORKSPACE: gpu.dealloc [[ARENA]] : memref<512xi8>
+func @callee(%arg0: f64) {
+  %c0 = constant 0 : index
+  %0 = gpu.alloc () : memref<8x8xf64>
+  store %arg0, %0[%c0, %c0] : memref<8x8xf64>
+  gpu.dealloc %0 : memref<8x8xf64>
+  %1 = gpu.alloc () : memref<8x8xf64>
+  store %arg0, %1[%c0, %c0] : memref<8x8xf64>
+  gpu.dealloc %1 : memref<8x8xf64>
+  return
+}
+
+// WORKSPACE-LABEL: func @caller
+// WORKSPACE-NEXT: call @callee(%{{.*}}) : (f64) -> ()
+func @caller(%arg0: f64) {
+  call @callee(%arg0) : (f64) -> ()
+  return
+}
@@ -0,0 +1,97 @@
+// RUN: oec-opt %s -split-input-file --convert-stencil-to-std | FileCheck %s
+
+// CHECK-LABEL: @reduce_column
+func @reduce_column(%arg0: !stencil.field<?x?x?xf64>, %arg1: !stencil.field<?x?x0xf64>) attributes {stencil.program} {
+  %0 = stencil.cast %arg0 ([0, 0, 0]:[10, 10, 10]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<10x10x10xf64>
+  %1 = stencil.cast %arg1 ([0, 0, 0]:[10, 10, 10]) : (!stencil.field<?x?x0xf64>) -> !stencil.field<10x10x0xf64>
+  %2 = stencil.load %0 ([0, 0, 0]:[8, 8, 8]) : (!stencil.field<10x10x10xf64>) -> !stencil.temp<8x8x8xf64>
+  // CHECK: [[VIEW:%.*]] = subview %{{.*}}[0, 0] [8, 8] [1, 1] : memref<10x10xf64> to memref<8x8xf64, #map{{[0-9]*}}>
+  // CHECK: [[ZERO:%.*]] = constant 0.000000e+00 : f64
+  // CHECK: scf.parallel
+  // CHECK-NEXT: store [[ZERO]], [[VIEW]]{{\[}}%{{.*}}, %{{.*}}]
+  // Accumulate the column of every thread and combine it once
+  // CHECK: scf.parallel
+  // CHECK: [[ACC:%.*]] = alloca() : memref<f64>
+  // CHECK-NEXT: [[INIT:%.*]] = constant 0.000000e+00 : f64
+  // CHECK-NEXT: store [[INIT]], [[ACC]][] : memref<f64>
+  // CHECK-NEXT: scf.for
+  %3 = stencil.apply (%arg2 = %2 : !stencil.temp<8x8x8xf64>) -> !stencil.temp<8x8x8xf64> {
+    // CHECK: [[VALUE:%.*]] = load
+    // CHECK: [[CURRENT:%.*]] = load [[ACC]][] : memref<f64>
+    // CHECK-NEXT: [[SUM:%.*]] = addf [[VALUE]], [[CURRENT]] : f64
+    // CHECK-NEXT: store [[SUM]], [[ACC]][] : memref<f64>
+    // CHECK-NOT: atomic_rmw
+    // CHECK: [[PARTIAL:%.*]] = load [[ACC]][] : memref<f64>
+    // CHECK: atomic_rmw "addf" [[PARTIAL]], [[VIEW]]{{\[}}%{{.*}}, %{{.*}}]
+    // CHECK-NOT: gpu.alloc
+    %4 = stencil.access %arg2[0, 0, 0] : (!stencil.temp<8x8x8xf64>) -> f64
+    %5 = stencil.store_result %4 : (f64) -> !stencil.result<f64>
+    stencil.return %5 : !stencil.result<f64>
+  } to ([0, 0, 0]:[8, 8, 8])
+  stencil.reduce "add" %3 to %1 ([0, 0, 0]:[8, 8, 8]) : !stencil.temp<8x8x8xf64> to !stencil.field<10x10x0xf64>
+  return
+}
+
+// -----
+
+// CHECK-LABEL: @reduce_global
+func @reduce_global(%arg0: !stencil.field<?x?x?xf64>, %arg1: !stencil.field<0x0x0xf64>) attributes {stencil.program} {
+  %0 = stencil.cast %arg0 ([0, 0, 0]:[10, 10, 10]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<10x10x10xf64>
+  // CHECK: [[OUT:%.*]] = memref_cast %{{.*}} : memref<f64> to memref<f64>
+  %1 = stencil.cast %arg1 ([0, 0, 0]:[10, 10, 10]) : (!stencil.field<0x0x0xf64>) -> !stencil.field<0x0x0xf64>
+  %2 = stencil.load %0 ([0, 0, 0]:[8, 8, 8]) : (!stencil.field<10x10x10xf64>) -> !stencil.temp<8x8x8xf64>
+  // CHECK: [[INF:%.*]] = constant 0xFFF0000000000000 : f64
+  // CHECK-NEXT: store [[INF]], [[OUT]][] : memref<f64>
+  // CHECK: scf.parallel
+  // CHECK: [[ACC:%.*]] = alloca() : memref<f64>
+  // CHECK-NEXT: [[INIT:%.*]] = constant 0xFFF0000000000000 : f64
+  // CHECK-NEXT: store [[INIT]], [[ACC]][] : memref<f64>
+  // CHECK-NEXT: scf.for
+  %3 = stencil.apply (%arg2 = %2 : !stencil.temp<8x8x8xf64>) -> !stencil.temp<8x8x8xf64> {
+    // CHECK: [[VALUE:%.*]] = load
+    // CHECK: [[CURRENT:%.*]] = load [[ACC]][] : memref<f64>
+    // CHECK-NEXT: [[CMP:%.*]] = cmpf "ogt", [[VALUE]], [[CURRENT]] : f64
+    // CHECK-NEXT: [[MAX:%.*]] = select [[CMP]], [[VALUE]], [[CURRENT]] : f64
+    // CHECK-NEXT: store [[MAX]], [[ACC]][] : memref<f64>
+    // CHECK-NOT: generic_atomic_rmw
+    // CHECK: [[PARTIAL:%.*]] = load [[ACC]][] : memref<f64>
+    // CHECK-NEXT: generic_atomic_rmw [[OUT]][] : memref<f64> {
+    // CHECK-NEXT: ^bb0([[OLD:%.*]]: f64):
+    // CHECK-NEXT: [[CMP:%.*]] = cmpf "ogt", [[PARTIAL]], [[OLD]] : f64
+    // CHECK-NEXT: [[MAX:%.*]] = select [[CMP]], [[PARTIAL]], [[OLD]] : f64
+    // CHECK-NEXT: atomic_yield [[MAX]] : f64
+    // CHECK-NOT: gpu.alloc
+    %4 = stencil.access %arg2[0, 0, 0] : (!stencil.temp<8x8x8xf64>) -> f64
+    %5 = stencil.store_result %4 : (f64) -> !stencil.result<f64>
+    stencil.return %5 : !stencil.result<f64>
+  } to ([0, 0, 0]:[8, 8, 8])
+  stencil.reduce "max" %3 to %1 ([0, 0, 0]:[8, 8, 8]) : !stencil.temp<8x8x8xf64> to !stencil.field<0x0x0xf64>
+  return
+}
+
+// -----
+
+// CHECK-LABEL: @scan_column
+func @scan_column(%arg0: !stencil.field<?x?x?xf64>, %arg1: !stencil.field<?x?x?xf64>) attributes {stencil.program} {
+  %0 = stencil.cast %arg0 ([0, 0, 0]:[10, 10, 10]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<10x10x10xf64>
+  %1 = stencil.cast %arg1 ([0, 0, 0]:[10, 10, 10]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<10x10x10xf64>
+  %2 = stencil.load %0 ([0, 0, 0]:[8, 8, 8]) : (!stencil.field<10x10x10xf64>) -> !stencil.temp<8x8x8xf64>
+  // CHECK: [[TEMP:%.*]] = gpu.alloc () : memref<8x8x8xf64>
+  // CHECK: scf.parallel
+  // CHECK: store %{{.*}}, [[TEMP]]
+  %3 = stencil.apply (%arg2 = %2 : !stencil.temp<8x8x8xf64>) -> !stencil.temp<8x8x8xf64> {
+    %4 = stencil.access %arg2[0, 0, 0] : (!stencil.temp<8x8x8xf64>) -> f64
+    %5 = stencil.store_result %4 : (f64) -> !stencil.result<f64>
+    stencil.return %5 : !stencil.result<f64>
+  } to ([0, 0, 0]:[8, 8, 8])
+  // CHECK: [[VIEW:%.*]] = subview %{{.*}}[0, 0, 0] [8, 8, 8] [1, 1, 1] : memref<10x10x10xf64> to memref<8x8x8xf64, #map{{[0-9]*}}>
+  // CHECK: scf.parallel ([[J:%.*]], [[I:%.*]]) =
+  // CHECK: scf.for [[K:%.*]] = %{{.*}} to %{{.*}} step %{{.*}} iter_args([[ACC:%.*]] = %{{.*}}) -> (f64) {
+  // CHECK-NEXT: [[VALUE:%.*]] = load [[TEMP]]{{\[}}[[K]], [[J]], [[I]]] : memref<8x8x8xf64>
+  // CHECK-NEXT: [[SUM:%.*]] = addf [[ACC]], [[VALUE]] : f64
+  // CHECK-NEXT: store [[SUM]], [[VIEW]]{{\[}}[[K]], [[J]], [[I]]]
+  // CHECK-NEXT: scf.yield [[SUM]] : f64
+  // CHECK: gpu.dealloc [[TEMP]] : memref<8x8x8xf64>
+  stencil.scan "add" %3 along 2 to %1 ([0, 0, 0]:[8, 8, 8]) : !stencil.temp<8x8x8xf64> to !stencil.field<10x10x10xf64>
+  return
+}
@@ -0,0 +1,18 @@
+// RUN: oec-opt %s --stencil-summary='label=input' --convert-stencil-to-std --stencil-summary='label=lowered' -o /dev/null 2>&1 | FileCheck %s
+
+// CHECK: {"label":"input","function":"laplace","applies":1,"accesses":2,"dyn_accesses":0,"buffers":0,"stores":1,"unrolled":0,"max_unroll":1,"temp_bytes":262144,"allocs":0,"alloc_bytes":0,"parallel_loops":0,"launches":0}
+// CHECK-NEXT: {"label":"lowered","function":"laplace","applies":0,"accesses":0,"dyn_accesses":0,"buffers":0,"stores":0,"unrolled":0,"max_unroll":1,"temp_bytes":0,"allocs":0,"alloc_bytes":0,"parallel_loops":1,"launches":0}
+func @laplace(%arg0: !stencil.field<?x?x?xf64>, %arg1: !stencil.field<?x?x?xf64>) attributes {stencil.program} {
+  %0 = stencil.cast %arg0([-4, -4, -4] : [36, 36, 36]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<40x40x40xf64>
+  %1 = stencil.cast %arg1([-4, -4, -4] : [36, 36, 36]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<40x40x40xf64>
+  %2 = stencil.load %0([-1, 0, 0] : [33, 32, 32]) : (!stencil.field<40x40x40xf64>) -> !stencil.temp<34x32x32xf64>
+  %3 = stencil.apply (%arg2 = %2 : !stencil.temp<34x32x32xf64>) -> !stencil.temp<32x32x32xf64> {
+    %4 = stencil.access %arg2 [-1, 0, 0] : (!stencil.temp<34x32x32xf64>) -> f64
+    %5 = stencil.access %arg2 [1, 0, 0] : (!stencil.temp<34x32x32xf64>) -> f64
+    %6 = addf %4, %5 : f64
+    %7 = stencil.store_result %6 : (f64) -> !stencil.result<f64>
+    stencil.return %7 : !stencil.result<f64>
+  } to ([0, 0, 0] : [32, 32, 32])
+  stencil.store %3 to %1([0, 0, 0] : [32, 32, 32]) : !stencil.temp<32x32x32xf64> to !stencil.field<40x40x40xf64>
+  return
+}
@@ -0,0 +1,47 @@
+// RUN: oec-opt %s -split-input-file --convert-stencil-to-std='vertical-caching=true' | FileCheck %s
+
+// CHECK-LABEL: @vertical_window
+func @vertical_window(%arg0: !stencil.field<?x?x?xf64>) attributes {stencil.program} {
+  %0 = stencil.cast %arg0 ([0, 0, -1]:[8, 8, 9]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<8x8x10xf64>
+  // CHECK: [[VIEW:%.*]] = subview
+  %1 = stencil.load %0 ([0, 0, -1]:[8, 8, 9]) : (!stencil.field<8x8x10xf64>) -> !stencil.temp<8x8x10xf64>
+  // CHECK: scf.parallel ([[I:%.*]], [[J:%.*]]) = ({{.*}}) to ({{.*}}) step ({{.*}}) {
+  // CHECK-COUNT-2: load [[VIEW]]
+  // CHECK: scf.for {{.*}} iter_args([[K0:%.*]] = %{{.*}}, [[K1:%.*]] = %{{.*}}) -> (f64, f64) {
+  %2 = stencil.apply (%arg1 = %1 : !stencil.temp<8x8x10xf64>) -> !stencil.temp<8x8x8xf64> {
+    // CHECK: [[K2:%.*]] = load [[VIEW]]
+    // CHECK-NOT: load [[VIEW]]
+    %3 = stencil.access %arg1[0, 0, -1] : (!stencil.temp<8x8x10xf64>) -> f64
+    %4 = stencil.access %arg1[0, 0, 0] : (!stencil.temp<8x8x10xf64>) -> f64
+    %5 = stencil.access %arg1[0, 0, 1] : (!stencil.temp<8x8x10xf64>) -> f64
+    // CHECK: addf [[K0]], [[K1]]
+    %6 = addf %3, %4 : f64
+    // CHECK: addf %{{.*}}, [[K2]]
+    %7 = addf %6, %5 : f64
+    // CHECK: store %{{.*}}, %{{.*}}[%{{.*}}, %{{.*}}, %{{.*}}] : memref<8x8x8xf64>
+    // CHECK: scf.yield [[K1]], [[K2]] : f64, f64
+    %8 = stencil.store_result %7 : (f64) -> !stencil.result<f64>
+    stencil.return %8 : !stencil.result<f64>
+  } to ([0, 0, 0]:[8, 8, 8])
+  %3 = stencil.buffer %2([0, 0, 0]:[8, 8, 8]) : (!stencil.temp<8x8x8xf64>) -> !stencil.temp<8x8x8xf64>
+  return
+}
+
+// -----
+
+// CHECK-LABEL: @horizontal_only
+func @horizontal_only(%arg0: !stencil.field<?x?x?xf64>) attributes {stencil.program} {
+  %0 = stencil.cast %arg0 ([-1, 0, 0]:[9, 8, 8]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<10x8x8xf64>
+  %1 = stencil.load %0 ([-1, 0, 0]:[9, 8, 8]) : (!stencil.field<10x8x8xf64>) -> !stencil.temp<10x8x8xf64>
+  // CHECK-NOT: scf.for
+  // CHECK: scf.parallel ({{.*}}, {{.*}}, {{.*}}) = ({{.*}}) to ({{.*}}) step ({{.*}}) {
+  %2 = stencil.apply (%arg1 = %1 : !stencil.temp<10x8x8xf64>) -> !stencil.temp<8x8x8xf64> {
+    %3 = stencil.access %arg1[-1, 0, 0] : (!stencil.temp<10x8x8xf64>) -> f64
+    %4 = stencil.access %arg1[1, 0, 0] : (!stencil.temp<10x8x8xf64>) -> f64
+    %5 = addf %3, %4 : f64
+    %6 = stencil.store_result %5 : (f64) -> !stencil.result<f64>
+    stencil.return %6 : !stencil.result<f64>
+  } to ([0, 0, 0]:[8, 8, 8])
+  %3 = stencil.buffer %2([0, 0, 0]:[8, 8, 8]) : (!stencil.temp<8x8x8xf64>) -> !stencil.temp<8x8x8xf64>
+  return
+}
@@ -0,0 +1,81 @@
+// RUN: oec-opt %s -split-input-file --convert-stencil-to-std='workgroup-tile-sizes=4,2,1' | FileCheck %s
+// RUN: oec-opt %s -split-input-file --convert-stencil-to-std='workgroup-tile-sizes=4,2,1 stage-dyn-access=true' | FileCheck --check-prefix=DYN %s
+// RUN: oec-opt %s -split-input-file --convert-stencil-to-std='workgroup-tile-sizes=4,2,1 workgroup-memory-size=64' | FileCheck --check-prefix=LDS %s
+
+// CHECK-LABEL: @staged_access
+// LDS-LABEL: @staged_access
+func @staged_access(%arg0: !stencil.field<?x?x?xf64>) attributes {stencil.program} {
+  %0 = stencil.cast %arg0 ([-1, 0, 0]:[9, 8, 8]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<10x8x8xf64>
+  // CHECK: [[VIEW:%.*]] = subview %{{.*}}[0, 0, 0] [8, 8, 10] [1, 1, 1]
+  %1 = stencil.load %0 ([-1, 0, 0]:[9, 8, 8]) : (!stencil.field<10x8x8xf64>) -> !stencil.temp<10x8x8xf64>
+  // CHECK: scf.parallel ([[TILE0:%.*]], [[TILE1:%.*]], [[TILE2:%.*]]) = ({{.*}}) to ({{.*}}) step ({{.*}}) {
+  // CHECK: [[BUFFER:%.*]] = alloc() : memref<1x2x6xf64, 3>
+  // LDS-NOT: alloc() : memref<{{.*}}, 3>
+  // LDS-NOT: gpu.barrier
+  // CHECK: scf.parallel ([[POINT0:%.*]], [[POINT1:%.*]], [[POINT2:%.*]]) = ({{.*}}) to ({{.*}}) step ({{.*}}) {
+  %2 = stencil.apply (%arg1 = %1 : !stencil.temp<10x8x8xf64>) -> !stencil.temp<8x8x8xf64> {
+    // CHECK: scf.for
+    // CHECK: [[INPUT:%.*]] = load [[VIEW]]
+    // CHECK: store [[INPUT]], [[BUFFER]]
+    // CHECK: gpu.barrier
+    // CHECK: scf.if
+    // CHECK-COUNT-2: load [[BUFFER]]
+    %3 = stencil.access %arg1[-1, 0, 0] : (!stencil.temp<10x8x8xf64>) -> f64
+    %4 = stencil.access %arg1[1, 0, 0] : (!stencil.temp<10x8x8xf64>) -> f64
+    %5 = addf %3, %4 : f64
+    // CHECK: store %{{.*}}, %{{.*}}[%{{.*}}, %{{.*}}, %{{.*}}] : memref<8x8x8xf64>
+    %6 = stencil.store_result %5 : (f64) -> !stencil.result<f64>
+    stencil.return %6 : !stencil.result<f64>
+  } to ([0, 0, 0]:[8, 8, 8])
+  %3 = stencil.buffer %2([0, 0, 0]:[8, 8, 8]) : (!stencil.temp<8x8x8xf64>) -> !stencil.temp<8x8x8xf64>
+  return
+}
+
+// -----
+
+// CHECK-LABEL: @unstaged_dyn_access
+// LDS-LABEL: @unstaged_dyn_access
+func @unstaged_dyn_access(%arg0: !stencil.field<?x?x?xf64>) attributes {stencil.program} {
+  %0 = stencil.cast %arg0 ([0, 0, 0]:[8, 8, 8]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<8x8x8xf64>
+  // CHECK: [[VIEW:%.*]] = subview
+  %1 = stencil.load %0 ([0, 0, 0]:[8, 8, 8]) : (!stencil.field<8x8x8xf64>) -> !stencil.temp<8x8x8xf64>
+  // CHECK-NOT: alloc() : memref<{{.*}}, 3>
+  %2 = stencil.apply (%arg1 = %1 : !stencil.temp<8x8x8xf64>) -> !stencil.temp<8x8x8xf64> {
+    // CHECK-NOT: gpu.barrier
+    // CHECK: load [[VIEW]]
+    %c0 = constant 0 : index
+    %3 = stencil.dyn_access %arg1(%c0, %c0, %c0) in [0, 0, 0] : [0, 0, 0] : (!stencil.temp<8x8x8xf64>) -> f64
+    %4 = stencil.store_result %3 : (f64) -> !stencil.result<f64>
+    stencil.return %4 : !stencil.result<f64>
+  } to ([0, 0, 0]:[8, 8, 8])
+  %3 = stencil.buffer %2([0, 0, 0]:[8, 8, 8]) : (!stencil.temp<8x8x8xf64>) -> !stencil.temp<8x8x8xf64>
+  return
+}
+
+// -----
+
+// CHECK-LABEL: @staged_dyn_access
+// DYN-LABEL: @staged_dyn_access
+func @staged_dyn_access(%arg0: !stencil.field<?x?x?xf64>) attributes {stencil.program} {
+  %0 = stencil.cast %arg0 ([-1, 0, 0]:[9, 8, 8]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<10x8x8xf64>
+  // DYN: [[VIEW:%.*]] = subview %{{.*}}[0, 0, 0] [8, 8, 10] [1, 1, 1]
+  %1 = stencil.load %0 ([-1, 0, 0]:[9, 8, 8]) : (!stencil.field<10x8x8xf64>) -> !stencil.temp<10x8x8xf64>
+  // CHECK-NOT: alloc() : memref<{{.*}}, 3>
+  // DYN: scf.parallel ([[TILE0:%.*]], [[TILE1:%.*]], [[TILE2:%.*]]) = ({{.*}}) to ({{.*}}) step ({{.*}}) {
+  // DYN: [[BUFFER:%.*]] = alloc() : memref<1x2x6xf64, 3>
+  %2 = stencil.apply (%arg1 = %1 : !stencil.temp<10x8x8xf64>) -> !stencil.temp<8x8x8xf64> {
+    // DYN: [[INPUT:%.*]] = load [[VIEW]]
+    // DYN: store [[INPUT]], [[BUFFER]]
+    // DYN: gpu.barrier
+    // DYN: subi %{{.*}}, [[TILE0]] : index
+    // DYN: load [[BUFFER]]
+    %3 = stencil.index 0 [-1, 0, 0] : index
+    %4 = stencil.index 1 [0, 0, 0] : index
+    %5 = stencil.index 2 [0, 0, 0] : index
+    %6 = stencil.dyn_access %arg1(%3, %4, %5) in [-1, 0, 0] : [1, 0, 0] : (!stencil.temp<10x8x8xf64>) -> f64
+    %7 = stencil.store_result %6 : (f64) -> !stencil.result<f64>
+    stencil.return %7 : !stencil.result<f64>
+  } to ([0, 0, 0]:[8, 8, 8])
+  %3 = stencil.buffer %2([0, 0, 0]:[8, 8, 8]) : (!stencil.temp<8x8x8xf64>) -> !stencil.temp<8x8x8xf64>
+  return
+}
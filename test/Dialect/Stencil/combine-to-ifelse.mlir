@@ -1,8 +1,11 @@
 // RUN: oec-opt %s -split-input-file --stencil-combine-to-ifelse -cse | oec-opt | FileCheck %s
 // RUN: oec-opt %s -split-input-file --stencil-combine-to-ifelse='internal-only' -cse | oec-opt | FileCheck --check-prefix=CHECKINT %s
+// RUN: oec-opt %s -split-input-file --stencil-combine-to-ifelse='use-cost-model' -cse | oec-opt | FileCheck --check-prefix=COST %s
+// RUN: oec-opt %s -split-input-file --stencil-combine-to-ifelse='use-cost-model max-flops-per-byte=0.25' -cse | oec-opt | FileCheck --check-prefix=MAT %s
 
 // CHECK-LABEL: func @simple
 // CHECKINT-LABEL: func @simple
+// COST-LABEL: func @simple
 func @simple(%arg0: !stencil.field<?x?x?xf64>, %arg1: !stencil.field<?x?x?xf64>) attributes {stencil.program} {
   // CHECKINT-COUNT-2: {{%.*}} = stencil.apply
   %0 = stencil.cast %arg0([-3, -3, 0] : [67, 67, 60]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<70x70x60xf64>
@@ -33,6 +36,7 @@ func @simple(%arg0: !stencil.field<?x?x?xf64>, %arg1: !stencil.field<?x?x?xf64>)
     stencil.return %7 : !stencil.result<f64>
   } to ([32, 0, 0] : [64, 64, 60])
   // CHECK-NOT: {{%.*}} = stencil.combine
+  // COST: {{%.*}} = stencil.combine 0 at 32
   %5 = stencil.combine 0 at 32 lower = (%3 : !stencil.temp<32x64x60xf64>) upper = (%4 : !stencil.temp<32x64x60xf64>) ([0, 0, 0] : [64, 64, 60]) : !stencil.temp<64x64x60xf64>
   stencil.store %5 to %1([0, 0, 0] : [64, 64, 60]) : !stencil.temp<64x64x60xf64> to !stencil.field<70x70x60xf64>
   return
@@ -84,6 +88,9 @@ func @nested(%arg0: !stencil.field<?x?x?xf64>, %arg1: !stencil.field<?x?x?xf64>)
 
 // CHECK-LABEL: func @internal
 // CHECKINT-LABEL: func @internal
+// COST-LABEL: func @internal
+// COST-NOT: stencil.combine
+// COST: return
 func @internal(%arg0: !stencil.field<?x?x?xf64>, %arg1: !stencil.field<?x?x?xf64>) attributes {stencil.program} {
   // CHECK-COUNT-2: {{%.*}} = stencil.apply
   %0 = stencil.cast %arg0([-3, -3, 0] : [67, 67, 60]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<70x70x60xf64>
@@ -268,4 +275,44 @@ func @multiple_apply(%arg0: !stencil.field<?x?x?xf64>, %arg1: !stencil.field<?x?
   stencil.store %7#0 to %0([0, 0, 0] : [64, 64, 60]) : !stencil.temp<64x64x60xf64> to !stencil.field<70x70x60xf64>
   stencil.store %7#1 to %1([0, 0, 0] : [64, 64, 60]) : !stencil.temp<64x64x60xf64> to !stencil.field<70x70x60xf64>
   return
-}
\ No newline at end of file
+}
+
+// -----
+
+// COST-LABEL: func @internal_offsets
+// MAT-LABEL: func @internal_offsets
+func @internal_offsets(%arg0: !stencil.field<?x?x?xf64>, %arg1: !stencil.field<?x?x?xf64>) attributes {stencil.program} {
+  %0 = stencil.cast %arg0([-3, -3, 0] : [67, 67, 60]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<70x70x60xf64>
+  %1 = stencil.cast %arg1([-3, -3, 0] : [67, 67, 60]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<70x70x60xf64>
+  %2 = stencil.load %0([-1, 0, 0] : [66, 64, 60]) : (!stencil.field<70x70x60xf64>) -> !stencil.temp<67x64x60xf64>
+  // COST: {{%.*}} = stencil.apply ({{%.*}} = {{%.*}} : !stencil.temp<67x64x60xf64>, {{%.*}} = {{%.*}} : !stencil.temp<67x64x60xf64>) -> !stencil.temp<66x64x60xf64> {
+  // COST: {{%.*}} = scf.if {{%.*}} -> (!stencil.result<f64>) {
+  // COST-NOT: stencil.combine
+  %3 = stencil.apply (%arg2 = %2 : !stencil.temp<67x64x60xf64>) -> !stencil.temp<33x64x60xf64> {
+    %7 = stencil.access %arg2 [0, 0, 0] : (!stencil.temp<67x64x60xf64>) -> f64
+    %8 = stencil.access %arg2 [1, 0, 0] : (!stencil.temp<67x64x60xf64>) -> f64
+    %9 = addf %7, %8 : f64
+    %10 = mulf %9, %9 : f64
+    %11 = stencil.store_result %10 : (f64) -> !stencil.result<f64>
+    stencil.return %11 : !stencil.result<f64>
+  } to ([-1, 0, 0] : [32, 64, 60])
+  %4 = stencil.apply (%arg2 = %2 : !stencil.temp<67x64x60xf64>) -> !stencil.temp<33x64x60xf64> {
+    %7 = stencil.access %arg2 [0, 0, 0] : (!stencil.temp<67x64x60xf64>) -> f64
+    %8 = addf %7, %7 : f64
+    %9 = stencil.store_result %8 : (f64) -> !stencil.result<f64>
+    stencil.return %9 : !stencil.result<f64>
+  } to ([32, 0, 0] : [65, 64, 60])
+  // MAT: {{%.*}} = stencil.combine 0 at 32
+  %5 = stencil.combine 0 at 32 lower = (%3 : !stencil.temp<33x64x60xf64>) upper = (%4 : !stencil.temp<33x64x60xf64>) ([-1, 0, 0] : [65, 64, 60]) : !stencil.temp<66x64x60xf64>
+  %6 = stencil.apply (%arg2 = %5 : !stencil.temp<66x64x60xf64>) -> !stencil.temp<64x64x60xf64> {
+    %7 = stencil.access %arg2 [-1, 0, 0] : (!stencil.temp<66x64x60xf64>) -> f64
+    %8 = stencil.access %arg2 [0, 0, 0] : (!stencil.temp<66x64x60xf64>) -> f64
+    %9 = stencil.access %arg2 [1, 0, 0] : (!stencil.temp<66x64x60xf64>) -> f64
+    %10 = addf %7, %8 : f64
+    %11 = addf %9, %10 : f64
+    %12 = stencil.store_result %11 : (f64) -> !stencil.result<f64>
+    stencil.return %12 : !stencil.result<f64>
+  } to ([0, 0, 0] : [64, 64, 60])
+  stencil.store %6 to %1([0, 0, 0] : [64, 64, 60]) : !stencil.temp<64x64x60xf64> to !stencil.field<70x70x60xf64>
+  return
+}
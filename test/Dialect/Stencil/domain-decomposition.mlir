@@ -0,0 +1,76 @@
+// RUN: oec-opt %s --stencil-shape-inference --stencil-domain-decomposition='ranks=2,2' | FileCheck %s
+// RUN: oec-opt %s --stencil-shape-inference --stencil-domain-decomposition='ranks=2,2 overlap=false' | FileCheck --check-prefix=CHECK-NOSPLIT %s
+// RUN: oec-opt %s --stencil-shape-inference --stencil-domain-decomposition='ranks=2,2 dimension-order=kij' | FileCheck --check-prefix=CHECK-KIJ %s
+
+// CHECK: func private @oecHaloExchangeBeginF64(!stencil.field<?x?x?xf64>, i64, i64, i64, i64, i64, i64, i64, i64, i64, i64, i64, i64, i64) attributes {llvm.emit_c_interface}
+// CHECK: func private @oecHaloExchangeEnd() attributes {llvm.emit_c_interface}
+
+// CHECK-LABEL: func @laplace(%{{.*}}: !stencil.field<?x?x?xf64>, %{{.*}}: !stencil.field<?x?x?xf64>) {
+//  CHECK-NEXT: [[TAG:%.*]] = constant 0 : i64
+//  CHECK-NEXT: [[DIMI:%.*]] = constant 2 : i64
+//  CHECK-NEXT: [[DIMJ:%.*]] = constant 1 : i64
+//  CHECK-NEXT: [[RANKSI:%.*]] = constant 2 : i64
+//  CHECK-NEXT: [[RANKSJ:%.*]] = constant 2 : i64
+//  CHECK-NEXT: [[ORIGINI:%.*]] = constant 4 : i64
+//  CHECK-NEXT: [[ORIGINJ:%.*]] = constant 4 : i64
+//  CHECK-NEXT: [[SIZEI:%.*]] = constant 32 : i64
+//  CHECK-NEXT: [[SIZEJ:%.*]] = constant 32 : i64
+//  CHECK-NEXT: [[LOWERI:%.*]] = constant 1 : i64
+//  CHECK-NEXT: [[LOWERJ:%.*]] = constant 1 : i64
+//  CHECK-NEXT: [[UPPERI:%.*]] = constant 1 : i64
+//  CHECK-NEXT: [[UPPERJ:%.*]] = constant 1 : i64
+//  CHECK-NEXT: call @oecHaloExchangeBeginF64(%arg0, [[TAG]], [[DIMI]], [[DIMJ]], [[RANKSI]], [[RANKSJ]], [[ORIGINI]], [[ORIGINJ]], [[SIZEI]], [[SIZEJ]], [[LOWERI]], [[LOWERJ]], [[UPPERI]], [[UPPERJ]])
+//  CHECK-NEXT: call @laplace_interior(%arg0, %arg1)
+//  CHECK-NEXT: call @oecHaloExchangeEnd()
+//  CHECK-NEXT: call @laplace_boundary0(%arg0, %arg1)
+//  CHECK-NEXT: call @laplace_boundary1(%arg0, %arg1)
+//  CHECK-NEXT: call @laplace_boundary2(%arg0, %arg1)
+//  CHECK-NEXT: call @laplace_boundary3(%arg0, %arg1)
+//  CHECK-NEXT: return
+
+// CHECK-LABEL: func private @laplace_interior
+//  CHECK-SAME: attributes {stencil.program}
+//       CHECK: stencil.cast %arg0([-4, -4, -4] : [36, 36, 68]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<40x40x72xf64>
+//       CHECK: stencil.load %{{.*}} : (!stencil.field<40x40x72xf64>) -> !stencil.temp<?x?x?xf64>
+//       CHECK: stencil.store %{{.*}} to %{{.*}}([1, 1, 0] : [31, 31, 64])
+// CHECK-LABEL: func private @laplace_boundary0
+//       CHECK: stencil.store %{{.*}} to %{{.*}}([0, 0, 0] : [1, 32, 64])
+// CHECK-LABEL: func private @laplace_boundary1
+//       CHECK: stencil.store %{{.*}} to %{{.*}}([31, 0, 0] : [32, 32, 64])
+// CHECK-LABEL: func private @laplace_boundary2
+//       CHECK: stencil.store %{{.*}} to %{{.*}}([1, 0, 0] : [31, 1, 64])
+// CHECK-LABEL: func private @laplace_boundary3
+//       CHECK: stencil.store %{{.*}} to %{{.*}}([1, 31, 0] : [31, 32, 64])
+
+// The kij order stores the i and j dimensions in the memref dimensions 1 and 0
+// CHECK-KIJ-LABEL: func @laplace
+//  CHECK-KIJ-NEXT: [[TAG:%.*]] = constant 0 : i64
+//  CHECK-KIJ-NEXT: [[DIMI:%.*]] = constant 1 : i64
+//  CHECK-KIJ-NEXT: [[DIMJ:%.*]] = constant 0 : i64
+//       CHECK-KIJ: call @oecHaloExchangeBeginF64(%arg0, [[TAG]], [[DIMI]], [[DIMJ]],
+
+// CHECK-NOSPLIT-LABEL: func @laplace
+//       CHECK-NOSPLIT: call @oecHaloExchangeBeginF64
+//  CHECK-NOSPLIT-NEXT: call @oecHaloExchangeEnd()
+//  CHECK-NOSPLIT-NEXT: call @laplace_local(%arg0, %arg1)
+//  CHECK-NOSPLIT-NEXT: return
+// CHECK-NOSPLIT-LABEL: func private @laplace_local
+//       CHECK-NOSPLIT: stencil.store %{{.*}} to %{{.*}}([0, 0, 0] : [32, 32, 64])
+func @laplace(%arg0: !stencil.field<?x?x?xf64>, %arg1: !stencil.field<?x?x?xf64>) attributes {stencil.program} {
+  %0 = stencil.cast %arg0([-4, -4, -4] : [68, 68, 68]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<72x72x72xf64>
+  %1 = stencil.cast %arg1([-4, -4, -4] : [68, 68, 68]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<72x72x72xf64>
+  %2 = stencil.load %0 : (!stencil.field<72x72x72xf64>) -> !stencil.temp<?x?x?xf64>
+  %3 = stencil.apply (%arg2 = %2 : !stencil.temp<?x?x?xf64>) -> !stencil.temp<?x?x?xf64> {
+    %4 = stencil.access %arg2 [-1, 0, 0] : (!stencil.temp<?x?x?xf64>) -> f64
+    %5 = stencil.access %arg2 [1, 0, 0] : (!stencil.temp<?x?x?xf64>) -> f64
+    %6 = stencil.access %arg2 [0, 1, 0] : (!stencil.temp<?x?x?xf64>) -> f64
+    %7 = stencil.access %arg2 [0, -1, 0] : (!stencil.temp<?x?x?xf64>) -> f64
+    %8 = addf %4, %5 : f64
+    %9 = addf %6, %7 : f64
+    %10 = addf %8, %9 : f64
+    %11 = stencil.store_result %10 : (f64) -> !stencil.result<f64>
+    stencil.return %11 : !stencil.result<f64>
+  }
+  stencil.store %3 to %1([0, 0, 0] : [64, 64, 64]) : !stencil.temp<?x?x?xf64> to !stencil.field<72x72x72xf64>
+  return
+}
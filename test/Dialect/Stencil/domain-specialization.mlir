@@ -0,0 +1,51 @@
+// RUN: oec-opt %s --stencil-domain-specialization='domain-sizes=32,32,64,64,64,64,128,96,64' --stencil-shape-inference | FileCheck %s
+
+// CHECK-LABEL: func @laplace_dispatch(%{{.*}}: index, %{{.*}}: index, %{{.*}}: index, %{{.*}}: !stencil.field<?x?x?xf64>, %{{.*}}: !stencil.field<?x?x?xf64>) {
+//   CHECK-DAG: [[C32I:%.*]] = constant 32 : index
+//   CHECK-DAG: [[C32J:%.*]] = constant 32 : index
+//   CHECK-DAG: [[C64K:%.*]] = constant 64 : index
+//       CHECK: scf.if
+//  CHECK-NEXT: call @laplace_32x32x64(%arg3, %arg4)
+//  CHECK-NEXT: } else {
+//       CHECK: scf.if
+//  CHECK-NEXT: call @laplace_128x96x64(%arg3, %arg4)
+//  CHECK-NEXT: } else {
+//       CHECK: scf.if
+//  CHECK-NEXT: call @laplace(%arg3, %arg4)
+//  CHECK-NEXT: } else {
+//  CHECK-NEXT: [[FALSE:%.*]] = constant false
+//  CHECK-NEXT: assert [[FALSE]], "unexpected domain size"
+//       CHECK: return
+
+// CHECK-LABEL: func @laplace(
+//       CHECK: stencil.cast %arg0([-4, -4, -4] : [68, 68, 68])
+//       CHECK: stencil.store %{{.*}} to %{{.*}}([0, 0, 0] : [64, 64, 64])
+
+// CHECK-LABEL: func private @laplace_32x32x64
+//  CHECK-SAME: attributes {stencil.program}
+//       CHECK: stencil.cast %arg0([-4, -4, -4] : [36, 36, 68]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<40x40x72xf64>
+//       CHECK: stencil.load %{{.*}}([-1, -1, 0] : [33, 33, 64]) : (!stencil.field<40x40x72xf64>) -> !stencil.temp<34x34x64xf64>
+//       CHECK: } to ([0, 0, 0] : [32, 32, 64])
+//       CHECK: stencil.store %{{.*}} to %{{.*}}([0, 0, 0] : [32, 32, 64])
+
+// CHECK-LABEL: func private @laplace_128x96x64
+//       CHECK: stencil.cast %arg0([-4, -4, -4] : [132, 100, 68]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<136x104x72xf64>
+//       CHECK: stencil.store %{{.*}} to %{{.*}}([0, 0, 0] : [128, 96, 64])
+func @laplace(%arg0: !stencil.field<?x?x?xf64>, %arg1: !stencil.field<?x?x?xf64>) attributes {stencil.program} {
+  %0 = stencil.cast %arg0([-4, -4, -4] : [68, 68, 68]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<72x72x72xf64>
+  %1 = stencil.cast %arg1([-4, -4, -4] : [68, 68, 68]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<72x72x72xf64>
+  %2 = stencil.load %0 : (!stencil.field<72x72x72xf64>) -> !stencil.temp<?x?x?xf64>
+  %3 = stencil.apply (%arg2 = %2 : !stencil.temp<?x?x?xf64>) -> !stencil.temp<?x?x?xf64> {
+    %4 = stencil.access %arg2 [-1, 0, 0] : (!stencil.temp<?x?x?xf64>) -> f64
+    %5 = stencil.access %arg2 [1, 0, 0] : (!stencil.temp<?x?x?xf64>) -> f64
+    %6 = stencil.access %arg2 [0, 1, 0] : (!stencil.temp<?x?x?xf64>) -> f64
+    %7 = stencil.access %arg2 [0, -1, 0] : (!stencil.temp<?x?x?xf64>) -> f64
+    %8 = addf %4, %5 : f64
+    %9 = addf %6, %7 : f64
+    %10 = addf %8, %9 : f64
+    %11 = stencil.store_result %10 : (f64) -> !stencil.result<f64>
+    stencil.return %11 : !stencil.result<f64>
+  }
+  stencil.store %3 to %1([0, 0, 0] : [64, 64, 64]) : !stencil.temp<?x?x?xf64> to !stencil.field<72x72x72xf64>
+  return
+}
@@ -0,0 +1,80 @@
+// RUN: oec-opt %s -split-input-file --stencil-interior-split -cse | oec-opt | FileCheck %s
+
+// CHECK-LABEL: func @ifelse
+func @ifelse(%arg0: !stencil.field<?x?x?xf64>, %arg1: !stencil.field<?x?x?xf64>) attributes {stencil.program} {
+  %0 = stencil.cast %arg0([-3, -3, 0] : [67, 67, 60]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<70x70x60xf64>
+  %1 = stencil.cast %arg1([-3, -3, 0] : [67, 67, 60]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<70x70x60xf64>
+  %2 = stencil.load %0([0, 0, 0] : [65, 64, 60]) : (!stencil.field<70x70x60xf64>) -> !stencil.temp<65x64x60xf64>
+  // CHECK: [[LOWER:%.*]] = stencil.apply ([[ARG0:%.*]] = {{%.*}} : !stencil.temp<65x64x60xf64>) -> !stencil.temp<32x64x60xf64> {
+  // CHECK-NEXT: [[ACC0:%.*]] = stencil.access [[ARG0]] [0, 0, 0] : (!stencil.temp<65x64x60xf64>) -> f64
+  // CHECK-NEXT: [[RES0:%.*]] = stencil.store_result [[ACC0]] : (f64) -> !stencil.result<f64>
+  // CHECK-NEXT: stencil.return [[RES0]] : !stencil.result<f64>
+  // CHECK-NEXT: } to ([0, 0, 0] : [32, 64, 60])
+  // CHECK: [[UPPER:%.*]] = stencil.apply ([[ARG1:%.*]] = {{%.*}} : !stencil.temp<65x64x60xf64>) -> !stencil.temp<32x64x60xf64> {
+  // CHECK-NEXT: [[ACC1:%.*]] = stencil.access [[ARG1]] [1, 0, 0] : (!stencil.temp<65x64x60xf64>) -> f64
+  // CHECK-NEXT: [[RES1:%.*]] = stencil.store_result [[ACC1]] : (f64) -> !stencil.result<f64>
+  // CHECK-NEXT: stencil.return [[RES1]] : !stencil.result<f64>
+  // CHECK-NEXT: } to ([32, 0, 0] : [64, 64, 60])
+  // CHECK-NEXT: [[COMBINE:%.*]] = stencil.combine 0 at 32 lower = ([[LOWER]] : !stencil.temp<32x64x60xf64>) upper = ([[UPPER]] : !stencil.temp<32x64x60xf64>) ([0, 0, 0] : [64, 64, 60]) : !stencil.temp<64x64x60xf64>
+  // CHECK-NEXT: stencil.store [[COMBINE]] to {{%.*}}([0, 0, 0] : [64, 64, 60])
+  %3 = stencil.apply (%arg2 = %2 : !stencil.temp<65x64x60xf64>) -> !stencil.temp<64x64x60xf64> {
+    %4 = stencil.index 0 [0, 0, 0] : index
+    %c32 = constant 32 : index
+    %5 = cmpi ult, %4, %c32 : index
+    %6 = scf.if %5 -> (!stencil.result<f64>) {
+      %7 = stencil.access %arg2 [0, 0, 0] : (!stencil.temp<65x64x60xf64>) -> f64
+      %8 = stencil.store_result %7 : (f64) -> !stencil.result<f64>
+      scf.yield %8 : !stencil.result<f64>
+    } else {
+      %7 = stencil.access %arg2 [1, 0, 0] : (!stencil.temp<65x64x60xf64>) -> f64
+      %8 = stencil.store_result %7 : (f64) -> !stencil.result<f64>
+      scf.yield %8 : !stencil.result<f64>
+    }
+    stencil.return %6 : !stencil.result<f64>
+  } to ([0, 0, 0] : [64, 64, 60])
+  stencil.store %3 to %1([0, 0, 0] : [64, 64, 60]) : !stencil.temp<64x64x60xf64> to !stencil.field<70x70x60xf64>
+  return
+}
+
+// -----
+
+// CHECK-LABEL: func @boundary
+func @boundary(%arg0: !stencil.field<?x?x?xf64>, %arg1: !stencil.field<?x?x?xf64>) attributes {stencil.program} {
+  %0 = stencil.cast %arg0([-4, -4, -4] : [68, 68, 68]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<72x72x72xf64>
+  %1 = stencil.cast %arg1([-4, -4, -4] : [68, 68, 68]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<72x72x72xf64>
+  %2 = stencil.load %0([0, -1, 0] : [65, 64, 64]) : (!stencil.field<72x72x72xf64>) -> !stencil.temp<65x65x64xf64>
+  // CHECK-NOT: select
+  // CHECK: [[L0:%.*]] = stencil.apply
+  // CHECK: stencil.access {{%.*}} [1, 0, 0]
+  // CHECK: } to ([0, 0, 0] : [1, 63, 64])
+  // CHECK: [[L1:%.*]] = stencil.apply
+  // CHECK: stencil.access {{%.*}} [0, -1, 0]
+  // CHECK: } to ([0, 63, 0] : [1, 64, 64])
+  // CHECK-NEXT: [[LOWER:%.*]] = stencil.combine 1 at 63 lower = ([[L0]] : !stencil.temp<1x63x64xf64>) upper = ([[L1]] : !stencil.temp<1x1x64xf64>) ([0, 0, 0] : [1, 64, 64]) : !stencil.temp<1x64x64xf64>
+  // CHECK: [[U0:%.*]] = stencil.apply
+  // CHECK: stencil.access {{%.*}} [0, 0, 0]
+  // CHECK: } to ([1, 0, 0] : [64, 63, 64])
+  // CHECK: [[U1:%.*]] = stencil.apply
+  // CHECK: stencil.access {{%.*}} [0, -1, 0]
+  // CHECK: } to ([1, 63, 0] : [64, 64, 64])
+  // CHECK-NEXT: [[UPPER:%.*]] = stencil.combine 1 at 63 lower = ([[U0]] : !stencil.temp<63x63x64xf64>) upper = ([[U1]] : !stencil.temp<63x1x64xf64>) ([1, 0, 0] : [64, 64, 64]) : !stencil.temp<63x64x64xf64>
+  // CHECK-NEXT: [[COMBINE:%.*]] = stencil.combine 0 at 1 lower = ([[LOWER]] : !stencil.temp<1x64x64xf64>) upper = ([[UPPER]] : !stencil.temp<63x64x64xf64>) ([0, 0, 0] : [64, 64, 64]) : !stencil.temp<64x64x64xf64>
+  // CHECK-NEXT: stencil.store [[COMBINE]] to {{%.*}}([0, 0, 0] : [64, 64, 64])
+  %3 = stencil.apply (%arg2 = %2 : !stencil.temp<65x65x64xf64>) -> !stencil.temp<64x64x64xf64> {
+    %4 = stencil.index 0 [0, 0, 0] : index
+    %5 = stencil.index 1 [0, 0, 0] : index
+    %c0 = constant 0 : index
+    %c63 = constant 63 : index
+    %6 = cmpi eq, %4, %c0 : index
+    %7 = cmpi sge, %5, %c63 : index
+    %8 = stencil.access %arg2 [0, 0, 0] : (!stencil.temp<65x65x64xf64>) -> f64
+    %9 = stencil.access %arg2 [1, 0, 0] : (!stencil.temp<65x65x64xf64>) -> f64
+    %10 = stencil.access %arg2 [0, -1, 0] : (!stencil.temp<65x65x64xf64>) -> f64
+    %11 = select %6, %9, %8 : f64
+    %12 = select %7, %10, %11 : f64
+    %13 = stencil.store_result %12 : (f64) -> !stencil.result<f64>
+    stencil.return %13 : !stencil.result<f64>
+  } to ([0, 0, 0] : [64, 64, 64])
+  stencil.store %3 to %1([0, 0, 0] : [64, 64, 64]) : !stencil.temp<64x64x64xf64> to !stencil.field<72x72x72xf64>
+  return
+}
@@ -0,0 +1,45 @@
+// RUN: oec-opt %s --stencil-kernel-fusion -cse | oec-opt | FileCheck %s
+// RUN: oec-opt %s --stencil-kernel-fusion='dump=true' -o /dev/null 2>&1 | FileCheck --check-prefix=DUMP %s
+// RUN: oec-opt %s --stencil-kernel-fusion='max-registers=24' | oec-opt | FileCheck --check-prefix=BUDGET %s
+
+// CHECK-LABEL: func @diamond
+// BUDGET-LABEL: func @diamond
+func @diamond(%arg0: !stencil.field<?x?x?xf64>, %arg1: !stencil.field<?x?x?xf64>, %arg2: !stencil.field<?x?x?xf64>) attributes {stencil.program} {
+  %0 = stencil.cast %arg0([-4, -4, -4] : [68, 68, 68]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<72x72x72xf64>
+  %1 = stencil.cast %arg1([-4, -4, -4] : [68, 68, 68]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<72x72x72xf64>
+  %2 = stencil.cast %arg2([-4, -4, -4] : [68, 68, 68]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<72x72x72xf64>
+  %3 = stencil.load %0([-1, -1, 0] : [65, 65, 64]) : (!stencil.field<72x72x72xf64>) -> !stencil.temp<66x66x64xf64>
+  // CHECK: [[RES:%.*]]:2 = stencil.apply ([[ARG:%.*]] = {{%.*}} : !stencil.temp<66x66x64xf64>) -> (!stencil.temp<64x64x64xf64>, !stencil.temp<64x64x64xf64>) {
+  // CHECK-DAG: stencil.access [[ARG]] [-1, 0, 0]
+  // CHECK-DAG: stencil.access [[ARG]] [1, 0, 0]
+  // CHECK-DAG: stencil.access [[ARG]] [0, -1, 0]
+  // CHECK-DAG: stencil.access [[ARG]] [0, 1, 0]
+  // CHECK: stencil.return {{%.*}}, {{%.*}} : !stencil.result<f64>, !stencil.result<f64>
+  // CHECK-NEXT: } to ([0, 0, 0] : [64, 64, 64])
+  // CHECK-NEXT: stencil.store [[RES]]#0 to {{%.*}}([0, 0, 0] : [64, 64, 64])
+  // CHECK-NEXT: stencil.store [[RES]]#1 to {{%.*}}([0, 0, 0] : [64, 64, 64])
+  // BUDGET-COUNT-2: stencil.apply ({{%.*}} = {{%.*}} : !stencil.temp<66x66x64xf64>) -> !stencil.temp<64x64x64xf64>
+  %4 = stencil.apply (%arg3 = %3 : !stencil.temp<66x66x64xf64>) -> !stencil.temp<64x64x64xf64> {
+    %6 = stencil.access %arg3 [-1, 0, 0] : (!stencil.temp<66x66x64xf64>) -> f64
+    %7 = stencil.access %arg3 [1, 0, 0] : (!stencil.temp<66x66x64xf64>) -> f64
+    %8 = addf %6, %7 : f64
+    %9 = stencil.store_result %8 : (f64) -> !stencil.result<f64>
+    stencil.return %9 : !stencil.result<f64>
+  } to ([0, 0, 0] : [64, 64, 64])
+  %5 = stencil.apply (%arg3 = %3 : !stencil.temp<66x66x64xf64>) -> !stencil.temp<64x64x64xf64> {
+    %6 = stencil.access %arg3 [0, -1, 0] : (!stencil.temp<66x66x64xf64>) -> f64
+    %7 = stencil.access %arg3 [0, 1, 0] : (!stencil.temp<66x66x64xf64>) -> f64
+    %8 = addf %6, %7 : f64
+    %9 = stencil.store_result %8 : (f64) -> !stencil.result<f64>
+    stencil.return %9 : !stencil.result<f64>
+  } to ([0, 0, 0] : [64, 64, 64])
+  stencil.store %4 to %1([0, 0, 0] : [64, 64, 64]) : !stencil.temp<64x64x64xf64> to !stencil.field<72x72x72xf64>
+  stencil.store %5 to %2([0, 0, 0] : [64, 64, 64]) : !stencil.temp<64x64x64xf64> to !stencil.field<72x72x72xf64>
+  return
+}
+
+// DUMP: kernel fusion of @diamond
+// DUMP-NEXT: apply0 at
+// DUMP-NEXT: apply1 at
+// DUMP-NEXT: fuse apply0 and apply1: saves 8 bytes/point, 28 registers, 1 inputs
+// DUMP-NEXT: 1 kernels, traffic 32 -> 24 bytes/point
@@ -129,6 +129,40 @@ func @store(%out : !stencil.field<?x?x?xf64>) {
 
 // -----
 
+// CHECK-LABEL: func @reduce(%{{.*}}: !stencil.field<?x?x0xf64>, %{{.*}}: !stencil.field<0x0x0xf64>) {
+func @reduce(%out1 : !stencil.field<?x?x0xf64>, %out2 : !stencil.field<0x0x0xf64>) {
+  %0 = "stencil.cast"(%out1) {lb=[-3,-3,0], ub=[67,67,60]} : (!stencil.field<?x?x0xf64>) -> (!stencil.field<70x70x0xf64>)
+  %1 = "stencil.cast"(%out2) {lb=[0,0,0], ub=[64,64,60]} : (!stencil.field<0x0x0xf64>) -> (!stencil.field<0x0x0xf64>)
+  %2:2 = "stencil.apply"() ({
+    %3 = constant 1.0 : f64
+    %4 = "stencil.store_result"(%3) : (f64) -> !stencil.result<f64>
+    %5 = "stencil.store_result"(%3) : (f64) -> !stencil.result<f64>
+    "stencil.return"(%4, %5) : (!stencil.result<f64>, !stencil.result<f64>) -> ()
+  }) : () -> (!stencil.temp<?x?x?xf64>, !stencil.temp<?x?x?xf64>)
+  //  CHECK: stencil.reduce "add" %{{.*}} to %{{.*}}([0, 0, 0] : [64, 64, 60]) : !stencil.temp<?x?x?xf64> to !stencil.field<70x70x0xf64>
+  "stencil.reduce"(%2#0, %0) {kind="add", lb=[0,0,0], ub=[64,64,60]} : (!stencil.temp<?x?x?xf64>, !stencil.field<70x70x0xf64>) -> ()
+  //  CHECK: stencil.reduce "max" %{{.*}} to %{{.*}}([0, 0, 0] : [64, 64, 60]) : !stencil.temp<?x?x?xf64> to !stencil.field<0x0x0xf64>
+  "stencil.reduce"(%2#1, %1) {kind="max", lb=[0,0,0], ub=[64,64,60]} : (!stencil.temp<?x?x?xf64>, !stencil.field<0x0x0xf64>) -> ()
+  return
+}
+
+// -----
+
+// CHECK-LABEL: func @scan(%{{.*}}: !stencil.field<?x?x?xf64>) {
+func @scan(%out : !stencil.field<?x?x?xf64>) {
+  %0 = "stencil.cast"(%out) {lb=[-3,-3,0], ub=[67,67,60]} : (!stencil.field<?x?x?xf64>) -> (!stencil.field<70x70x60xf64>)
+  %1 = "stencil.apply"() ({
+    %2 = constant 1.0 : f64
+    %3 = "stencil.store_result"(%2) : (f64) -> !stencil.result<f64>
+    "stencil.return"(%3) : (!stencil.result<f64>) -> ()
+  }) : () -> !stencil.temp<?x?x?xf64>
+  //  CHECK: stencil.scan "add" %{{.*}} along 2 to %{{.*}}([0, 0, 0] : [64, 64, 60]) : !stencil.temp<?x?x?xf64> to !stencil.field<70x70x60xf64>
+  "stencil.scan"(%1, %0) {kind="add", dim=2, lb=[0,0,0], ub=[64,64,60]} : (!stencil.temp<?x?x?xf64>, !stencil.field<70x70x60xf64>) -> ()
+  return
+}
+
+// -----
+
 // CHECK-LABEL: func @return(%{{.*}}: f64) 
 func @return(%in : f64)
   attributes { stencil.program } {
@@ -149,4 +149,37 @@ func @test(%arg0: !stencil.field<?x?x?xf64>, %arg1: !stencil.field<?x?x?xf64>) a
   %7 = stencil.combine 1 at 62 lower = (%5 : !stencil.temp<64x62x60xf64>) upper = (%6 : !stencil.temp<64x1x60xf64>) ([0, 0, 0] : [64, 63, 60]) : !stencil.temp<64x63x60xf64>
   stencil.store %7 to %1([0, 0, 0] : [64, 63, 60]) : !stencil.temp<64x63x60xf64> to !stencil.field<70x70x60xf64>
   return
-}
\ No newline at end of file
+}
+
+// -----
+
+// CHECK-LABEL: func @peel_2d
+func @peel_2d(%arg0: !stencil.field<?x?x?xf64>, %arg1: !stencil.field<?x?x?xf64>) attributes {stencil.program} {
+  %0 = stencil.cast %arg0([-3, -3, 0] : [67, 67, 62]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<70x70x62xf64>
+  %1 = stencil.cast %arg1([-3, -3, 0] : [67, 67, 62]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<70x70x62xf64>
+  %2 = stencil.load %0([0, 0, 0] : [64, 61, 62]) : (!stencil.field<70x70x62xf64>) -> !stencil.temp<64x61x62xf64>
+  // CHECK: [[BODY:%.*]] = stencil.apply ({{%.*}} = {{%.*}} : !stencil.temp<64x61x62xf64>) -> !stencil.temp<64x60x60xf64> {
+  // CHECK: } to ([0, 0, 0] : [64, 60, 60])
+  // CHECK: [[PEEL:%.*]] = stencil.apply ({{%.*}} = {{%.*}} : !stencil.temp<64x61x62xf64>) -> !stencil.temp<64x60x1xf64> {
+  // CHECK-NEXT: [[ACC1:%.*]] = stencil.access {{%.*}}[0, 0, 0] : (!stencil.temp<64x61x62xf64>) -> f64
+  // CHECK-NEXT: [[RES1:%.*]] = stencil.store_result [[ACC1]] : (f64) -> !stencil.result<f64>
+  // CHECK-NEXT: [[ACC2:%.*]] = stencil.access {{%.*}}[0, 1, 0] : (!stencil.temp<64x61x62xf64>) -> f64
+  // CHECK-NEXT: [[RES2:%.*]] = stencil.store_result [[ACC2]] : (f64) -> !stencil.result<f64>
+  // CHECK-NEXT: [[RES3:%.*]] = stencil.store_result : () -> !stencil.result<f64>
+  // CHECK: stencil.return unroll [1, 2, 2] [[RES1]], [[RES2]], [[RES3]], [[RES3]] : !stencil.result<f64>, !stencil.result<f64>, !stencil.result<f64>, !stencil.result<f64>
+  // CHECK: } to ([0, 0, 60] : [64, 60, 61])
+  %3 = stencil.apply (%arg2 = %2 : !stencil.temp<64x61x62xf64>) -> !stencil.temp<64x60x61xf64> {
+    %4 = stencil.access %arg2 [0, 0, 0] : (!stencil.temp<64x61x62xf64>) -> f64
+    %5 = stencil.store_result %4 : (f64) -> !stencil.result<f64>
+    %6 = stencil.access %arg2 [0, 1, 0] : (!stencil.temp<64x61x62xf64>) -> f64
+    %7 = stencil.store_result %6 : (f64) -> !stencil.result<f64>
+    %8 = stencil.access %arg2 [0, 0, 1] : (!stencil.temp<64x61x62xf64>) -> f64
+    %9 = stencil.store_result %8 : (f64) -> !stencil.result<f64>
+    %10 = stencil.access %arg2 [0, 1, 1] : (!stencil.temp<64x61x62xf64>) -> f64
+    %11 = stencil.store_result %10 : (f64) -> !stencil.result<f64>
+    stencil.return unroll [1, 2, 2] %5, %7, %9, %11 : !stencil.result<f64>, !stencil.result<f64>, !stencil.result<f64>, !stencil.result<f64>
+  } to ([0, 0, 0] : [64, 60, 61])
+  // CHECK: {{%.*}} = stencil.combine 2 at 60 lower = ([[BODY]] : !stencil.temp<64x60x60xf64>) upper = ([[PEEL]] : !stencil.temp<64x60x1xf64>) ([0, 0, 0] : [64, 60, 61]) : !stencil.temp<64x60x61xf64>
+  stencil.store %3 to %1([0, 0, 0] : [64, 60, 61]) : !stencil.temp<64x60x61xf64> to !stencil.field<70x70x62xf64>
+  return
+}
@@ -0,0 +1,110 @@
+// RUN: oec-opt %s -split-input-file -verify-diagnostics --stencil-precision-policy='compute-type=f32' | oec-opt | FileCheck %s
+
+// CHECK-LABEL: func @compute
+func @compute(%arg0: !stencil.field<?x?x?xf64>, %arg1: !stencil.field<?x?x?xf64>) attributes {stencil.program} {
+  %0 = stencil.cast %arg0([-4, -4, -4] : [68, 68, 68]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<72x72x72xf64>
+  %1 = stencil.cast %arg1([-4, -4, -4] : [68, 68, 68]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<72x72x72xf64>
+  %2 = stencil.load %0 : (!stencil.field<72x72x72xf64>) -> !stencil.temp<?x?x?xf64>
+  // CHECK: stencil.apply ({{%.*}} = {{%.*}} : !stencil.temp<?x?x?xf64>) -> !stencil.temp<?x?x?xf64> {
+  // CHECK-NEXT: [[ACC0:%.*]] = stencil.access {{%.*}} [-1, 0, 0] : (!stencil.temp<?x?x?xf64>) -> f64
+  // CHECK-NEXT: [[ACC1:%.*]] = stencil.access {{%.*}} [1, 0, 0] : (!stencil.temp<?x?x?xf64>) -> f64
+  // CHECK-NEXT: [[TRUNC0:%.*]] = fptrunc [[ACC0]] : f64 to f32
+  // CHECK-NEXT: [[TRUNC1:%.*]] = fptrunc [[ACC1]] : f64 to f32
+  // CHECK-NEXT: [[SUM:%.*]] = addf [[TRUNC0]], [[TRUNC1]] : f32
+  // CHECK-NEXT: [[CST:%.*]] = constant 5.000000e-01 : f32
+  // CHECK-NEXT: [[MUL:%.*]] = mulf [[SUM]], [[CST]] : f32
+  // CHECK-NEXT: [[EXT:%.*]] = fpext [[MUL]] : f32 to f64
+  // CHECK-NEXT: [[RES:%.*]] = stencil.store_result [[EXT]] : (f64) -> !stencil.result<f64>
+  // CHECK-NEXT: stencil.return [[RES]] : !stencil.result<f64>
+  %3 = stencil.apply (%arg2 = %2 : !stencil.temp<?x?x?xf64>) -> !stencil.temp<?x?x?xf64> {
+    %4 = stencil.access %arg2 [-1, 0, 0] : (!stencil.temp<?x?x?xf64>) -> f64
+    %5 = stencil.access %arg2 [1, 0, 0] : (!stencil.temp<?x?x?xf64>) -> f64
+    %6 = addf %4, %5 : f64
+    %cst = constant 5.000000e-01 : f64
+    %7 = mulf %6, %cst : f64
+    %8 = stencil.store_result %7 : (f64) -> !stencil.result<f64>
+    stencil.return %8 : !stencil.result<f64>
+  }
+  stencil.store %3 to %1([0, 0, 0] : [64, 64, 64]) : !stencil.temp<?x?x?xf64> to !stencil.field<72x72x72xf64>
+  return
+}
+
+// -----
+
+// CHECK-LABEL: func @storage
+// CHECK-SAME: (%{{.*}}: !stencil.field<?x?x?xf32> {stencil.storage_type = f32}, %{{.*}}: !stencil.field<?x?x?xf32> {stencil.storage_type = f32})
+func @storage(%arg0: !stencil.field<?x?x?xf64> {stencil.storage_type = f32}, %arg1: !stencil.field<?x?x?xf64> {stencil.storage_type = f32}) attributes {stencil.program} {
+  // CHECK: stencil.cast {{%.*}}([-4, -4, -4] : [68, 68, 68]) : (!stencil.field<?x?x?xf32>) -> !stencil.field<72x72x72xf32>
+  %0 = stencil.cast %arg0([-4, -4, -4] : [68, 68, 68]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<72x72x72xf64>
+  %1 = stencil.cast %arg1([-4, -4, -4] : [68, 68, 68]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<72x72x72xf64>
+  // CHECK: stencil.load {{%.*}} : (!stencil.field<72x72x72xf32>) -> !stencil.temp<?x?x?xf32>
+  %2 = stencil.load %0 : (!stencil.field<72x72x72xf64>) -> !stencil.temp<?x?x?xf64>
+  // CHECK: [[TEMP:%.*]] = stencil.apply ({{%.*}} = {{%.*}} : !stencil.temp<?x?x?xf32>) -> !stencil.temp<?x?x?xf32> attributes {stencil.compute_type = f64} {
+  // CHECK-NEXT: [[ACC0:%.*]] = stencil.access {{%.*}} [-1, 0, 0] : (!stencil.temp<?x?x?xf32>) -> f32
+  // CHECK-NEXT: [[ACC1:%.*]] = stencil.access {{%.*}} [1, 0, 0] : (!stencil.temp<?x?x?xf32>) -> f32
+  // CHECK-NEXT: [[EXT0:%.*]] = fpext [[ACC0]] : f32 to f64
+  // CHECK-NEXT: [[EXT1:%.*]] = fpext [[ACC1]] : f32 to f64
+  // CHECK-NEXT: [[SUM:%.*]] = addf [[EXT0]], [[EXT1]] : f64
+  // CHECK-NEXT: [[TRUNC:%.*]] = fptrunc [[SUM]] : f64 to f32
+  // CHECK-NEXT: [[RES:%.*]] = stencil.store_result [[TRUNC]] : (f32) -> !stencil.result<f32>
+  // CHECK-NEXT: stencil.return [[RES]] : !stencil.result<f32>
+  %3 = stencil.apply (%arg2 = %2 : !stencil.temp<?x?x?xf64>) -> !stencil.temp<?x?x?xf64> attributes {stencil.compute_type = f64} {
+    %4 = stencil.access %arg2 [-1, 0, 0] : (!stencil.temp<?x?x?xf64>) -> f64
+    %5 = stencil.access %arg2 [1, 0, 0] : (!stencil.temp<?x?x?xf64>) -> f64
+    %6 = addf %4, %5 : f64
+    %7 = stencil.store_result %6 : (f64) -> !stencil.result<f64>
+    stencil.return %7 : !stencil.result<f64>
+  }
+  // CHECK: stencil.store [[TEMP]] to {{%.*}}([0, 0, 0] : [64, 64, 64]) : !stencil.temp<?x?x?xf32> to !stencil.field<72x72x72xf32>
+  stencil.store %3 to %1([0, 0, 0] : [64, 64, 64]) : !stencil.temp<?x?x?xf64> to !stencil.field<72x72x72xf64>
+  return
+}
+
+// -----
+
+// CHECK-LABEL: func @precise
+func @precise(%arg0: !stencil.field<?x?x?xf64>, %arg1: !stencil.field<?x?x?xf64>) attributes {stencil.program} {
+  %0 = stencil.cast %arg0([-4, -4, -4] : [68, 68, 68]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<72x72x72xf64>
+  %1 = stencil.cast %arg1([-4, -4, -4] : [68, 68, 68]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<72x72x72xf64>
+  %2 = stencil.load %0 : (!stencil.field<72x72x72xf64>) -> !stencil.temp<?x?x?xf64>
+  // CHECK: [[ACC0:%.*]] = stencil.access {{%.*}} [-1, 0, 0] : (!stencil.temp<?x?x?xf64>) -> f64
+  // CHECK-NEXT: [[ACC1:%.*]] = stencil.access {{%.*}} [1, 0, 0] : (!stencil.temp<?x?x?xf64>) -> f64
+  // CHECK-NEXT: [[DIFF:%.*]] = subf [[ACC0]], [[ACC1]] {stencil.precise} : f64
+  // CHECK-NEXT: [[TRUNC0:%.*]] = fptrunc [[DIFF]] : f64 to f32
+  // CHECK-NEXT: [[TRUNC1:%.*]] = fptrunc [[ACC0]] : f64 to f32
+  // CHECK-NEXT: [[MUL:%.*]] = mulf [[TRUNC0]], [[TRUNC1]] : f32
+  // CHECK-NEXT: [[EXT:%.*]] = fpext [[MUL]] : f32 to f64
+  // CHECK-NEXT: stencil.store_result [[EXT]] : (f64) -> !stencil.result<f64>
+  %3 = stencil.apply (%arg2 = %2 : !stencil.temp<?x?x?xf64>) -> !stencil.temp<?x?x?xf64> {
+    %4 = stencil.access %arg2 [-1, 0, 0] : (!stencil.temp<?x?x?xf64>) -> f64
+    %5 = stencil.access %arg2 [1, 0, 0] : (!stencil.temp<?x?x?xf64>) -> f64
+    %6 = subf %4, %5 {stencil.precise} : f64
+    %7 = mulf %6, %4 : f64
+    %8 = stencil.store_result %7 : (f64) -> !stencil.result<f64>
+    stencil.return %8 : !stencil.result<f64>
+  }
+  stencil.store %3 to %1([0, 0, 0] : [64, 64, 64]) : !stencil.temp<?x?x?xf64> to !stencil.field<72x72x72xf64>
+  return
+}
+
+// -----
+
+// The calls cannot pass the fields with the changed storage type
+// expected-error @+1 {{expected no calls of a program changing its storage types}}
+func @called(%arg0: !stencil.field<?x?x?xf64> {stencil.storage_type = f32}, %arg1: !stencil.field<?x?x?xf64>) attributes {stencil.program} {
+  %0 = stencil.cast %arg0([-4, -4, -4] : [68, 68, 68]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<72x72x72xf64>
+  %1 = stencil.cast %arg1([-4, -4, -4] : [68, 68, 68]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<72x72x72xf64>
+  %2 = stencil.load %0 : (!stencil.field<72x72x72xf64>) -> !stencil.temp<?x?x?xf64>
+  %3 = stencil.apply (%arg2 = %2 : !stencil.temp<?x?x?xf64>) -> !stencil.temp<?x?x?xf64> {
+    %4 = stencil.access %arg2 [0, 0, 0] : (!stencil.temp<?x?x?xf64>) -> f64
+    %5 = stencil.store_result %4 : (f64) -> !stencil.result<f64>
+    stencil.return %5 : !stencil.result<f64>
+  }
+  stencil.store %3 to %1([0, 0, 0] : [64, 64, 64]) : !stencil.temp<?x?x?xf64> to !stencil.field<72x72x72xf64>
+  return
+}
+
+func @caller(%arg0: !stencil.field<?x?x?xf64>, %arg1: !stencil.field<?x?x?xf64>) {
+  call @called(%arg0, %arg1) : (!stencil.field<?x?x?xf64>, !stencil.field<?x?x?xf64>) -> ()
+  return
+}
@@ -0,0 +1,72 @@
+// RUN: oec-opt %s --stencil-shape-inference --stencil-inlining --stencil-unrolling='unroll-factor=2' --stencil-shape-inference | FileCheck %s
+// RUN: oec-opt %s --stencil-shape-inference --stencil-inlining --stencil-unrolling='unroll-factor=2' | oec-opt --stencil-shape-inference | FileCheck %s
+
+// The shape inference reusing the extents updated by the inlining and the
+// unrolling infers the same shapes as a fresh shape inference run
+
+// CHECK-LABEL: func @laplace
+//       CHECK: stencil.load %{{.*}}([-1, -1, 0] : [65, 65, 64])
+//       CHECK: stencil.apply
+//       CHECK: stencil.return unroll [1, 2, 1]
+//       CHECK: } to ([0, 0, 0] : [64, 64, 64])
+//   CHECK-NOT: stencil.apply
+//       CHECK: stencil.store %{{.*}} to %{{.*}}([0, 0, 0] : [64, 64, 64])
+func @laplace(%arg0: !stencil.field<?x?x?xf64>, %arg1: !stencil.field<?x?x?xf64>) attributes {stencil.program} {
+  %0 = stencil.cast %arg0([-4, -4, -4] : [68, 68, 68]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<72x72x72xf64>
+  %1 = stencil.cast %arg1([-4, -4, -4] : [68, 68, 68]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<72x72x72xf64>
+  %2 = stencil.load %0 : (!stencil.field<72x72x72xf64>) -> !stencil.temp<?x?x?xf64>
+  %3 = stencil.apply (%arg2 = %2 : !stencil.temp<?x?x?xf64>) -> !stencil.temp<?x?x?xf64> {
+    %5 = stencil.access %arg2 [-1, 0, 0] : (!stencil.temp<?x?x?xf64>) -> f64
+    %6 = stencil.access %arg2 [1, 0, 0] : (!stencil.temp<?x?x?xf64>) -> f64
+    %7 = addf %5, %6 : f64
+    %8 = stencil.store_result %7 : (f64) -> !stencil.result<f64>
+    stencil.return %8 : !stencil.result<f64>
+  }
+  %4 = stencil.apply (%arg2 = %3 : !stencil.temp<?x?x?xf64>) -> !stencil.temp<?x?x?xf64> {
+    %5 = stencil.access %arg2 [0, -1, 0] : (!stencil.temp<?x?x?xf64>) -> f64
+    %6 = stencil.access %arg2 [0, 1, 0] : (!stencil.temp<?x?x?xf64>) -> f64
+    %7 = addf %5, %6 : f64
+    %8 = stencil.store_result %7 : (f64) -> !stencil.result<f64>
+    stencil.return %8 : !stencil.result<f64>
+  }
+  stencil.store %4 to %1([0, 0, 0] : [64, 64, 64]) : !stencil.temp<?x?x?xf64> to !stencil.field<72x72x72xf64>
+  return
+}
+
+// The consumer of the inlined apply op gets its extents updated since the
+// inlining replaces its operand
+// CHECK-LABEL: func @chain
+//       CHECK: stencil.load %{{.*}}([-2, -2, 0] : [66, 66, 64])
+//       CHECK: } to ([-1, -1, 0] : [65, 65, 64])
+//       CHECK: stencil.dyn_access
+//       CHECK: } to ([0, 0, 0] : [64, 64, 64])
+func @chain(%arg0: !stencil.field<?x?x?xf64>, %arg1: !stencil.field<?x?x?xf64>) attributes {stencil.program} {
+  %0 = stencil.cast %arg0([-4, -4, -4] : [68, 68, 68]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<72x72x72xf64>
+  %1 = stencil.cast %arg1([-4, -4, -4] : [68, 68, 68]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<72x72x72xf64>
+  %2 = stencil.load %0 : (!stencil.field<72x72x72xf64>) -> !stencil.temp<?x?x?xf64>
+  %3 = stencil.apply (%arg2 = %2 : !stencil.temp<?x?x?xf64>) -> !stencil.temp<?x?x?xf64> {
+    %6 = stencil.access %arg2 [-1, 0, 0] : (!stencil.temp<?x?x?xf64>) -> f64
+    %7 = stencil.access %arg2 [1, 0, 0] : (!stencil.temp<?x?x?xf64>) -> f64
+    %8 = addf %6, %7 : f64
+    %9 = stencil.store_result %8 : (f64) -> !stencil.result<f64>
+    stencil.return %9 : !stencil.result<f64>
+  }
+  %4 = stencil.apply (%arg2 = %3 : !stencil.temp<?x?x?xf64>) -> !stencil.temp<?x?x?xf64> {
+    %6 = stencil.access %arg2 [0, -1, 0] : (!stencil.temp<?x?x?xf64>) -> f64
+    %7 = stencil.access %arg2 [0, 1, 0] : (!stencil.temp<?x?x?xf64>) -> f64
+    %8 = addf %6, %7 : f64
+    %9 = stencil.store_result %8 : (f64) -> !stencil.result<f64>
+    stencil.return %9 : !stencil.result<f64>
+  }
+  // The dynamic accesses prevent the inlining of the middle apply op
+  %5 = stencil.apply (%arg2 = %4 : !stencil.temp<?x?x?xf64>) -> !stencil.temp<?x?x?xf64> {
+    %6 = stencil.index 0 [0, 0, 0] : index
+    %7 = stencil.index 1 [0, 0, 0] : index
+    %8 = stencil.index 2 [0, 0, 0] : index
+    %9 = stencil.dyn_access %arg2(%6, %7, %8) in [-1, -1, 0] : [1, 1, 0] : (!stencil.temp<?x?x?xf64>) -> f64
+    %10 = stencil.store_result %9 : (f64) -> !stencil.result<f64>
+    stencil.return %10 : !stencil.result<f64>
+  }
+  stencil.store %5 to %1([0, 0, 0] : [64, 64, 64]) : !stencil.temp<?x?x?xf64> to !stencil.field<72x72x72xf64>
+  return
+}
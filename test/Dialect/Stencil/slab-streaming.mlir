@@ -0,0 +1,90 @@
+// RUN: oec-opt %s --stencil-shape-inference --stencil-slab-streaming='slab-size=32' | FileCheck %s
+// RUN: oec-opt %s --stencil-shape-inference --stencil-slab-streaming='slab-size=32 dim=1' | FileCheck --check-prefix=CHECK-J %s
+// RUN: oec-opt %s --stencil-shape-inference --stencil-slab-streaming='slab-size=32 dim=1 dimension-order=kij' | FileCheck --check-prefix=CHECK-KIJ %s
+// RUN: oec-opt %s --stencil-shape-inference --stencil-slab-streaming='slab-size=32 ensemble-size=4' | FileCheck --check-prefix=CHECK-ENS %s
+// RUN: not oec-opt %s --stencil-shape-inference --stencil-slab-streaming='slab-size=32 dimension-order=kij' 2>&1 | FileCheck --check-prefix=CHECK-UNIT %s
+
+// CHECK: func private @oecSlabPrefetchF64(!stencil.field<?x?x?xf64>, i64, i64, i64, i64) attributes {llvm.emit_c_interface}
+// CHECK: func private @oecSlabWait(i64) attributes {llvm.emit_c_interface}
+
+// CHECK-LABEL: func @vertical(%{{.*}}: !stencil.field<?x?x?xf64>, %{{.*}}: !stencil.field<?x?x?xf64>) {
+//  CHECK-NEXT: [[DIM0:%.*]] = constant 0 : i64
+//  CHECK-NEXT: [[BEGIN0:%.*]] = constant 3 : i64
+//  CHECK-NEXT: [[SIZE0:%.*]] = constant 34 : i64
+//  CHECK-NEXT: [[TODEVICE0:%.*]] = constant 1 : i64
+//  CHECK-NEXT: call @oecSlabPrefetchF64(%arg0, [[DIM0]], [[BEGIN0]], [[SIZE0]], [[TODEVICE0]])
+//  CHECK-NEXT: [[WAIT0:%.*]] = constant 1 : i64
+//  CHECK-NEXT: call @oecSlabWait([[WAIT0]])
+//  CHECK-NEXT: [[DIM1:%.*]] = constant 0 : i64
+//  CHECK-NEXT: [[BEGIN1:%.*]] = constant 35 : i64
+//  CHECK-NEXT: [[SIZE1:%.*]] = constant 34 : i64
+//  CHECK-NEXT: [[TODEVICE1:%.*]] = constant 1 : i64
+//  CHECK-NEXT: call @oecSlabPrefetchF64(%arg0, [[DIM1]], [[BEGIN1]], [[SIZE1]], [[TODEVICE1]])
+//  CHECK-NEXT: call @vertical_slab0(%arg0, %arg1)
+//  CHECK-NEXT: [[DIM2:%.*]] = constant 0 : i64
+//  CHECK-NEXT: [[BEGIN2:%.*]] = constant 4 : i64
+//  CHECK-NEXT: [[SIZE2:%.*]] = constant 32 : i64
+//  CHECK-NEXT: [[TOHOST2:%.*]] = constant 0 : i64
+//  CHECK-NEXT: call @oecSlabPrefetchF64(%arg1, [[DIM2]], [[BEGIN2]], [[SIZE2]], [[TOHOST2]])
+//  CHECK-NEXT: [[WAIT1:%.*]] = constant 1 : i64
+//  CHECK-NEXT: call @oecSlabWait([[WAIT1]])
+//  CHECK-NEXT: call @vertical_slab1(%arg0, %arg1)
+//  CHECK-NEXT: [[DIM3:%.*]] = constant 0 : i64
+//  CHECK-NEXT: [[BEGIN3:%.*]] = constant 36 : i64
+//  CHECK-NEXT: [[SIZE3:%.*]] = constant 32 : i64
+//  CHECK-NEXT: [[TOHOST3:%.*]] = constant 0 : i64
+//  CHECK-NEXT: call @oecSlabPrefetchF64(%arg1, [[DIM3]], [[BEGIN3]], [[SIZE3]], [[TOHOST3]])
+//  CHECK-NEXT: [[WAIT2:%.*]] = constant 0 : i64
+//  CHECK-NEXT: call @oecSlabWait([[WAIT2]])
+//  CHECK-NEXT: return
+
+// CHECK-LABEL: func private @vertical_slab0
+//  CHECK-SAME: attributes {stencil.program}
+//       CHECK: stencil.cast %arg0([-4, -4, -4] : [68, 68, 68]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<72x72x72xf64>
+//       CHECK: stencil.load %{{.*}} : (!stencil.field<72x72x72xf64>) -> !stencil.temp<?x?x?xf64>
+//       CHECK: stencil.store %{{.*}} to %{{.*}}([0, 0, 0] : [64, 64, 32])
+// CHECK-LABEL: func private @vertical_slab1
+//       CHECK: stencil.store %{{.*}} to %{{.*}}([0, 0, 32] : [64, 64, 64])
+
+// CHECK-J-LABEL: func @vertical
+//       CHECK-J: [[DIM:%.*]] = constant 1 : i64
+//  CHECK-J-NEXT: [[BEGIN:%.*]] = constant 4 : i64
+//  CHECK-J-NEXT: [[SIZE:%.*]] = constant 32 : i64
+//  CHECK-J-NEXT: [[TODEVICE:%.*]] = constant 1 : i64
+//  CHECK-J-NEXT: call @oecSlabPrefetchF64(%arg0, [[DIM]], [[BEGIN]], [[SIZE]], [[TODEVICE]])
+// CHECK-J-LABEL: func private @vertical_slab0
+//       CHECK-J: stencil.store %{{.*}} to %{{.*}}([0, 0, 0] : [64, 32, 64])
+// CHECK-J-LABEL: func private @vertical_slab1
+//       CHECK-J: stencil.store %{{.*}} to %{{.*}}([0, 32, 0] : [64, 64, 64])
+// The j dimension is the outermost memref dimension of the kij order
+// CHECK-KIJ-LABEL: func @vertical
+//       CHECK-KIJ: [[DIM:%.*]] = constant 0 : i64
+//  CHECK-KIJ-NEXT: [[BEGIN:%.*]] = constant 4 : i64
+//  CHECK-KIJ-NEXT: [[SIZE:%.*]] = constant 32 : i64
+//  CHECK-KIJ-NEXT: [[TODEVICE:%.*]] = constant 1 : i64
+//  CHECK-KIJ-NEXT: call @oecSlabPrefetchF64(%arg0, [[DIM]], [[BEGIN]], [[SIZE]], [[TODEVICE]])
+
+// The ensemble dimension precedes the k dimension
+// CHECK-ENS: func private @oecSlabPrefetchEnsembleF64(!stencil.field<?x?x?xf64>, i64, i64, i64, i64) attributes {llvm.emit_c_interface}
+// CHECK-ENS-LABEL: func @vertical
+//  CHECK-ENS-NEXT: [[DIM:%.*]] = constant 1 : i64
+//  CHECK-ENS-NEXT: [[BEGIN:%.*]] = constant 3 : i64
+//  CHECK-ENS-NEXT: [[SIZE:%.*]] = constant 34 : i64
+//  CHECK-ENS-NEXT: [[TODEVICE:%.*]] = constant 1 : i64
+//  CHECK-ENS-NEXT: call @oecSlabPrefetchEnsembleF64(%arg0, [[DIM]], [[BEGIN]], [[SIZE]], [[TODEVICE]])
+
+// CHECK-UNIT: expected the streamed dimension not to be the unit-stride memref dimension
+func @vertical(%arg0: !stencil.field<?x?x?xf64>, %arg1: !stencil.field<?x?x?xf64>) attributes {stencil.program} {
+  %0 = stencil.cast %arg0([-4, -4, -4] : [68, 68, 68]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<72x72x72xf64>
+  %1 = stencil.cast %arg1([-4, -4, -4] : [68, 68, 68]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<72x72x72xf64>
+  %2 = stencil.load %0 : (!stencil.field<72x72x72xf64>) -> !stencil.temp<?x?x?xf64>
+  %3 = stencil.apply (%arg2 = %2 : !stencil.temp<?x?x?xf64>) -> !stencil.temp<?x?x?xf64> {
+    %4 = stencil.access %arg2 [0, 0, -1] : (!stencil.temp<?x?x?xf64>) -> f64
+    %5 = stencil.access %arg2 [0, 0, 1] : (!stencil.temp<?x?x?xf64>) -> f64
+    %6 = addf %4, %5 : f64
+    %7 = stencil.store_result %6 : (f64) -> !stencil.result<f64>
+    stencil.return %7 : !stencil.result<f64>
+  }
+  stencil.store %3 to %1([0, 0, 0] : [64, 64, 64]) : !stencil.temp<?x?x?xf64> to !stencil.field<72x72x72xf64>
+  return
+}
@@ -0,0 +1,38 @@
+// RUN: oec-opt %s --stencil-inlining='use-cost-model=true' --cse | FileCheck %s --check-prefix=INLINE
+// RUN: oec-opt %s --stencil-inlining='use-cost-model=true max-flops-per-byte=0.25' --cse | FileCheck %s --check-prefix=FLOPS
+// RUN: oec-opt %s --stencil-inlining='use-cost-model=true max-offsets=2' --cse | FileCheck %s --check-prefix=OFFSETS
+
+// INLINE-LABEL: func @laplace
+// INLINE-COUNT-1: stencil.apply
+// INLINE-NOT: stencil.apply
+// FLOPS-LABEL: func @laplace
+// FLOPS-COUNT-2: stencil.apply
+// OFFSETS-LABEL: func @laplace
+// OFFSETS-COUNT-2: stencil.apply
+func @laplace(%arg0: !stencil.field<?x?x?xf64>, %arg1: !stencil.field<?x?x?xf64>) attributes {stencil.program} {
+  %0 = stencil.cast %arg0([-3, -3, 0] : [67, 67, 60]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<70x70x60xf64>
+  %1 = stencil.cast %arg1([-3, -3, 0] : [67, 67, 60]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<70x70x60xf64>
+  %2 = stencil.load %0([-2, -2, 0] : [66, 66, 60]) : (!stencil.field<70x70x60xf64>) -> !stencil.temp<68x68x60xf64>
+  %3 = stencil.apply (%arg2 = %2 : !stencil.temp<68x68x60xf64>) -> !stencil.temp<66x66x60xf64> {
+    %cst = constant 2.000000e+00 : f64
+    %5 = stencil.access %arg2 [-1, 0, 0] : (!stencil.temp<68x68x60xf64>) -> f64
+    %6 = stencil.access %arg2 [1, 0, 0] : (!stencil.temp<68x68x60xf64>) -> f64
+    %7 = addf %5, %6 : f64
+    %8 = mulf %7, %cst : f64
+    %9 = stencil.store_result %8 : (f64) -> !stencil.result<f64>
+    stencil.return %9 : !stencil.result<f64>
+  } to ([-1, -1, 0] : [65, 65, 60])
+  %4 = stencil.apply (%arg2 = %3 : !stencil.temp<66x66x60xf64>) -> !stencil.temp<64x64x60xf64> {
+    %5 = stencil.access %arg2 [-1, 0, 0] : (!stencil.temp<66x66x60xf64>) -> f64
+    %6 = stencil.access %arg2 [1, 0, 0] : (!stencil.temp<66x66x60xf64>) -> f64
+    %7 = stencil.access %arg2 [0, -1, 0] : (!stencil.temp<66x66x60xf64>) -> f64
+    %8 = stencil.access %arg2 [0, 1, 0] : (!stencil.temp<66x66x60xf64>) -> f64
+    %9 = addf %5, %6 : f64
+    %10 = addf %7, %8 : f64
+    %11 = addf %9, %10 : f64
+    %12 = stencil.store_result %11 : (f64) -> !stencil.result<f64>
+    stencil.return %12 : !stencil.result<f64>
+  } to ([0, 0, 0] : [64, 64, 60])
+  stencil.store %4 to %1([0, 0, 0] : [64, 64, 60]) : !stencil.temp<64x64x60xf64> to !stencil.field<70x70x60xf64>
+  return
+}
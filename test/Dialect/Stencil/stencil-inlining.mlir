@@ -1,4 +1,6 @@
 // RUN: oec-opt %s -split-input-file --stencil-inlining --cse | oec-opt | FileCheck %s
+// RUN: oec-opt %s -split-input-file --stencil-inlining='remarks=true' -o /dev/null 2>&1 | FileCheck --check-prefix=REMARK %s
+// RUN: oec-opt %s -split-input-file --stencil-inlining='inline-dyn-access=true' --cse | oec-opt | FileCheck --check-prefix=DYN %s
 
 // CHECK-LABEL: func @simple(%{{.*}}: !stencil.field<?x?x?xf64>, %{{.*}}: !stencil.field<?x?x?xf64>) attributes {stencil.program}
 //  CHECK-NEXT: %{{.*}} = stencil.cast %{{.*}}([-3, -3, -3] : [67, 67, 67]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<70x70x70xf64>
@@ -30,6 +32,8 @@ func @simple(%arg0: !stencil.field<?x?x?xf64>, %arg1: !stencil.field<?x?x?xf64>)
   return
 }
 
+// REMARK: remark: inlined the producer at {{.*}} at 1 offsets
+
 // -----
 
 //  CHECK-LABEL: func @simple_index(%{{.*}}: f64, %{{.*}}: !stencil.field<?x?x?xf64>) attributes {stencil.program}
@@ -256,6 +260,16 @@ func @root(%arg0: !stencil.field<?x?x?xf64>, %arg1: !stencil.field<?x?x?xf64>, %
 //  CHECK-DAG: stencil.return %{{.*}} : !stencil.result<f64>
 //  CHECK-NEXT: }
 //  CHECK-NEXT: stencil.store %{{.*}} to %{{.*}}([0, 0, 0] : [64, 64, 60]) : !stencil.temp<64x64x60xf64> to !stencil.field<70x70x70xf64>
+// DYN-LABEL: func @dyn_access(%{{.*}}: !stencil.field<?x?x?xf64>, %{{.*}}: !stencil.field<?x?x?xf64>) attributes {stencil.program}
+//       DYN: %{{.*}} = stencil.load %{{.*}} : (!stencil.field<70x70x70xf64>) -> !stencil.temp<68x66x62xf64>
+//  DYN-NEXT: %{{.*}} = stencil.apply ([[ARG0:%.*]] = %{{.*}} : !stencil.temp<68x66x62xf64>) ->
+//   DYN-DAG: %{{.*}} = stencil.index 0 [-1, 0, 0] : index
+//   DYN-DAG: %{{.*}} = stencil.index 0 [1, 0, 0] : index
+//   DYN-DAG: %{{.*}} = stencil.dyn_access [[ARG0]](%{{.*}}, %{{.*}}, %{{.*}}) in [-2, -1, -2] : [0, 1, 0] : (!stencil.temp<68x66x62xf64>) -> f64
+//   DYN-DAG: %{{.*}} = stencil.dyn_access [[ARG0]](%{{.*}}, %{{.*}}, %{{.*}}) in [0, -1, -2] : [2, 1, 0] : (!stencil.temp<68x66x62xf64>) -> f64
+//   DYN-DAG: stencil.return %{{.*}} : !stencil.result<f64>
+//  DYN-NEXT: }
+//  DYN-NEXT: stencil.store %{{.*}} to %{{.*}}([0, 0, 0] : [64, 64, 60]) : !stencil.temp<64x64x60xf64> to !stencil.field<70x70x70xf64>
 func @dyn_access(%arg0: !stencil.field<?x?x?xf64>, %arg1: !stencil.field<?x?x?xf64>) attributes {stencil.program} {
   %0 = stencil.cast %arg0([-3, -3, -3] : [67, 67, 67]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<70x70x70xf64>
   %1 = stencil.cast %arg1([-3, -3, -3] : [67, 67, 67]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<70x70x70xf64>
@@ -0,0 +1,83 @@
+// RUN: oec-opt %s -split-input-file --stencil-unrolling='unroll-factor=4 adaptive=true' -cse | oec-opt | FileCheck %s
+// RUN: oec-opt %s -split-input-file --stencil-unrolling='unroll-factor=4 adaptive=true max-registers=48' -cse | oec-opt | FileCheck --check-prefix=CHECK48 %s
+
+// CHECK-LABEL: func @vertical
+// CHECK48-LABEL: func @vertical
+func @vertical(%arg0 : !stencil.field<?x?x?xf64>, %arg1 : !stencil.field<?x?x?xf64>) attributes { stencil.program } {
+  %0 = stencil.cast %arg0([-3, -3, 0] : [67, 67, 60]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<70x70x60xf64>
+  %1 = stencil.cast %arg1([-3, -3, 0] : [67, 67, 60]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<70x70x60xf64>
+  %2 = stencil.load %0([-1, -1, 0] : [65, 65, 60]) : (!stencil.field<70x70x60xf64>) -> !stencil.temp<66x66x60xf64>
+  %3 = stencil.apply (%arg2 = %2 : !stencil.temp<66x66x60xf64>) -> !stencil.temp<64x64x60xf64> {
+    %4 = stencil.access %arg2 [0, -1, 0] : (!stencil.temp<66x66x60xf64>) -> f64
+    %5 = stencil.access %arg2 [0, 0, 0] : (!stencil.temp<66x66x60xf64>) -> f64
+    %6 = stencil.access %arg2 [0, 1, 0] : (!stencil.temp<66x66x60xf64>) -> f64
+    %7 = addf %4, %5 : f64
+    %8 = addf %7, %6 : f64
+    // CHECK: stencil.return unroll [1, 4, 1]
+    // CHECK48: stencil.return unroll [1, 4, 1]
+    %9 = stencil.store_result %8 : (f64) -> !stencil.result<f64>
+    stencil.return %9 : !stencil.result<f64>
+  } to ([0, 0, 0] : [64, 64, 60])
+  stencil.store %3 to %1([0, 0, 0] : [64, 64, 60]) : !stencil.temp<64x64x60xf64> to !stencil.field<70x70x60xf64>
+  return
+}
+
+// -----
+
+// CHECK-LABEL: func @horizontal
+// CHECK48-LABEL: func @horizontal
+func @horizontal(%arg0 : !stencil.field<?x?x?xf64>, %arg1 : !stencil.field<?x?x?xf64>) attributes { stencil.program } {
+  %0 = stencil.cast %arg0([-3, -3, 0] : [67, 67, 60]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<70x70x60xf64>
+  %1 = stencil.cast %arg1([-3, -3, 0] : [67, 67, 60]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<70x70x60xf64>
+  %2 = stencil.load %0([-1, -1, 0] : [65, 65, 60]) : (!stencil.field<70x70x60xf64>) -> !stencil.temp<66x66x60xf64>
+  %3 = stencil.apply (%arg2 = %2 : !stencil.temp<66x66x60xf64>) -> !stencil.temp<64x64x60xf64> {
+    %4 = stencil.access %arg2 [-1, 0, 0] : (!stencil.temp<66x66x60xf64>) -> f64
+    %5 = stencil.access %arg2 [0, 0, 0] : (!stencil.temp<66x66x60xf64>) -> f64
+    %6 = stencil.access %arg2 [1, 0, 0] : (!stencil.temp<66x66x60xf64>) -> f64
+    %7 = addf %4, %5 : f64
+    %8 = addf %7, %6 : f64
+    // CHECK-NOT: unroll
+    // CHECK: stencil.return {{%.*}} : !stencil.result<f64>
+    // CHECK48-NOT: unroll
+    // CHECK48: stencil.return {{%.*}} : !stencil.result<f64>
+    %9 = stencil.store_result %8 : (f64) -> !stencil.result<f64>
+    stencil.return %9 : !stencil.result<f64>
+  } to ([0, 0, 0] : [64, 64, 60])
+  stencil.store %3 to %1([0, 0, 0] : [64, 64, 60]) : !stencil.temp<64x64x60xf64> to !stencil.field<70x70x60xf64>
+  return
+}
+
+// -----
+
+// CHECK-LABEL: func @box
+// CHECK48-LABEL: func @box
+func @box(%arg0 : !stencil.field<?x?x?xf64>, %arg1 : !stencil.field<?x?x?xf64>) attributes { stencil.program } {
+  %0 = stencil.cast %arg0([-3, -3, 0] : [67, 67, 60]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<70x70x60xf64>
+  %1 = stencil.cast %arg1([-3, -3, 0] : [67, 67, 60]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<70x70x60xf64>
+  %2 = stencil.load %0([-1, -1, 0] : [65, 65, 60]) : (!stencil.field<70x70x60xf64>) -> !stencil.temp<66x66x60xf64>
+  %3 = stencil.apply (%arg2 = %2 : !stencil.temp<66x66x60xf64>) -> !stencil.temp<64x64x60xf64> {
+    %4 = stencil.access %arg2 [-1, -1, 0] : (!stencil.temp<66x66x60xf64>) -> f64
+    %5 = stencil.access %arg2 [0, -1, 0] : (!stencil.temp<66x66x60xf64>) -> f64
+    %6 = stencil.access %arg2 [1, -1, 0] : (!stencil.temp<66x66x60xf64>) -> f64
+    %7 = stencil.access %arg2 [-1, 0, 0] : (!stencil.temp<66x66x60xf64>) -> f64
+    %8 = stencil.access %arg2 [0, 0, 0] : (!stencil.temp<66x66x60xf64>) -> f64
+    %9 = stencil.access %arg2 [1, 0, 0] : (!stencil.temp<66x66x60xf64>) -> f64
+    %10 = stencil.access %arg2 [-1, 1, 0] : (!stencil.temp<66x66x60xf64>) -> f64
+    %11 = stencil.access %arg2 [0, 1, 0] : (!stencil.temp<66x66x60xf64>) -> f64
+    %12 = stencil.access %arg2 [1, 1, 0] : (!stencil.temp<66x66x60xf64>) -> f64
+    %13 = addf %4, %5 : f64
+    %14 = addf %13, %6 : f64
+    %15 = addf %14, %7 : f64
+    %16 = addf %15, %8 : f64
+    %17 = addf %16, %9 : f64
+    %18 = addf %17, %10 : f64
+    %19 = addf %18, %11 : f64
+    %20 = addf %19, %12 : f64
+    // CHECK: stencil.return unroll [1, 4, 1]
+    // CHECK48: stencil.return unroll [1, 2, 1]
+    %21 = stencil.store_result %20 : (f64) -> !stencil.result<f64>
+    stencil.return %21 : !stencil.result<f64>
+  } to ([0, 0, 0] : [64, 64, 60])
+  stencil.store %3 to %1([0, 0, 0] : [64, 64, 60]) : !stencil.temp<64x64x60xf64> to !stencil.field<70x70x60xf64>
+  return
+}
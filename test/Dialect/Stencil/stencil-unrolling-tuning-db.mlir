@@ -0,0 +1,53 @@
+// RUN: oec-opt %s -split-input-file --stencil-unrolling='tuning-db=%S/Inputs/tuning-db.json' | FileCheck %s
+// RUN: oec-opt %s --stencil-unrolling='tuning-db=%S/Inputs/tuning-db.json' | FileCheck %s
+
+// CHECK-LABEL: func @tuned
+func @tuned(%arg0 : !stencil.field<?x?x?xf64>, %arg1 : !stencil.field<?x?x?xf64>) attributes { stencil.program } {
+  %0 = stencil.cast %arg0([-3, -3, 0] : [67, 67, 60]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<70x70x60xf64>
+  %1 = stencil.cast %arg1([-3, -3, 0] : [67, 67, 60]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<70x70x60xf64>
+  %2 = stencil.load %0([0, 0, 0] : [64, 64, 60]) : (!stencil.field<70x70x60xf64>) -> !stencil.temp<64x64x60xf64>
+  %3 = stencil.apply (%arg2 = %2 : !stencil.temp<64x64x60xf64>) -> !stencil.temp<64x64x60xf64> {
+    // CHECK-DAG: stencil.access {{%.*}}[0, 0, 3] : (!stencil.temp<64x64x60xf64>) -> f64
+    %4 = stencil.access %arg2[0, 0, 0] : (!stencil.temp<64x64x60xf64>) -> f64
+    %5 = stencil.store_result %4 : (f64) -> !stencil.result<f64>
+    // CHECK: stencil.return unroll [1, 1, 4]
+    stencil.return %5 : !stencil.result<f64>
+  } to ([0, 0, 0] : [64, 64, 60])
+  stencil.store %3 to %1([0, 0, 0] : [64, 64, 60]) : !stencil.temp<64x64x60xf64> to !stencil.field<70x70x60xf64>
+  return
+}
+
+// -----
+
+// CHECK-LABEL: func @partially_tuned
+func @partially_tuned(%arg0 : !stencil.field<?x?x?xf64>, %arg1 : !stencil.field<?x?x?xf64>) attributes { stencil.program } {
+  %0 = stencil.cast %arg0([-3, -3, 0] : [67, 67, 60]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<70x70x60xf64>
+  %1 = stencil.cast %arg1([-3, -3, 0] : [67, 67, 60]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<70x70x60xf64>
+  %2 = stencil.load %0([0, 0, 0] : [64, 66, 60]) : (!stencil.field<70x70x60xf64>) -> !stencil.temp<64x66x60xf64>
+  %3 = stencil.apply (%arg2 = %2 : !stencil.temp<64x66x60xf64>) -> !stencil.temp<64x66x60xf64> {
+    // CHECK-DAG: stencil.access {{%.*}}[0, 2, 0] : (!stencil.temp<64x66x60xf64>) -> f64
+    %4 = stencil.access %arg2[0, 0, 0] : (!stencil.temp<64x66x60xf64>) -> f64
+    %5 = stencil.store_result %4 : (f64) -> !stencil.result<f64>
+    // CHECK: stencil.return unroll [1, 3, 1]
+    stencil.return %5 : !stencil.result<f64>
+  } to ([0, 0, 0] : [64, 66, 60])
+  stencil.store %3 to %1([0, 0, 0] : [64, 66, 60]) : !stencil.temp<64x66x60xf64> to !stencil.field<70x70x60xf64>
+  return
+}
+
+// -----
+
+// CHECK-LABEL: func @untuned
+func @untuned(%arg0 : !stencil.field<?x?x?xf64>, %arg1 : !stencil.field<?x?x?xf64>) attributes { stencil.program } {
+  %0 = stencil.cast %arg0([-3, -3, 0] : [67, 67, 60]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<70x70x60xf64>
+  %1 = stencil.cast %arg1([-3, -3, 0] : [67, 67, 60]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<70x70x60xf64>
+  %2 = stencil.load %0([0, 0, 0] : [64, 64, 60]) : (!stencil.field<70x70x60xf64>) -> !stencil.temp<64x64x60xf64>
+  %3 = stencil.apply (%arg2 = %2 : !stencil.temp<64x64x60xf64>) -> !stencil.temp<64x64x60xf64> {
+    %4 = stencil.access %arg2[0, 0, 0] : (!stencil.temp<64x64x60xf64>) -> f64
+    %5 = stencil.store_result %4 : (f64) -> !stencil.result<f64>
+    // CHECK: stencil.return unroll [1, 2, 1]
+    stencil.return %5 : !stencil.result<f64>
+  } to ([0, 0, 0] : [64, 64, 60])
+  stencil.store %3 to %1([0, 0, 0] : [64, 64, 60]) : !stencil.temp<64x64x60xf64> to !stencil.field<70x70x60xf64>
+  return
+}
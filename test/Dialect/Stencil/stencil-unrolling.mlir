@@ -1,4 +1,5 @@
 // RUN: oec-opt %s -split-input-file --stencil-unrolling='unroll-factor=4' -cse | oec-opt | FileCheck %s
+// RUN: oec-opt %s -split-input-file --stencil-unrolling='unroll-factors=1,2,2' | oec-opt | FileCheck --check-prefix=FACTORS %s
 
 // CHECK-LABEL: func @access
 func @access(%arg0 : !stencil.field<?x?x?xf64>, %arg1 : !stencil.field<?x?x?xf64>) attributes { stencil.program } {
@@ -69,3 +70,32 @@ func @dyn_access(%arg0 : !stencil.field<?x?x?xf64>, %arg1 : !stencil.field<?x?x?
   return
 }
 
+// -----
+
+// FACTORS-LABEL: func @shared_access
+func @shared_access(%arg0 : !stencil.field<?x?x?xf64>, %arg1 : !stencil.field<?x?x?xf64>) attributes { stencil.program } {
+  %0 = stencil.cast %arg0([-3, -3, 0] : [67, 67, 60]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<70x70x60xf64>
+  %1 = stencil.cast %arg1([-3, -3, 0] : [67, 67, 60]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<70x70x60xf64>
+  %2 = stencil.load %0([0, 0, 0] : [64, 65, 60]) : (!stencil.field<70x70x60xf64>) -> !stencil.temp<64x65x60xf64>
+  %3 = stencil.apply (%arg2 = %2 : !stencil.temp<64x65x60xf64>) -> !stencil.temp<64x64x60xf64> {
+    // FACTORS-DAG: [[ACC1:%.*]] = stencil.access {{%.*}}[0, 0, 0] : (!stencil.temp<64x65x60xf64>) -> f64
+    // FACTORS-DAG: [[ACC2:%.*]] = stencil.access {{%.*}}[0, 1, 0] : (!stencil.temp<64x65x60xf64>) -> f64
+    // FACTORS-DAG: [[ACC3:%.*]] = stencil.access {{%.*}}[0, 2, 0] : (!stencil.temp<64x65x60xf64>) -> f64
+    // FACTORS-DAG: [[ACC4:%.*]] = stencil.access {{%.*}}[0, 0, 1] : (!stencil.temp<64x65x60xf64>) -> f64
+    // FACTORS-DAG: [[ACC5:%.*]] = stencil.access {{%.*}}[0, 1, 1] : (!stencil.temp<64x65x60xf64>) -> f64
+    // FACTORS-DAG: [[ACC6:%.*]] = stencil.access {{%.*}}[0, 2, 1] : (!stencil.temp<64x65x60xf64>) -> f64
+    // FACTORS-NOT: stencil.access
+    // FACTORS-DAG: addf [[ACC1]], [[ACC2]] : f64
+    // FACTORS-DAG: addf [[ACC2]], [[ACC3]] : f64
+    // FACTORS-DAG: addf [[ACC4]], [[ACC5]] : f64
+    // FACTORS-DAG: addf [[ACC5]], [[ACC6]] : f64
+    %4 = stencil.access %arg2[0, 0, 0] : (!stencil.temp<64x65x60xf64>) -> f64
+    %5 = stencil.access %arg2[0, 1, 0] : (!stencil.temp<64x65x60xf64>) -> f64
+    %6 = addf %4, %5 : f64
+    %7 = stencil.store_result %6 : (f64) -> !stencil.result<f64>
+    // FACTORS: stencil.return unroll [1, 2, 2] {{%.*}}, {{%.*}}, {{%.*}}, {{%.*}} : !stencil.result<f64>, !stencil.result<f64>, !stencil.result<f64>, !stencil.result<f64>
+    stencil.return %7 : !stencil.result<f64>
+  } to ([0, 0, 0] : [64, 64, 60])
+  stencil.store %3 to %1([0, 0, 0] : [64, 64, 60]) : !stencil.temp<64x64x60xf64> to !stencil.field<70x70x60xf64>
+  return
+}
@@ -0,0 +1,50 @@
+// RUN: oec-opt %s -split-input-file --stencil-temporal-blocking='time-steps=2' | FileCheck %s
+
+// CHECK-LABEL: func @laplace
+func @laplace(%arg0: !stencil.field<?x?x?xf64>, %arg1: !stencil.field<?x?x?xf64> {stencil.update = 0}) attributes {stencil.program} {
+  %0 = stencil.cast %arg0([-4, -4, -4] : [68, 68, 68]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<72x72x72xf64>
+  %1 = stencil.cast %arg1([-4, -4, -4] : [68, 68, 68]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<72x72x72xf64>
+  //  CHECK: [[LOAD:%.*]] = stencil.load
+  //  CHECK: [[STEP0:%.*]] = stencil.apply
+  //  CHECK-NOT: stencil.store
+  //  CHECK: [[BOUNDARY:%.*]] = stencil.apply ([[ARG0:%.*]] = [[STEP0]] : !stencil.temp<?x?x?xf64>, [[ARG1:%.*]] = [[LOAD]] : !stencil.temp<?x?x?xf64>)
+  //  CHECK: stencil.index 0 [0, 0, 0]
+  //  CHECK: stencil.index 1 [0, 0, 0]
+  //  CHECK-NOT: stencil.index 2
+  //  CHECK: select
+  //  CHECK: [[STEP1:%.*]] = stencil.apply ({{.*}} = [[BOUNDARY]] : !stencil.temp<?x?x?xf64>)
+  //  CHECK: stencil.store [[STEP1]] to %{{.*}}([0, 0, 0] : [64, 64, 64])
+  //  CHECK-NOT: stencil.store
+  %2 = stencil.load %0 : (!stencil.field<72x72x72xf64>) -> !stencil.temp<?x?x?xf64>
+  %3 = stencil.apply (%arg2 = %2 : !stencil.temp<?x?x?xf64>) -> !stencil.temp<?x?x?xf64> {
+    %4 = stencil.access %arg2 [-1, 0, 0] : (!stencil.temp<?x?x?xf64>) -> f64
+    %5 = stencil.access %arg2 [1, 0, 0] : (!stencil.temp<?x?x?xf64>) -> f64
+    %6 = stencil.access %arg2 [0, 1, 0] : (!stencil.temp<?x?x?xf64>) -> f64
+    %7 = stencil.access %arg2 [0, -1, 0] : (!stencil.temp<?x?x?xf64>) -> f64
+    %8 = addf %4, %5 : f64
+    %9 = addf %6, %7 : f64
+    %10 = addf %8, %9 : f64
+    %11 = stencil.store_result %10 : (f64) -> !stencil.result<f64>
+    stencil.return %11 : !stencil.result<f64>
+  }
+  stencil.store %3 to %1([0, 0, 0] : [64, 64, 64]) : !stencil.temp<?x?x?xf64> to !stencil.field<72x72x72xf64>
+  return
+}
+
+// -----
+
+// CHECK-LABEL: func @no_update
+func @no_update(%arg0: !stencil.field<?x?x?xf64>, %arg1: !stencil.field<?x?x?xf64>) attributes {stencil.program} {
+  %0 = stencil.cast %arg0([-4, -4, -4] : [68, 68, 68]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<72x72x72xf64>
+  %1 = stencil.cast %arg1([-4, -4, -4] : [68, 68, 68]) : (!stencil.field<?x?x?xf64>) -> !stencil.field<72x72x72xf64>
+  //  CHECK-COUNT-1: stencil.apply
+  //  CHECK-NOT: stencil.apply
+  %2 = stencil.load %0 : (!stencil.field<72x72x72xf64>) -> !stencil.temp<?x?x?xf64>
+  %3 = stencil.apply (%arg2 = %2 : !stencil.temp<?x?x?xf64>) -> !stencil.temp<?x?x?xf64> {
+    %4 = stencil.access %arg2 [-1, 0, 0] : (!stencil.temp<?x?x?xf64>) -> f64
+    %5 = stencil.store_result %4 : (f64) -> !stencil.result<f64>
+    stencil.return %5 : !stencil.result<f64>
+  }
+  stencil.store %3 to %1([0, 0, 0] : [64, 64, 64]) : !stencil.temp<?x?x?xf64> to !stencil.field<72x72x72xf64>
+  return
+}
@@ -0,0 +1,176 @@
+#!/usr/bin/env python3
+# -*- Python -*-
+"""Benchmark the example stencil programs.
+
+The tool compiles every stencil program through the documented oec-opt
+pipeline, times the program on the configured domain size, and reports the
+kernel time, the achieved bandwidth, and the fraction of the roofline as
+json. The bandwidth counts one load or store of the domain per field
+argument, which is the minimal memory traffic of the program.
+"""
+
+import argparse
+import datetime
+import glob
+import json
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import oec_runner  # noqa: E402
+
+FLOAT_OPS_RE = re.compile(r'=\s*(addf|subf|mulf|divf|negf|sqrt|exp|log)\b')
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('inputs', nargs='+',
+                        help='stencil program files or directories')
+    parser.add_argument('--backend', choices=oec_runner.BACKENDS,
+                        default='cuda', help='target backend')
+    parser.add_argument('--domain', default='64,64,64',
+                        help='domain size of the programs')
+    parser.add_argument('--tile-sizes', default='128,1,1',
+                        help='tile sizes of the parallel loops')
+    parser.add_argument('--unroll-factor', type=int, default=1,
+                        help='unroll factor of the stencil unrolling pass')
+    parser.add_argument('--unroll-index', type=int, default=1,
+                        help='unroll index of the stencil unrolling pass')
+    parser.add_argument('--repetitions', type=int, default=20,
+                        help='timed executions per program')
+    parser.add_argument('--peak-bandwidth', type=float, default=None,
+                        help='peak memory bandwidth in GB/s')
+    parser.add_argument('--peak-gflops', type=float, default=None,
+                        help='peak floating point throughput in GFLOP/s')
+    parser.add_argument('-o', '--output', default=None,
+                        help='json output file (default stdout)')
+    parser.add_argument('--tool-dir', default=None,
+                        help='directory containing oec-opt and the llvm tools')
+    parser.add_argument('--mlir-lib-dir', default=None,
+                        help='directory containing the mlir runtime libraries')
+    parser.add_argument('--work-dir', default=None,
+                        help='directory storing the compiled programs')
+    return parser.parse_args()
+
+
+def collect_inputs(inputs):
+    files = []
+    for path in inputs:
+        if os.path.isdir(path):
+            files += sorted(glob.glob(os.path.join(path, '*.mlir')))
+        else:
+            files.append(path)
+    return files
+
+
+def get_revision():
+    """Return the git revision of the benchmarked sources if available."""
+    try:
+        return subprocess.check_output(
+            ['git', 'rev-parse', 'HEAD'], stderr=subprocess.DEVNULL,
+            cwd=os.path.dirname(os.path.abspath(__file__)),
+            universal_newlines=True).strip()
+    except (OSError, subprocess.CalledProcessError):
+        return None
+
+
+def count_points(argument, domain):
+    count = 1
+    for dim in argument.dims:
+        count *= domain[dim]
+    return count
+
+
+def benchmark_program(tools, program, path, args, domain, work_dir):
+    """Return the benchmark result of one program."""
+    result = {'program': program.name, 'file': os.path.basename(path)}
+
+    # Compute the minimal memory traffic and the floating point operations
+    # (every operation of the program body is executed once per domain point)
+    num_bytes = sum(count_points(argument, domain) *
+                    oec_runner.ELEMENT_BYTES[argument.element_type]
+                    for argument in program.arguments if argument.is_field)
+    num_flops = len(FLOAT_OPS_RE.findall(program.body)) * domain[0] * \
+        domain[1] * domain[2]
+    result['bytes'] = num_bytes
+    result['flops'] = num_flops
+
+    options = oec_runner.pipeline(
+        args.backend, oec_runner.parse_list(args.tile_sizes),
+        args.unroll_factor, args.unroll_index)
+    try:
+        time = oec_runner.measure(tools, program, options, args.backend,
+                                  args.repetitions, work_dir)
+    except oec_runner.ToolError as error:
+        result['status'] = 'error'
+        result['error'] = str(error)
+        return result
+
+    seconds = time * 1e-3
+    result['status'] = 'ok'
+    result['time_ms'] = time
+    result['bandwidth_gbs'] = num_bytes / seconds * 1e-9
+    result['gflops'] = num_flops / seconds * 1e-9
+    if args.peak_bandwidth:
+        # The roofline time is limited by memory or by compute
+        roofline = num_bytes / (args.peak_bandwidth * 1e9)
+        if args.peak_gflops:
+            roofline = max(roofline, num_flops / (args.peak_gflops * 1e9))
+        result['roofline_fraction'] = roofline / seconds
+    return result
+
+
+def main():
+    args = parse_args()
+    domain = oec_runner.parse_list(args.domain)
+    if len(domain) != 3 or any(size <= 0 for size in domain):
+        sys.exit('oec-bench: expected three positive domain sizes')
+    try:
+        tools = oec_runner.Tools(args.tool_dir, args.mlir_lib_dir)
+    except oec_runner.ToolError as error:
+        sys.exit('oec-bench: {}'.format(error))
+
+    work_dir = args.work_dir or tempfile.mkdtemp(prefix='oec-bench-')
+    results = []
+    for path in collect_inputs(args.inputs):
+        # Resize the program to the benchmark domain
+        with open(path) as f:
+            text = oec_runner.resize_domain(f.read(), domain)
+        name = os.path.splitext(os.path.basename(path))[0]
+        file_dir = os.path.join(work_dir, name)
+        os.makedirs(file_dir, exist_ok=True)
+        resized = os.path.join(file_dir, os.path.basename(path))
+        with open(resized, 'w') as f:
+            f.write(text)
+        for program in oec_runner.parse_programs(resized):
+            print('benchmarking {}'.format(program.name), file=sys.stderr)
+            results.append(benchmark_program(
+                tools, program, path, args, domain,
+                os.path.join(file_dir, program.name)))
+
+    report = {
+        'revision': get_revision(),
+        'date': datetime.datetime.now().isoformat(),
+        'backend': args.backend,
+        'domain': domain,
+        'tile_sizes': args.tile_sizes,
+        'unroll_factor': args.unroll_factor,
+        'unroll_index': args.unroll_index,
+        'peak_bandwidth_gbs': args.peak_bandwidth,
+        'peak_gflops': args.peak_gflops,
+        'results': results,
+    }
+    if args.output:
+        with open(args.output, 'w') as f:
+            json.dump(report, f, indent=2)
+            f.write('\n')
+    else:
+        json.dump(report, sys.stdout, indent=2)
+        sys.stdout.write('\n')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,148 @@
+#!/usr/bin/env python3
+# -*- Python -*-
+"""Autotune the lowering parameters of stencil programs.
+
+The tool compiles every variant of the search space through the oec-opt
+pipelines, times the variants on the target, and stores the fastest
+configuration of every stencil program in a tuning database. The database
+maps the program names to their parameters:
+
+  { "hdiff": { "unroll-factor": 2, "unroll-index": 1,
+               "tile-sizes": [128, 1, 1], "time-ms": 0.081 } }
+
+Pass the database to the stencil unrolling pass using the tuning-db option
+to apply the tuned unrolling parameters.
+"""
+
+import argparse
+import itertools
+import json
+import os
+import sys
+import tempfile
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import oec_runner  # noqa: E402
+
+DEFAULT_TILE_SIZES = {
+    'cuda': '128,1,1;64,2,1;32,4,1;256,1,1',
+    # Keep the i-dimension tile a multiple of the 64-wide wavefronts
+    'rocm': '64,1,1;128,1,1;64,2,1;64,4,1;256,1,1',
+    'cpu': '64,4,4;256,2,2;32,8,8',
+}
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('inputs', nargs='+', help='stencil program files')
+    parser.add_argument('--backend', choices=oec_runner.BACKENDS,
+                        default='cuda', help='target backend')
+    parser.add_argument('--tile-sizes', default=None,
+                        help='tile size variants separated by semicolons '
+                        '(e.g. "128,1,1;64,2,1")')
+    parser.add_argument('--unroll-factors', default='1,2,4',
+                        help='unroll factor variants')
+    parser.add_argument('--unroll-indexes', default='1,2',
+                        help='unroll index variants')
+    parser.add_argument('--vector-widths', default='4',
+                        help='vector width variants of the cpu backend')
+    parser.add_argument('--repetitions', type=int, default=10,
+                        help='timed executions per variant')
+    parser.add_argument('-o', '--database', default='tuning-db.json',
+                        help='tuning database to update')
+    parser.add_argument('--tool-dir', default=None,
+                        help='directory containing oec-opt and the llvm tools')
+    parser.add_argument('--mlir-lib-dir', default=None,
+                        help='directory containing the mlir runtime libraries')
+    parser.add_argument('--work-dir', default=None,
+                        help='directory storing the compiled variants')
+    parser.add_argument('-v', '--verbose', action='store_true',
+                        help='print the timing of every variant')
+    return parser.parse_args()
+
+
+def search_space(args):
+    """Return the variants as tuples of tile sizes, unroll factor, unroll
+    index, and vector width."""
+    tile_sizes = args.tile_sizes or DEFAULT_TILE_SIZES[args.backend]
+    tile_variants = [oec_runner.parse_list(tiles)
+                     for tiles in tile_sizes.split(';')]
+    vector_widths = oec_runner.parse_list(args.vector_widths)
+    if args.backend != 'cpu':
+        vector_widths = vector_widths[:1]
+    variants = []
+    for tiles, factor, index, width in itertools.product(
+            tile_variants, oec_runner.parse_list(args.unroll_factors),
+            oec_runner.parse_list(args.unroll_indexes), vector_widths):
+        # Unrolling by one does not depend on the unroll index
+        if factor == 1 and any(v[1] == 1 and v[0] == tiles and v[3] == width
+                               for v in variants):
+            continue
+        variants.append((tiles, factor, index, width))
+    return variants
+
+
+def tune_program(tools, program, args, work_dir):
+    """Return the fastest configuration of a program or None."""
+    best = None
+    for number, (tiles, factor, index, width) in enumerate(
+            search_space(args)):
+        options = oec_runner.pipeline(args.backend, tiles, factor, index,
+                                      width)
+        variant_dir = os.path.join(work_dir, program.name, str(number))
+        try:
+            time = oec_runner.measure(tools, program, options, args.backend,
+                                      args.repetitions, variant_dir)
+        except oec_runner.ToolError as error:
+            if args.verbose:
+                print('  skipping variant {}: {}'.format(number, error),
+                      file=sys.stderr)
+            continue
+        if args.verbose:
+            print('  tiles={} unroll-factor={} unroll-index={} '
+                  'vector-width={}: {:.4f} ms'.format(
+                      tiles, factor, index, width, time))
+        if best is None or time < best['time-ms']:
+            best = {'unroll-factor': factor, 'unroll-index': index,
+                    'tile-sizes': tiles, 'time-ms': time,
+                    'backend': args.backend}
+            if args.backend == 'cpu':
+                best['vector-width'] = width
+    return best
+
+
+def main():
+    args = parse_args()
+    try:
+        tools = oec_runner.Tools(args.tool_dir, args.mlir_lib_dir)
+    except oec_runner.ToolError as error:
+        sys.exit('oec-tune: {}'.format(error))
+
+    # Update the existing database
+    database = {}
+    if os.path.exists(args.database):
+        with open(args.database) as f:
+            database = json.load(f)
+
+    work_dir = args.work_dir or tempfile.mkdtemp(prefix='oec-tune-')
+    for path in args.inputs:
+        for program in oec_runner.parse_programs(path):
+            print('tuning {}'.format(program.name))
+            best = tune_program(tools, program, args, work_dir)
+            if best is None:
+                print('  no variant of {} ran successfully'.format(
+                    program.name), file=sys.stderr)
+                continue
+            print('  best: unroll-factor={} unroll-index={} tile-sizes={} '
+                  '({:.4f} ms)'.format(best['unroll-factor'],
+                                       best['unroll-index'],
+                                       best['tile-sizes'], best['time-ms']))
+            database[program.name] = best
+
+    with open(args.database, 'w') as f:
+        json.dump(database, f, indent=2, sort_keys=True)
+        f.write('\n')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,345 @@
+# -*- Python -*-
+"""Compile stencil programs through the oec pipelines and time them.
+
+The module parses the stencil programs of an input file, lowers them using
+the documented oec-opt pipelines, links the lowered code with a generated
+host driver that calls the C interface of the program, and runs the driver
+to measure the execution time.
+"""
+
+import os
+import re
+import shutil
+import subprocess
+
+BACKENDS = ['cuda', 'rocm', 'cpu']
+
+C_TYPES = {'f64': 'double', 'f32': 'float', 'i64': 'int64_t', 'i32': 'int32_t'}
+ELEMENT_BYTES = {'f64': 8, 'f32': 4, 'i64': 8, 'i32': 4}
+
+FUNC_RE = re.compile(
+    r'func\s+@(\w+)\s*\((.*?)\)\s*attributes\s*\{[^}]*stencil\.program',
+    re.DOTALL)
+ARG_RE = re.compile(r'%(\w+)\s*:\s*(!stencil\.field<[^>]*>|\w+)')
+CAST_RE = r'stencil\.cast\s+%{}\s*\(.*?\)\s*:\s*\(.*?\)\s*->\s*' \
+          r'!stencil\.field<([^>]*)>'
+
+
+class ToolError(Exception):
+    """Error raised if compiling or running a variant fails."""
+
+
+class Argument:
+    """Argument of a stencil program.
+
+    Fields store their memref shape (the reversed non-zero field dimensions)
+    and the indexes of the non-zero field dimensions. Scalars store empty
+    shapes.
+    """
+
+    def __init__(self, name, element_type, shape, dims, is_field):
+        self.name = name
+        self.element_type = element_type
+        self.shape = shape
+        self.dims = dims
+        self.is_field = is_field
+
+    def num_elements(self):
+        count = 1
+        for size in self.shape:
+            count *= size
+        return count
+
+    def num_bytes(self):
+        return self.num_elements() * ELEMENT_BYTES[self.element_type]
+
+
+class Program:
+    """Stencil program found in an input file."""
+
+    def __init__(self, name, arguments, path, body):
+        self.name = name
+        self.arguments = arguments
+        self.path = path
+        self.body = body
+
+
+def function_body(text, start):
+    """Return the body of the function whose attributes end after start."""
+    begin = text.find('{', text.find('}', start))
+    depth = 0
+    for index in range(begin, len(text)):
+        if text[index] == '{':
+            depth += 1
+        elif text[index] == '}':
+            depth -= 1
+            if depth == 0:
+                return text[begin:index + 1]
+    return text[begin:]
+
+
+def parse_programs(path):
+    """Return the stencil programs of a file and their argument shapes."""
+    with open(path) as f:
+        text = f.read()
+    matches = list(FUNC_RE.finditer(text))
+    programs = []
+    for match in matches:
+        body = function_body(text, match.end())
+        arguments = []
+        for name, type in ARG_RE.findall(match.group(2)):
+            if not type.startswith('!stencil.field'):
+                arguments.append(Argument(name, type, [], [], False))
+                continue
+            # Read the static field shape from the cast operation
+            cast = re.search(CAST_RE.format(name), body, re.DOTALL)
+            if not cast:
+                raise ToolError('no cast for argument %{} of {}'.format(
+                    name, match.group(1)))
+            dims = cast.group(1).split('x')
+            shape = [int(dim) for dim in dims[:-1] if int(dim) != 0]
+            present = [i for i, dim in enumerate(dims[:-1]) if int(dim) != 0]
+            arguments.append(Argument(name, dims[-1], list(reversed(shape)),
+                                      present, True))
+        programs.append(Program(match.group(1), arguments, path, body))
+    return programs
+
+
+def parse_list(text):
+    """Return the integers of a comma separated list."""
+    return [int(value) for value in text.split(',') if value]
+
+
+def resize_domain(text, domain, reference=64):
+    """Return a stencil file resized from the reference domain size.
+
+    The function shifts all upper bounds and static field sizes by the
+    difference between the domain and the reference domain size, which keeps
+    the halos of the example programs unchanged.
+    """
+    def shift_bounds(match):
+        upper = [int(value) for value in match.group(2).split(',')]
+        upper = [value + size - reference
+                 for value, size in zip(upper, domain)]
+        return '([{}] : [{}])'.format(
+            match.group(1), ', '.join(str(value) for value in upper))
+
+    def shift_type(match):
+        dims = match.group(2).split('x')
+        dims = [dim if dim in ('?', '0') else str(int(dim) + size - reference)
+                for dim, size in zip(dims, domain)]
+        return '{}<{}x'.format(match.group(1), 'x'.join(dims))
+
+    text = re.sub(r'\(\[([-0-9, ]*)\]\s*:\s*\[([-0-9, ]*)\]\)',
+                  shift_bounds, text)
+    return re.sub(r'(!stencil\.(?:field|temp))<((?:[0-9?]+x){2}[0-9?]+)x',
+                  shift_type, text)
+
+
+def pipeline(backend, tile_sizes=None, unroll_factor=1, unroll_index=1,
+             vector_width=4, extra_options=None):
+    """Return the oec-opt options of the documented lowering pipelines."""
+    options = ['--stencil-inlining', '--cse', '--canonicalize']
+    if unroll_factor > 1:
+        options += ['--stencil-unrolling=unroll-factor={} unroll-index={}'.
+                    format(unroll_factor, unroll_index), '--cse',
+                    '--canonicalize']
+    options += ['--stencil-shape-inference', '--convert-stencil-to-std',
+                '--cse']
+    options += extra_options or []
+    tiles = ','.join(str(size) for size in tile_sizes or [])
+    if backend == 'cpu':
+        cpu_options = 'vector-width={}'.format(vector_width)
+        if tiles:
+            cpu_options += ' tile-sizes=' + tiles
+        return options + ['--canonicalize',
+                          '--stencil-kernel-to-cpu=' + cpu_options]
+    if tiles:
+        options += ['--parallel-loop-tiling=parallel-loop-tile-sizes=' + tiles]
+    options += ['--canonicalize', '--test-gpu-greedy-parallel-loop-mapping',
+                '--convert-parallel-loops-to-gpu', '--canonicalize',
+                '--lower-affine', '--convert-scf-to-std']
+    if backend == 'rocm':
+        return options + ['--stencil-kernel-to-hsaco']
+    return options + ['--stencil-kernel-to-cubin']
+
+
+class Tools:
+    """Paths of the tools and libraries used to build the drivers."""
+
+    def __init__(self, tool_dir=None, mlir_lib_dir=None, cc=None):
+        search = os.pathsep.join(
+            [tool_dir or '', os.path.dirname(os.path.abspath(__file__)),
+             os.environ.get('PATH', '')])
+        self.oec_opt = self._find('oec-opt', search)
+        self.mlir_translate = self._find('mlir-translate', search)
+        self.llc = self._find('llc', search)
+        self.cc = cc or os.environ.get('CC') or self._find('cc', search)
+        self.mlir_lib_dir = mlir_lib_dir or os.path.join(
+            os.path.dirname(os.path.dirname(self.mlir_translate)), 'lib')
+
+    @staticmethod
+    def _find(name, search):
+        path = shutil.which(name, path=search)
+        if not path:
+            raise ToolError('cannot find ' + name)
+        return path
+
+
+def _run(command, output=None):
+    with open(output, 'w') if output else open(os.devnull, 'w') as out:
+        result = subprocess.run(command, stdout=out,
+                                stderr=subprocess.PIPE,
+                                universal_newlines=True)
+    if result.returncode != 0:
+        raise ToolError('{} failed:\n{}'.format(
+            os.path.basename(command[0]), result.stderr))
+
+
+def compile_program(tools, path, options, work_dir):
+    """Lower a stencil file and return the path of the object file."""
+    lowered = os.path.join(work_dir, 'lowered.mlir')
+    llvm_ir = os.path.join(work_dir, 'lowered.ll')
+    obj = os.path.join(work_dir, 'lowered.o')
+    _run([tools.oec_opt] + options + [path], lowered)
+    _run([tools.mlir_translate, '--mlir-to-llvmir', lowered], llvm_ir)
+    _run([tools.llc, '-O3', '-filetype=obj', '-relocation-model=pic',
+          llvm_ir, '-o', obj])
+    return obj
+
+
+def _memref_type(argument):
+    return 'memref_{}_{}'.format(argument.element_type,
+                                 len(argument.shape))
+
+
+def generate_driver(program, backend):
+    """Return a C driver timing the C interface of a program."""
+    lines = ['#include <stdint.h>', '#include <stdio.h>',
+             '#include <stdlib.h>', '#include <time.h>', '']
+    if backend == 'cuda':
+        lines += ['#include <cuda_runtime_api.h>',
+                  '#define OEC_ALLOC(ptr, bytes) cudaMallocManaged('
+                  '(void **)&(ptr), bytes, cudaMemAttachGlobal)',
+                  '#define OEC_SYNC() cudaDeviceSynchronize()']
+    elif backend == 'rocm':
+        lines += ['#include <hip/hip_runtime_api.h>',
+                  '#define OEC_ALLOC(ptr, bytes) hipMallocManaged('
+                  '(void **)&(ptr), bytes, hipMemAttachGlobal)',
+                  '#define OEC_SYNC() hipDeviceSynchronize()']
+    else:
+        lines += ['#define OEC_ALLOC(ptr, bytes) '
+                  'posix_memalign((void **)&(ptr), 64, bytes)',
+                  '#define OEC_SYNC()']
+    lines.append('')
+
+    # Declare the memref descriptors and the program interface
+    declared = set()
+    parameters = []
+    for argument in program.arguments:
+        c_type = C_TYPES[argument.element_type]
+        if not argument.is_field:
+            parameters.append(c_type)
+            continue
+        memref = _memref_type(argument)
+        parameters.append(memref + ' *')
+        if memref in declared:
+            continue
+        declared.add(memref)
+        rank = len(argument.shape)
+        lines += ['typedef struct {',
+                  '  {} *allocated;'.format(c_type),
+                  '  {} *aligned;'.format(c_type),
+                  '  int64_t offset;']
+        if rank:
+            lines += ['  int64_t sizes[{}];'.format(rank),
+                      '  int64_t strides[{}];'.format(rank)]
+        lines += ['}} {};'.format(memref), '']
+    lines += ['void _mlir_ciface_{}({});'.format(
+        program.name, ', '.join(parameters) or 'void'), '']
+    lines += ['static int compare(const void *x, const void *y) {',
+              '  double a = *(const double *)x, b = *(const double *)y;',
+              '  return (a > b) - (a < b);', '}', '',
+              'static double now() {', '  struct timespec ts;',
+              '  clock_gettime(CLOCK_MONOTONIC, &ts);',
+              '  return ts.tv_sec * 1e3 + ts.tv_nsec * 1e-6;', '}', '']
+
+    # Allocate and initialize the fields
+    lines += ['int main(int argc, char **argv) {',
+              '  int repetitions = argc > 1 ? atoi(argv[1]) : 10;',
+              '  if (repetitions < 1)', '    repetitions = 1;']
+    arguments = []
+    for index, argument in enumerate(program.arguments):
+        c_type = C_TYPES[argument.element_type]
+        if not argument.is_field:
+            arguments.append('({})1'.format(c_type))
+            continue
+        name = 'arg{}'.format(index)
+        arguments.append('&' + name)
+        lines += ['  {} {};'.format(_memref_type(argument), name),
+                  '  OEC_ALLOC({}.allocated, {});'.format(
+                      name, argument.num_bytes()),
+                  '  {0}.aligned = {0}.allocated;'.format(name),
+                  '  {}.offset = 0;'.format(name)]
+        stride = 1
+        for dim in reversed(range(len(argument.shape))):
+            lines += ['  {}.sizes[{}] = {};'.format(
+                name, dim, argument.shape[dim]),
+                '  {}.strides[{}] = {};'.format(name, dim, stride)]
+            stride *= argument.shape[dim]
+        lines += ['  for (int64_t i = 0; i < {}; ++i)'.format(
+            argument.num_elements()),
+            '    {}.aligned[i] = ({})(1 + i % 7);'.format(name, c_type)]
+
+    # Time the program after a warm up run
+    call = '  _mlir_ciface_{}({});'.format(program.name, ', '.join(arguments))
+    lines += [call, '  OEC_SYNC();',
+              '  double *times = malloc(repetitions * sizeof(double));',
+              '  for (int r = 0; r < repetitions; ++r) {',
+              '    double start = now();', '  ' + call, '    OEC_SYNC();',
+              '    times[r] = now() - start;', '  }',
+              '  qsort(times, repetitions, sizeof(double), compare);',
+              '  printf("time_ms %.6f\\n", times[repetitions / 2]);',
+              '  printf("min_time_ms %.6f\\n", times[0]);',
+              '  return 0;', '}', '']
+    return '\n'.join(lines)
+
+
+def link_driver(tools, program, obj, backend, work_dir):
+    """Build the driver executable of a program."""
+    source = os.path.join(work_dir, 'driver.c')
+    exe = os.path.join(work_dir, 'driver')
+    with open(source, 'w') as f:
+        f.write(generate_driver(program, backend))
+    command = [tools.cc, '-O2', source, obj, '-o', exe,
+               '-L' + tools.mlir_lib_dir, '-Wl,-rpath,' + tools.mlir_lib_dir]
+    if backend == 'cuda':
+        command += ['-lcuda-runtime-wrappers', '-lcudart']
+    elif backend == 'rocm':
+        command += ['-D__HIP_PLATFORM_HCC__', '-lrocm-runtime-wrappers',
+                    '-lamdhip64']
+    else:
+        command += ['-fopenmp']
+    _run(command + ['-lm'])
+    return exe
+
+
+def run_driver(exe, repetitions):
+    """Run a driver and return the median execution time in milliseconds."""
+    result = subprocess.run([exe, str(repetitions)], stdout=subprocess.PIPE,
+                            stderr=subprocess.PIPE, universal_newlines=True)
+    if result.returncode != 0:
+        raise ToolError('running {} failed:\n{}'.format(exe, result.stderr))
+    times = dict(line.split() for line in result.stdout.splitlines()
+                 if line.count(' ') == 1)
+    if 'time_ms' not in times:
+        raise ToolError('missing time in the output of ' + exe)
+    return float(times['time_ms'])
+
+
+def measure(tools, program, options, backend, repetitions, work_dir):
+    """Compile, link, and time one variant of a program."""
+    os.makedirs(work_dir, exist_ok=True)
+    obj = compile_program(tools, program.path, options, work_dir)
+    exe = link_driver(tools, program, obj, backend, work_dir)
+    return run_driver(exe, repetitions)